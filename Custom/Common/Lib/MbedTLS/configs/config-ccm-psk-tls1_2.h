@@ -57,6 +57,7 @@
 /* TLS protocol feature support */
 #define MBEDTLS_KEY_EXCHANGE_PSK_ENABLED
 #define MBEDTLS_SSL_PROTO_TLS1_2
+#define MBEDTLS_SSL_SESSION_TICKETS /* Client side resumption with RFC 5077 tickets */
 // #define MBEDTLS_SSL_PROTO_TLS1_3
 
 /*
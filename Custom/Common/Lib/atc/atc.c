@@ -18,7 +18,7 @@
 **************    Private Definitions
 ************************************************************************************************************/
 
-// none
+#define ATC_TRIE_NONE             0xFFFF
 
 /************************************************************************************************************
 **************    Private Variables
@@ -40,6 +40,11 @@ bool              ATC_TxWait(ATC_HandleTypeDef* hAtc, uint32_t Timeout);
 void              ATC_CheckEvents(ATC_HandleTypeDef* hAtc);
 uint8_t           ATC_CheckResponse(ATC_HandleTypeDef* hAtc,char** ppFound);
 void              ATC_CheckErrors(ATC_HandleTypeDef* hAtc);
+bool              ATC_SetResponse(ATC_HandleTypeDef* hAtc, uint8_t Index, const char* pResp);
+void              ATC_ResetResponse(ATC_HandleTypeDef* hAtc);
+bool              ATC_BuildTrie(ATC_HandleTypeDef* hAtc);
+void              ATC_LineReset(ATC_HandleTypeDef* hAtc);
+void              ATC_LineDispatch(ATC_HandleTypeDef* hAtc, char* pLine);
 
 /***********************************************************************************************************/
 
@@ -85,6 +90,191 @@ void ATC_RxFlush(ATC_HandleTypeDef* hAtc)
 {
   hAtc->RxIndex = 0;
   memset(hAtc->pReadBuff, 0, hAtc->Size);
+  hAtc->ScanIndex = 0;
+  hAtc->LineStart = 0;
+  ATC_LineReset(hAtc);
+  ATC_ResetResponse(hAtc);
+}
+
+/***********************************************************************************************************/
+
+bool ATC_SetResponse(ATC_HandleTypeDef* hAtc, uint8_t Index, const char* pResp)
+{
+  // String and KMP failure table share one allocation
+  size_t len = strlen(pResp);
+  size_t offset = (len + 2) & ~(size_t)1;
+  if (len >= 0xFFFF)
+  {
+    return false;
+  }
+  hAtc->ppResp[Index] = (uint8_t*) ATC_Malloc(offset + (len * sizeof(uint16_t)));
+  if (hAtc->ppResp[Index] == NULL)
+  {
+    return false;
+  }
+  memcpy(hAtc->ppResp[Index], pResp, len + 1);
+  if (Index == 0)
+  {
+    memset(hAtc->RespChars, 0, sizeof(hAtc->RespChars));
+  }
+  for (size_t i = 0; i < len; i++)
+  {
+    hAtc->RespChars[(uint8_t)pResp[i] >> 5] |= 1UL << ((uint8_t)pResp[i] & 31);
+  }
+  uint16_t *fail = (uint16_t*) &hAtc->ppResp[Index][offset];
+  uint16_t k = 0;
+  if (len > 0)
+  {
+    fail[0] = 0;
+  }
+  for (size_t i = 1; i < len; i++)
+  {
+    while ((k > 0) && (pResp[i] != pResp[k]))
+    {
+      k = fail[k - 1];
+    }
+    if (pResp[i] == pResp[k])
+    {
+      k++;
+    }
+    fail[i] = k;
+  }
+  hAtc->ppRespFail[Index] = fail;
+  hAtc->RespLen[Index] = (uint16_t)len;
+  hAtc->RespState[Index] = 0;
+  return true;
+}
+
+/***********************************************************************************************************/
+
+void ATC_ResetResponse(ATC_HandleTypeDef* hAtc)
+{
+  hAtc->RespIndex = 0;
+  memset(hAtc->RespState, 0, sizeof(hAtc->RespState));
+}
+
+/***********************************************************************************************************/
+
+bool ATC_BuildTrie(ATC_HandleTypeDef* hAtc)
+{
+  uint32_t count = 1;
+  ATC_Free((void**)&hAtc->pTrie);
+  hAtc->TrieCount = 0;
+  for (uint32_t i = 0; i < hAtc->CmdCount; i++)
+  {
+    count += strlen(hAtc->psCmds[i].pCmd);
+  }
+  for (uint32_t i = 0; i < hAtc->EventCount; i++)
+  {
+    count += strlen(hAtc->psEvents[i].Event);
+  }
+  if ((count >= ATC_TRIE_NONE) || (hAtc->CmdCount >= 0xFFFF) || (hAtc->EventCount >= 0xFFFF))
+  {
+    return false;
+  }
+  hAtc->pTrie = (ATC_NodeTypeDef*) ATC_Malloc(count * sizeof(ATC_NodeTypeDef));
+  if (hAtc->pTrie == NULL)
+  {
+    return false;
+  }
+  memset(hAtc->pTrie, 0, count * sizeof(ATC_NodeTypeDef));
+  hAtc->TrieCount = 1;
+  for (uint32_t i = 0; i < hAtc->CmdCount + hAtc->EventCount; i++)
+  {
+    bool is_cmd = (i < hAtc->CmdCount);
+    const char *key = is_cmd ? hAtc->psCmds[i].pCmd : hAtc->psEvents[i - hAtc->CmdCount].Event;
+    uint16_t node = 0;
+    // Events are matched at line start, line breaks in front of them are never seen
+    if (!is_cmd)
+    {
+      while ((*key == '\r') || (*key == '\n'))
+      {
+        key++;
+      }
+    }
+    for (; *key != 0; key++)
+    {
+      uint16_t child = hAtc->pTrie[node].Child;
+      while ((child != 0) && (hAtc->pTrie[child].Ch != *key))
+      {
+        child = hAtc->pTrie[child].Next;
+      }
+      if (child == 0)
+      {
+        child = hAtc->TrieCount++;
+        hAtc->pTrie[child].Ch = *key;
+        hAtc->pTrie[child].Next = hAtc->pTrie[node].Child;
+        hAtc->pTrie[node].Child = child;
+      }
+      node = child;
+    }
+    // The first entry of a table wins, like the linear search did
+    if (is_cmd && (hAtc->pTrie[node].Cmd == 0))
+    {
+      hAtc->pTrie[node].Cmd = i + 1;
+    }
+    else if (!is_cmd && (hAtc->pTrie[node].Event == 0))
+    {
+      hAtc->pTrie[node].Event = i - hAtc->CmdCount + 1;
+    }
+  }
+  ATC_LineReset(hAtc);
+  return true;
+}
+
+/***********************************************************************************************************/
+
+void ATC_LineReset(ATC_HandleTypeDef* hAtc)
+{
+  if (hAtc->pTrie != NULL)
+  {
+    hAtc->LineNode = 0;
+    hAtc->LineCmd = hAtc->pTrie[0].Cmd;
+    hAtc->LineEvent = hAtc->pTrie[0].Event;
+  }
+  else
+  {
+    hAtc->LineNode = ATC_TRIE_NONE;
+    hAtc->LineCmd = 0;
+    hAtc->LineEvent = 0;
+  }
+}
+
+/***********************************************************************************************************/
+
+void ATC_LineDispatch(ATC_HandleTypeDef* hAtc, char* pLine)
+{
+  if (hAtc->LineCmd != 0)
+  {
+    // Extract arguments (e.g., "ON" from "AT+LED=ON")
+    const ATC_CmdTypeDef *cmd = &hAtc->psCmds[hAtc->LineCmd - 1];
+    const char *args = pLine + strlen(cmd->pCmd);
+    char response[64];
+    cmd->CmdCallback(args, response);
+    // Send response (use TX buffer)
+    snprintf((char*) hAtc->pTxBuff, hAtc->Size, "%s\r\n", response);
+    ATC_TxRaw(hAtc, hAtc->pTxBuff, strlen((char*) hAtc->pTxBuff));
+  }
+  else if (hAtc->LineEvent != 0)
+  {
+    // Point at the line break too when the event was registered with it, as strstr did
+    const ATC_EventTypeDef *ev = &hAtc->psEvents[hAtc->LineEvent - 1];
+    const char *key = ev->Event;
+    while ((*key == '\r') || (*key == '\n'))
+    {
+      key++;
+    }
+    for (const char *k = key; (k > ev->Event) && (pLine > (char*)hAtc->pReadBuff) && (pLine[-1] == k[-1]); k--)
+    {
+      pLine--;
+    }
+    ev->EventCallback(pLine);
+  }
+  else
+  {
+    snprintf((char*) hAtc->pTxBuff, hAtc->Size, "%s\r\n", "+ERROR");
+    ATC_TxRaw(hAtc, hAtc->pTxBuff, strlen((char*) hAtc->pTxBuff));
+  }
 }
 
 /***********************************************************************************************************/
@@ -163,48 +353,66 @@ bool ATC_TxWait(ATC_HandleTypeDef* hAtc, uint32_t Timeout)
 
 void ATC_CheckEvents(ATC_HandleTypeDef* hAtc)
 {
-  if (hAtc->RxIndex > 0)
+  // Consume each byte once: complete lines are dispatched, a partial line keeps its trie position
+  uint16_t end = hAtc->RxIndex;
+  char *rx_data = (char*) hAtc->pReadBuff;
+  if (hAtc->ScanIndex > end)
   {
-    char *rx_data = (char*) hAtc->pReadBuff;
-    bool command_processed = false;
-    bool event_processed = false;
-    // 1. Check for AT commands first
-    for (uint32_t i = 0; i < hAtc->CmdCount; i++)
+    hAtc->ScanIndex = 0;
+    hAtc->LineStart = 0;
+    ATC_LineReset(hAtc);
+  }
+  for (uint16_t pos = hAtc->ScanIndex; pos < end; pos++)
+  {
+    char ch = rx_data[pos];
+    if ((ch == '\r') || (ch == '\n'))
     {
-      const char *prefix = hAtc->psCmds[i].pCmd;
-      if (strncmp(rx_data, prefix, strlen(prefix)) == 0)
+      if (pos > hAtc->LineStart)
       {
-        // Extract arguments (e.g., "ON" from "AT+LED=ON")
-        const char *args = rx_data + strlen(prefix);
-        char response[64];
-        hAtc->psCmds[i].CmdCallback(args, response);
-        // Send response (use TX buffer)
-        snprintf((char*) hAtc->pTxBuff, hAtc->Size, "%s\r\n", response);
-        ATC_TxRaw(hAtc, hAtc->pTxBuff, strlen((char*) hAtc->pTxBuff));
-        command_processed = true;
-        break;
+        ATC_LineDispatch(hAtc, &rx_data[hAtc->LineStart]);
       }
+      hAtc->LineStart = pos + 1;
+      ATC_LineReset(hAtc);
+      continue;
     }
-    // 2. If no command matched, check for events (original behavior)
-    if (!command_processed)
+    if (hAtc->LineNode == ATC_TRIE_NONE)
     {
-      for (uint32_t ev = 0; ev < hAtc->EventCount; ev++)
-      {
-        char *found = strstr(rx_data, hAtc->psEvents[ev].Event);
-        if (found != NULL)
-        {
-          hAtc->psEvents[ev].EventCallback(found);
-          event_processed = true;
-          break;
-        }
-      }
+      continue;
     }
-    if ((!command_processed) && (!event_processed))
+    uint16_t child = hAtc->pTrie[hAtc->LineNode].Child;
+    while ((child != 0) && (hAtc->pTrie[child].Ch != ch))
     {
-      snprintf((char*) hAtc->pTxBuff, hAtc->Size, "%s\r\n", "+ERROR");
-      ATC_TxRaw(hAtc, hAtc->pTxBuff, strlen((char*) hAtc->pTxBuff));
+      child = hAtc->pTrie[child].Next;
     }
-    ATC_RxFlush(hAtc); // Clear buffer after processing
+    if (child == 0)
+    {
+      hAtc->LineNode = ATC_TRIE_NONE;
+      continue;
+    }
+    hAtc->LineNode = child;
+    // Keep the lowest table index among all prefixes of the line
+    uint16_t cmd = hAtc->pTrie[child].Cmd;
+    uint16_t ev = hAtc->pTrie[child].Event;
+    if ((cmd != 0) && ((hAtc->LineCmd == 0) || (cmd < hAtc->LineCmd)))
+    {
+      hAtc->LineCmd = cmd;
+    }
+    if ((ev != 0) && ((hAtc->LineEvent == 0) || (ev < hAtc->LineEvent)))
+    {
+      hAtc->LineEvent = ev;
+    }
+  }
+  hAtc->ScanIndex = end;
+  if ((hAtc->LineStart < end) && (end >= hAtc->Size))
+  {
+    // Buffer full without a line break, take what we have
+    ATC_LineDispatch(hAtc, &rx_data[hAtc->LineStart]);
+    hAtc->LineStart = end;
+  }
+  // Only flush when nothing is pending and no new data arrived meanwhile
+  if ((end > 0) && (hAtc->LineStart == end) && (hAtc->RxIndex == end))
+  {
+    ATC_RxFlush(hAtc);
   }
 }
 
@@ -212,24 +420,74 @@ void ATC_CheckEvents(ATC_HandleTypeDef* hAtc)
 
 uint8_t ATC_CheckResponse(ATC_HandleTypeDef* hAtc, char** ppFound)
 {
+  // Only bytes received since the last call are scanned, the KMP states carry over
   uint8_t index = 0;
-  if (hAtc->RxIndex > 0)
+  uint16_t end = hAtc->RxIndex;
+  const uint8_t *rx_data = hAtc->pReadBuff;
+  if (hAtc->RespIndex > end)
+  {
+    ATC_ResetResponse(hAtc);
+  }
+  if (end > 0)
   {
     for (uint16_t i = 0; i < hAtc->RespCount; i++)
     {
-      char *found = strstr((char*)hAtc->pReadBuff, (char*)hAtc->ppResp[i]);
-      if (found != NULL)
+      if (hAtc->RespLen[i] == 0)
       {
-        if (ppFound != NULL)
-        {
-          // *ppFound = found;
-          *ppFound = (char*)hAtc->pReadBuff;
-        }
         index = i + 1;
         break;
       }
     }
   }
+  bool active = true;
+  for (uint16_t pos = hAtc->RespIndex; (pos < end) && (index != 1); pos++)
+  {
+    uint8_t ch = rx_data[pos];
+    if ((hAtc->RespChars[ch >> 5] & (1UL << (ch & 31))) == 0)
+    {
+      // A byte outside every item breaks all partial matches
+      if (active)
+      {
+        memset(hAtc->RespState, 0, sizeof(hAtc->RespState));
+        active = false;
+      }
+      continue;
+    }
+    active = true;
+    for (uint16_t i = 0; i < hAtc->RespCount; i++)
+    {
+      const uint8_t *resp = hAtc->ppResp[i];
+      const uint16_t *fail = hAtc->ppRespFail[i];
+      uint16_t k = hAtc->RespState[i];
+      if (hAtc->RespLen[i] == 0)
+      {
+        continue;
+      }
+      while ((k > 0) && (ch != resp[k]))
+      {
+        k = fail[k - 1];
+      }
+      if (ch == resp[k])
+      {
+        k++;
+      }
+      if (k == hAtc->RespLen[i])
+      {
+        // Several items may end in the same chunk, the lowest index wins like before
+        if ((index == 0) || (i + 1 < index))
+        {
+          index = i + 1;
+        }
+        k = fail[k - 1];
+      }
+      hAtc->RespState[i] = k;
+    }
+  }
+  hAtc->RespIndex = end;
+  if ((index != 0) && (ppFound != NULL))
+  {
+    *ppFound = (char*)hAtc->pReadBuff;
+  }
   return index;
 }
 
@@ -314,6 +572,7 @@ bool ATC_Init(ATC_HandleTypeDef* hAtc, UART_HandleTypeDef* hUart, uint16_t Buffe
       break;
     }
     hAtc->Size = BufferSize;
+    ATC_LineReset(hAtc);
     __HAL_UART_CLEAR_FLAG(hAtc->hUart, 0xFFFFFFFF);
     if (HAL_UARTEx_ReceiveToIdle_DMA(hAtc->hUart, hAtc->pRxBuff, hAtc->Size) != HAL_OK)
     {
@@ -332,6 +591,10 @@ bool ATC_Init(ATC_HandleTypeDef* hAtc, UART_HandleTypeDef* hUart, uint16_t Buffe
     {
       ATC_Free((void**)&hAtc->pRxBuff);
     }
+    if (hAtc->pTxBuff != NULL)
+    {
+      ATC_Free((void**)&hAtc->pTxBuff);
+    }
     if (hAtc->pReadBuff != NULL)
     {
       ATC_Free((void**)&hAtc->pReadBuff);
@@ -365,7 +628,9 @@ void ATC_DeInit(ATC_HandleTypeDef* hAtc)
       break;
     }
     ATC_Free((void**)&hAtc->pRxBuff);
+    ATC_Free((void**)&hAtc->pTxBuff);
     ATC_Free((void**)&hAtc->pReadBuff);
+    ATC_Free((void**)&hAtc->pTrie);
     memset(hAtc, 0, sizeof(ATC_HandleTypeDef));
 
   } while (0);
@@ -399,7 +664,7 @@ bool ATC_SetEvents(ATC_HandleTypeDef* hAtc, const ATC_EventTypeDef* psEvents)
     }
     hAtc->psEvents = (ATC_EventTypeDef*)psEvents;
     hAtc->EventCount = ev;
-    answer = true;
+    answer = ATC_BuildTrie(hAtc);
 
   } while (0);
 
@@ -431,7 +696,7 @@ bool ATC_SetCommands(ATC_HandleTypeDef *hAtc, const ATC_CmdTypeDef *psCmds)
     }
     hAtc->psCmds = (ATC_CmdTypeDef*) psCmds;
     hAtc->CmdCount = cmd;
-    answer = true;
+    answer = ATC_BuildTrie(hAtc);
 
   } while (0);
 
@@ -481,19 +746,18 @@ int ATC_SendReceive(ATC_HandleTypeDef* hAtc, const char* pCommand, uint32_t TxTi
   for (int i = 0; i < Items; i++)
   {
     char *arg = va_arg(args, char*);
-    hAtc->ppResp[i] = (uint8_t*) ATC_Malloc(strlen(arg) + 1);
-    if (hAtc->ppResp[i] == NULL)
+    if (ATC_SetResponse(hAtc, i, arg) == false)
     {
+      va_end(args);
       for (uint8_t j = 0; j < i; j++)
       {
         ATC_Free((void**)&hAtc->ppResp[j]);
       }
       return ATC_RESP_MEM_ERROR;
     }
-    strcpy((char*) hAtc->ppResp[i], arg);
-    hAtc->ppResp[i][strlen(arg)] = 0;
   }
   va_end(args);
+  ATC_ResetResponse(hAtc);
 
   if (pCommand != NULL) {
     do
@@ -604,19 +868,18 @@ int ATC_Receive(ATC_HandleTypeDef *hAtc, char **ppResp, uint32_t RxTimeout, uint
   for (int i = 0; i < Items; i++)
   {
     char *arg = va_arg(args, char*);
-    hAtc->ppResp[i] = (uint8_t*) ATC_Malloc(strlen(arg) + 1);
-    if (hAtc->ppResp[i] == NULL)
+    if (ATC_SetResponse(hAtc, i, arg) == false)
     {
+      va_end(args);
       for (uint8_t j = 0; j < i; j++)
       {
         ATC_Free((void**)&hAtc->ppResp[j]);
       }
       return ATC_RESP_MEM_ERROR;
     }
-    strcpy((char*) hAtc->ppResp[i], arg);
-    hAtc->ppResp[i][strlen(arg)] = 0;
   }
   va_end(args);
+  ATC_ResetResponse(hAtc);
 
   if (Items > 0)
   {
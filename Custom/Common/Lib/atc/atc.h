@@ -9,10 +9,14 @@
   Youtube:    https://www.youtube.com/@nimaltd
   Instagram:  https://instagram.com/github.NimaLTD
 
-  Version:    4.3.0
+  Version:    4.4.0
 
   History:
 
+              4.4.0
+              - Incremental response matching, each received byte is scanned once
+              - Line based event/command parser with a prefix trie
+
               4.3.0
               - Added Command callback
 
@@ -131,6 +135,16 @@ typedef struct
 
 } ATC_EventTypeDef;
 
+typedef struct
+{
+  char                       Ch;
+  uint16_t                   Cmd;        // command index + 1 ending at this node, 0 if none
+  uint16_t                   Event;      // event index + 1 ending at this node, 0 if none
+  uint16_t                   Child;      // first child, 0 if none (root is never a child)
+  uint16_t                   Next;       // next sibling, 0 if none
+
+} ATC_NodeTypeDef;
+
 typedef struct
 {
   UART_HandleTypeDef*        hUart;
@@ -147,6 +161,18 @@ typedef struct
   uint8_t*                   pTxBuff;
   uint8_t*                   pReadBuff;
   uint8_t*                   ppResp[ATC_RESP_MAX];
+  uint16_t*                  ppRespFail[ATC_RESP_MAX];   // KMP failure table, stored behind the string
+  uint16_t                   RespLen[ATC_RESP_MAX];
+  uint16_t                   RespState[ATC_RESP_MAX];    // matched length of each response so far
+  uint16_t                   RespIndex;                  // next byte for the response matcher
+  uint32_t                   RespChars[8];               // bytes that occur in any expected response
+  ATC_NodeTypeDef*           pTrie;                      // command and event prefixes, node 0 is root
+  uint16_t                   TrieCount;
+  uint16_t                   ScanIndex;                  // next byte for the line parser
+  uint16_t                   LineStart;
+  uint16_t                   LineNode;                   // trie position in the current line
+  uint16_t                   LineCmd;                    // best command match in the current line
+  uint16_t                   LineEvent;                  // best event match in the current line
 
 } ATC_HandleTypeDef;
 
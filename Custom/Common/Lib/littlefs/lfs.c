@@ -668,6 +668,34 @@ static int lfs_alloc(lfs_t *lfs, lfs_block_t *block) {
         while (lfs->lookahead.next < lfs->lookahead.size) {
             if (!(lfs->lookahead.buffer[lfs->lookahead.next / 8]
                     & (1U << (lfs->lookahead.next % 8)))) {
+                // prefer a less worn free block further in the window, it is
+                // marked in use so the sequential scan below steps over it
+                if (lfs->cfg->wear) {
+                    lfs_block_t best = lfs->lookahead.next;
+                    uint32_t best_wear = lfs->cfg->wear(lfs->cfg,
+                            (lfs->lookahead.start + best) % lfs->block_count);
+                    for (lfs_block_t off = best + 1;
+                            off < lfs->lookahead.size && best_wear > 0;
+                            off++) {
+                        if (lfs->lookahead.buffer[off / 8] & (1U << (off % 8))) {
+                            continue;
+                        }
+                        uint32_t wear = lfs->cfg->wear(lfs->cfg,
+                                (lfs->lookahead.start + off) % lfs->block_count);
+                        if (wear < best_wear) {
+                            best = off;
+                            best_wear = wear;
+                        }
+                    }
+
+                    if (best != lfs->lookahead.next) {
+                        lfs->lookahead.buffer[best / 8] |= 1U << (best % 8);
+                        *block = (lfs->lookahead.start + best)
+                                % lfs->block_count;
+                        return 0;
+                    }
+                }
+
                 // found a free block
                 *block = (lfs->lookahead.start + lfs->lookahead.next)
                         % lfs->block_count;
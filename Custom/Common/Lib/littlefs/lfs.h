@@ -180,6 +180,11 @@ struct lfs_config {
     // are propagated to the user.
     int (*sync)(const struct lfs_config *c);
 
+    // Optional wear of a block, typically its erase count. When provided the
+    // allocator picks the least worn free block of the lookahead window
+    // instead of the first one. May be NULL.
+    uint32_t (*wear)(const struct lfs_config *c, lfs_block_t block);
+
 #ifdef LFS_THREADSAFE
     // Lock the underlying block device. Negative error codes
     // are propagated to the user.
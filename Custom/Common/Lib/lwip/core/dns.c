@@ -1657,4 +1657,37 @@ dns_gethostbyname_addrtype(const char *hostname, ip_addr_t *addr, dns_found_call
                      LWIP_DNS_ISMDNS_ARG(is_mdns));
 }
 
+/**
+ * @ingroup dns
+ * Get the remaining time to live of a hostname resolved into the dns_table.
+ * Can be used from a dns_found_callback to learn the TTL of the answer.
+ *
+ * @param hostname the hostname that was queried
+ * @param ttl pointer to store the remaining TTL in seconds
+ * @return ERR_OK if the hostname is in the dns_table, ERR_ARG otherwise
+ */
+err_t
+dns_gethostttl(const char *hostname, u32_t *ttl)
+{
+  size_t namelen;
+  u8_t i;
+
+  if ((hostname == NULL) || (ttl == NULL)) {
+    return ERR_ARG;
+  }
+  namelen = strlen(hostname);
+  if (namelen >= DNS_MAX_NAME_LENGTH) {
+    return ERR_ARG;
+  }
+  for (i = 0; i < DNS_TABLE_SIZE; ++i) {
+    if ((dns_table[i].state == DNS_STATE_DONE) &&
+        (lwip_strnicmp(hostname, dns_table[i].name, namelen) == 0) &&
+        !dns_table[i].name[namelen]) {
+      *ttl = dns_table[i].ttl;
+      return ERR_OK;
+    }
+  }
+  return ERR_ARG;
+}
+
 #endif /* LWIP_DNS */
@@ -108,7 +108,6 @@
 #include "lwip/timeouts.h"
 #include "netif/etharp.h"
 
-#include <limits.h>
 #include <string.h>
 
 /** Define this to enable debug output of this module */
@@ -116,17 +115,41 @@
 #define NAT_DEBUG      LWIP_DBG_OFF
 #endif
 
-#define LWIP_NAT_TTL_INFINITE                    (INT_MAX)
 #define LWIP_NAT_DEFAULT_TTL_SECONDS             (128)
 #define LWIP_NAT_FORWARD_HEADER_SIZE_MIN         (sizeof(struct eth_hdr))
 
+/* State table sizes, override in lwipopts.h */
+#ifndef LWIP_NAT_DEFAULT_STATE_TABLES_ICMP
 #define LWIP_NAT_DEFAULT_STATE_TABLES_ICMP       (16)
+#endif
+#ifndef LWIP_NAT_DEFAULT_STATE_TABLES_TCP
 #define LWIP_NAT_DEFAULT_STATE_TABLES_TCP        (256)
+#endif
+#ifndef LWIP_NAT_DEFAULT_STATE_TABLES_UDP
 #define LWIP_NAT_DEFAULT_STATE_TABLES_UDP        (256)
+#endif
+
+/* Hash buckets per state table, any value > 0 */
+#ifndef LWIP_NAT_HASH_BUCKETS_ICMP
+#define LWIP_NAT_HASH_BUCKETS_ICMP               LWIP_NAT_DEFAULT_STATE_TABLES_ICMP
+#endif
+#ifndef LWIP_NAT_HASH_BUCKETS_TCP
+#define LWIP_NAT_HASH_BUCKETS_TCP                LWIP_NAT_DEFAULT_STATE_TABLES_TCP
+#endif
+#ifndef LWIP_NAT_HASH_BUCKETS_UDP
+#define LWIP_NAT_HASH_BUCKETS_UDP                LWIP_NAT_DEFAULT_STATE_TABLES_UDP
+#endif
 
 #define LWIP_NAT_DEFAULT_TCP_SOURCE_PORT         (40000)
 #define LWIP_NAT_DEFAULT_UDP_SOURCE_PORT         (40000)
 
+/* The translated port is source port + slot, incoming packets index the slot with it */
+#if (LWIP_NAT_DEFAULT_TCP_SOURCE_PORT + LWIP_NAT_DEFAULT_STATE_TABLES_TCP > 65536) || \
+    (LWIP_NAT_DEFAULT_UDP_SOURCE_PORT + LWIP_NAT_DEFAULT_STATE_TABLES_UDP > 65536) || \
+    (LWIP_NAT_DEFAULT_STATE_TABLES_ICMP >= 65535)
+#error "NAT state tables too large"
+#endif
+
 #define IPNAT_ENTRY_RESET(x) do { \
   (x)->ttl = 0; \
 } while(0)
@@ -139,10 +162,13 @@ typedef struct ip4_nat_conf
 
 typedef struct ip4_nat_entry_common
 {
-  s32_t           ttl; /* @todo: do we really need this to be signed?? */
+  s32_t           ttl; /* expiry on ip4_nat_clock, 0 while the slot is free */
   ip4_addr_t       source;
   ip4_addr_t       dest;
   ip4_nat_conf_t   *cfg;
+  u16_t            hash_next; /* next in bucket or free list, slot + 1, 0 ends the chain */
+  u16_t            lru_prev;  /* towards the most recently used entry, slot + 1 */
+  u16_t            lru_next;  /* towards the least recently used entry, slot + 1 */
 } ip4_nat_entry_common_t;
 
 typedef struct ip4_nat_entries_icmp
@@ -176,10 +202,51 @@ typedef union u_nat_entry
   ip4_nat_entries_udp_t  *udp;
 } nat_entry_t;
 
+/** One state table: slots of a protocol entry type, hashed on the key the
+ * lookup needs and kept in least recently used order for eviction. */
+typedef struct ip4_nat_table
+{
+  u8_t    *entries;
+  u16_t    entry_size;
+  u16_t    size;
+  u16_t   *buckets;      /* slot + 1 of the first entry, 0 if empty */
+  u16_t    bucket_count;
+  u16_t    lru_head;     /* most recently used, slot + 1 */
+  u16_t    lru_tail;     /* eviction candidate, slot + 1 */
+  u16_t    free_head;    /* unused slots chained through hash_next */
+  u32_t  (*hash)(const ip4_nat_entry_common_t *entry);
+} ip4_nat_table_t;
+
+#define IP4_NAT_TABLE_ENTRY(t, i) \
+  ((ip4_nat_entry_common_t *)(void *)((t)->entries + (size_t)(i) * (t)->entry_size))
+#define IP4_NAT_TABLE_SLOT(t, e) \
+  ((u16_t)(((const u8_t *)(e) - (t)->entries) / (t)->entry_size))
+
+static u32_t ip4_nat_icmp_hash(const ip4_nat_entry_common_t *entry);
+static u32_t ip4_nat_tcp_hash(const ip4_nat_entry_common_t *entry);
+static u32_t ip4_nat_udp_hash(const ip4_nat_entry_common_t *entry);
+
 static ip4_nat_conf_t *ip4_nat_cfg = NULL;
 static ip4_nat_entries_icmp_t ip4_nat_icmp_table[LWIP_NAT_DEFAULT_STATE_TABLES_ICMP];
 static ip4_nat_entries_tcp_t ip4_nat_tcp_table[LWIP_NAT_DEFAULT_STATE_TABLES_TCP];
 static ip4_nat_entries_udp_t ip4_nat_udp_table[LWIP_NAT_DEFAULT_STATE_TABLES_UDP];
+static u16_t ip4_nat_icmp_buckets[LWIP_NAT_HASH_BUCKETS_ICMP];
+static u16_t ip4_nat_tcp_buckets[LWIP_NAT_HASH_BUCKETS_TCP];
+static u16_t ip4_nat_udp_buckets[LWIP_NAT_HASH_BUCKETS_UDP];
+
+/* ICMP is hashed on the reply key, TCP and UDP on the outgoing key */
+static ip4_nat_table_t ip4_nat_icmp = {
+  (u8_t *)ip4_nat_icmp_table, sizeof(ip4_nat_entries_icmp_t), LWIP_NAT_DEFAULT_STATE_TABLES_ICMP,
+  ip4_nat_icmp_buckets, LWIP_NAT_HASH_BUCKETS_ICMP, 0, 0, 0, ip4_nat_icmp_hash
+};
+static ip4_nat_table_t ip4_nat_tcp = {
+  (u8_t *)ip4_nat_tcp_table, sizeof(ip4_nat_entries_tcp_t), LWIP_NAT_DEFAULT_STATE_TABLES_TCP,
+  ip4_nat_tcp_buckets, LWIP_NAT_HASH_BUCKETS_TCP, 0, 0, 0, ip4_nat_tcp_hash
+};
+static ip4_nat_table_t ip4_nat_udp = {
+  (u8_t *)ip4_nat_udp_table, sizeof(ip4_nat_entries_udp_t), LWIP_NAT_DEFAULT_STATE_TABLES_UDP,
+  ip4_nat_udp_buckets, LWIP_NAT_HASH_BUCKETS_UDP, 0, 0, 0, ip4_nat_udp_hash
+};
 
 /* ----------------------- Static functions (COMMON) --------------------*/
 static void     ip4_nat_chksum_adjust(u8_t *chksum, const u8_t *optr, s16_t olen, const u8_t *nptr, s16_t nlen);
@@ -234,25 +301,197 @@ nat_timer(void *arg)
   sys_timeout(LWIP_NAT_TMR_INTERVAL_SEC * 1000, nat_timer, NULL);
 }
 
+/** Seconds counted by the NAT timer. An entry expires once the clock reaches
+ * its ttl; every use sets the same lifetime and moves the entry to the LRU
+ * head, so expiry times only grow from the tail to the head. */
+static u32_t ip4_nat_clock;
+
+/** Mix a connection key into a bucket hash */
+static u32_t
+ip4_nat_hash(u32_t a, u32_t b, u32_t c)
+{
+  u32_t h = a ^ (b * 0x9E3779B1UL) ^ (c * 0x85EBCA6BUL);
+  h ^= h >> 16;
+  h *= 0x7FEB352DUL;
+  h ^= h >> 15;
+  return h;
+}
+
+static u32_t
+ip4_nat_icmp_hash(const ip4_nat_entry_common_t *entry)
+{
+  const ip4_nat_entries_icmp_t *icmp = (const ip4_nat_entries_icmp_t *)entry;
+  return ip4_nat_hash(entry->dest.addr, 0, ((u32_t)icmp->id << 16) | icmp->seqno);
+}
+
+static u32_t
+ip4_nat_tcp_hash(const ip4_nat_entry_common_t *entry)
+{
+  const ip4_nat_entries_tcp_t *tcp = (const ip4_nat_entries_tcp_t *)entry;
+  return ip4_nat_hash(entry->source.addr, entry->dest.addr, ((u32_t)tcp->sport << 16) | tcp->dport);
+}
+
+static u32_t
+ip4_nat_udp_hash(const ip4_nat_entry_common_t *entry)
+{
+  const ip4_nat_entries_udp_t *udp = (const ip4_nat_entries_udp_t *)entry;
+  return ip4_nat_hash(entry->source.addr, entry->dest.addr, ((u32_t)udp->sport << 16) | udp->dport);
+}
+
+/** Put every slot of a table on its free list */
+static void
+ip4_nat_table_init(ip4_nat_table_t *t)
+{
+  u16_t i;
+
+  memset(t->buckets, 0, t->bucket_count * sizeof(u16_t));
+  for (i = 0; i < t->size; i++) {
+    ip4_nat_entry_common_t *entry = IP4_NAT_TABLE_ENTRY(t, i);
+    IPNAT_ENTRY_RESET(entry);
+    entry->lru_prev = 0;
+    entry->lru_next = 0;
+    entry->hash_next = (i + 1 < t->size) ? (u16_t)(i + 2) : 0;
+  }
+  t->free_head = (t->size > 0) ? 1 : 0;
+  t->lru_head = 0;
+  t->lru_tail = 0;
+}
+
+static void
+ip4_nat_lru_unlink(ip4_nat_table_t *t, ip4_nat_entry_common_t *entry)
+{
+  if (entry->lru_prev) {
+    IP4_NAT_TABLE_ENTRY(t, entry->lru_prev - 1)->lru_next = entry->lru_next;
+  } else {
+    t->lru_head = entry->lru_next;
+  }
+  if (entry->lru_next) {
+    IP4_NAT_TABLE_ENTRY(t, entry->lru_next - 1)->lru_prev = entry->lru_prev;
+  } else {
+    t->lru_tail = entry->lru_prev;
+  }
+  entry->lru_prev = 0;
+  entry->lru_next = 0;
+}
+
+static void
+ip4_nat_lru_push(ip4_nat_table_t *t, ip4_nat_entry_common_t *entry)
+{
+  u16_t slot = IP4_NAT_TABLE_SLOT(t, entry) + 1;
+
+  entry->lru_prev = 0;
+  entry->lru_next = t->lru_head;
+  if (t->lru_head) {
+    IP4_NAT_TABLE_ENTRY(t, t->lru_head - 1)->lru_prev = slot;
+  } else {
+    t->lru_tail = slot;
+  }
+  t->lru_head = slot;
+}
+
+/** Mark an entry as used by a packet: refresh its ttl and move it to the
+ * head of the eviction order */
+static void
+ip4_nat_table_touch(ip4_nat_table_t *t, ip4_nat_entry_common_t *entry)
+{
+  entry->ttl = (s32_t)(ip4_nat_clock + LWIP_NAT_DEFAULT_TTL_SECONDS);
+  if (t->lru_head != IP4_NAT_TABLE_SLOT(t, entry) + 1) {
+    ip4_nat_lru_unlink(t, entry);
+    ip4_nat_lru_push(t, entry);
+  }
+}
+
+/** Insert an entry whose key fields are set into its bucket */
+static void
+ip4_nat_table_link(ip4_nat_table_t *t, ip4_nat_entry_common_t *entry)
+{
+  u16_t bucket = (u16_t)(t->hash(entry) % t->bucket_count);
+
+  entry->hash_next = t->buckets[bucket];
+  t->buckets[bucket] = IP4_NAT_TABLE_SLOT(t, entry) + 1;
+  ip4_nat_lru_push(t, entry);
+}
+
+/** Remove an entry from its bucket and the eviction order, and free the slot */
+static void
+ip4_nat_table_release(ip4_nat_table_t *t, ip4_nat_entry_common_t *entry)
+{
+  u16_t slot = IP4_NAT_TABLE_SLOT(t, entry) + 1;
+  u16_t *link = &t->buckets[t->hash(entry) % t->bucket_count];
+
+  while (*link && *link != slot) {
+    link = &IP4_NAT_TABLE_ENTRY(t, *link - 1)->hash_next;
+  }
+  if (*link == slot) {
+    *link = entry->hash_next;
+  }
+  ip4_nat_lru_unlink(t, entry);
+  IPNAT_ENTRY_RESET(entry);
+  entry->hash_next = t->free_head;
+  t->free_head = slot;
+}
+
+/** Take a free slot, evicting the least recently used entry when the table
+ * is full. The caller fills in the key and calls ip4_nat_table_link().
+ *
+ * @return the slot's entry or NULL if the table has no slots at all
+ */
+static ip4_nat_entry_common_t *
+ip4_nat_table_alloc(ip4_nat_table_t *t)
+{
+  ip4_nat_entry_common_t *entry;
+
+  if (!t->free_head) {
+    if (!t->lru_tail) {
+      return NULL;
+    }
+    LWIP_DEBUGF(NAT_DEBUG, ("ip4_nat_table_alloc: table full, evicting slot %" U16_F "\n", (u16_t)(t->lru_tail - 1)));
+    ip4_nat_table_release(t, IP4_NAT_TABLE_ENTRY(t, t->lru_tail - 1));
+  }
+  entry = IP4_NAT_TABLE_ENTRY(t, t->free_head - 1);
+  t->free_head = entry->hash_next;
+  entry->hash_next = 0;
+  return entry;
+}
+
+/** Free the expired entries of a table, walking from the LRU tail up to the
+ * first entry that is still alive */
+static void
+ip4_nat_table_tmr(ip4_nat_table_t *t)
+{
+  while (t->lru_tail) {
+    ip4_nat_entry_common_t *entry = IP4_NAT_TABLE_ENTRY(t, t->lru_tail - 1);
+    if ((s32_t)((u32_t)entry->ttl - ip4_nat_clock) > 0) {
+      break;
+    }
+    ip4_nat_table_release(t, entry);
+  }
+}
+
+/** Free all entries of a table created through a NAT configuration */
+static void
+ip4_nat_table_reset_cfg(ip4_nat_table_t *t, ip4_nat_conf_t *cfg)
+{
+  u16_t i;
+
+  for (i = 0; i < t->size; i++) {
+    ip4_nat_entry_common_t *entry = IP4_NAT_TABLE_ENTRY(t, i);
+    if (entry->ttl && (entry->cfg == cfg)) {
+      ip4_nat_table_release(t, entry);
+    }
+  }
+}
+
 /** Initialize this module */
 void
 ip4_nat_init(void)
 {
-  int i;
   extern void lwip_ip_input_set_hook(int (*hook)(struct pbuf *p, struct netif *inp));
   SYS_ARCH_DECL_PROTECT(lev);
 
-  /* @todo: this can be omitted since we trust static variables
-            to be initialized to zero */
-  for (i = 0; i < LWIP_NAT_DEFAULT_STATE_TABLES_ICMP; i++) {
-    IPNAT_ENTRY_RESET(&ip4_nat_icmp_table[i].common);
-  }
-  for (i = 0; i < LWIP_NAT_DEFAULT_STATE_TABLES_TCP; i++) {
-    IPNAT_ENTRY_RESET(&ip4_nat_tcp_table[i].common);
-  }
-  for (i = 0; i < LWIP_NAT_DEFAULT_STATE_TABLES_UDP; i++) {
-    IPNAT_ENTRY_RESET(&ip4_nat_udp_table[i].common);
-  }
+  ip4_nat_table_init(&ip4_nat_icmp);
+  ip4_nat_table_init(&ip4_nat_tcp);
+  ip4_nat_table_init(&ip4_nat_udp);
 
   /* we must lock scheduler to protect following code */
   SYS_ARCH_PROTECT(lev);
@@ -363,25 +602,9 @@ ip4_nat_remove(const ip4_nat_entry_t *remove_entry)
 static void
 ip4_nat_reset_state(ip4_nat_conf_t *cfg)
 {
-  int i;
-
-  /* @todo: optimize this!!!
-     why do we search for it anyway, if we have the pointer??? */
-  for (i = 0; i < LWIP_NAT_DEFAULT_STATE_TABLES_ICMP; i++) {
-    if(ip4_nat_icmp_table[i].common.cfg == cfg) {
-      IPNAT_ENTRY_RESET(&ip4_nat_icmp_table[i].common);
-    }
-  }
-  for (i = 0; i < LWIP_NAT_DEFAULT_STATE_TABLES_TCP; i++) {
-    if(ip4_nat_tcp_table[i].common.cfg == cfg) {
-      IPNAT_ENTRY_RESET(&ip4_nat_tcp_table[i].common);
-    }
-  }
-  for (i = 0; i < LWIP_NAT_DEFAULT_STATE_TABLES_UDP; i++) {
-    if(ip4_nat_udp_table[i].common.cfg == cfg) {
-      IPNAT_ENTRY_RESET(&ip4_nat_udp_table[i].common);
-    }
-  }
+  ip4_nat_table_reset_cfg(&ip4_nat_icmp, cfg);
+  ip4_nat_table_reset_cfg(&ip4_nat_tcp, cfg);
+  ip4_nat_table_reset_cfg(&ip4_nat_udp, cfg);
 }
 
 /** Check if this packet should be routed or should be translated
@@ -449,7 +672,6 @@ ip4_nat_input(struct pbuf *p)
   nat_entry_t           nat_entry;
   err_t                 err;
   u8_t                  consumed = 0;
-  int                   i;
   struct pbuf          *q = NULL;
 
   nat_entry.cmn = NULL;
@@ -464,7 +686,7 @@ ip4_nat_input(struct pbuf *p)
         nat_entry.tcp = ip4_nat_tcp_lookup_incoming(iphdr, tcphdr);
         if (nat_entry.tcp != NULL) {
           /* Refresh TCP entry */
-          nat_entry.tcp->common.ttl = LWIP_NAT_DEFAULT_TTL_SECONDS;
+          ip4_nat_table_touch(&ip4_nat_tcp, nat_entry.cmn);
           tcphdr->dest = nat_entry.tcp->sport;
           /* Adjust TCP checksum for changed destination port */
           ip4_nat_chksum_adjust((u8_t *)&(tcphdr->chksum),
@@ -489,7 +711,7 @@ ip4_nat_input(struct pbuf *p)
         nat_entry.udp = ip4_nat_udp_lookup_incoming(iphdr, udphdr);
         if (nat_entry.udp != NULL) {
           /* Refresh UDP entry */
-          nat_entry.udp->common.ttl = LWIP_NAT_DEFAULT_TTL_SECONDS;
+          ip4_nat_table_touch(&ip4_nat_udp, nat_entry.cmn);
           udphdr->dest = nat_entry.udp->sport;
           /* Adjust UDP checksum for changed destination port */
           ip4_nat_chksum_adjust((u8_t *)&(udphdr->chksum),
@@ -512,17 +734,22 @@ ip4_nat_input(struct pbuf *p)
           p->tot_len));
       } else {
         if (ICMP_ER == ICMPH_TYPE(icmphdr)) {
-          for (i = 0; i < LWIP_NAT_DEFAULT_STATE_TABLES_ICMP; i++) {
-            nat_entry.icmp = &ip4_nat_icmp_table[i];
-            if ((nat_entry.icmp->common.ttl) &&
-                (iphdr->src.addr == nat_entry.icmp->common.dest.addr) &&
-                (nat_entry.icmp->id == icmphdr->id) &&
-                (nat_entry.icmp->seqno == icmphdr->seqno)) {
+          u16_t slot = ip4_nat_icmp.buckets[ip4_nat_hash(iphdr->src.addr, 0,
+            ((u32_t)icmphdr->id << 16) | icmphdr->seqno) % ip4_nat_icmp.bucket_count];
+          while (slot) {
+            ip4_nat_entries_icmp_t *cur = &ip4_nat_icmp_table[slot - 1];
+            if ((iphdr->src.addr == cur->common.dest.addr) &&
+                (cur->id == icmphdr->id) &&
+                (cur->seqno == icmphdr->seqno)) {
+              nat_entry.icmp = cur;
               ip4_nat_dbg_dump_icmp_nat_entry("found existing nat entry: ", nat_entry.icmp);
               consumed = 1;
-              IPNAT_ENTRY_RESET(nat_entry.cmn);
+              /* The slot keeps its data until the next allocation, which
+                 cannot happen before this packet is sent */
+              ip4_nat_table_release(&ip4_nat_icmp, nat_entry.cmn);
               break;
             }
+            slot = cur->common.hash_next;
           }
         }
       }
@@ -584,46 +811,24 @@ ip4_nat_input(struct pbuf *p)
     }
     /* now that q (and/or p) is sent (or not), give up the reference to it
        this frees the input pbuf (p) as we have consumed it. */
-    // pbuf_free(q);
+    pbuf_free(q);
   }
   return consumed;
 }
 
-/** Check if one NAT entry timed out */
-static void
-ip4_nat_check_timeout(ip4_nat_entry_common_t *nat_entry)
-{
-  if(nat_entry->ttl > 0) {
-    if(nat_entry->ttl != LWIP_NAT_TTL_INFINITE) {
-      /* this is not a 'no-timeout' entry */
-      if(nat_entry->ttl > LWIP_NAT_TMR_INTERVAL_SEC) {
-        nat_entry->ttl -= LWIP_NAT_TMR_INTERVAL_SEC;
-      } else {
-        nat_entry->ttl = 0;
-      }
-    }
-  }
-}
-
 /** The NAT timer function, to be called at an interval of
  * LWIP_NAT_TMR_INTERVAL_SEC seconds.
  */
 void
 ip4_nat_tmr(void)
 {
-  int i;
-
   LWIP_DEBUGF(NAT_DEBUG, ("ip4_nat_tmr: removing old entries\n"));
 
-  for(i = 0; i < LWIP_NAT_DEFAULT_STATE_TABLES_ICMP; i++) {
-    ip4_nat_check_timeout((ip4_nat_entry_common_t *) & ip4_nat_icmp_table[i]);
-  }
-  for(i = 0; i < LWIP_NAT_DEFAULT_STATE_TABLES_TCP; i++) {
-    ip4_nat_check_timeout((ip4_nat_entry_common_t *) & ip4_nat_tcp_table[i]);
-  }
-  for(i = 0; i < LWIP_NAT_DEFAULT_STATE_TABLES_UDP; i++) {
-    ip4_nat_check_timeout((ip4_nat_entry_common_t *) & ip4_nat_udp_table[i]);
-  }
+  ip4_nat_clock += LWIP_NAT_TMR_INTERVAL_SEC;
+
+  ip4_nat_table_tmr(&ip4_nat_icmp);
+  ip4_nat_table_tmr(&ip4_nat_tcp);
+  ip4_nat_table_tmr(&ip4_nat_udp);
 }
 
 /** Check if we want to perform NAT with this packet. If so, send it out on
@@ -644,7 +849,6 @@ ip4_nat_out(struct pbuf *p)
   struct udp_hdr       *udphdr;
   ip4_nat_conf_t        *nat_config;
   nat_entry_t           nat_entry;
-  int             i;
 
   nat_entry.cmn = NULL;
 
@@ -705,15 +909,13 @@ ip4_nat_out(struct pbuf *p)
             ("ip4_nat_out: short icmp echo packet (%" U16_F " bytes) discarded\n", p->tot_len));
         } else {
           if (ICMPH_TYPE(icmphdr) == ICMP_ECHO) {
-            for (i = 0; i < LWIP_NAT_DEFAULT_STATE_TABLES_ICMP; i++) {
-              if (!ip4_nat_icmp_table[i].common.ttl) {
-                nat_entry.icmp = &ip4_nat_icmp_table[i];
-                ip4_nat_cmn_init(nat_config, iphdr, nat_entry.cmn);
-                nat_entry.icmp->id = icmphdr->id;
-                nat_entry.icmp->seqno = icmphdr->seqno;
-                ip4_nat_dbg_dump_icmp_nat_entry(" ip4_nat_out: created new NAT entry ", nat_entry.icmp);
-                break;
-              }
+            nat_entry.cmn = ip4_nat_table_alloc(&ip4_nat_icmp);
+            if (nat_entry.cmn != NULL) {
+              ip4_nat_cmn_init(nat_config, iphdr, nat_entry.cmn);
+              nat_entry.icmp->id = icmphdr->id;
+              nat_entry.icmp->seqno = icmphdr->seqno;
+              ip4_nat_table_link(&ip4_nat_icmp, nat_entry.cmn);
+              ip4_nat_dbg_dump_icmp_nat_entry(" ip4_nat_out: created new NAT entry ", nat_entry.icmp);
             }
             if (NULL == nat_entry.icmp)
             {
@@ -774,7 +976,7 @@ ip4_nat_cmn_init(ip4_nat_conf_t *nat_config, const struct ip_hdr *iphdr, ip4_nat
   nat_entry->cfg = nat_config;
   ip4_addr_set(&nat_entry->dest, &iphdr->dest);
   ip4_addr_set(&nat_entry->source, &iphdr->src);
-  nat_entry->ttl = LWIP_NAT_DEFAULT_TTL_SECONDS;
+  nat_entry->ttl = (s32_t)(ip4_nat_clock + LWIP_NAT_DEFAULT_TTL_SECONDS);
 }
 
 /**
@@ -790,19 +992,20 @@ ip4_nat_cmn_init(ip4_nat_conf_t *nat_config, const struct ip_hdr *iphdr, ip4_nat
 static ip4_nat_entries_udp_t *
 ip4_nat_udp_lookup_incoming(const struct ip_hdr *iphdr, const struct udp_hdr *udphdr)
 {
-  int i;
   ip4_nat_entries_udp_t *nat_entry = NULL;
-
-  for (i = 0; i < LWIP_NAT_DEFAULT_STATE_TABLES_UDP; i++) {
-    if (ip4_nat_udp_table[i].common.ttl) {
-      if ((iphdr->src.addr == ip4_nat_udp_table[i].common.dest.addr) &&
-          (udphdr->src == ip4_nat_udp_table[i].dport) &&
-          (udphdr->dest == ip4_nat_udp_table[i].nport)) {
-        nat_entry = &ip4_nat_udp_table[i];
-        ip4_nat_dbg_dump_udp_nat_entry("ip4_nat_udp_lookup_incoming: found existing nat entry: ",
-                                      nat_entry);
-        break;
-      }
+  u16_t port = ntohs(udphdr->dest);
+
+  /* The translated port names the slot */
+  if ((port >= LWIP_NAT_DEFAULT_UDP_SOURCE_PORT) &&
+      (port < LWIP_NAT_DEFAULT_UDP_SOURCE_PORT + LWIP_NAT_DEFAULT_STATE_TABLES_UDP)) {
+    ip4_nat_entries_udp_t *slot = &ip4_nat_udp_table[port - LWIP_NAT_DEFAULT_UDP_SOURCE_PORT];
+    if ((slot->common.ttl) &&
+        (iphdr->src.addr == slot->common.dest.addr) &&
+        (udphdr->src == slot->dport) &&
+        (udphdr->dest == slot->nport)) {
+      nat_entry = slot;
+      ip4_nat_dbg_dump_udp_nat_entry("ip4_nat_udp_lookup_incoming: found existing nat entry: ",
+                                    nat_entry);
     }
   }
   return nat_entry;
@@ -815,41 +1018,44 @@ ip4_nat_udp_lookup_incoming(const struct ip_hdr *iphdr, const struct udp_hdr *ud
  * @param iphdr The IP header.
  * @param udphdr The UDP header.
  * @param allocate If no existing NAT entry is found and this flag is true
- *        a NAT entry is allocated.
+ *        a NAT entry is allocated, evicting the least recently used one
+ *        when the table is full.
  */
 static ip4_nat_entries_udp_t *
 ip4_nat_udp_lookup_outgoing(ip4_nat_conf_t *nat_config, const struct ip_hdr *iphdr,
                            const struct udp_hdr *udphdr, u8_t allocate)
 {
-  int i;
   nat_entry_t nat_entry;
-  int last_free = -1;
+  u16_t slot;
 
   nat_entry.cmn = NULL;
-  for (i = 0; i < LWIP_NAT_DEFAULT_STATE_TABLES_UDP; i++) {
-    if (ip4_nat_udp_table[i].common.ttl) {
-      if ((iphdr->src.addr == ip4_nat_udp_table[i].common.source.addr) &&
-          (iphdr->dest.addr == ip4_nat_udp_table[i].common.dest.addr) &&
-          (udphdr->src == ip4_nat_udp_table[i].sport) &&
-          (udphdr->dest == ip4_nat_udp_table[i].dport)) {
-        nat_entry.udp = &ip4_nat_udp_table[i];
-
-        ip4_nat_dbg_dump_udp_nat_entry("ip4_nat_udp_lookup_outgoing: found existing nat entry: ",
-                                      nat_entry.udp);
-        break;
-      }
-    } else {
-        last_free = i;
+  slot = ip4_nat_udp.buckets[ip4_nat_hash(iphdr->src.addr, iphdr->dest.addr,
+    ((u32_t)udphdr->src << 16) | udphdr->dest) % ip4_nat_udp.bucket_count];
+  while (slot) {
+    ip4_nat_entries_udp_t *cur = &ip4_nat_udp_table[slot - 1];
+    if ((iphdr->src.addr == cur->common.source.addr) &&
+        (iphdr->dest.addr == cur->common.dest.addr) &&
+        (udphdr->src == cur->sport) &&
+        (udphdr->dest == cur->dport)) {
+      nat_entry.udp = cur;
+      ip4_nat_table_touch(&ip4_nat_udp, nat_entry.cmn);
+
+      ip4_nat_dbg_dump_udp_nat_entry("ip4_nat_udp_lookup_outgoing: found existing nat entry: ",
+                                    nat_entry.udp);
+      break;
     }
+    slot = cur->common.hash_next;
   }
   if (nat_entry.cmn == NULL) {
     if (allocate) {
-      if (last_free != -1) {
-        nat_entry.udp = &ip4_nat_udp_table[last_free];
-        nat_entry.udp->nport = htons((u16_t) (LWIP_NAT_DEFAULT_UDP_SOURCE_PORT + last_free));
+      nat_entry.cmn = ip4_nat_table_alloc(&ip4_nat_udp);
+      if (nat_entry.cmn != NULL) {
+        nat_entry.udp->nport = htons((u16_t) (LWIP_NAT_DEFAULT_UDP_SOURCE_PORT +
+                                                   IP4_NAT_TABLE_SLOT(&ip4_nat_udp, nat_entry.cmn)));
         nat_entry.udp->sport = udphdr->src;
         nat_entry.udp->dport = udphdr->dest;
         ip4_nat_cmn_init(nat_config, iphdr, nat_entry.cmn);
+        ip4_nat_table_link(&ip4_nat_udp, nat_entry.cmn);
 
         ip4_nat_dbg_dump_udp_nat_entry("ip4_nat_udp_lookup_outgoing: created new nat entry: ",
                                       nat_entry.udp);
@@ -873,20 +1079,21 @@ ip4_nat_udp_lookup_outgoing(ip4_nat_conf_t *nat_config, const struct ip_hdr *iph
 static ip4_nat_entries_tcp_t *
 ip4_nat_tcp_lookup_incoming(const struct ip_hdr *iphdr, const struct tcp_hdr *tcphdr)
 {
-  int i;
   ip4_nat_entries_tcp_t *nat_entry = NULL;
-
-  for (i = 0; i < LWIP_NAT_DEFAULT_STATE_TABLES_TCP; i++) {
-    if (ip4_nat_tcp_table[i].common.ttl) {
-      if ((iphdr->src.addr == ip4_nat_tcp_table[i].common.dest.addr) &&
-          (tcphdr->src == ip4_nat_tcp_table[i].dport) &&
-          (tcphdr->dest == ip4_nat_tcp_table[i].nport)) {
-        nat_entry = &ip4_nat_tcp_table[i];
-
-        ip4_nat_dbg_dump_tcp_nat_entry("ip4_nat_tcp_lookup_incoming: found existing nat entry: ",
-                                      nat_entry);
-        break;
-      }
+  u16_t port = ntohs(tcphdr->dest);
+
+  /* The translated port names the slot */
+  if ((port >= LWIP_NAT_DEFAULT_TCP_SOURCE_PORT) &&
+      (port < LWIP_NAT_DEFAULT_TCP_SOURCE_PORT + LWIP_NAT_DEFAULT_STATE_TABLES_TCP)) {
+    ip4_nat_entries_tcp_t *slot = &ip4_nat_tcp_table[port - LWIP_NAT_DEFAULT_TCP_SOURCE_PORT];
+    if ((slot->common.ttl) &&
+        (iphdr->src.addr == slot->common.dest.addr) &&
+        (tcphdr->src == slot->dport) &&
+        (tcphdr->dest == slot->nport)) {
+      nat_entry = slot;
+
+      ip4_nat_dbg_dump_tcp_nat_entry("ip4_nat_tcp_lookup_incoming: found existing nat entry: ",
+                                    nat_entry);
     }
   }
   return nat_entry;
@@ -899,46 +1106,49 @@ ip4_nat_tcp_lookup_incoming(const struct ip_hdr *iphdr, const struct tcp_hdr *tc
  * @param iphdr The IP header.
  * @param tcphdr The TCP header.
  * @param allocate If no existing NAT entry is found and this flag is true
- *   a NAT entry is allocated.
+ *   a NAT entry is allocated, evicting the least recently used one when
+ *   the table is full.
  */
 static ip4_nat_entries_tcp_t *
 ip4_nat_tcp_lookup_outgoing(ip4_nat_conf_t *nat_config, const struct ip_hdr *iphdr,
                            const struct tcp_hdr *tcphdr, u8_t allocate)
 {
-  int i;
   nat_entry_t nat_entry;
-  int last_free = -1;
+  u16_t slot;
 
   nat_entry.cmn = NULL;
-  for (i = 0; i < LWIP_NAT_DEFAULT_STATE_TABLES_TCP; i++) {
-    if (ip4_nat_tcp_table[i].common.ttl) {
-      if ((iphdr->src.addr == ip4_nat_tcp_table[i].common.source.addr) &&
-          (iphdr->dest.addr == ip4_nat_tcp_table[i].common.dest.addr) &&
-          (tcphdr->src == ip4_nat_tcp_table[i].sport) &&
-          (tcphdr->dest == ip4_nat_tcp_table[i].dport)) {
-        nat_entry.tcp = &ip4_nat_tcp_table[i];
-
-        ip4_nat_dbg_dump_tcp_nat_entry("ip4_nat_tcp_lookup_outgoing: found existing nat entry: ",
-                                      nat_entry.tcp);
-        break;
-      }
-    } else {
-        last_free = i;
+  slot = ip4_nat_tcp.buckets[ip4_nat_hash(iphdr->src.addr, iphdr->dest.addr,
+    ((u32_t)tcphdr->src << 16) | tcphdr->dest) % ip4_nat_tcp.bucket_count];
+  while (slot) {
+    ip4_nat_entries_tcp_t *cur = &ip4_nat_tcp_table[slot - 1];
+    if ((iphdr->src.addr == cur->common.source.addr) &&
+        (iphdr->dest.addr == cur->common.dest.addr) &&
+        (tcphdr->src == cur->sport) &&
+        (tcphdr->dest == cur->dport)) {
+      nat_entry.tcp = cur;
+      ip4_nat_table_touch(&ip4_nat_tcp, nat_entry.cmn);
+
+      ip4_nat_dbg_dump_tcp_nat_entry("ip4_nat_tcp_lookup_outgoing: found existing nat entry: ",
+                                    nat_entry.tcp);
+      break;
     }
+    slot = cur->common.hash_next;
   }
   if (nat_entry.cmn == NULL) {
     if (allocate) {
-      if (last_free != -1) {
-        nat_entry.tcp = &ip4_nat_tcp_table[last_free];
-        nat_entry.tcp->nport = htons((u16_t) (LWIP_NAT_DEFAULT_TCP_SOURCE_PORT + last_free));
+      nat_entry.cmn = ip4_nat_table_alloc(&ip4_nat_tcp);
+      if (nat_entry.cmn != NULL) {
+        nat_entry.tcp->nport = htons((u16_t) (LWIP_NAT_DEFAULT_TCP_SOURCE_PORT +
+                                                   IP4_NAT_TABLE_SLOT(&ip4_nat_tcp, nat_entry.cmn)));
         nat_entry.tcp->sport = tcphdr->src;
         nat_entry.tcp->dport = tcphdr->dest;
         ip4_nat_cmn_init(nat_config, iphdr, nat_entry.cmn);
+        ip4_nat_table_link(&ip4_nat_tcp, nat_entry.cmn);
 
         ip4_nat_dbg_dump_tcp_nat_entry("ip4_nat_tcp_lookup_outgoing: created new nat entry: ",
                                       nat_entry.tcp);
       } else {
-        LWIP_DEBUGF(NAT_DEBUG, ("ip4_nat_udp_lookup_outgoing: no more NAT entries available\n"));
+        LWIP_DEBUGF(NAT_DEBUG, ("ip4_nat_tcp_lookup_outgoing: no more NAT entries available\n"));
       }
     }
   }
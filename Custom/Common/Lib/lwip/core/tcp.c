@@ -1654,6 +1654,39 @@ tcp_setprio(struct tcp_pcb *pcb, u8_t prio)
   pcb->prio = prio;
 }
 
+/**
+ * @ingroup tcp
+ * Sets the receive window limit of an established connection, e.g. to size
+ * it for the link it runs over. Data the application has not taken yet keeps
+ * counting against the new limit; a window that was already announced is
+ * not shrunk, it closes down to the limit as the data arrives.
+ *
+ * @param pcb the tcp_pcb to manipulate
+ * @param wnd new window limit, clamped to [TCP_MSS, TCP_WND]
+ */
+void
+tcp_set_rcv_wnd_max(struct tcp_pcb *pcb, tcpwnd_size_t wnd)
+{
+  tcpwnd_size_t used, wnd_max;
+
+  LWIP_ASSERT_CORE_LOCKED();
+
+  LWIP_ERROR("tcp_set_rcv_wnd_max: invalid pcb", pcb != NULL, return);
+  /* the window is reset when window scaling is agreed during the handshake */
+  LWIP_ERROR("tcp_set_rcv_wnd_max: connection not established",
+             pcb->state >= ESTABLISHED, return);
+
+  wnd = LWIP_MIN(LWIP_MAX(wnd, TCP_MSS), TCP_WND);
+  used = (tcpwnd_size_t)(TCP_WND_MAX(pcb) - pcb->rcv_wnd);
+  pcb->rcv_wnd_max = wnd;
+  wnd_max = TCP_WND_MAX(pcb);
+  pcb->rcv_wnd = (used < wnd_max) ? (tcpwnd_size_t)(wnd_max - used) : 0;
+  if (tcp_update_rcv_ann_wnd(pcb) > 0) {
+    /* announce a raised window with the next (delayed) ACK */
+    tcp_set_flags(pcb, TF_ACK_DELAY);
+  }
+}
+
 #if TCP_QUEUE_OOSEQ
 /**
  * Returns a copy of the given TCP segment.
@@ -1897,6 +1930,7 @@ tcp_alloc(u8_t prio)
     /* Start with a window that does not need scaling. When window scaling is
        enabled and used, the window is enlarged when both sides agree on scaling. */
     pcb->rcv_wnd = pcb->rcv_ann_wnd = TCPWND_MIN16(TCP_WND);
+    pcb->rcv_wnd_max = TCP_WND;
     pcb->ttl = TCP_TTL;
     /* As initial send MSS, we use TCP_MSS but limit it to 536.
        The send MSS is updated when an MSS option is received. */
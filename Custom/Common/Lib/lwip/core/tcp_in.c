@@ -879,6 +879,9 @@ tcp_process(struct tcp_pcb *pcb)
 #if TCP_CALCULATE_EFF_SEND_MSS
         pcb->mss = tcp_eff_send_mss(pcb->mss, &pcb->local_ip, &pcb->remote_ip);
 #endif /* TCP_CALCULATE_EFF_SEND_MSS */
+#ifdef LWIP_HOOK_TCP_ESTABLISHED
+        LWIP_HOOK_TCP_ESTABLISHED(pcb);
+#endif
 
         pcb->cwnd = LWIP_TCP_CALC_INITIAL_CWND(pcb->mss);
         LWIP_DEBUGF(TCP_CWND_DEBUG, ("tcp_process (SENT): cwnd %"TCPWNDSIZE_F
@@ -941,6 +944,9 @@ tcp_process(struct tcp_pcb *pcb)
         if (TCP_SEQ_BETWEEN(ackno, pcb->lastack + 1, pcb->snd_nxt)) {
           pcb->state = ESTABLISHED;
           LWIP_DEBUGF(TCP_DEBUG, ("TCP connection established %"U16_F" -> %"U16_F".\n", inseg.tcphdr->src, inseg.tcphdr->dest));
+#ifdef LWIP_HOOK_TCP_ESTABLISHED
+          LWIP_HOOK_TCP_ESTABLISHED(pcb);
+#endif
 #if LWIP_CALLBACK_API || TCP_LISTEN_BACKLOG
           if (pcb->listener == NULL) {
             /* listen pcb might be closed by now */
@@ -2899,6 +2899,25 @@
 #define LWIP_HOOK_TCP_INPACKET_PCB(pcb, hdr, optlen, opt1len, opt2, p)
 #endif
 
+/**
+ * LWIP_HOOK_TCP_ESTABLISHED:
+ * Hook called when a connection enters ESTABLISHED, for both active and
+ * passive opens, before the connected or accept callback runs. The options
+ * of the handshake (MSS, window scaling) are known at this point, so this
+ * can be used to size the connection, e.g. with tcp_set_rcv_wnd_max().
+ * Signature:\code{.c}
+ * void my_hook_tcp_established(struct tcp_pcb *pcb);
+ * \endcode
+ * Arguments:
+ * - pcb: the connection that was just established
+ *
+ * ATTENTION: don't call any tcp api functions that might change tcp state (pcb
+ * state or any pcb lists) from this callback!
+ */
+#ifdef __DOXYGEN__
+#define LWIP_HOOK_TCP_ESTABLISHED(pcb)
+#endif
+
 /**
  * LWIP_HOOK_TCP_OUT_TCPOPT_LENGTH:
  * Hook for increasing the size of the options allocated with a tcp header.
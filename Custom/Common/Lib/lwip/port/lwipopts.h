@@ -51,7 +51,7 @@
 #define LWIP_IGMP                         LWIP_IPV4
 #define LWIP_ICMP                         LWIP_IPV4
 
-#define LWIP_CHECKSUM_ON_COPY             0
+#define LWIP_CHECKSUM_ON_COPY             1
 #define CHECKSUM_GEN_IP                   1
 #define CHECKSUM_GEN_UDP                  1
 #define CHECKSUM_GEN_TCP                  1
@@ -208,20 +208,29 @@ a lot of data that needs to be copied, this should be set high. */
 /* TCP Maximum segment size. */
 #define TCP_MSS                 1460
 
-/* TCP sender buffer space (bytes). */
+/* TCP sender buffer space (bytes). Connections over a known interface
+   are resized once established (netif_manager_tcp_established), from
+   8 up to 64 * TCP_MSS depending on the link and its RTT. */
 #define TCP_SND_BUF             TCP_MSS * 32
 
 /* TCP sender buffer space (pbufs). This must be at least = 2 *
-   TCP_SND_BUF/TCP_MSS for things to work. */
-#define TCP_SND_QUEUELEN       (64)
+   TCP_SND_BUF/TCP_MSS for things to work, sized for the largest
+   per-connection send buffer. */
+#define TCP_SND_QUEUELEN       (2 * 64)
 
 /* TCP writable space (bytes). This must be less than or equal
    to TCP_SND_BUF. It is the amount of space which must be
-   available in the tcp snd_buf for select to return writable */
-#define TCP_SNDLOWAT           (TCP_SND_BUF / 2)
+   available in the tcp snd_buf for select to return writable.
+   Must stay below the smallest per-connection send buffer. */
+#define TCP_SNDLOWAT           (TCP_MSS * 4)
 
-/* TCP receive window. */
-#define TCP_WND                (TCP_MSS * 8)
+/* Window scaling, so a receive window can exceed 64 KB. */
+#define LWIP_WND_SCALE          1
+#define TCP_RCV_SCALE           2
+
+/* TCP receive window. This is the upper bound, each connection is
+   limited to what its link needs once established. */
+#define TCP_WND                (TCP_MSS * 64)
 
 /* Maximum number of retransmissions of data segments. */
 #define TCP_MAXRTX              12
@@ -229,6 +238,11 @@ a lot of data that needs to be copied, this should be set high. */
 /* Maximum number of retransmissions of SYN segments. */
 #define TCP_SYNMAXRTX           4
 
+/* Per-pcb user data slots, ms_network uses one to release referenced
+   (zero-copy) sends when they are acknowledged, netif_manager one to
+   return a connection's buffer budget. */
+#define LWIP_TCP_PCB_NUM_EXT_ARGS 2
+
 
 /* ---------- ARP options ---------- */
 #define LWIP_ARP                1
@@ -352,4 +366,8 @@ extern void sntp_get_system_time(uint32_t *sec, uint32_t *us);
 #define SNTP_SET_SYSTEM_TIME(sec)      sntp_set_system_time(sec)
 #define SNTP_GET_SYSTEM_TIME(sec, us)  sntp_get_system_time(&sec, &us)
 
+struct tcp_pcb;
+extern void netif_manager_tcp_established(struct tcp_pcb *pcb);
+#define LWIP_HOOK_TCP_ESTABLISHED(pcb) netif_manager_tcp_established(pcb)
+
 #endif /* LWIP_LWIPOPTS_H */
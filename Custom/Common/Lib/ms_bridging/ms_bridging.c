@@ -1,6 +1,18 @@
 #include <string.h>
 #include "ms_bridging.h"
 
+#if defined(MS_BR_EVT_CREATE) && defined(MS_BR_EVT_DELETE) && defined(MS_BR_EVT_SET) && defined(MS_BR_EVT_CLEAR) && defined(MS_BR_EVT_WAIT)
+#define MS_BR_USE_EVT
+#endif
+#if defined(MS_BR_MUTEX_CREATE) && defined(MS_BR_MUTEX_DELETE) && defined(MS_BR_MUTEX_LOCK) && defined(MS_BR_MUTEX_UNLOCK)
+#define MS_BR_USE_MUTEX
+#endif
+
+#define MS_BR_TXN_FREE                          0
+#define MS_BR_TXN_WAIT                          1
+#define MS_BR_TXN_DONE                          2
+#define MS_BR_TXN_ALL_MASK                      ((1U << MS_BR_WINDOW_SIZE) - 1)
+
 // CRC16-CCITT calculation (polynomial 0x1021)
 static uint16_t ms_bridging_crc16(uint8_t *data, uint16_t len)
 {
@@ -21,6 +33,38 @@ static uint16_t ms_bridging_crc16(uint8_t *data, uint16_t len)
     return crc;
 }
 
+static void ms_bridging_lock(ms_bridging_handler_t *handler)
+{
+#ifdef MS_BR_USE_MUTEX
+    if (handler->lock != NULL) MS_BR_MUTEX_LOCK(handler->lock);
+#endif
+}
+
+static void ms_bridging_unlock(ms_bridging_handler_t *handler)
+{
+#ifdef MS_BR_USE_MUTEX
+    if (handler->lock != NULL) MS_BR_MUTEX_UNLOCK(handler->lock);
+#endif
+}
+
+// Wake the waiters of the given in flight slots (may be called within the interrupt)
+static void ms_bridging_signal(ms_bridging_handler_t *handler, uint32_t flags)
+{
+#ifdef MS_BR_USE_EVT
+    if (handler->ack_evt != NULL) MS_BR_EVT_SET(handler->ack_evt, flags);
+#endif
+}
+
+// Sleep until one of the flags is signalled or the timeout expires
+static void ms_bridging_wait_signal(ms_bridging_handler_t *handler, uint32_t flags, uint32_t timeout_ms)
+{
+#ifdef MS_BR_USE_EVT
+    MS_BR_EVT_WAIT(handler->ack_evt, flags, timeout_ms);
+#else
+    MS_BR_DELAY_MS((timeout_ms < MS_BR_WAIT_ACK_DELAY_MS) ? timeout_ms : MS_BR_WAIT_ACK_DELAY_MS);
+#endif
+}
+
 // Find empty slot in ack frame buffer
 static int ms_bridging_find_empty_ack_slot(ms_bridging_handler_t *handler)
 {
@@ -34,53 +78,47 @@ static int ms_bridging_find_empty_ack_slot(ms_bridging_handler_t *handler)
     return MS_BR_ERR_NO_FOUND;
 }
 
-// Find empty slot in notify frame buffer
-static int ms_bridging_find_empty_notify_slot(ms_bridging_handler_t *handler)
+// Find the in flight frame an ack belongs to
+static int ms_bridging_find_inflight(ms_bridging_handler_t *handler, ms_bridging_frame_t *ack_frame)
 {
     int i = 0;
 
-    for (; i < MS_BR_FRAME_BUF_NUM; i++) {
-        if (handler->notify_frame[i].is_valid == 0) {
+    for (; i < MS_BR_WINDOW_SIZE; i++) {
+        if (handler->inflight[i].state == MS_BR_TXN_WAIT && handler->inflight[i].frame.header.id == ack_frame->header.id
+            && handler->inflight[i].frame.header.cmd == ack_frame->header.cmd && handler->inflight[i].ack_type == ack_frame->header.type) {
             return i;
         }
     }
     return MS_BR_ERR_NO_FOUND;
 }
 
-// Wait for ack
-static int ms_bridging_wait_for_ack(ms_bridging_handler_t *handler, ms_bridging_frame_type_t frame_type, ms_bridging_frame_cmd_t frame_cmd, uint16_t frame_id, ms_bridging_frame_t *ack_frame)
+// Take the ack of an in flight frame
+static int ms_bridging_take_ack(ms_bridging_handler_t *handler, ms_bridging_inflight_t *txn, ms_bridging_frame_t *ack_frame)
 {
     int i = 0;
-    uint32_t start_tick = 0, now_tick = 0;
-
-    start_tick = MS_BR_GET_TICK_MS();
-    do {
-    #if defined(MS_BR_SEM_CREATE) && defined(MS_BR_SEM_DELETE) && defined(MS_BR_SEM_WAIT) && defined(MS_BR_SEM_POST)
-        MS_BR_SEM_WAIT(handler->ack_sem, MS_BR_WAIT_ACK_DELAY_MS);
-    #else
-        MS_BR_DELAY_MS(MS_BR_WAIT_ACK_DELAY_MS);
-    #endif
-        if (handler->is_ready == 0) return MS_BR_ERR_INVALID_STATE;
-        for (i = 0; i < MS_BR_FRAME_BUF_NUM; i++) {
-            if (handler->ack_frame[i].is_valid == 1) {
-                if (handler->ack_frame[i].header.id == frame_id && handler->ack_frame[i].header.cmd == frame_cmd && handler->ack_frame[i].header.type == frame_type) {
-                    memcpy(ack_frame, &handler->ack_frame[i], sizeof(ms_bridging_frame_t));
-                    handler->ack_frame[i].data = NULL;
-                    handler->ack_frame[i].is_valid = 0;
-                    return MS_BR_OK;
-                }
+
+    for (; i < MS_BR_FRAME_BUF_NUM; i++) {
+        if (handler->ack_frame[i].is_valid == 1) {
+            if (handler->ack_frame[i].header.id == txn->frame.header.id && handler->ack_frame[i].header.cmd == txn->frame.header.cmd && handler->ack_frame[i].header.type == txn->ack_type) {
+                memcpy(ack_frame, &handler->ack_frame[i], sizeof(ms_bridging_frame_t));
+                handler->ack_frame[i].data = NULL;
+                handler->ack_frame[i].is_valid = 0;
+                return MS_BR_OK;
             }
         }
-        now_tick = MS_BR_GET_TICK_MS();
-    } while (MS_BR_TICK_DIFF_MS(start_tick, now_tick) < MS_BR_WAIT_ACK_TIMEOUT_MS);
-    
-    return MS_BR_ERR_TIMEOUT;
+    }
+    return MS_BR_ERR_NO_FOUND;
 }
 
 // Add ack frame
 static int ms_bridging_add_ack_frame(ms_bridging_handler_t *handler, ms_bridging_frame_t *frame)
 {
-    int empty_slot = -1;
+    int i = 0, empty_slot = -1, txn_slot = -1;
+    uint32_t flags = 0;
+
+    // Late duplicates of an ack that was already consumed are dropped here
+    txn_slot = ms_bridging_find_inflight(handler, frame);
+    if (txn_slot < 0) return MS_BR_ERR_NO_FOUND;
 
     empty_slot = ms_bridging_find_empty_ack_slot(handler);
     if (empty_slot < 0) return MS_BR_ERR_NO_MEM;
@@ -89,22 +127,46 @@ static int ms_bridging_add_ack_frame(ms_bridging_handler_t *handler, ms_bridging
     handler->ack_frame_received_tick[empty_slot] = MS_BR_GET_TICK_MS();
     frame->data = NULL;
 
-#if defined(MS_BR_SEM_CREATE) && defined(MS_BR_SEM_DELETE) && defined(MS_BR_SEM_WAIT) && defined(MS_BR_SEM_POST)
-    MS_BR_SEM_POST(handler->ack_sem);
-#endif
+    if (handler->last_ack_valid == 0 || MS_BR_SEQ_AFTER(frame->header.id, handler->last_ack_id)) {
+        handler->last_ack_id = frame->header.id;
+        handler->last_ack_valid = 1;
+    }
+    flags = 1U << txn_slot;
+    if (handler->window > 1) {
+        // The peer answers in order, so this ack also tells every older frame still waiting that it was lost
+        for (; i < MS_BR_WINDOW_SIZE; i++) {
+            if (handler->inflight[i].state == MS_BR_TXN_WAIT) flags |= 1U << i;
+        }
+    }
+    ms_bridging_signal(handler, flags);
     return MS_BR_OK;
 }
 
+// Check whether a request or event is already queued (retransmitted by the peer)
+static int ms_bridging_is_notify_queued(ms_bridging_handler_t *handler, ms_bridging_frame_t *frame)
+{
+    int i = 0;
+
+    for (; i < MS_BR_FRAME_BUF_NUM; i++) {
+        if (handler->notify_frame[i].is_valid == 1 && handler->notify_frame[i].header.id == frame->header.id
+            && handler->notify_frame[i].header.cmd == frame->header.cmd && handler->notify_frame[i].header.type == frame->header.type) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
 // Add notify frame
 static int ms_bridging_add_notify_frame(ms_bridging_handler_t *handler, ms_bridging_frame_t *frame)
 {
-    int empty_slot = -1;
+    ms_bridging_frame_t *slot = &handler->notify_frame[handler->notify_tail];
 
-    empty_slot = ms_bridging_find_empty_notify_slot(handler);
-    if (empty_slot < 0) return MS_BR_ERR_NO_MEM;
+    if (slot->is_valid != 0) return MS_BR_ERR_NO_MEM;
+    if (handler->window > 1 && ms_bridging_is_notify_queued(handler, frame)) return MS_BR_ERR_FAILED;
 
-    memcpy(&handler->notify_frame[empty_slot], frame, sizeof(ms_bridging_frame_t));
+    memcpy(slot, frame, sizeof(ms_bridging_frame_t));
     frame->data = NULL;
+    handler->notify_tail = (handler->notify_tail + 1) % MS_BR_FRAME_BUF_NUM;
 
 #if defined(MS_BR_SEM_CREATE) && defined(MS_BR_SEM_DELETE) && defined(MS_BR_SEM_WAIT) && defined(MS_BR_SEM_POST)
     MS_BR_SEM_POST(handler->notify_sem);
@@ -142,11 +204,10 @@ static int ms_bridging_calculate_frame_crc(ms_bridging_frame_t *frame)
     return MS_BR_OK;
 }
 
-// Build frame
-static int ms_bridging_build_frame(ms_bridging_handler_t *handler, ms_bridging_frame_t *frame, ms_bridging_frame_type_t type, ms_bridging_frame_cmd_t cmd, uint8_t *data, uint16_t len)
+// Build frame (the id was reserved together with the in flight slot)
+static int ms_bridging_build_frame(ms_bridging_frame_t *frame, ms_bridging_frame_type_t type, ms_bridging_frame_cmd_t cmd, uint8_t *data, uint16_t len)
 {
     frame->header.sof = MS_BR_FRAME_SOF;
-    frame->header.id = handler->global_frame_id++;
     frame->header.len = len;
     frame->header.type = type;
     frame->header.cmd = cmd;
@@ -179,6 +240,265 @@ static int ms_bridging_send_frame(ms_bridging_handler_t *handler, ms_bridging_fr
     return ret;
 }
 
+// Send a response or event ack, kept for replay in window mode
+static int ms_bridging_send_reply(ms_bridging_handler_t *handler, ms_bridging_frame_t *frame)
+{
+    ms_bridging_resp_cache_t *entry = NULL;
+
+    if (handler->window > 1 && frame->header.len <= MS_BR_RESP_CACHE_DATA_MAX) {
+        entry = &handler->resp_cache[handler->resp_cache_next];
+        handler->resp_cache_next = (handler->resp_cache_next + 1) % MS_BR_RESP_CACHE_NUM;
+        entry->id = frame->header.id;
+        entry->type = frame->header.type;
+        entry->cmd = frame->header.cmd;
+        entry->len = (frame->data != NULL) ? frame->header.len : 0;
+        if (entry->len > 0) memcpy(entry->data, frame->data, entry->len);
+        entry->tick = MS_BR_GET_TICK_MS();
+        entry->is_valid = 1;
+    }
+    return ms_bridging_send_frame(handler, frame);
+}
+
+// Resend the cached reply of a retransmitted request or event
+static int ms_bridging_replay(ms_bridging_handler_t *handler, ms_bridging_frame_t *req_frame)
+{
+    int i = 0;
+    uint16_t reply_type = (req_frame->header.type == MS_BR_FRAME_TYPE_REQUEST) ? MS_BR_FRAME_TYPE_RESPONSE : MS_BR_FRAME_TYPE_EVENT_ACK;
+    ms_bridging_resp_cache_t *entry = NULL;
+    ms_bridging_frame_t frame = {0};
+
+    for (; i < MS_BR_RESP_CACHE_NUM; i++) {
+        entry = &handler->resp_cache[i];
+        if (entry->is_valid == 0 || entry->id != req_frame->header.id || entry->cmd != req_frame->header.cmd || entry->type != reply_type) continue;
+        if (MS_BR_TICK_DIFF_MS(entry->tick, MS_BR_GET_TICK_MS()) >= MS_BR_RESP_CACHE_AGE_MS) {
+            entry->is_valid = 0;
+            continue;
+        }
+        frame.header.sof = MS_BR_FRAME_SOF;
+        frame.header.id = entry->id;
+        frame.header.len = entry->len;
+        frame.header.type = entry->type;
+        frame.header.cmd = entry->cmd;
+        frame.data = (entry->len > 0) ? entry->data : NULL;
+        ms_bridging_calculate_frame_crc(&frame);
+        MS_BR_LOGD("Replay reply, id: %d cmd: %d", frame.header.id, frame.header.cmd);
+        return ms_bridging_send_frame(handler, &frame);
+    }
+    return MS_BR_ERR_NO_FOUND;
+}
+
+// Handle protocol frames the application never sees, MS_BR_OK if the frame was consumed
+static int ms_bridging_deal_internal_frame(ms_bridging_handler_t *handler, ms_bridging_frame_t *frame)
+{
+    ms_bridging_caps_t caps = {0}, peer_caps = {0};
+
+    if (frame->header.type == MS_BR_FRAME_TYPE_REQUEST && frame->header.cmd == MS_BR_FRAME_CMD_GET_CAPS) {
+        peer_caps.window = 1;
+        if (frame->header.len >= sizeof(ms_bridging_caps_t) && frame->data != NULL) {
+            memcpy(&peer_caps, frame->data, sizeof(ms_bridging_caps_t));
+        }
+        // A probe starts a new session, ids cached from the previous one mean nothing
+        memset(handler->resp_cache, 0, sizeof(handler->resp_cache));
+        handler->window = (peer_caps.window == 0) ? 1 : ((peer_caps.window < MS_BR_WINDOW_SIZE) ? peer_caps.window : MS_BR_WINDOW_SIZE);
+        caps.version = MS_BR_PROTO_VERSION;
+        caps.window = MS_BR_WINDOW_SIZE;
+        MS_BR_LOGD("Peer window: %d", handler->window);
+        ms_bridging_response(handler, frame, &caps, sizeof(ms_bridging_caps_t));
+        return MS_BR_OK;
+    }
+
+    if (handler->window > 1 && (frame->header.type == MS_BR_FRAME_TYPE_REQUEST || frame->header.type == MS_BR_FRAME_TYPE_EVENT)) {
+        if (ms_bridging_replay(handler, frame) == MS_BR_OK) return MS_BR_OK;
+    }
+    return MS_BR_ERR_NO_FOUND;
+}
+
+// Check that the next id stays within one window of the oldest frame still in flight,
+// so the peer only has to remember the replies of a single window
+static int ms_bridging_window_open(ms_bridging_handler_t *handler)
+{
+    int i = 0;
+    uint16_t span = 0;
+
+    if (handler->inflight_num >= handler->window) return 0;
+    for (; i < MS_BR_WINDOW_SIZE; i++) {
+        if (handler->inflight[i].state == MS_BR_TXN_FREE || handler->inflight[i].is_probe) continue;
+        span = (uint16_t)(handler->global_frame_id - handler->inflight[i].frame.header.id);
+        if (span >= handler->window) return 0;
+    }
+    return 1;
+}
+
+// Reserve an in flight slot and its id, the capability probe may exceed the window
+static int ms_bridging_txn_acquire(ms_bridging_handler_t *handler, uint8_t is_probe, uint32_t wait_ms)
+{
+    int i = 0;
+    uint32_t start_tick = MS_BR_GET_TICK_MS();
+
+    for (;;) {
+        if (handler->is_ready == 0) return MS_BR_ERR_INVALID_STATE;
+        ms_bridging_lock(handler);
+        if (is_probe || ms_bridging_window_open(handler)) {
+            for (i = 0; i < MS_BR_WINDOW_SIZE; i++) {
+                if (handler->inflight[i].state == MS_BR_TXN_FREE) {
+                    handler->inflight[i].state = MS_BR_TXN_DONE;
+                    handler->inflight[i].is_probe = is_probe;
+                    handler->inflight[i].frame.header.id = handler->global_frame_id++;
+                    if (!is_probe) handler->inflight_num++;
+                    ms_bridging_unlock(handler);
+                    return i;
+                }
+            }
+        }
+        ms_bridging_unlock(handler);
+        if (MS_BR_TICK_DIFF_MS(start_tick, MS_BR_GET_TICK_MS()) >= wait_ms) return MS_BR_ERR_TIMEOUT;
+        ms_bridging_wait_signal(handler, MS_BR_EVT_SLOT_FREE, MS_BR_WAIT_ACK_DELAY_MS);
+    }
+}
+
+// Release an in flight slot, any response data not handed over is freed
+static void ms_bridging_txn_release(ms_bridging_handler_t *handler, int slot)
+{
+    ms_bridging_inflight_t *txn = &handler->inflight[slot];
+
+    if (txn->data_out != NULL) {
+        MS_BR_FREE(txn->data_out);
+        txn->data_out = NULL;
+    }
+    ms_bridging_lock(handler);
+    txn->state = MS_BR_TXN_FREE;
+    if (!txn->is_probe) handler->inflight_num--;
+    ms_bridging_unlock(handler);
+    ms_bridging_signal(handler, MS_BR_EVT_SLOT_FREE);
+}
+
+// Send a new frame from a reserved slot
+static int ms_bridging_txn_start(ms_bridging_handler_t *handler, int slot, ms_bridging_frame_type_t type, ms_bridging_frame_cmd_t cmd, void *data, uint16_t len, ms_bridging_frame_type_t ack_type)
+{
+    int ret = MS_BR_OK;
+    ms_bridging_inflight_t *txn = &handler->inflight[slot];
+
+    ms_bridging_build_frame(&txn->frame, type, cmd, (uint8_t *)data, len);
+    txn->ack_type = ack_type;
+    txn->retries = 0;
+    if (txn->is_probe) {
+        txn->rto_ms = MS_BR_CAPS_TIMEOUT_MS;
+        txn->max_retries = 0;
+    } else {
+        txn->rto_ms = (handler->window > 1) ? MS_BR_WINDOW_RTO_MS : MS_BR_WAIT_ACK_TIMEOUT_MS;
+        txn->max_retries = MS_BR_RETRY_TIMES;
+    }
+    txn->result = MS_BR_ERR_TIMEOUT;
+    txn->data_out = NULL;
+    txn->len_out = 0;
+#ifdef MS_BR_USE_EVT
+    MS_BR_EVT_CLEAR(handler->ack_evt, 1U << slot);
+#endif
+    txn->sent_tick = MS_BR_GET_TICK_MS();
+    // From here on the receive interrupt may match acks against this slot
+    txn->state = MS_BR_TXN_WAIT;
+
+    ret = ms_bridging_send_frame(handler, &txn->frame);
+    if (ret != MS_BR_OK) {
+        txn->result = ret;
+        txn->state = MS_BR_TXN_DONE;
+    }
+    return ret;
+}
+
+// Advance one in flight frame, return 1 once it is finished
+static int ms_bridging_txn_poll(ms_bridging_handler_t *handler, int slot)
+{
+    int ret = MS_BR_OK, is_lost = 0;
+    uint32_t now_tick = 0;
+    ms_bridging_inflight_t *txn = &handler->inflight[slot];
+    ms_bridging_frame_t ack_frame = {0};
+
+    if (txn->state != MS_BR_TXN_WAIT) return 1;
+    if (handler->is_ready == 0) {
+        txn->result = MS_BR_ERR_INVALID_STATE;
+        txn->state = MS_BR_TXN_DONE;
+        return 1;
+    }
+
+    if (ms_bridging_take_ack(handler, txn, &ack_frame) == MS_BR_OK) {
+        if (ack_frame.header.len > 0 && ack_frame.data != NULL) {
+            txn->data_out = ack_frame.data;
+            txn->len_out = ack_frame.header.len;
+        } else if (ack_frame.data != NULL) {
+            MS_BR_FREE(ack_frame.data);
+        }
+        txn->result = MS_BR_OK;
+        txn->state = MS_BR_TXN_DONE;
+        return 1;
+    }
+
+    // A newer ack overtook this frame: resend once right away, later losses wait for the timeout
+    // (acks still arriving for the rest of the window say nothing about the resent copy)
+    now_tick = MS_BR_GET_TICK_MS();
+    is_lost = handler->window > 1 && txn->retries == 0 && handler->last_ack_valid
+              && MS_BR_SEQ_AFTER(handler->last_ack_id, txn->frame.header.id);
+    if (!is_lost && MS_BR_TICK_DIFF_MS(txn->sent_tick, now_tick) < txn->rto_ms) return 0;
+
+    if (txn->retries >= txn->max_retries) {
+        txn->result = MS_BR_ERR_TIMEOUT;
+        txn->state = MS_BR_TXN_DONE;
+        return 1;
+    }
+    txn->retries++;
+    txn->sent_tick = now_tick;
+    MS_BR_LOGD("Resend frame, id: %d cmd: %d retry: %d", txn->frame.header.id, txn->frame.header.cmd, txn->retries);
+    ret = ms_bridging_send_frame(handler, &txn->frame);
+    if (ret != MS_BR_OK) {
+        txn->result = ret;
+        txn->state = MS_BR_TXN_DONE;
+        return 1;
+    }
+    return 0;
+}
+
+// Time until the first of the given in flight frames needs a retransmit
+static uint32_t ms_bridging_txn_next_wait(ms_bridging_handler_t *handler, uint32_t mask)
+{
+    int i = 0;
+    uint32_t now_tick = MS_BR_GET_TICK_MS(), elapsed = 0, wait_ms = MS_BR_WAIT_ACK_TIMEOUT_MS;
+
+    for (; i < MS_BR_WINDOW_SIZE; i++) {
+        if ((mask & (1U << i)) == 0 || handler->inflight[i].state != MS_BR_TXN_WAIT) continue;
+        elapsed = MS_BR_TICK_DIFF_MS(handler->inflight[i].sent_tick, now_tick);
+        if (elapsed >= handler->inflight[i].rto_ms) return 0;
+        if (handler->inflight[i].rto_ms - elapsed < wait_ms) wait_ms = handler->inflight[i].rto_ms - elapsed;
+    }
+    return wait_ms;
+}
+
+// Send one frame and wait for its ack
+static int ms_bridging_transfer(ms_bridging_handler_t *handler, ms_bridging_frame_type_t type, ms_bridging_frame_cmd_t cmd, void *data, uint16_t len,
+                                ms_bridging_frame_type_t ack_type, uint8_t is_probe, void **data_out, uint16_t *len_out)
+{
+    int ret = MS_BR_OK, slot = -1;
+    ms_bridging_inflight_t *txn = NULL;
+
+    slot = ms_bridging_txn_acquire(handler, is_probe, MS_BR_WAIT_ACK_TIMEOUT_MS * (MS_BR_RETRY_TIMES + 1));
+    if (slot < 0) return slot;
+    txn = &handler->inflight[slot];
+
+    ret = ms_bridging_txn_start(handler, slot, type, cmd, data, len, ack_type);
+    if (ret == MS_BR_OK) {
+        while (ms_bridging_txn_poll(handler, slot) == 0) {
+            ms_bridging_wait_signal(handler, 1U << slot, ms_bridging_txn_next_wait(handler, 1U << slot));
+        }
+        ret = txn->result;
+    }
+    if (ret == MS_BR_OK && txn->data_out != NULL && data_out != NULL && len_out != NULL) {
+        *data_out = txn->data_out;
+        *len_out = txn->len_out;
+        txn->data_out = NULL;
+    }
+    ms_bridging_txn_release(handler, slot);
+    return ret;
+}
+
 ms_bridging_handler_t *ms_bridging_init(ms_bridging_send_func_t send_func, ms_bridging_notify_cb_t event_cb)
 {
     ms_bridging_handler_t *handler = NULL;
@@ -188,22 +508,32 @@ ms_bridging_handler_t *ms_bridging_init(ms_bridging_send_func_t send_func, ms_br
     if (handler == NULL) return NULL;
     memset(handler, 0, sizeof(ms_bridging_handler_t));
 #if defined(MS_BR_SEM_CREATE) && defined(MS_BR_SEM_DELETE) && defined(MS_BR_SEM_WAIT) && defined(MS_BR_SEM_POST)
-    handler->ack_sem = MS_BR_SEM_CREATE();
-    if (handler->ack_sem == NULL) {
-        MS_BR_FREE(handler);
-        return NULL;
-    }
     handler->notify_sem = MS_BR_SEM_CREATE();
-    if (handler->notify_sem == NULL) {
-        MS_BR_SEM_DELETE(handler->ack_sem);
-        MS_BR_FREE(handler);
-        return NULL;
-    }
+    if (handler->notify_sem == NULL) goto ms_bridging_init_err;
+#endif
+#ifdef MS_BR_USE_EVT
+    handler->ack_evt = MS_BR_EVT_CREATE();
+    if (handler->ack_evt == NULL) goto ms_bridging_init_err;
+#endif
+#ifdef MS_BR_USE_MUTEX
+    handler->lock = MS_BR_MUTEX_CREATE();
+    if (handler->lock == NULL) goto ms_bridging_init_err;
 #endif
     handler->send_func = send_func;
     handler->notify_cb = event_cb;
+    handler->window = 1;
     handler->is_ready = 1;
     return handler;
+
+ms_bridging_init_err:
+#if defined(MS_BR_SEM_CREATE) && defined(MS_BR_SEM_DELETE) && defined(MS_BR_SEM_WAIT) && defined(MS_BR_SEM_POST)
+    if (handler->notify_sem != NULL) MS_BR_SEM_DELETE(handler->notify_sem);
+#endif
+#ifdef MS_BR_USE_EVT
+    if (handler->ack_evt != NULL) MS_BR_EVT_DELETE(handler->ack_evt);
+#endif
+    MS_BR_FREE(handler);
+    return NULL;
 }
 
 void ms_bridging_deinit(ms_bridging_handler_t *handler)
@@ -213,9 +543,9 @@ void ms_bridging_deinit(ms_bridging_handler_t *handler)
 
     handler->is_ready = 0;
 #if defined(MS_BR_SEM_CREATE) && defined(MS_BR_SEM_DELETE) && defined(MS_BR_SEM_WAIT) && defined(MS_BR_SEM_POST)
-    MS_BR_SEM_POST(handler->ack_sem);
     MS_BR_SEM_POST(handler->notify_sem);
 #endif
+    ms_bridging_signal(handler, MS_BR_TXN_ALL_MASK | MS_BR_EVT_SLOT_FREE);
     for (; i < MS_BR_FRAME_BUF_NUM; i++) {
         if (handler->ack_frame[i].data != NULL) {
             MS_BR_FREE(handler->ack_frame[i].data);
@@ -234,14 +564,22 @@ void ms_bridging_deinit(ms_bridging_handler_t *handler)
         handler->input_frame.is_valid = 0;
     }
 #if defined(MS_BR_SEM_CREATE) && defined(MS_BR_SEM_DELETE) && defined(MS_BR_SEM_WAIT) && defined(MS_BR_SEM_POST)
-    if (handler->ack_sem != NULL) {
-        MS_BR_SEM_DELETE(handler->ack_sem);
-        handler->ack_sem = NULL;
-    }
     if (handler->notify_sem != NULL) {
         MS_BR_SEM_DELETE(handler->notify_sem);
         handler->notify_sem = NULL;
     }
+#endif
+#ifdef MS_BR_USE_EVT
+    if (handler->ack_evt != NULL) {
+        MS_BR_EVT_DELETE(handler->ack_evt);
+        handler->ack_evt = NULL;
+    }
+#endif
+#ifdef MS_BR_USE_MUTEX
+    if (handler->lock != NULL) {
+        MS_BR_MUTEX_DELETE(handler->lock);
+        handler->lock = NULL;
+    }
 #endif
     MS_BR_FREE(handler);
 }
@@ -277,11 +615,19 @@ void ms_bridging_recv(ms_bridging_handler_t *handler, uint8_t *buf, uint16_t len
     
     for (; i < len; i++) {
         if (handler->is_ready == 0) return;
-        if (handler->input_frame_len == 0 && buf[i] != MS_BR_FRAME_SOF) return;
+        // Resync on the next start of frame, back-to-back frames may share one receive chunk
+        if (handler->input_frame_len == 0 && buf[i] != MS_BR_FRAME_SOF) continue;
         if (handler->input_frame_len > MS_BR_BUF_MAX_SIZE) goto ms_bridging_recv_err;
         if (handler->input_frame_len < MS_BR_FRAME_HEADER_LEN) {
             ((uint8_t *)&(handler->input_frame.header))[handler->input_frame_len] = buf[i];
             handler->input_frame_len++;
+            // A damaged length would otherwise swallow the frames queued behind this one
+            if (handler->input_frame_len == MS_BR_FRAME_HEADER_LEN
+                && (handler->input_frame.header.len > MS_BR_BUF_MAX_SIZE
+                    || ms_bridging_crc16((uint8_t *)&(handler->input_frame.header), MS_BR_FRAME_HEADER_LEN - 2) != handler->input_frame.header.crc)) {
+                handler->input_frame_len = 0;
+                continue;
+            }
         } else if (handler->input_frame_len < MS_BR_FRAME_HEADER_LEN + handler->input_frame.header.len) {
             if (handler->input_frame.data == NULL) {
                 handler->input_frame.data = (uint8_t *)MS_BR_MALLOC(handler->input_frame.header.len);
@@ -313,18 +659,25 @@ void ms_bridging_polling(ms_bridging_handler_t *handler)
 {
     int i = 0;
     uint32_t now_tick = 0;
+    ms_bridging_frame_t *frame = NULL;
     if (handler == NULL) goto ms_bridging_polling_end;
 
     for (; i < MS_BR_FRAME_BUF_NUM; i++) {
         if (handler->is_ready == 0) goto ms_bridging_polling_end;
-        if (handler->notify_frame[i].is_valid == 1) {
-            handler->notify_cb(handler, &handler->notify_frame[i]);
-            if (handler->notify_frame[i].data != NULL) {
-                MS_BR_FREE(handler->notify_frame[i].data);
-                handler->notify_frame[i].data = NULL;
-            }
-            handler->notify_frame[i].is_valid = 0;
+        frame = &handler->notify_frame[handler->notify_head];
+        if (frame->is_valid != 1) break;
+        if (ms_bridging_deal_internal_frame(handler, frame) != MS_BR_OK) {
+            handler->notify_cb(handler, frame);
+        }
+        if (frame->data != NULL) {
+            MS_BR_FREE(frame->data);
+            frame->data = NULL;
         }
+        frame->is_valid = 0;
+        handler->notify_head = (handler->notify_head + 1) % MS_BR_FRAME_BUF_NUM;
+    }
+
+    for (i = 0; i < MS_BR_FRAME_BUF_NUM; i++) {
         if (handler->is_ready == 0) goto ms_bridging_polling_end;
         if (handler->ack_frame[i].is_valid == 1) {
             now_tick = MS_BR_GET_TICK_MS();
@@ -350,32 +703,97 @@ ms_bridging_polling_end:
 
 int ms_bridging_request(ms_bridging_handler_t *handler, ms_bridging_frame_cmd_t cmd, void *data, uint16_t len, void **data_out, uint16_t *len_out)
 {
-    int ret = MS_BR_OK, retry_times = 0;
-    ms_bridging_frame_t frame = {0};
     if (handler == NULL) return MS_BR_ERR_INVALID_ARG;
 
-    ret = ms_bridging_build_frame(handler, &frame, MS_BR_FRAME_TYPE_REQUEST, cmd, (uint8_t *)data, len);
-    if (ret != MS_BR_OK) return ret;
+    return ms_bridging_transfer(handler, MS_BR_FRAME_TYPE_REQUEST, cmd, data, len, MS_BR_FRAME_TYPE_RESPONSE, 0, data_out, len_out);
+}
 
-    do {
-        if (handler->is_ready == 0) return MS_BR_ERR_INVALID_STATE;
+int ms_bridging_request_batch(ms_bridging_handler_t *handler, ms_bridging_batch_item_t *items, uint16_t count)
+{
+    int ret = MS_BR_OK, slot = -1, i = 0, progress = 0;
+    int16_t slot_item[MS_BR_WINDOW_SIZE];
+    uint16_t next = 0, done = 0;
+    uint32_t pending = 0;
+    ms_bridging_batch_item_t *item = NULL;
+    if (handler == NULL || (items == NULL && count > 0)) return MS_BR_ERR_INVALID_ARG;
 
-        ret = ms_bridging_send_frame(handler, &frame);
-        if (ret != MS_BR_OK) return ret;
+    for (i = 0; i < count; i++) {
+        items[i].data_out = NULL;
+        items[i].len_out = 0;
+        items[i].result = MS_BR_ERR_TIMEOUT;
+    }
 
-        ret = ms_bridging_wait_for_ack(handler, MS_BR_FRAME_TYPE_RESPONSE, cmd, frame.header.id, &frame);
-        if (ret == MS_BR_OK && frame.header.len > 0 && frame.data != NULL && data_out != NULL && len_out != NULL) {
-            *data_out = MS_BR_MALLOC(frame.header.len);
-            if (*data_out == NULL) {
-                MS_BR_FREE(frame.data);
-                return MS_BR_ERR_NO_MEM;
+    while (done < count) {
+        // Fill the window, only block for a slot while nothing of ours is in flight
+        while (next < count) {
+            slot = ms_bridging_txn_acquire(handler, 0, pending ? 0 : MS_BR_WAIT_ACK_TIMEOUT_MS * (MS_BR_RETRY_TIMES + 1));
+            if (slot < 0) {
+                if (pending) break;
+                for (; next < count; next++, done++) items[next].result = slot;
+                break;
+            }
+            item = &items[next];
+            ret = ms_bridging_txn_start(handler, slot, MS_BR_FRAME_TYPE_REQUEST, item->cmd, item->data, item->len, MS_BR_FRAME_TYPE_RESPONSE);
+            if (ret != MS_BR_OK) {
+                item->result = ret;
+                ms_bridging_txn_release(handler, slot);
+                next++;
+                done++;
+                continue;
             }
-            memcpy(*data_out, frame.data, frame.header.len);
-            *len_out = frame.header.len;
-            MS_BR_FREE(frame.data);
+            slot_item[slot] = next++;
+            pending |= 1U << slot;
         }
-    } while (retry_times++ < MS_BR_RETRY_TIMES && ret != MS_BR_OK);
-    
+        if (pending == 0) continue;
+
+        progress = 0;
+        for (i = 0; i < MS_BR_WINDOW_SIZE; i++) {
+            if ((pending & (1U << i)) == 0 || ms_bridging_txn_poll(handler, i) == 0) continue;
+            item = &items[slot_item[i]];
+            item->result = handler->inflight[i].result;
+            if (item->result == MS_BR_OK) {
+                item->data_out = handler->inflight[i].data_out;
+                item->len_out = handler->inflight[i].len_out;
+                handler->inflight[i].data_out = NULL;
+            }
+            ms_bridging_txn_release(handler, i);
+            pending &= ~(1U << i);
+            done++;
+            progress = 1;
+        }
+        if (!progress && pending) {
+            ms_bridging_wait_signal(handler, pending, ms_bridging_txn_next_wait(handler, pending));
+        }
+    }
+
+    for (i = 0; i < count; i++) {
+        if (items[i].result != MS_BR_OK) return items[i].result;
+    }
+    return MS_BR_OK;
+}
+
+int ms_bridging_negotiate(ms_bridging_handler_t *handler)
+{
+    int ret = MS_BR_OK;
+    void *data_out = NULL;
+    uint16_t len_out = 0;
+    ms_bridging_caps_t caps = {0}, peer_caps = {0};
+    if (handler == NULL) return MS_BR_ERR_INVALID_ARG;
+
+    caps.version = MS_BR_PROTO_VERSION;
+    caps.window = MS_BR_WINDOW_SIZE;
+    ret = ms_bridging_transfer(handler, MS_BR_FRAME_TYPE_REQUEST, MS_BR_FRAME_CMD_GET_CAPS, &caps, sizeof(ms_bridging_caps_t), MS_BR_FRAME_TYPE_RESPONSE, 1, &data_out, &len_out);
+    if (ret == MS_BR_OK && data_out != NULL && len_out >= sizeof(ms_bridging_caps_t)) {
+        memcpy(&peer_caps, data_out, sizeof(ms_bridging_caps_t));
+        if (peer_caps.window == 0) peer_caps.window = 1;
+        handler->window = (peer_caps.window < MS_BR_WINDOW_SIZE) ? peer_caps.window : MS_BR_WINDOW_SIZE;
+    } else {
+        if (ret == MS_BR_OK) ret = MS_BR_ERR_INVALID_FMT;
+        handler->window = 1;
+    }
+    if (data_out != NULL) MS_BR_FREE(data_out);
+
+    MS_BR_LOGD("Peer window: %d, ret: %d", handler->window, ret);
     return ret;
 }
 
@@ -392,28 +810,14 @@ int ms_bridging_response(ms_bridging_handler_t *handler, ms_bridging_frame_t *re
     frame.data = data;
     ms_bridging_calculate_frame_crc(&frame);
     
-    return ms_bridging_send_frame(handler, &frame);
+    return ms_bridging_send_reply(handler, &frame);
 }
 
 int ms_bridging_send_event(ms_bridging_handler_t *handler, ms_bridging_frame_cmd_t cmd, void *data, uint16_t len)
 {
-    int ret = MS_BR_OK, retry_times = 0;
-    ms_bridging_frame_t frame = {0};
     if (handler == NULL) return MS_BR_ERR_INVALID_ARG;
 
-    ret = ms_bridging_build_frame(handler, &frame, MS_BR_FRAME_TYPE_EVENT, cmd, (uint8_t *)data, len);
-    if (ret != MS_BR_OK) return ret;
-
-    do {
-        if (handler->is_ready == 0) return MS_BR_ERR_INVALID_STATE;
-
-        ret = ms_bridging_send_frame(handler, &frame);
-        if (ret != MS_BR_OK) return ret;
-
-        ret = ms_bridging_wait_for_ack(handler, MS_BR_FRAME_TYPE_EVENT_ACK, cmd, frame.header.id, &frame);
-    } while (retry_times++ < MS_BR_RETRY_TIMES && ret != MS_BR_OK);
-    
-    return ret;
+    return ms_bridging_transfer(handler, MS_BR_FRAME_TYPE_EVENT, cmd, data, len, MS_BR_FRAME_TYPE_EVENT_ACK, 0, NULL, NULL);
 }
 
 int ms_bridging_event_ack(ms_bridging_handler_t *handler, ms_bridging_frame_t *event_frame)
@@ -428,7 +832,7 @@ int ms_bridging_event_ack(ms_bridging_handler_t *handler, ms_bridging_frame_t *e
     frame.header.cmd = event_frame->header.cmd;
     ms_bridging_calculate_frame_crc(&frame);
     
-    return ms_bridging_send_frame(handler, &frame);
+    return ms_bridging_send_reply(handler, &frame);
 }
 
 // Convenience functions for common operations
@@ -54,9 +54,9 @@ static int nvs_flash_al_wrt(nvs_fs_t *fs, uint32_t addr, const void *data,
     offset += addr & ADDR_OFFS_MASK;
     if(fs->flash_ops.flash_write_protection_set != NULL) {
         rc = fs->flash_ops.flash_write_protection_set(false);
-    }
-    if (rc) {
-        return rc;
+        if (rc) {
+            return rc;
+        }
     }
     blen = len & ~(fs->flash_parameters.write_block_size - 1U);
     if (blen > 0) {
@@ -235,9 +235,9 @@ static int nvs_flash_erase_sector(nvs_fs_t *fs, uint32_t addr)
 
     if(fs->flash_ops.flash_write_protection_set != NULL) {
         rc = fs->flash_ops.flash_write_protection_set(false);
-    }
-    if (rc) {
-        return rc;
+        if (rc) {
+            return rc;
+        }
     }
 
     rc = fs->flash_ops.flash_erase(offset, fs->sector_size);
@@ -419,18 +419,23 @@ static int nvs_sector_close(nvs_fs_t *fs)
     return 0;
 }
 
-static int nvs_gc(nvs_fs_t *fs)
+/*
+ * Garbage collection of the sector after the write sector, split in steps:
+ * nvs_gc_begin locates its entries, nvs_gc_copy moves live entries into the
+ * write sector and nvs_gc_erase erases it. The flash sees the same sequence
+ * whether the steps run back to back or spread over time, as long as no new
+ * entry is written in between (nvs_write completes a pending collection
+ * first), so an interrupted collection is recovered by nvs_startup as before.
+ */
+// Entry walk bounds of a closed sector, 1 if the sector was never closed
+static int nvs_sector_entries(nvs_fs_t *fs, uint32_t sec_addr, uint32_t *addr, uint32_t *stop_addr)
 {
     int rc;
-    struct nvs_ate close_ate, gc_ate, wlk_ate;
-    uint32_t sec_addr, gc_addr, gc_prev_addr, wlk_addr, wlk_prev_addr,
-          data_addr, stop_addr;
+    struct nvs_ate close_ate;
+    uint32_t gc_addr;
     size_t ate_size;
 
     ate_size = nvs_al_size(fs, sizeof(struct nvs_ate));
-
-    sec_addr = (fs->ate_wra & ADDR_SECT_MASK);
-    nvs_sector_advance(fs, &sec_addr);
     gc_addr = sec_addr + fs->sector_size - ate_size;
 
     rc = nvs_flash_ate_rd(fs, gc_addr, &close_ate);
@@ -440,14 +445,10 @@ static int nvs_gc(nvs_fs_t *fs)
 
     rc = nvs_ate_cmp_const(&close_ate, fs->flash_parameters.erase_value);
     if (!rc) {
-        rc = nvs_flash_erase_sector(fs, sec_addr);
-        if (rc) {
-            return rc;
-        }
-        return 0;
+        return 1;
     }
 
-    stop_addr = gc_addr - ate_size;
+    *stop_addr = gc_addr - ate_size;
 
     if (!nvs_ate_crc8_check(&close_ate)) {
         gc_addr &= ADDR_SECT_MASK;
@@ -459,31 +460,128 @@ static int nvs_gc(nvs_fs_t *fs)
         }
     }
 
+    *addr = gc_addr;
+    return 0;
+}
+
+// Whether the entry read from before gc_prev_addr is the newest one of its key
+static int nvs_gc_entry_live(nvs_fs_t *fs, uint32_t gc_prev_addr, const struct nvs_ate *gc_ate)
+{
+    int rc;
+    struct nvs_ate wlk_ate;
+    uint32_t wlk_addr, wlk_prev_addr;
+
+    wlk_addr = fs->ate_wra;
+    do {
+        wlk_prev_addr = wlk_addr;
+        rc = nvs_prev_ate(fs, &wlk_addr, &wlk_ate);
+        if (rc) {
+            return rc;
+        }
+        if ((strncmp(wlk_ate.key, gc_ate->key, NVS_KEY_SIZE) == 0) &&
+            (!nvs_ate_crc8_check(&wlk_ate))) {
+            break;
+        }
+    } while (wlk_addr != fs->ate_wra);
+
+    return (wlk_prev_addr == gc_prev_addr) && gc_ate->len;
+}
+
+static int nvs_gc_begin(nvs_fs_t *fs)
+{
+    int rc;
+    uint32_t sec_addr;
+
+    sec_addr = (fs->ate_wra & ADDR_SECT_MASK);
+    nvs_sector_advance(fs, &sec_addr);
+    fs->gc_sec_addr = sec_addr;
+
+    rc = nvs_sector_entries(fs, sec_addr, &fs->gc_addr, &fs->gc_stop_addr);
+    if (rc < 0) {
+        return rc;
+    }
+    fs->gc_state = rc ? NVS_GC_ERASE : NVS_GC_COPY;
+    return 0;
+}
+
+/*
+ * Space left in the write sector if the write sector were closed now and
+ * the sector after it collected: a sector minus its close entry, the first
+ * free entry slot and the live entries moved in. Reads only.
+ */
+static int nvs_gc_space_after(nvs_fs_t *fs, size_t *space)
+{
+    int rc;
+    struct nvs_ate gc_ate;
+    uint32_t sec_addr, gc_addr, gc_prev_addr, stop_addr;
+    size_t ate_size, live = 0;
+
+    ate_size = nvs_al_size(fs, sizeof(struct nvs_ate));
+
+    // Closing moves the write sector on by one, the collection takes the one after
+    sec_addr = (fs->ate_wra & ADDR_SECT_MASK);
+    nvs_sector_advance(fs, &sec_addr);
+    nvs_sector_advance(fs, &sec_addr);
+
+    *space = fs->sector_size - 2 * ate_size;
+    rc = nvs_sector_entries(fs, sec_addr, &gc_addr, &stop_addr);
+    if (rc < 0) {
+        return rc;
+    }
+    if (rc) {
+        // Never closed, nothing to move in
+        return 0;
+    }
+
     do {
         gc_prev_addr = gc_addr;
         rc = nvs_prev_ate(fs, &gc_addr, &gc_ate);
         if (rc) {
             return rc;
         }
-
         if (nvs_ate_crc8_check(&gc_ate)) {
             continue;
         }
+        rc = nvs_gc_entry_live(fs, gc_prev_addr, &gc_ate);
+        if (rc < 0) {
+            return rc;
+        }
+        if (rc) {
+            live += ate_size + nvs_al_size(fs, gc_ate.len);
+        }
+    } while (gc_prev_addr != stop_addr);
 
-        wlk_addr = fs->ate_wra;
-        do {
-            wlk_prev_addr = wlk_addr;
-            rc = nvs_prev_ate(fs, &wlk_addr, &wlk_ate);
-            if (rc) {
-                return rc;
-            }
-            if ((strncmp(wlk_ate.key, gc_ate.key, NVS_KEY_SIZE) == 0) &&
-                (!nvs_ate_crc8_check(&wlk_ate))) {
-                break;
-            }
-        } while (wlk_addr != fs->ate_wra);
+    *space = live < *space ? *space - live : 0;
+    return 0;
+}
 
-        if ((wlk_prev_addr == gc_prev_addr) && gc_ate.len) {
+// Examine up to max_entries entries of the collected sector, moving live ones
+static int nvs_gc_copy(nvs_fs_t *fs, uint16_t max_entries)
+{
+    int rc;
+    struct nvs_ate gc_ate;
+    uint32_t gc_prev_addr, data_addr;
+
+    while (fs->gc_state == NVS_GC_COPY && max_entries--) {
+        gc_prev_addr = fs->gc_addr;
+        rc = nvs_prev_ate(fs, &fs->gc_addr, &gc_ate);
+        if (rc) {
+            return rc;
+        }
+
+        if (gc_prev_addr == fs->gc_stop_addr) {
+            fs->gc_state = NVS_GC_ERASE;
+        }
+
+        if (nvs_ate_crc8_check(&gc_ate)) {
+            continue;
+        }
+
+        rc = nvs_gc_entry_live(fs, gc_prev_addr, &gc_ate);
+        if (rc < 0) {
+            return rc;
+        }
+        if (rc) {
             data_addr = (gc_prev_addr & ADDR_SECT_MASK);
             data_addr += gc_ate.offset;
 
@@ -500,15 +598,75 @@ static int nvs_gc(nvs_fs_t *fs)
                 return rc;
             }
         }
-    } while (gc_prev_addr != stop_addr);
+    }
+    return 0;
+}
+
+static int nvs_gc_erase(nvs_fs_t *fs)
+{
+    int rc;
 
-    rc = nvs_flash_erase_sector(fs, sec_addr);
+    rc = nvs_flash_erase_sector(fs, fs->gc_sec_addr);
     if (rc) {
         return rc;
     }
+    fs->gc_state = NVS_GC_IDLE;
     return 0;
 }
 
+// Run a started collection to its end
+static int nvs_gc_finish(nvs_fs_t *fs)
+{
+    int rc;
+
+    if (fs->gc_state == NVS_GC_COPY) {
+        rc = nvs_gc_copy(fs, UINT16_MAX);
+        if (rc) {
+            return rc;
+        }
+    }
+    if (fs->gc_state == NVS_GC_ERASE) {
+        return nvs_gc_erase(fs);
+    }
+    return 0;
+}
+
+static int nvs_gc(nvs_fs_t *fs)
+{
+    int rc;
+
+    rc = nvs_gc_begin(fs);
+    if (rc) {
+        return rc;
+    }
+    return nvs_gc_finish(fs);
+}
+
+// Close sectors and collect until required_space fits in the write sector
+static int nvs_make_room(nvs_fs_t *fs, size_t required_space)
+{
+    int rc, gc_count;
+
+    for (gc_count = 0; ; gc_count++) {
+        if (gc_count == fs->sector_count) {
+            return -ENOSPC;
+        }
+        if (fs->ate_wra >= fs->data_wra + required_space) {
+            return 0;
+        }
+
+        rc = nvs_sector_close(fs);
+        if (rc) {
+            return rc;
+        }
+
+        rc = nvs_gc(fs);
+        if (rc) {
+            return rc;
+        }
+    }
+}
+
 static int nvs_startup(nvs_fs_t *fs)
 {
     int rc;
@@ -523,6 +681,7 @@ static int nvs_startup(nvs_fs_t *fs)
 
     fs->mutex_ops.lock(fs->mutex);
 
+    fs->gc_state = NVS_GC_IDLE;
     ate_size = nvs_al_size(fs, sizeof(struct nvs_ate));
 
     for (i = 0; i < fs->sector_count; i++) {
@@ -651,6 +810,7 @@ int nvs_clear(nvs_fs_t *fs)
             return rc;
         }
     }
+    fs->gc_state = NVS_GC_IDLE;
     return 0;
 }
 
@@ -694,7 +854,7 @@ int nvs_init(nvs_fs_t *fs)
 
 size_t nvs_write(nvs_fs_t *fs, const char *key, const void *data, size_t len)
 {
-    int rc, gc_count;
+    int rc;
     size_t ate_size, data_size;
     struct nvs_ate wlk_ate;
     uint32_t wlk_addr, rd_addr;
@@ -758,39 +918,188 @@ size_t nvs_write(nvs_fs_t *fs, const char *key, const void *data, size_t len)
 
     fs->mutex_ops.lock(fs->mutex);
 
-    gc_count = 0;
-    while (1) {
-        if (gc_count == fs->sector_count) {
-            rc = -ENOSPC;
-            goto end;
+    // Nothing may be written between the steps of a collection
+    rc = nvs_gc_finish(fs);
+    if (rc) {
+        goto end;
+    }
+
+    rc = nvs_make_room(fs, required_space);
+    if (rc) {
+        goto end;
+    }
+
+    rc = nvs_flash_wrt_entry(fs, key, data, len);
+    if (rc) {
+        goto end;
+    }
+    rc = len;
+end:
+    fs->mutex_ops.unlock(fs->mutex);
+    return rc;
+}
+
+#define NVS_BATCH_NEW 0         /* key not found yet */
+#define NVS_BATCH_CHANGED 1     /* key found with a different value */
+#define NVS_BATCH_SAME 2        /* flash already holds this value */
+
+int nvs_write_batch(nvs_fs_t *fs, const nvs_write_entry_t *entries,
+            size_t count)
+{
+    int rc, written = 0;
+    size_t ate_size, data_size, i, pending;
+    struct nvs_ate wlk_ate;
+    uint32_t wlk_addr, rd_addr;
+    uint8_t state[NVS_WRITE_BATCH_MAX];
+
+    if (!fs->ready) {
+        printf("NVS not initialized\r\n");
+        return -EACCES;
+    }
+
+    if (count > NVS_WRITE_BATCH_MAX) {
+        return -EINVAL;
+    }
+
+    ate_size = nvs_al_size(fs, sizeof(struct nvs_ate));
+
+    for (i = 0; i < count; i++) {
+        if ((entries[i].len > (fs->sector_size - 3 * ate_size)) ||
+            ((entries[i].len > 0) && (entries[i].data == NULL))) {
+            return -EINVAL;
         }
+    }
 
-        if (fs->ate_wra >= fs->data_wra + required_space) {
+    fs->mutex_ops.lock(fs->mutex);
 
-            rc = nvs_flash_wrt_entry(fs, key, data, len);
-            if (rc) {
-                goto end;
+    rc = nvs_gc_finish(fs);
+    if (rc) {
+        goto end;
+    }
+
+    // One walk of the allocation table finds the latest entry of every key
+    memset(state, NVS_BATCH_NEW, sizeof(state));
+    pending = count;
+    wlk_addr = fs->ate_wra;
+    while (pending) {
+        rd_addr = wlk_addr;
+        rc = nvs_prev_ate(fs, &wlk_addr, &wlk_ate);
+        if (rc) {
+            goto end;
+        }
+        if (!nvs_ate_crc8_check(&wlk_ate)) {
+            for (i = 0; i < count; i++) {
+                if (state[i] != NVS_BATCH_NEW ||
+                    strncmp(wlk_ate.key, entries[i].key, NVS_KEY_SIZE) != 0) {
+                    continue;
+                }
+                state[i] = NVS_BATCH_CHANGED;
+                pending--;
+                if (entries[i].len != wlk_ate.len) {
+                    continue;
+                }
+                rc = 0;
+                if (entries[i].len) {
+                    rc = nvs_flash_block_cmp(fs,
+                        (rd_addr & ADDR_SECT_MASK) + wlk_ate.offset,
+                        entries[i].data, entries[i].len);
+                    if (rc < 0) {
+                        goto end;
+                    }
+                }
+                if (!rc) {
+                    state[i] = NVS_BATCH_SAME;
+                }
             }
+        }
+        if (wlk_addr == fs->ate_wra) {
             break;
         }
+    }
 
-        rc = nvs_sector_close(fs);
+    // Written back to back: the batch costs at most the collections its size needs
+    for (i = 0; i < count; i++) {
+        if (state[i] == NVS_BATCH_SAME ||
+            (state[i] == NVS_BATCH_NEW && entries[i].len == 0)) {
+            continue;
+        }
+
+        data_size = nvs_al_size(fs, entries[i].len);
+        rc = nvs_make_room(fs, data_size ? data_size + ate_size : 0);
         if (rc) {
             goto end;
         }
 
-        rc = nvs_gc(fs);
+        rc = nvs_flash_wrt_entry(fs, entries[i].key, entries[i].data,
+                     entries[i].len);
         if (rc) {
             goto end;
         }
-        gc_count++;
+        written++;
     }
-    rc = len;
+    rc = written;
 end:
     fs->mutex_ops.unlock(fs->mutex);
     return rc;
 }
 
+int nvs_gc_step(nvs_fs_t *fs, size_t watermark, uint16_t max_entries)
+{
+    int rc = 0;
+
+    if (!fs->ready) {
+        return -EACCES;
+    }
+
+    fs->mutex_ops.lock(fs->mutex);
+
+    switch (fs->gc_state) {
+    case NVS_GC_IDLE:
+        if (fs->ate_wra >= fs->data_wra + watermark) {
+            break;
+        }
+        // Nothing written since the last check found the collection not worth it
+        if (fs->gc_checked_wra == fs->ate_wra) {
+            break;
+        }
+        // Collect only if it leaves the write sector above the watermark, otherwise
+        // every call would erase another sector of live entries for nothing
+        size_t space;
+        rc = nvs_gc_space_after(fs, &space);
+        if (rc) {
+            break;
+        }
+        if (space < watermark) {
+            fs->gc_checked_wra = fs->ate_wra;
+            break;
+        }
+        // Same as a writer finding the sector full, only earlier
+        rc = nvs_sector_close(fs);
+        if (!rc) {
+            rc = nvs_gc_begin(fs);
+        }
+        if (rc || fs->gc_state != NVS_GC_COPY) {
+            break;
+        }
+        // fall through
+    case NVS_GC_COPY:
+        rc = nvs_gc_copy(fs, max_entries ? max_entries : 1);
+        break;
+    case NVS_GC_ERASE:
+        rc = nvs_gc_erase(fs);
+        break;
+    default:
+        rc = -EINVAL;
+        break;
+    }
+
+    if (!rc && fs->gc_state != NVS_GC_IDLE) {
+        rc = 1;
+    }
+    fs->mutex_ops.unlock(fs->mutex);
+    return rc;
+}
+
 int nvs_delete(nvs_fs_t *fs, const char *key)
 {
     return nvs_write(fs, key, NULL, 0);
@@ -30,6 +30,14 @@ extern "C" {
 
 #define NVS_BLOCK_SIZE 32
 #define NVS_KEY_SIZE 24
+#define NVS_WRITE_BATCH_MAX 32
+
+/*
+ * Garbage collection state
+ */
+#define NVS_GC_IDLE 0
+#define NVS_GC_COPY 1	/* moving live entries out of gc_sec_addr */
+#define NVS_GC_ERASE 2	/* gc_sec_addr holds nothing live, erase pending */
 
 /* Allocation Table Entry */
 struct nvs_ate {
@@ -83,6 +91,11 @@ typedef struct nvs_fs {
 				 */
 	uint16_t sector_count;	/* amount of sectors in the filesystem */
 	bool ready;		/* is the filesystem initialized ? */
+	uint8_t gc_state;	/* NVS_GC_IDLE, NVS_GC_COPY or NVS_GC_ERASE */
+	uint32_t gc_sec_addr;	/* sector under collection */
+	uint32_t gc_addr;	/* next entry of that sector to examine */
+	uint32_t gc_stop_addr;	/* last entry of that sector */
+	uint32_t gc_checked_wra;	/* ate_wra when nvs_gc_step last found nothing to gain */
     nvs_flash_ops_t flash_ops;
 	struct flash_parameter flash_parameters;
     nvs_mutex_ops_t mutex_ops;
@@ -147,6 +160,53 @@ int nvs_clear(nvs_fs_t *fs);
 
 size_t nvs_write(nvs_fs_t *fs, const char *key, const void *data, size_t len);
 
+/**
+ * @brief Entry of a batched write
+ */
+typedef struct {
+	const char *key;
+	const void *data;
+	size_t len;	/* 0 deletes the key */
+} nvs_write_entry_t;
+
+/**
+ * @brief nvs_write_batch
+ *
+ * Write several entries under one lock. A single walk of the allocation
+ * table finds the entries whose value is already in flash, the others are
+ * written back to back. Entries are independent: a failure part way leaves
+ * the earlier ones written.
+ *
+ * @param fs Pointer to file system
+ * @param entries Entries to write, keys must be distinct
+ * @param count Number of entries, at most NVS_WRITE_BATCH_MAX
+ * @retval Number of entries written, unchanged ones are not counted
+ * @retval -ERRNO errno code if error
+ */
+int nvs_write_batch(nvs_fs_t *fs, const nvs_write_entry_t *entries,
+		    size_t count);
+
+/**
+ * @brief nvs_gc_step
+ *
+ * Run one bounded step of garbage collection ahead of the writers. A
+ * collection starts when the write sector has less than watermark bytes
+ * left and collecting would leave at least watermark bytes, so sectors full
+ * of live entries are not erased over and over; that check is repeated only
+ * after new writes. Each following call examines at most max_entries entries
+ * or erases the collected sector. A write arriving while a collection is in progress
+ * completes it first, so crash recovery is the same as for a collection
+ * started by nvs_write.
+ *
+ * @param fs Pointer to file system
+ * @param watermark Free bytes in the write sector below which to collect
+ * @param max_entries Entries examined per call
+ * @retval 1 Collection in progress, call again
+ * @retval 0 Nothing to do
+ * @retval -ERRNO errno code if error
+ */
+int nvs_gc_step(nvs_fs_t *fs, size_t watermark, uint16_t max_entries);
+
 /**
  * @brief nvs_delete
  *
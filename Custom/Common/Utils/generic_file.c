@@ -48,8 +48,9 @@ int file_fclose(void *fd)
     if (inst == NULL || inst->ops == NULL || inst->ops->fclose == NULL)
         return -1;
     
+    // Backends release the handle even when closing reports an error
     int ret = inst->ops->fclose(inst->context, fd);
-    if (ret == 0) {
+    if (fd != NULL) {
         inst->open_count--;
     }
     return ret;
@@ -154,6 +155,14 @@ int file_stat(const char *filename, struct stat *st)
 
 }
 
+int file_fallocate(void *fd, uint64_t size)
+{
+    file_instance_t* inst = get_current_instance();
+    if(inst == NULL || inst->ops == NULL || inst->ops->fallocate == NULL)
+        return -1;
+    return inst->ops->fallocate(inst->context, fd, size);
+}
+
 int file_ops_register(FS_Type_t type, file_ops_t *ops, void *context) 
 {
     if (ops == NULL || type < 0 || type >= FS_MAX) return -1;
@@ -257,8 +266,9 @@ int disk_file_fclose(FS_Type_t type, void *fd)
     if (inst == NULL || inst->ops == NULL || inst->ops->fclose == NULL)
         return -1;
     
+    // Backends release the handle even when closing reports an error
     int ret = inst->ops->fclose(inst->context, fd);
-    if (ret == 0) {
+    if (fd != NULL) {
         inst->open_count--;
     }
     return ret;
@@ -372,3 +382,12 @@ int disk_file_stat(FS_Type_t type, const char *filename, struct stat *st)
         return -1;
     return inst->ops->stat(inst->context, filename, st);
 }
+
+int disk_file_fallocate(FS_Type_t type, void *fd, uint64_t size)
+{
+    if(type < 0 || type >= FS_MAX) return -1;
+    file_instance_t* inst = &instances[type];
+    if(inst == NULL || inst->ops == NULL || inst->ops->fallocate == NULL)
+        return -1;
+    return inst->ops->fallocate(inst->context, fd, size);
+}
@@ -5,6 +5,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <stdbool.h>
+#include <stdint.h>
 #include <sys/stat.h>
 
 #define MAX_FILENAME_LEN 64
@@ -34,6 +35,7 @@ typedef struct file_ops_t {
     int (*readdir)(void *context, void *dd, char *info);
     int (*closedir)(void *context, void *dd);
     int (*stat)(void *context, const char *filename, struct stat *st);
+    int (*fallocate)(void *context, void *fd, uint64_t size);     // optional, reserve space for a known final size
 } file_ops_t;
 
 typedef struct {
@@ -69,6 +71,8 @@ int file_readdir(void *dd, char *info);
 
 int file_stat(const char *filename, struct stat *st);
 
+int file_fallocate(void *fd, uint64_t size);
+
 int file_ops_register(FS_Type_t type, file_ops_t *ops, void *context);
 
 int file_ops_unregister(int handle);
@@ -101,4 +105,6 @@ int disk_file_readdir(FS_Type_t type, void *dd, char *info);
 
 int disk_file_stat(FS_Type_t type, const char *filename, struct stat *st);
 
+int disk_file_fallocate(FS_Type_t type, void *fd, uint64_t size);
+
 #endif
\ No newline at end of file
@@ -0,0 +1,84 @@
+#include "generic_time.h"
+
+#if defined(__linux__) && !defined(__ARM_ARCH_8_1M_MAIN__)
+
+#include <time.h>
+
+uint64_t generic_time_us(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000ULL + (uint64_t)ts.tv_nsec / 1000ULL;
+}
+
+#else
+
+#include "stm32n6xx.h"
+#include "cmsis_os2.h"
+
+typedef struct {
+    uint8_t initialized;
+    uint32_t last_cyccnt;
+    uint64_t cycles;        // CYCCNT extended to 64 bits
+    uint32_t last_tick;
+    uint64_t ticks;         // kernel tick extended to 64 bits
+    uint64_t last_us;
+} generic_time_t;
+
+static generic_time_t g_time = {0};
+
+static void generic_time_init(uint32_t cycles_per_us)
+{
+    DCB->DEMCR |= DCB_DEMCR_TRCENA_Msk;
+    DWT->CYCCNT = 0;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+
+    g_time.last_cyccnt = 0;
+    g_time.last_tick = osKernelGetTickCount();
+    g_time.ticks = g_time.last_tick;
+    g_time.cycles = g_time.ticks * 1000000ULL / osKernelGetTickFreq() * cycles_per_us;
+    g_time.last_us = 0;
+    g_time.initialized = 1;
+}
+
+uint64_t generic_time_us(void)
+{
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+
+    uint32_t cycles_per_us = SystemCoreClock / 1000000U;
+    if (cycles_per_us == 0) cycles_per_us = 1;
+    if (!g_time.initialized) generic_time_init(cycles_per_us);
+
+    uint32_t cyccnt = DWT->CYCCNT;
+    g_time.cycles += (uint32_t)(cyccnt - g_time.last_cyccnt);
+    g_time.last_cyccnt = cyccnt;
+
+    uint64_t us = g_time.cycles / cycles_per_us;
+
+    // CYCCNT wraps every few seconds and stops in some low power modes, so
+    // keep it within a couple of kernel ticks of the tick based time
+    if (osKernelGetState() == osKernelRunning) {
+        uint32_t tick_freq = osKernelGetTickFreq();
+        uint32_t tick = osKernelGetTickCount();
+        g_time.ticks += (uint32_t)(tick - g_time.last_tick);
+        g_time.last_tick = tick;
+
+        uint64_t tick_period_us = 1000000ULL / tick_freq;
+        uint64_t tick_us = g_time.ticks * 1000000ULL / tick_freq;
+        if (us + tick_period_us < tick_us || us > tick_us + 2 * tick_period_us) {
+            us = tick_us;
+            g_time.cycles = tick_us * cycles_per_us;
+        }
+    }
+
+    if (us < g_time.last_us) {
+        us = g_time.last_us;
+    }
+    g_time.last_us = us;
+
+    __set_PRIMASK(primask);
+    return us;
+}
+
+#endif
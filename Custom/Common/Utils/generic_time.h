@@ -0,0 +1,31 @@
+#ifndef GENERIC_TIME_H
+#define GENERIC_TIME_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Monotonic microsecond clock
+ * @details On target the DWT cycle counter is extended to 64 bits and kept
+ *          in step with the kernel tick, so values never go backwards even
+ *          if the core clock changes or the counter wraps unobserved.
+ *          Safe to call from threads and interrupts.
+ * @return Microseconds since an arbitrary epoch (boot on target)
+ */
+uint64_t generic_time_us(void);
+
+/**
+ * @brief Monotonic millisecond clock derived from generic_time_us()
+ */
+static inline uint32_t generic_time_ms(void)
+{
+    return (uint32_t)(generic_time_us() / 1000ULL);
+}
+
+#ifdef __cplusplus
+}
+#endif
+#endif
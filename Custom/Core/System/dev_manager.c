@@ -42,6 +42,50 @@ static inline void list_del(struct list_head *entry)
     entry->prev = NULL;
 }
 
+// FNV-1a over the device name
+static unsigned int name_hash(const char *name)
+{
+    unsigned int hash = 2166136261u;
+    while (*name) {
+        hash ^= (unsigned char)*name++;
+        hash *= 16777619u;
+    }
+    return hash % DEV_NAME_HASH_SIZE;
+}
+
+static void name_hash_add(device_t *dev)
+{
+    unsigned int bucket = name_hash(dev->name);
+    dev->hash_next = g_dev_mgr.name_hash[bucket];
+    g_dev_mgr.name_hash[bucket] = dev;
+}
+
+static void name_hash_del(device_t *dev)
+{
+    device_t **pp = &g_dev_mgr.name_hash[name_hash(dev->name)];
+    while (*pp) {
+        if (*pp == dev) {
+            *pp = dev->hash_next;
+            break;
+        }
+        pp = &(*pp)->hash_next;
+    }
+    dev->hash_next = NULL;
+}
+
+// Exact-name lookup, caller holds the lock
+static device_t *name_hash_find(const char *name, dev_type_t type)
+{
+    device_t *dev = g_dev_mgr.name_hash[name_hash(name)];
+    while (dev) {
+        if ((type >= DEV_TYPE_MAX || dev->type == type) && strcmp(dev->name, name) == 0) {
+            return dev;
+        }
+        dev = dev->hash_next;
+    }
+    return NULL;
+}
+
 // Device registration
 int device_register(device_t *dev)
 {
@@ -70,6 +114,8 @@ int device_register(device_t *dev)
     
     // Add to device list
     list_add_tail(&dev->list, &g_dev_mgr.devices[dev->type]);
+    name_hash_add(dev);
+    g_dev_mgr.generation++;
 
     UNLOCK(&g_dev_mgr);
     return 0;
@@ -90,6 +136,8 @@ void device_unregister(device_t *dev)
     
     // Remove from list
     list_del(&dev->list);
+    name_hash_del(dev);
+    g_dev_mgr.generation++;
     
     UNLOCK(&g_dev_mgr);
 }
@@ -100,18 +148,10 @@ device_t *device_find(const char *name, dev_type_t type)
     if (!name || type >= DEV_TYPE_MAX) 
         return NULL;
 
-    device_t *dev = NULL;
     LOCK(&g_dev_mgr);
-    
-    list_for_each_entry(dev, &g_dev_mgr.devices[type], list) {
-        if (strcmp(dev->name, name) == 0) {
-            UNLOCK(&g_dev_mgr);
-            return dev;
-        }
-    }
-    
+    device_t *dev = name_hash_find(name, type);
     UNLOCK(&g_dev_mgr);
-    return NULL;
+    return dev;
 }
 
 // Device operation API
@@ -211,6 +251,12 @@ device_t *device_find_pattern(const char *pattern, dev_type_t type)
     device_t *result = NULL;
     LOCK(&g_dev_mgr);
     
+    // Most lookups use the full device name
+    result = name_hash_find(pattern, type);
+    if (result) {
+        goto found;
+    }
+    
     if (type < DEV_TYPE_MAX) {
         device_t *dev;
         list_for_each_entry(dev, &g_dev_mgr.devices[type], list) {
@@ -237,12 +283,32 @@ found:
     return result;
 }
 
+// Resolve a cached handle, lock-free while the registry is unchanged
+device_t *device_handle_get(device_handle_t *handle)
+{
+    if (!handle) return NULL;
+    
+    unsigned int generation = g_dev_mgr.generation;
+    if (handle->dev && handle->generation == generation) {
+        return handle->dev;
+    }
+    
+    handle->dev = device_find_pattern(handle->pattern, handle->type);
+    handle->generation = generation;
+    return handle->dev;
+}
+
 // Initialize device manager
 void device_manager_init(dev_lock_func_t lock, dev_unlock_func_t unlock)
 {
     for (int i = 0; i < DEV_TYPE_MAX; i++) {
         INIT_LIST_HEAD(&g_dev_mgr.devices[i]);
     }
+    for (int i = 0; i < DEV_NAME_HASH_SIZE; i++) {
+        g_dev_mgr.name_hash[i] = NULL;
+    }
+    // Start at 1 so a zeroed handle never looks resolved
+    g_dev_mgr.generation = 1;
     
     /* Set thread safety callbacks */
     if (lock && unlock) {
@@ -83,12 +83,27 @@ typedef struct device {
     dev_ops_t *ops;             // Device operations set
     void *priv_data;            // Private data
     struct list_head list;      // Linked list node
+    struct device *hash_next;   // Name index bucket chain
 } device_t;
 
+// Cached device lookup, re-resolved when the registry generation changes
+typedef struct {
+    device_t *dev;              // Resolved device (NULL until first use)
+    unsigned int generation;    // Registry generation dev was resolved at
+    const char *pattern;        // Name pattern passed to device_find_pattern
+    dev_type_t type;            // Device type (DEV_TYPE_MAX for any)
+} device_handle_t;
+
+#define DEVICE_HANDLE_INIT(_pattern, _type) { NULL, 0, (_pattern), (_type) }
+
 typedef int (*device_callback_t)(device_t *dev, void *arg);
+#define DEV_NAME_HASH_SIZE 32
+
 // Device manager structure
 typedef struct device_manager {
     struct list_head devices[DEV_TYPE_MAX];  // Linked list head for each device type
+    device_t *name_hash[DEV_NAME_HASH_SIZE]; // Exact-name index over all types
+    volatile unsigned int generation;        // Bumped on every register/unregister
     
     /* Thread safety control */
     bool thread_safe;           // Whether thread safe
@@ -107,5 +122,6 @@ int device_foreach(device_callback_t callback, void *arg);
 int device_foreach_type(dev_type_t type, device_callback_t callback, void *arg);
 int device_count(dev_type_t type);
 device_t *device_find_pattern(const char *pattern, dev_type_t type);
+device_t *device_handle_get(device_handle_t *handle);
 void device_manager_init(dev_lock_func_t lock, dev_unlock_func_t unlock);
 #endif
\ No newline at end of file
@@ -137,6 +137,7 @@
 
 // SSL/TLS - Settings
 #define NVS_KEY_MQTT_VERIFY_HOSTNAME    "mqtt_verify"
+#define NVS_KEY_MQTT_TLS_SESSION        "mqtt_tls_sess"
 
 // Last Will and Testament
 #define NVS_KEY_MQTT_LWT_TOPIC          "mqtt_lwt_t"
@@ -273,6 +273,7 @@ static void parse_mqtt_service(cJSON *json, mqtt_service_config_t *cfg)
         json_save_cert_data(base_cfg, "client_key_data", cfg->base_config.client_key_path, cfg->base_config.client_key_len);
 
         json_get_uint8(base_cfg, "verify_hostname", &cfg->base_config.verify_hostname);
+        json_get_uint8(base_cfg, "tls_session_persist", &cfg->base_config.tls_session_persist);
 
         // Last Will and Testament
         json_get_string(base_cfg, "lwt_topic", cfg->base_config.lwt_topic, sizeof(cfg->base_config.lwt_topic));
@@ -614,6 +615,7 @@ static cJSON *serialize_mqtt_service(const mqtt_service_config_t *cfg)
     serialize_cert_data(base_cfg, "client_key_data", cfg->base_config.client_key_path, cfg->base_config.client_key_len);
 
     cJSON_AddNumberToObject(base_cfg, "verify_hostname", cfg->base_config.verify_hostname);
+    cJSON_AddNumberToObject(base_cfg, "tls_session_persist", cfg->base_config.tls_session_persist);
 
     // Last Will and Testament
     cJSON_AddStringToObject(base_cfg, "lwt_topic", cfg->base_config.lwt_topic);
@@ -169,6 +169,7 @@
             .client_key_len = 0,
             
             .verify_hostname = 0,
+            .tls_session_persist = 0,
             
             // Last Will and Testament
             .lwt_topic = "aicam/status/offline",
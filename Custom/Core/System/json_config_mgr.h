@@ -180,6 +180,7 @@ typedef struct {
     uint16_t client_key_len;                     // Client key length (0 = use strlen)
     
     uint8_t verify_hostname;                     // Verify hostname in SSL
+    uint8_t tls_session_persist;                 // Keep the TLS session (master secret) in NVS across deep sleep
     
     // Last Will and Testament (maps to ms_mqtt_config_t.last_will)
     char lwt_topic[MAX_TOPIC_LENGTH];           // Last will topic
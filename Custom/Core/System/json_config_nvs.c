@@ -529,6 +529,10 @@ static aicam_result_t save_mqtt_base_config_to_nvs(const mqtt_base_config_t *con
     if (result != AICAM_OK)
         LOG_CORE_ERROR("Failed to save MQTT verify hostname to NVS");
 
+    result = json_config_nvs_write_uint8(NVS_KEY_MQTT_TLS_SESSION, config->tls_session_persist);
+    if (result != AICAM_OK)
+        LOG_CORE_ERROR("Failed to save MQTT TLS session persist to NVS");
+
     result = json_config_nvs_write_string(NVS_KEY_MQTT_LWT_TOPIC, config->lwt_topic);
     if (result != AICAM_OK)
         LOG_CORE_ERROR("Failed to save MQTT LWT topic to NVS");
@@ -1201,6 +1205,12 @@ aicam_result_t json_config_load_from_nvs(aicam_global_config_t *config)
     else
         json_config_nvs_write_uint8(NVS_KEY_MQTT_VERIFY_HOSTNAME, config->mqtt_service.base_config.verify_hostname);
 
+    result = json_config_nvs_read_uint8(NVS_KEY_MQTT_TLS_SESSION, &temp_uint8);
+    if (result == AICAM_OK)
+        config->mqtt_service.base_config.tls_session_persist = temp_uint8;
+    else
+        json_config_nvs_write_uint8(NVS_KEY_MQTT_TLS_SESSION, config->mqtt_service.base_config.tls_session_persist);
+
     // Last Will and Testament
     result = json_config_nvs_read_string(NVS_KEY_MQTT_LWT_TOPIC, config->mqtt_service.base_config.lwt_topic, sizeof(config->mqtt_service.base_config.lwt_topic));
     if (result != AICAM_OK)
@@ -0,0 +1,113 @@
+/**
+ * @file video_abr.c
+ * @brief Adaptive bitrate controller for live streaming
+ */
+
+#include "video_abr.h"
+#include <string.h>
+
+#define VIDEO_ABR_RTT_BASE_AGE_MS   10000   // Let the RTT baseline follow route changes
+
+void video_abr_get_default_config(video_abr_config_t *config, uint32_t nominal_bps)
+{
+    if (!config) return;
+
+    memset(config, 0, sizeof(video_abr_config_t));
+    config->max_bps = nominal_bps;
+    config->min_bps = nominal_bps / 8;
+    config->queue_high_ms = 400;
+    config->queue_low_ms = 100;
+    config->rtt_slack_ms = 150;
+    config->decrease_pct = 70;
+    config->increase_pct = 8;
+    config->decrease_interval_ms = 500;
+    config->increase_interval_ms = 500;
+    config->hold_ms = 2000;
+}
+
+void video_abr_init(video_abr_t *abr, const video_abr_config_t *config, uint32_t now_ms)
+{
+    if (!abr || !config) return;
+
+    memset(abr, 0, sizeof(video_abr_t));
+    abr->config = *config;
+    if (abr->config.min_bps > abr->config.max_bps) {
+        abr->config.min_bps = abr->config.max_bps;
+    }
+    abr->target_bps = abr->config.max_bps;
+    abr->last_decrease_ms = now_ms - abr->config.hold_ms;
+    abr->last_increase_ms = now_ms;
+    abr->last_rtt_base_ms = now_ms;
+}
+
+static void video_abr_track_rtt(video_abr_t *abr, uint32_t rtt_ms, uint32_t now_ms)
+{
+    if (rtt_ms == 0) return;
+
+    if (abr->rtt_base_ms == 0 || rtt_ms < abr->rtt_base_ms) {
+        abr->rtt_base_ms = rtt_ms;
+        abr->last_rtt_base_ms = now_ms;
+    } else if (now_ms - abr->last_rtt_base_ms >= VIDEO_ABR_RTT_BASE_AGE_MS) {
+        // Drift upwards slowly, a standing queue must not become the baseline
+        abr->rtt_base_ms += (rtt_ms - abr->rtt_base_ms) / 4;
+        abr->last_rtt_base_ms = now_ms;
+    }
+}
+
+uint32_t video_abr_update(video_abr_t *abr, const video_abr_feedback_t *feedback, uint32_t now_ms)
+{
+    if (!abr || !feedback) return 0;
+
+    const video_abr_config_t *cfg = &abr->config;
+
+    // Nobody watching: start the next viewer at full quality
+    if (feedback->viewers == 0) {
+        abr->target_bps = cfg->max_bps;
+        abr->rtt_base_ms = 0;
+        return abr->target_bps;
+    }
+
+    video_abr_track_rtt(abr, feedback->rtt_ms, now_ms);
+
+    // Express the backlog as stream time at the current target
+    uint32_t queue_ms = 0;
+    if (abr->target_bps > 0) {
+        queue_ms = (uint32_t)(((uint64_t)feedback->queue_bytes * 8 * 1000) / abr->target_bps);
+    }
+
+    int congested = queue_ms > cfg->queue_high_ms;
+    if (feedback->rtt_ms != 0 && abr->rtt_base_ms != 0 &&
+        feedback->rtt_ms > abr->rtt_base_ms + cfg->rtt_slack_ms) {
+        congested = 1;
+    }
+
+    // A backlog that is already shrinking needs no further back-off
+    uint32_t draining = feedback->queue_bytes < abr->last_queue_bytes &&
+                        feedback->rtt_ms == 0;
+    abr->last_queue_bytes = feedback->queue_bytes;
+
+    if (congested) {
+        if (!draining &&
+            now_ms - abr->last_decrease_ms >= cfg->decrease_interval_ms &&
+            abr->target_bps > cfg->min_bps) {
+            uint32_t target = (uint32_t)(((uint64_t)abr->target_bps * cfg->decrease_pct) / 100);
+            abr->target_bps = target < cfg->min_bps ? cfg->min_bps : target;
+            abr->last_decrease_ms = now_ms;
+            abr->decreases++;
+        }
+        return abr->target_bps;
+    }
+
+    if (queue_ms <= cfg->queue_low_ms &&
+        abr->target_bps < cfg->max_bps &&
+        now_ms - abr->last_decrease_ms >= cfg->hold_ms &&
+        now_ms - abr->last_increase_ms >= cfg->increase_interval_ms) {
+        uint32_t step = (uint32_t)(((uint64_t)cfg->max_bps * cfg->increase_pct) / 100);
+        uint32_t target = abr->target_bps + (step ? step : 1);
+        abr->target_bps = target > cfg->max_bps ? cfg->max_bps : target;
+        abr->last_increase_ms = now_ms;
+        abr->increases++;
+    }
+
+    return abr->target_bps;
+}
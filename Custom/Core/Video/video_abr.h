@@ -0,0 +1,87 @@
+/**
+ * @file video_abr.h
+ * @brief Adaptive bitrate controller for live streaming
+ * @details Pure state machine, no RTOS dependency. Fed with send queue depth
+ *          and RTT from the streaming outputs, it backs the encoder target
+ *          off multiplicatively on congestion and probes back up additively
+ *          once the link has drained.
+ */
+
+#ifndef VIDEO_ABR_H
+#define VIDEO_ABR_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief ABR controller configuration
+ */
+typedef struct {
+    uint32_t min_bps;                 // Lower bound of the target bitrate
+    uint32_t max_bps;                 // Upper bound, normally the nominal encoder bitrate
+    uint32_t queue_high_ms;           // Queued data (in ms of stream) considered congestion
+    uint32_t queue_low_ms;            // Queued data below which probing up is allowed
+    uint32_t rtt_slack_ms;            // RTT above baseline + slack is congestion
+    uint32_t decrease_pct;            // New target on congestion, percent of current
+    uint32_t increase_pct;            // Probe step, percent of max_bps
+    uint32_t decrease_interval_ms;    // Minimum time between two decreases
+    uint32_t increase_interval_ms;    // Minimum time between two increases
+    uint32_t hold_ms;                 // Quiet time after a decrease before probing up
+} video_abr_config_t;
+
+/**
+ * @brief Link feedback sample from the streaming outputs
+ */
+typedef struct {
+    uint32_t queue_bytes;             // Worst per-viewer send queue depth
+    uint32_t rtt_ms;                  // Worst per-viewer RTT, 0 if unknown
+    uint32_t viewers;                 // Active viewers
+} video_abr_feedback_t;
+
+/**
+ * @brief ABR controller state
+ */
+typedef struct {
+    video_abr_config_t config;
+    uint32_t target_bps;
+    uint32_t rtt_base_ms;             // Smallest recent RTT, 0 until sampled
+    uint32_t last_decrease_ms;
+    uint32_t last_increase_ms;
+    uint32_t last_rtt_base_ms;        // Last time the RTT baseline was aged
+    uint32_t last_queue_bytes;        // Queue depth of the previous sample
+    uint32_t decreases;               // Number of back-offs
+    uint32_t increases;               // Number of probe steps
+} video_abr_t;
+
+/**
+ * @brief Fill default configuration for a nominal bitrate
+ * @param config Configuration to fill
+ * @param nominal_bps Nominal encoder bitrate, used as max_bps
+ */
+void video_abr_get_default_config(video_abr_config_t *config, uint32_t nominal_bps);
+
+/**
+ * @brief Reset the controller, target starts at max_bps
+ * @param abr Controller state
+ * @param config Configuration
+ * @param now_ms Current monotonic time in ms
+ */
+void video_abr_init(video_abr_t *abr, const video_abr_config_t *config, uint32_t now_ms);
+
+/**
+ * @brief Feed one feedback sample
+ * @param abr Controller state
+ * @param feedback Link feedback
+ * @param now_ms Current monotonic time in ms
+ * @return New target bitrate (unchanged value if no adjustment was made)
+ */
+uint32_t video_abr_update(video_abr_t *abr, const video_abr_feedback_t *feedback, uint32_t now_ms);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* VIDEO_ABR_H */
@@ -37,6 +37,11 @@ static aicam_result_t video_ai_process_frame(video_ai_node_data_t *data,
                                             video_frame_t **output_frame);
 static aicam_result_t video_ai_init_draw_service(video_ai_node_data_t *data);
 static aicam_result_t video_ai_deinit_draw_service(video_ai_node_data_t *data);
+static void video_ai_cache_reset(video_ai_node_data_t *data);
+static void video_ai_cache_publish(video_ai_node_data_t *data, const nn_result_t *result, uint32_t frame_id);
+static aicam_bool_t video_ai_cache_read(video_ai_node_data_t *data, uint32_t generation,
+                                        nn_result_snapshot_t *snapshot, uint32_t *frame_id);
+static aicam_bool_t video_ai_cache_find_best(video_ai_node_data_t *data, uint32_t frame_id, uint32_t *generation);
 
 
 /* ==================== API Implementation ==================== */
@@ -88,17 +93,19 @@ video_node_t* video_ai_node_create(const char *name, const video_ai_config_t *co
     memset(data, 0, sizeof(video_ai_node_data_t));
     memcpy(&data->config, config, sizeof(video_ai_config_t));
     
-    // Initialize NN result cache (circular queue)
-    memset(data->nn_result_cache, 0, sizeof(data->nn_result_cache));
-    data->write_index = 0;
-    data->read_index = 0;
-    data->cache_count = 0;
+    // Camera device is resolved on first use and re-resolved if re-registered
+    data->camera_handle = (device_handle_t)DEVICE_HANDLE_INIT(CAMERA_DEVICE_NAME, DEV_TYPE_VIDEO);
+    
+    // Initialize NN result ring (already zeroed above)
+    data->cache_generation = 0;
+    data->cache_base = 0;
+    data->fifo_generation = 0;
     data->cache_initialized = AICAM_FALSE;
     
-    // Create cache mutex
-    data->cache_mutex = osMutexNew(NULL);
-    if (!data->cache_mutex) {
-        LOG_CORE_ERROR("Failed to create cache mutex");
+    // FIFO readers claim generations under this lock so two readers never get the same one
+    data->fifo_mutex = osMutexNew(NULL);
+    if (!data->fifo_mutex) {
+        LOG_CORE_ERROR("Failed to create FIFO mutex");
         buffer_free(data);
         video_node_destroy(node);
         return NULL;
@@ -354,11 +361,7 @@ aicam_result_t video_ai_node_reload_model(video_node_t *node) {
     }
 
     //reset cache   
-    memset(data->nn_result_cache, 0, sizeof(data->nn_result_cache));
-    data->write_index = 0;
-    data->read_index = 0;
-    data->cache_count = 0;
-    data->cache_initialized = AICAM_FALSE;
+    video_ai_cache_reset(data);
 
     nn_ret = video_ai_node_load_model(node, 0);
     if (nn_ret != AICAM_OK) {
@@ -373,8 +376,8 @@ aicam_result_t video_ai_node_reload_model(video_node_t *node) {
     return AICAM_OK;
 }
 
-aicam_result_t video_ai_node_get_nn_result(video_node_t *node, nn_result_t *result) {
-    if (!node || !result) {
+aicam_result_t video_ai_node_get_nn_result(video_node_t *node, nn_result_snapshot_t *snapshot) {
+    if (!node || !snapshot) {
         LOG_CORE_ERROR("Invalid parameters for AI node get nn result");
         return AICAM_ERROR_INVALID_PARAM;
     }
@@ -385,92 +388,260 @@ aicam_result_t video_ai_node_get_nn_result(video_node_t *node, nn_result_t *resu
         return AICAM_ERROR_INVALID_PARAM;
     }
     
-    // Lock cache mutex
-    osStatus_t mutex_status = osMutexAcquire(data->cache_mutex, osWaitForever); 
-    if (mutex_status != osOK) {
-        LOG_CORE_ERROR("Failed to lock cache mutex: %d", mutex_status);
+    // Oldest unread result (FIFO), skipping anything already overwritten. The
+    // generation is read, copied and advanced under the FIFO lock; only the
+    // producer runs unlocked, which the slot seq check covers.
+    if (!data->fifo_mutex || osMutexAcquire(data->fifo_mutex, osWaitForever) != osOK) {
+        LOG_CORE_ERROR("Failed to acquire FIFO mutex");
         return AICAM_ERROR;
     }
-    
-    // Check if cache is empty
-    if (data->cache_count == 0) {
-        // Release mutex first
-        osMutexRelease(data->cache_mutex);
-        LOG_CORE_WARN("NN result cache is empty");
-        result->od.nb_detect = 0;
-        return AICAM_OK;
+    while (1) {
+        uint32_t head = data->cache_generation;
+        uint32_t oldest = head - data->cache_base > NN_RESULT_CACHE_SIZE ?
+                          head - NN_RESULT_CACHE_SIZE : data->cache_base;
+        uint32_t generation = data->fifo_generation;
+
+        if ((int32_t)(generation - oldest) < 0) {
+            generation = oldest;
+        }
+        if (generation == head) {
+            osMutexRelease(data->fifo_mutex);
+            LOG_CORE_WARN("NN result cache is empty");
+            snapshot->result.od.nb_detect = 0;
+            return AICAM_OK;
+        }
+        if (video_ai_cache_read(data, generation, snapshot, NULL)) {
+            data->fifo_generation = generation + 1;
+            break;
+        }
     }
+    osMutexRelease(data->fifo_mutex);
     
-    // Copy the oldest result (FIFO) - extract nn_result_t from nn_result_with_frame_id_t
-    memcpy(result, &data->nn_result_cache[data->read_index].result, sizeof(nn_result_t));
+    LOG_CORE_DEBUG("Retrieved NN result from cache: %d detections", snapshot->result.od.nb_detect);
+    return AICAM_OK;
+}
+
+aicam_result_t video_ai_node_get_best_nn_result(video_node_t *node, nn_result_snapshot_t *snapshot, uint32_t frame_id) {
+    if (!node || !snapshot) {
+        LOG_CORE_ERROR("Invalid parameters for AI node get latest nn result");
+        return AICAM_ERROR_INVALID_PARAM;
+    }
     
-    // Move read index (circular)
-    data->read_index = (data->read_index + 1) % NN_RESULT_CACHE_SIZE;
-    data->cache_count--;
+    video_ai_node_data_t *data = (video_ai_node_data_t*)video_node_get_private_data(node);
+    if (!data) {
+        LOG_CORE_ERROR("Invalid AI node data");
+        return AICAM_ERROR_INVALID_PARAM;
+    }
     
-    // Release cache mutex
-    osMutexRelease(data->cache_mutex);
+    // Retry if the producer overwrote the chosen slot while it was being copied
+    uint32_t generation;
+    do {
+        if (!video_ai_cache_find_best(data, frame_id, &generation)) {
+            LOG_CORE_WARN("NN result cache is empty");
+            snapshot->result.od.nb_detect = 0;
+            return AICAM_OK;
+        }
+    } while (!video_ai_cache_read(data, generation, snapshot, NULL));
     
-    LOG_CORE_DEBUG("Retrieved NN result from cache: %d detections", result->od.nb_detect);
     return AICAM_OK;
 }
 
-aicam_result_t video_ai_node_get_best_nn_result(video_node_t *node, nn_result_t *result, uint32_t frame_id) {
-    if (!node || !result) {
-        LOG_CORE_ERROR("Invalid parameters for AI node get latest nn result");
+aicam_result_t video_ai_node_peek_best_nn_result(video_node_t *node, uint32_t frame_id,
+                                                 const nn_result_t **result, uint32_t *generation) {
+    if (!node || !result || !generation) {
         return AICAM_ERROR_INVALID_PARAM;
     }
     
     video_ai_node_data_t *data = (video_ai_node_data_t*)video_node_get_private_data(node);
     if (!data) {
-        LOG_CORE_ERROR("Invalid AI node data");
         return AICAM_ERROR_INVALID_PARAM;
     }
     
-    // Lock cache mutex
-    osStatus_t mutex_status = osMutexAcquire(data->cache_mutex, osWaitForever); 
-    if (mutex_status != osOK) {
-        LOG_CORE_ERROR("Failed to lock cache mutex: %d", mutex_status);
-        return AICAM_ERROR;
+    if (!video_ai_cache_find_best(data, frame_id, generation)) {
+        *result = NULL;
+        return AICAM_ERROR_NOT_FOUND;
     }
     
-    // Check if cache is empty
-    if (data->cache_count == 0) {
-        // Release mutex first
-        osMutexRelease(data->cache_mutex);
-        LOG_CORE_WARN("NN result cache is empty");
-        result->od.nb_detect = 0;
-        return AICAM_OK;
+    *result = &data->nn_result_cache[*generation % NN_RESULT_CACHE_SIZE].snapshot.result;
+    return AICAM_OK;
+}
+
+aicam_bool_t video_ai_node_nn_result_valid(video_node_t *node, uint32_t generation) {
+    if (!node) {
+        return AICAM_FALSE;
     }
+    
+    video_ai_node_data_t *data = (video_ai_node_data_t*)video_node_get_private_data(node);
+    if (!data) {
+        return AICAM_FALSE;
+    }
+    
+    __DMB();
+    return data->nn_result_cache[generation % NN_RESULT_CACHE_SIZE].seq == generation * 2 + 2 ?
+           AICAM_TRUE : AICAM_FALSE;
+}
 
-    uint32_t best_index = 0;
-    uint32_t min_diff = UINT32_MAX;
+/* ==================== Internal Functions ==================== */
 
-    for (uint32_t i = 0; i < data->cache_count; i++)
-    {
-        uint32_t index = (data->write_index + NN_RESULT_CACHE_SIZE - data->cache_count + i) % NN_RESULT_CACHE_SIZE;
-        nn_result_with_frame_id_t *entry = &data->nn_result_cache[index];
+/*
+ * NN result ring
+ *
+ * Generation g lives in slot g % NN_RESULT_CACHE_SIZE. The AI thread is the only
+ * writer: it marks the slot odd, fills it, stamps seq = 2g + 2 and only then
+ * advances cache_generation. Readers never block the writer; they validate the
+ * slot seq around their copy and retry on mismatch. Each slot carries its own
+ * copy of the detections, so a validated copy is one consistent result.
+ *
+ * The closest-frame lookup is a binary search over the window and relies on
+ * frame IDs rising with the generation (compared wrap-safe). A frame ID that
+ * goes backwards, e.g. after the camera restarted its counter, drops the older
+ * results before it is published so the window stays ordered.
+ */
 
-        uint32_t diff = (entry->frame_id > frame_id) ? (entry->frame_id - frame_id) : (frame_id - entry->frame_id);
+static uint32_t video_ai_result_count(uint32_t count, uint32_t max)
+{
+    return count < max ? count : max;
+}
 
-        if (diff < min_diff)
-        {
-            min_diff = diff;
-            best_index = index;
-        }
+// Copy a result and its detection array, pointing dst at its own storage. The
+// result is assembled locally and stored last so a slot never holds a pointer
+// into the post-processing buffer or a count beyond its own storage.
+static void video_ai_result_copy(nn_result_snapshot_t *dst, const nn_result_t *src)
+{
+    nn_result_t result;
+    uint32_t n = 0;
+
+    memcpy(&result, src, sizeof(nn_result_t));
+    switch (result.type) {
+        case PP_TYPE_OD:
+            n = result.od.detects ? video_ai_result_count(result.od.nb_detect, NN_RESULT_MAX_DETECTS) : 0;
+            memcpy(dst->detects.od, result.od.detects, n * sizeof(od_detect_t));
+            result.od.detects = dst->detects.od;
+            result.od.nb_detect = (uint8_t)n;
+            break;
+        case PP_TYPE_MPE:
+            n = result.mpe.detects ? video_ai_result_count(result.mpe.nb_detect, NN_RESULT_MAX_POSES) : 0;
+            memcpy(dst->detects.mpe, result.mpe.detects, n * sizeof(mpe_detect_t));
+            result.mpe.detects = dst->detects.mpe;
+            result.mpe.nb_detect = (uint8_t)n;
+            break;
+        case PP_TYPE_ISEG:
+            n = result.iseg.detects ? video_ai_result_count(result.iseg.nb_detect, NN_RESULT_MAX_DETECTS) : 0;
+            memcpy(dst->detects.iseg, result.iseg.detects, n * sizeof(iseg_detect_t));
+            result.iseg.detects = dst->detects.iseg;
+            result.iseg.nb_detect = (uint8_t)n;
+            break;
+        case PP_TYPE_SPE:
+            n = result.spe.keypoints ? video_ai_result_count(result.spe.nb_keypoints, NN_RESULT_MAX_KEYPOINTS) : 0;
+            memcpy(dst->detects.spe, result.spe.keypoints, n * sizeof(spe_keypoint_t));
+            result.spe.keypoints = dst->detects.spe;
+            result.spe.nb_keypoints = n;
+            break;
+        default:
+            break;
     }
+    memcpy(&dst->result, &result, sizeof(nn_result_t));
+}
 
-    // Copy best match result
-    memcpy(result, &data->nn_result_cache[best_index].result, sizeof(nn_result_t));
+static void video_ai_cache_reset(video_ai_node_data_t *data)
+{
+    // Generations below the base are treated as gone; slots are left untouched
+    data->cache_base = data->cache_generation;
+    if (data->fifo_mutex) osMutexAcquire(data->fifo_mutex, osWaitForever);
+    data->fifo_generation = data->cache_generation;
+    if (data->fifo_mutex) osMutexRelease(data->fifo_mutex);
+    data->cache_initialized = AICAM_FALSE;
+}
 
-    // Release cache mutex (no index changes for non-destructive read)
-    osMutexRelease(data->cache_mutex);
-    
-    //LOG_CORE_DEBUG("Retrieved latest NN result from cache: %d detections", result->od.nb_detect);
-    return AICAM_OK;
+static void video_ai_cache_publish(video_ai_node_data_t *data, const nn_result_t *result, uint32_t frame_id)
+{
+    uint32_t generation = data->cache_generation;
+    nn_result_with_frame_id_t *slot = &data->nn_result_cache[generation % NN_RESULT_CACHE_SIZE];
+
+    // Keep the window ordered by frame ID, readers see the new base before the new result
+    if (generation != data->cache_base &&
+        (int32_t)(frame_id - data->nn_result_cache[(generation - 1) % NN_RESULT_CACHE_SIZE].frame_id) < 0) {
+        data->cache_base = generation;
+        __DMB();
+    }
+
+    slot->seq = generation * 2 + 1;
+    __DMB();
+    slot->frame_id = frame_id;
+    video_ai_result_copy(&slot->snapshot, result);
+    __DMB();
+    slot->seq = generation * 2 + 2;
+    __DMB();
+    data->cache_generation = generation + 1;
+    data->cache_initialized = AICAM_TRUE;
 }
 
-/* ==================== Internal Functions ==================== */
+static aicam_bool_t video_ai_cache_read(video_ai_node_data_t *data, uint32_t generation,
+                                        nn_result_snapshot_t *snapshot, uint32_t *frame_id)
+{
+    nn_result_with_frame_id_t *slot = &data->nn_result_cache[generation % NN_RESULT_CACHE_SIZE];
+    uint32_t expected = generation * 2 + 2;
+
+    if (slot->seq != expected) {
+        return AICAM_FALSE;
+    }
+    __DMB();
+    if (snapshot) {
+        video_ai_result_copy(snapshot, &slot->snapshot.result);
+    }
+    if (frame_id) {
+        *frame_id = slot->frame_id;
+    }
+    __DMB();
+    return slot->seq == expected ? AICAM_TRUE : AICAM_FALSE;
+}
+
+static aicam_bool_t video_ai_cache_find_best(video_ai_node_data_t *data, uint32_t frame_id, uint32_t *generation)
+{
+    uint32_t head = data->cache_generation;
+    uint32_t base = data->cache_base;
+    uint32_t count = head - base;
+    uint32_t slot_frame_id;
+
+    if (count == 0) {
+        return AICAM_FALSE;
+    }
+    if (count > NN_RESULT_CACHE_SIZE - 1) {
+        // Keep one slot of slack so the producer's next write is never in the window
+        count = NN_RESULT_CACHE_SIZE - 1;
+    }
+
+    // Lower bound: first generation whose frame_id >= frame_id
+    uint32_t lo = head - count;
+    uint32_t hi = head;
+    while (lo < hi) {
+        uint32_t mid = lo + (hi - lo) / 2;
+        if (!video_ai_cache_read(data, mid, NULL, &slot_frame_id)) {
+            // Overwritten under us: everything at or below mid is stale
+            lo = mid + 1;
+            continue;
+        }
+        if ((int32_t)(slot_frame_id - frame_id) < 0) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+
+    // Closest of the lower bound and its predecessor
+    uint32_t best = (lo == head) ? head - 1 : lo;
+    if (lo != head && lo != head - count) {
+        uint32_t prev_frame_id;
+        if (video_ai_cache_read(data, lo, NULL, &slot_frame_id) &&
+            video_ai_cache_read(data, lo - 1, NULL, &prev_frame_id) &&
+            (frame_id - prev_frame_id) <= (slot_frame_id - frame_id)) {
+            best = lo - 1;
+        }
+    }
+
+    *generation = best;
+    return AICAM_TRUE;
+}
 
 static aicam_result_t video_ai_start_device(video_ai_node_data_t *data) {
     if (!data) {
@@ -561,7 +732,7 @@ static aicam_result_t video_ai_process_frame(video_ai_node_data_t *data,
     }
 
     // get input buffer from pipe2 (use cached device handle)
-    device_t *camera_dev = device_find_pattern(CAMERA_DEVICE_NAME, DEV_TYPE_VIDEO);
+    device_t *camera_dev = device_handle_get(&data->camera_handle);
     if (!camera_dev)
     {
         LOG_CORE_ERROR("Camera device not found");
@@ -613,49 +784,8 @@ static aicam_result_t video_ai_process_frame(video_ai_node_data_t *data,
     // Save result to cache if inference was successful
     if (nn_ret == 0)
     {
-        // Optimized cache write with reduced lock time
-        uint32_t current_write_idx = data->write_index;
-
-        // Prepare result with timestamp and frame_id
-        nn_result_with_frame_id_t result_with_ts;
-        memcpy(&result_with_ts.result, &nn_result, sizeof(nn_result_t));
-        result_with_ts.frame_id = frame_id;
-
-        // Copy result to cache before acquiring lock (reduce critical section)
-        memcpy(&data->nn_result_cache[current_write_idx], &result_with_ts, sizeof(nn_result_with_frame_id_t));
-
-        // Lock cache mutex for minimal time
-        osStatus_t mutex_status = osMutexAcquire(data->cache_mutex, 10); // Reduced timeout
-        if (mutex_status == osOK)
-        {
-            // Update indices atomically
-            data->write_index = (data->write_index + 1) % NN_RESULT_CACHE_SIZE;
-
-            if (data->cache_count >= NN_RESULT_CACHE_SIZE)
-            {
-                data->read_index = (data->read_index + 1) % NN_RESULT_CACHE_SIZE;
-            }
-            else
-            {
-                data->cache_count++;
-            }
-
-            if (!data->cache_initialized)
-            {
-                data->cache_initialized = AICAM_TRUE;
-            }
-
-            osMutexRelease(data->cache_mutex);
-        }
-        else
-        {
-            // If lock fails, just log once to avoid spam
-            static uint32_t lock_fail_count = 0;
-            if ((++lock_fail_count % 100) == 1)
-            {
-                LOG_CORE_WARN("Cache mutex timeout, failed %lu times", lock_fail_count);
-            }
-        }
+        // Publish to the result ring; readers never hold a lock against us
+        video_ai_cache_publish(data, &nn_result, frame_id);
     }
 
     // No output frame generated - results are cached internally
@@ -796,15 +926,14 @@ static aicam_result_t video_ai_node_deinit_callback(video_node_t *node) {
         video_ai_stop_device(data);
     }
     
-    // Clean up cache mutex
-    if (data->cache_mutex) {
-        osMutexDelete(data->cache_mutex);
-        data->cache_mutex = NULL;
-    }
-    
     // Clear cache
-    data->cache_initialized = AICAM_FALSE;
-    memset(data->nn_result_cache, 0, sizeof(data->nn_result_cache));
+    video_ai_cache_reset(data);
+    
+    // Clean up FIFO mutex
+    if (data->fifo_mutex) {
+        osMutexDelete(data->fifo_mutex);
+        data->fifo_mutex = NULL;
+    }
     
     LOG_CORE_INFO("AI node deinitialized");
     return AICAM_OK;
@@ -19,6 +19,9 @@ extern "C" {
 #endif
 
 #define NN_RESULT_CACHE_SIZE 5
+#define NN_RESULT_MAX_DETECTS       32      // OD / ISEG detections kept per cached result
+#define NN_RESULT_MAX_POSES         8       // MPE detections kept per cached result
+#define NN_RESULT_MAX_KEYPOINTS     33      // SPE keypoints kept per cached result
 
 /* ==================== AI Node Configuration ==================== */
 
@@ -57,10 +60,27 @@ typedef struct {
     uint32_t current_detection_count;     // Current frame detection count
 } video_ai_stats_t;
 
+/**
+ * @brief NN result with its own copy of the detections
+ * @note The post-processing output lives in one static buffer per model that the next
+ *       inference overwrites, so the detection arrays are copied here and the result
+ *       pointers refer to this copy. ISEG masks and the SSEG class map are too large to
+ *       copy and still point at the post-processing buffer.
+ */
 typedef struct {
     nn_result_t result;
-    //uint64_t timestamp;        // Frame timestamp (milliseconds)
+    union {
+        od_detect_t od[NN_RESULT_MAX_DETECTS];
+        mpe_detect_t mpe[NN_RESULT_MAX_POSES];
+        iseg_detect_t iseg[NN_RESULT_MAX_DETECTS];
+        spe_keypoint_t spe[NN_RESULT_MAX_KEYPOINTS];
+    } detects;
+} nn_result_snapshot_t;
+
+typedef struct {
+    volatile uint32_t seq;     // 2 * generation + 2 when published, odd while being written
     uint32_t frame_id;         // Frame ID for synchronization
+    nn_result_snapshot_t snapshot;
 } nn_result_with_frame_id_t;
 
 /**
@@ -68,6 +88,7 @@ typedef struct {
  */
 typedef struct {
     device_t *ai_device;                  // AI device handle
+    device_handle_t camera_handle;        // Cached camera device lookup
     video_ai_config_t config;             // AI configuration
     video_ai_stats_t stats;               // AI statistics
     nn_model_info_t model_info;           // NN model information
@@ -77,13 +98,13 @@ typedef struct {
     aicam_bool_t is_running;              // Running status
     aicam_bool_t draw_service_initialized; // Drawing service initialization status
     
-    // NN result cache (circular queue with 3 buffers)
+    // NN result ring: single producer (AI thread), lock-free readers
     nn_result_with_frame_id_t nn_result_cache[NN_RESULT_CACHE_SIZE];
-    uint32_t write_index;                   // Write index for circular queue
-    uint32_t read_index;                    // Read index for circular queue  
-    uint32_t cache_count;                   // Number of items in cache (0-NN_RESULT_CACHE_SIZE)
+    volatile uint32_t cache_generation;     // Results published so far, slot = generation % NN_RESULT_CACHE_SIZE
+    volatile uint32_t cache_base;           // Oldest generation still valid (moved on reset)
+    uint32_t fifo_generation;               // Next generation for FIFO readers, guarded by fifo_mutex
+    osMutexId_t fifo_mutex;                 // Serializes FIFO readers, the producer never takes it
     aicam_bool_t cache_initialized;
-    osMutexId_t cache_mutex;
 } video_ai_node_data_t;
 
 /* ==================== API Functions ==================== */
@@ -187,18 +208,39 @@ aicam_result_t video_ai_node_reload_model(video_node_t *node);
 /**
  * @brief Get oldest NN result from cache (FIFO)
  * @param node AI node handle
- * @param result NN result structure to fill
+ * @param snapshot Filled with the result and its detections, consistent with each other
  * @return Operation result
  */
-aicam_result_t video_ai_node_get_nn_result(video_node_t *node, nn_result_t *result);
+aicam_result_t video_ai_node_get_nn_result(video_node_t *node, nn_result_snapshot_t *snapshot);
 
 /**
- * @brief Get latest NN result from cache (newest, non-destructive)
+ * @brief Get NN result closest to frame_id from cache (non-destructive)
  * @param node AI node handle
- * @param result NN result structure to fill
+ * @param snapshot Filled with the result and its detections, consistent with each other
+ * @param frame_id Frame ID to match
  * @return Operation result
  */
-aicam_result_t video_ai_node_get_best_nn_result(video_node_t *node, nn_result_t *result, uint32_t frame_id);
+aicam_result_t video_ai_node_get_best_nn_result(video_node_t *node, nn_result_snapshot_t *snapshot, uint32_t frame_id);
+
+/**
+ * @brief Get NN result closest to frame_id by reference (no copy)
+ * @param node AI node handle
+ * @param frame_id Frame ID to match
+ * @param result Pointer to the cached result and its detections, valid while video_ai_node_nn_result_valid() holds
+ * @param generation Generation of the returned result
+ * @return AICAM_OK, AICAM_ERROR_NOT_FOUND if the cache is empty
+ * @note The slot is reused NN_RESULT_CACHE_SIZE results later; check the generation after use
+ */
+aicam_result_t video_ai_node_peek_best_nn_result(video_node_t *node, uint32_t frame_id,
+                                                 const nn_result_t **result, uint32_t *generation);
+
+/**
+ * @brief Check whether a result returned by reference has not been overwritten
+ * @param node AI node handle
+ * @param generation Generation returned by video_ai_node_peek_best_nn_result
+ * @return AICAM_TRUE if the referenced result is still intact
+ */
+aicam_bool_t video_ai_node_nn_result_valid(video_node_t *node, uint32_t generation);
 
 /* ==================== Control Commands ==================== */
 
@@ -13,6 +13,11 @@
 #include <stdio.h>
 #include "nn.h"
 #include "drtc.h"
+#include "generic_time.h"
+
+// Frame wait timeout in frame periods, the driver wakes us on frame ready
+#define VIDEO_CAMERA_FRAME_WAIT_PERIODS  3
+#define VIDEO_CAMERA_FRAME_WAIT_MIN_MS   50
 
 /* ==================== Global Camera Device Reference ==================== */
 
@@ -451,12 +456,15 @@ static aicam_result_t video_camera_stop_device(video_camera_node_data_t *data) {
 static aicam_result_t video_camera_capture_frame_zero_copy(video_camera_node_data_t *data, video_frame_t **output_frame) {
     if (!data || !output_frame) return AICAM_ERROR_INVALID_PARAM;
     
-    uint64_t start_time = osKernelGetTickCount();
+    uint64_t start_time = generic_time_us();
     
     // Get frame buffer from camera (hardware buffer) - NO COPYING!
     camera_buffer_with_frame_id_t camera_buffer_with_frame_id;
-    int result = device_ioctl(data->camera_dev, CAM_CMD_GET_PIPE1_BUFFER_WITH_FRAME_ID, 
-                            (uint8_t *)&camera_buffer_with_frame_id, 0);
+    uint32_t fps = data->config.fps ? data->config.fps : 30;
+    uint32_t wait_ms = VIDEO_CAMERA_FRAME_WAIT_PERIODS * 1000 / fps;
+    if (wait_ms < VIDEO_CAMERA_FRAME_WAIT_MIN_MS) wait_ms = VIDEO_CAMERA_FRAME_WAIT_MIN_MS;
+    int result = device_ioctl(data->camera_dev, CAM_CMD_WAIT_PIPE1_BUFFER, 
+                            (uint8_t *)&camera_buffer_with_frame_id, wait_ms);
 
 
     if (result != AICAM_OK) {
@@ -489,6 +497,8 @@ static aicam_result_t video_camera_capture_frame_zero_copy(video_camera_node_dat
         .stride = data->config.width * data->config.bpp,
         .size = camera_buffer_with_frame_id.size,
         .timestamp = rtc_get_local_timestamp(),
+        .pts_us = camera_buffer_with_frame_id.pts_us,
+        .frame_id = camera_buffer_with_frame_id.frame_id,
         .sequence = data->frame_sequence++
     };
     
@@ -505,7 +515,7 @@ static aicam_result_t video_camera_capture_frame_zero_copy(video_camera_node_dat
     
     // Update statistics
     data->stats.frames_captured++;
-    uint64_t capture_time = osKernelGetTickCount() - start_time;
+    uint64_t capture_time = generic_time_us() - start_time;
     data->stats.avg_capture_time_us = (data->stats.avg_capture_time_us + capture_time) / 2;
     if (capture_time > data->stats.max_capture_time_us) {
         data->stats.max_capture_time_us = capture_time;
@@ -16,6 +16,10 @@
 #include "websocket_stream_server.h"
 #include "camera.h"
 #include "h264encapi.h"  // For H264ENC_INTRA_FRAME, H264ENC_PREDICTED_FRAME
+#include "generic_time.h"
+
+#define VIDEO_ENCODER_ABR_INTERVAL_MS   200   // Link feedback sampling period
+#define VIDEO_ENCODER_SUBMIT_TIMEOUT_MS 1000  // Wait for an in-flight slot before dropping
 
 /* ==================== Internal Function Declarations ==================== */
 
@@ -32,9 +36,12 @@ static aicam_result_t video_encoder_node_control_callback(video_node_t *node,
 
 static aicam_result_t video_encoder_start_device(video_encoder_node_data_t *data);
 static aicam_result_t video_encoder_stop_device(video_encoder_node_data_t *data);
-static aicam_result_t video_encoder_encode_frame_zero_copy(video_encoder_node_data_t *data, 
-                                                          video_frame_t *input_frame, 
-                                                          video_frame_t **output_frame);
+static void video_encoder_apply_roi_enable(video_encoder_node_data_t *data);
+static void video_encoder_abr_reset(video_encoder_node_data_t *data);
+static void video_encoder_apply_stream_feedback(video_encoder_node_data_t *data);
+static aicam_result_t video_encoder_submit_frame(video_encoder_node_data_t *data, 
+                                                 video_frame_t *input_frame);
+static void video_encoder_done_callback(enc_out_frame_t *frame, int status, void *ctx, void *user_data);
 
 /* ==================== API Implementation ==================== */
 
@@ -48,6 +55,7 @@ void video_encoder_get_default_config(video_encoder_config_t *config) {
     config->input_type = VENC_DEFAULT_INPUT_TYPE;
     config->quality = 80;
     config->bitrate = 2000; // 2Mbps
+    config->adaptive_bitrate = AICAM_TRUE;
 }
 
 video_node_t* video_encoder_node_create(const char *name, const video_encoder_config_t *config) {
@@ -152,6 +160,22 @@ aicam_result_t video_encoder_node_reset_stats(video_node_t *node) {
     return AICAM_OK;
 }
 
+aicam_result_t video_encoder_node_set_roi_callback(video_node_t *node,
+                                                   encoder_roi_callback_t callback,
+                                                   void *user_data) {
+    if (!node) return AICAM_ERROR_INVALID_PARAM;
+    
+    video_encoder_node_data_t *data = (video_encoder_node_data_t*)video_node_get_private_data(node);
+    if (!data) return AICAM_ERROR_INVALID_PARAM;
+    
+    data->roi_callback = callback;
+    data->roi_callback_user_data = user_data;
+    video_encoder_apply_roi_enable(data);
+    
+    LOG_CORE_INFO("Encoder ROI callback %s", callback ? "registered" : "unregistered");
+    return AICAM_OK;
+}
+
 aicam_result_t video_encoder_node_start(video_node_t *node) {
     if (!node) return AICAM_ERROR_INVALID_PARAM;
     
@@ -217,6 +241,23 @@ static aicam_result_t video_encoder_node_init_callback(video_node_t *node) {
     device_ioctl(data->encoder_dev, ENC_CMD_SET_PARAM, 
                 (uint8_t *)&data->enc_param, sizeof(enc_param_t));
     
+    // Asynchronous mode: one frame encodes while the previous one is sent
+    if (!data->job_sem) {
+        data->job_sem = osSemaphoreNew(ENC_ASYNC_DEPTH, ENC_ASYNC_DEPTH, NULL);
+        if (!data->job_sem) {
+            LOG_CORE_ERROR("Failed to create encoder job semaphore");
+            return AICAM_ERROR_NO_MEMORY;
+        }
+    }
+    enc_done_cb_config_t done_cb = {
+        .cb = video_encoder_done_callback,
+        .user_data = data,
+    };
+    if (device_ioctl(data->encoder_dev, ENC_CMD_SET_DONE_CALLBACK, (uint8_t *)&done_cb, 0) != AICAM_OK) {
+        LOG_CORE_ERROR("Failed to set encoder done callback");
+        return AICAM_ERROR;
+    }
+    
     LOG_CORE_INFO("Encoder node initialized: %dx%d@%dfps, input_type=%d", 
                   data->config.width, data->config.height, data->config.fps, data->config.input_type);
     
@@ -236,6 +277,14 @@ static aicam_result_t video_encoder_node_deinit_callback(video_node_t *node) {
         video_encoder_stop_device(data);
     }
     
+    if (data->encoder_dev) {
+        device_ioctl(data->encoder_dev, ENC_CMD_SET_DONE_CALLBACK, NULL, 0);
+    }
+    if (data->job_sem) {
+        osSemaphoreDelete(data->job_sem);
+        data->job_sem = NULL;
+    }
+    
     data->is_initialized = AICAM_FALSE;
     LOG_CORE_INFO("Encoder node deinitialized");
     return AICAM_OK;
@@ -255,16 +304,11 @@ static aicam_result_t video_encoder_node_process_callback(video_node_t *node,
         return AICAM_OK;
     }
     
-    // Process input frames
+    // Queue input frames, output is delivered by video_encoder_done_callback
     *output_count = 0;
     for (uint32_t i = 0; i < input_count && i < 1; i++) { // Process one frame at a time
         if (input_frames[i]) {
-            video_frame_t *output_frame = NULL;
-            aicam_result_t result = video_encoder_encode_frame_zero_copy(data, input_frames[i], &output_frame);
-            if (result == AICAM_OK && output_frame) {
-                output_frames[*output_count] = output_frame;
-                (*output_count)++;
-            }
+            video_encoder_submit_frame(data, input_frames[i]);
         }
     }
     
@@ -293,11 +337,20 @@ static aicam_result_t video_encoder_node_control_callback(video_node_t *node,
             
         case ENCODER_CMD_SET_BITRATE:
             if (param) {
+                // Applied between frames, no encoder restart
+                aicam_result_t result = device_ioctl(data->encoder_dev, ENC_CMD_SET_BITRATE, NULL,
+                                                     *(uint32_t*)param * 1000);
+                if (result != AICAM_OK) return result;
                 data->config.bitrate = *(uint32_t*)param;
-                return video_encoder_node_set_config(node, &data->config);
+                video_encoder_abr_reset(data);
+                return AICAM_OK;
             }
             break;
             
+        case ENCODER_CMD_FORCE_IDR:
+            data->stats.forced_idr++;
+            return device_ioctl(data->encoder_dev, ENC_CMD_FORCE_IDR, NULL, 0);
+            
         case ENCODER_CMD_GET_PARAM:
             if (param) {
                 memcpy(param, &data->enc_param, sizeof(enc_param_t));
@@ -315,6 +368,65 @@ static aicam_result_t video_encoder_node_control_callback(video_node_t *node,
 
 /* ==================== Internal Functions ==================== */
 
+static void video_encoder_abr_reset(video_encoder_node_data_t *data) {
+    video_abr_config_t abr_cfg;
+    uint32_t bitrate = 0;
+    
+    if (!data->encoder_dev) return;
+    if (device_ioctl(data->encoder_dev, ENC_CMD_GET_BITRATE, (uint8_t *)&bitrate, 0) != AICAM_OK) return;
+    
+    // Nominal bitrate is the ceiling, the controller only backs off from it
+    data->stats.bitrate_bps = bitrate;
+    data->abr_last_ms = generic_time_ms();
+    video_abr_get_default_config(&abr_cfg, bitrate);
+    if (abr_cfg.min_bps < VENC_MIN_BITRATE) {
+        abr_cfg.min_bps = VENC_MIN_BITRATE;
+    }
+    video_abr_init(&data->abr, &abr_cfg, data->abr_last_ms);
+}
+
+static void video_encoder_apply_stream_feedback(video_encoder_node_data_t *data) {
+    if (websocket_stream_server_take_keyframe_request()) {
+        if (device_ioctl(data->encoder_dev, ENC_CMD_FORCE_IDR, NULL, 0) == AICAM_OK) {
+            data->stats.forced_idr++;
+        }
+    }
+    
+    if (!data->config.adaptive_bitrate) return;
+    
+    uint32_t now_ms = generic_time_ms();
+    if (now_ms - data->abr_last_ms < VIDEO_ENCODER_ABR_INTERVAL_MS) return;
+    data->abr_last_ms = now_ms;
+    
+    websocket_stream_link_t link;
+    if (websocket_stream_server_get_link(&link) != AICAM_OK) return;
+    
+    video_abr_feedback_t feedback = {
+        .queue_bytes = link.queue_bytes,
+        .rtt_ms = link.rtt_ms,
+        .viewers = link.clients,
+    };
+    uint32_t target = video_abr_update(&data->abr, &feedback, now_ms);
+    if (target == 0 || target == data->stats.bitrate_bps) return;
+    
+    if (device_ioctl(data->encoder_dev, ENC_CMD_SET_BITRATE, NULL, target) == AICAM_OK) {
+        LOG_CORE_DEBUG("Encoder bitrate %u -> %u bps (queue %u bytes, rtt %u ms)",
+                       data->stats.bitrate_bps, target, link.queue_bytes, link.rtt_ms);
+        data->stats.bitrate_bps = target;
+        data->stats.bitrate_changes++;
+    }
+}
+
+static void video_encoder_apply_roi_enable(video_encoder_node_data_t *data) {
+    enc_roi_config_t roi_cfg;
+    
+    if (!data->encoder_dev) return;
+    if (device_ioctl(data->encoder_dev, ENC_CMD_GET_ROI_CONFIG, (uint8_t *)&roi_cfg, 0) != AICAM_OK) return;
+    
+    roi_cfg.enable = data->roi_callback ? 1 : 0;
+    device_ioctl(data->encoder_dev, ENC_CMD_SET_ROI_CONFIG, (uint8_t *)&roi_cfg, 0);
+}
+
 static aicam_result_t video_encoder_start_device(video_encoder_node_data_t *data) {
     if (!data || !data->is_initialized) return AICAM_ERROR_INVALID_PARAM;
     
@@ -331,6 +443,8 @@ static aicam_result_t video_encoder_start_device(video_encoder_node_data_t *data
     }
     
     data->is_running = AICAM_TRUE;
+    video_encoder_apply_roi_enable(data);
+    video_encoder_abr_reset(data);
     
     LOG_CORE_INFO("Encoder started: %dx%d@%dfps", 
                   data->config.width, data->config.height, data->config.fps);
@@ -355,61 +469,123 @@ static aicam_result_t video_encoder_stop_device(video_encoder_node_data_t *data)
     
     data->is_running = AICAM_FALSE;
     
+    // Wait for in-flight frames, queued jobs are completed with an error on stop
+    uint32_t drained = 0;
+    while (drained < ENC_ASYNC_DEPTH &&
+           osSemaphoreAcquire(data->job_sem, VIDEO_ENCODER_SUBMIT_TIMEOUT_MS) == osOK) {
+        drained++;
+    }
+    if (drained < ENC_ASYNC_DEPTH) {
+        LOG_CORE_WARN("Encoder stop: %u frames still in flight", ENC_ASYNC_DEPTH - drained);
+    }
+    while (drained--) {
+        osSemaphoreRelease(data->job_sem);
+    }
+    
     LOG_CORE_INFO("Encoder stopped");
     return AICAM_OK;
 }
 
-static aicam_result_t video_encoder_encode_frame_zero_copy(video_encoder_node_data_t *data, 
-                                                          video_frame_t *input_frame, 
-                                                          video_frame_t **output_frame) {
-    if (!data || !input_frame || !output_frame) return AICAM_ERROR_INVALID_PARAM;
-    
-    // Input frame to encoder 
-    aicam_result_t result = device_ioctl(data->encoder_dev, ENC_CMD_INPUT_BUFFER, 
-                                        input_frame->data, input_frame->info.size);
-    if (result != AICAM_OK) {
-        LOG_CORE_ERROR("Failed to input frame to encoder: %d", result);
+static void video_encoder_done_callback(enc_out_frame_t *frame, int status, void *ctx, void *user_data) {
+    video_encoder_node_data_t *data = (video_encoder_node_data_t*)user_data;
+    video_encoder_job_t *job = (video_encoder_job_t*)ctx;
+    video_frame_t *input_frame = job->frame;
+    
+    if (status == AICAM_OK && frame && frame->data_size > 0) {
+        // Determine frame type based on coding type
+        websocket_frame_type_t frame_type = WS_FRAME_TYPE_MJPEG; // Default for JPEG
+        if (frame->frame_info.codingType == H264ENC_INTRA_FRAME) {
+            frame_type = WS_FRAME_TYPE_H264_KEY;
+        } else if (frame->frame_info.codingType == H264ENC_PREDICTED_FRAME) {
+            frame_type = WS_FRAME_TYPE_H264_DELTA;
+        }
+        
+        // Send straight from the encoder buffer, header space is reserved in front
+        websocket_stream_server_send_frame_with_encoder_info(
+            frame->frame_buffer, 
+            frame->header_size + frame->data_size, 
+            input_frame->info.pts_us, 
+            frame_type, 
+            input_frame->info.width, 
+            input_frame->info.height,
+            &frame->frame_info);
+        
+        uint64_t latency_us = generic_time_us() - job->submit_us;
+        data->stats.frames_encoded++;
+        data->stats.total_bytes_encoded += frame->data_size;
+        data->stats.avg_frame_size = (uint32_t)(data->stats.total_bytes_encoded / data->stats.frames_encoded);
+        if (latency_us > data->stats.max_encode_time_us) {
+            data->stats.max_encode_time_us = latency_us;
+        }
+        data->stats.avg_encode_time_us = (data->stats.frames_encoded == 1) ? latency_us :
+            (data->stats.avg_encode_time_us * 9 + latency_us) / 10;
+        
+        // Hand the buffer back only once the consumer is done with it
+        device_ioctl(data->encoder_dev, ENC_CMD_RELEASE_OUTPUT, frame->frame_buffer, 0);
+    } else {
+        LOG_CORE_WARN("Encode failed for frame %u: %d", input_frame->info.frame_id, status);
         data->stats.encode_errors++;
-        return result;
     }
     
-    // Get encoded output frame structure
-    enc_out_frame_t enc_frame = {0};
-    result = device_ioctl(data->encoder_dev, ENC_CMD_OUTPUT_FRAME, 
-                         (uint8_t *)&enc_frame, 0);
+    job->frame = NULL;
+    video_frame_unref(input_frame);
+    osSemaphoreRelease(data->job_sem);
+}
+
+static aicam_result_t video_encoder_submit_frame(video_encoder_node_data_t *data, 
+                                                 video_frame_t *input_frame) {
+    if (!data || !input_frame) return AICAM_ERROR_INVALID_PARAM;
     
-    if (result != AICAM_OK) {
-        LOG_CORE_WARN("Failed to get encoded frame: %d", result);
+    // Backpressure: wait for one of the in-flight slots
+    if (osSemaphoreAcquire(data->job_sem, VIDEO_ENCODER_SUBMIT_TIMEOUT_MS) != osOK) {
+        LOG_CORE_WARN("Encoder busy, frame %u dropped", input_frame->info.frame_id);
         data->stats.encode_errors++;
-        return AICAM_ERROR;
+        return AICAM_ERROR_TIMEOUT;
     }
-
-    if (enc_frame.data_size == 0) {
-        LOG_CORE_WARN("Encoded frame data size is 0");
+    
+    // Bitrate and IDR requests from the stream clients, applied before this frame
+    video_encoder_apply_stream_feedback(data);
+    
+    // ROI map for this frame from the latest detections
+    if (data->roi_callback) {
+        uint32_t nb_boxes = data->roi_callback(input_frame->info.frame_id, data->roi_boxes,
+                                               ENC_ROI_MAX_BOXES, data->roi_callback_user_data);
+        device_ioctl(data->encoder_dev, ENC_CMD_SET_ROI_BOXES, (uint8_t *)data->roi_boxes, nb_boxes);
+    }
+    
+    // The semaphore guarantees a free slot
+    video_encoder_job_t *job = NULL;
+    for (uint32_t i = 0; i < ENC_ASYNC_DEPTH; i++) {
+        if (data->jobs[i].frame == NULL) {
+            job = &data->jobs[i];
+            break;
+        }
+    }
+    if (!job) {
+        osSemaphoreRelease(data->job_sem);
+        return AICAM_ERROR_BUSY;
+    }
+    
+    // Input stays referenced until the completion callback
+    video_frame_ref(input_frame);
+    job->frame = input_frame;
+    job->submit_us = generic_time_us();
+    
+    enc_job_t enc_job = {
+        .in_buffer = input_frame->data,
+        .size = input_frame->info.size,
+        .pts_us = input_frame->info.pts_us,
+        .ctx = job,
+    };
+    aicam_result_t result = device_ioctl(data->encoder_dev, ENC_CMD_SUBMIT, (uint8_t *)&enc_job, 0);
+    if (result != AICAM_OK) {
+        LOG_CORE_ERROR("Failed to submit frame to encoder: %d", result);
+        job->frame = NULL;
+        video_frame_unref(input_frame);
+        osSemaphoreRelease(data->job_sem);
         data->stats.encode_errors++;
-        return AICAM_ERROR;
+        return result;
     }
-
-    // Determine frame type based on coding type
-    websocket_frame_type_t frame_type = WS_FRAME_TYPE_MJPEG; // Default for JPEG
-    if (enc_frame.frame_info.codingType == H264ENC_INTRA_FRAME) {
-        frame_type = WS_FRAME_TYPE_H264_KEY;
-    } else if (enc_frame.frame_info.codingType == H264ENC_PREDICTED_FRAME) {
-        frame_type = WS_FRAME_TYPE_H264_DELTA;
-    }  
-
-    // Send frame with encoder information
-    // Use the full frame buffer (including header space) for WebSocket header filling
-    websocket_stream_server_send_frame_with_encoder_info(
-        enc_frame.frame_buffer, 
-        enc_frame.header_size + enc_frame.data_size, 
-        input_frame->info.timestamp, 
-        frame_type, 
-        input_frame->info.width, 
-        input_frame->info.height,
-        &enc_frame.frame_info);
     
-    *output_frame = NULL;
-
     return AICAM_OK;
 }
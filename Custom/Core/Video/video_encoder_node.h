@@ -11,6 +11,7 @@
 #include "aicam_types.h"
 #include "dev_manager.h"
 #include "enc.h"
+#include "video_abr.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -29,6 +30,7 @@ typedef struct {
     uint32_t quality;                     // Encoding quality (0-100)
     uint32_t bitrate;                     // Target bitrate (kbps)
     uint32_t pipe_id;                     // Pipeline ID (1 or 2)
+    aicam_bool_t adaptive_bitrate;        // Follow stream link feedback (send queue, RTT)
 } video_encoder_config_t;
 
 /**
@@ -37,12 +39,32 @@ typedef struct {
 typedef struct {
     uint64_t frames_encoded;              // Total frames encoded
     uint64_t encode_errors;               // Encoding errors
-    uint64_t avg_encode_time_us;          // Average encoding time
-    uint64_t max_encode_time_us;          // Maximum encoding time
+    uint64_t avg_encode_time_us;          // Average submit to completion latency
+    uint64_t max_encode_time_us;          // Maximum submit to completion latency
     uint64_t total_bytes_encoded;         // Total bytes encoded
     uint32_t avg_frame_size;              // Average frame size
+    uint32_t bitrate_bps;                 // Current encoder target bitrate
+    uint32_t bitrate_changes;             // Runtime bitrate updates
+    uint32_t forced_idr;                  // IDR frames requested by clients
 } video_encoder_stats_t;
 
+/**
+ * @brief ROI source callback, fills detection boxes for a camera frame
+ * @return Number of boxes written (0 clears the ROI map)
+ */
+typedef uint32_t (*encoder_roi_callback_t)(uint32_t frame_id,
+                                           enc_roi_box_t *boxes,
+                                           uint32_t max_boxes,
+                                           void *user_data);
+
+/**
+ * @brief Frame handed to the encoder and not completed yet
+ */
+typedef struct {
+    video_frame_t *frame;                 // Input frame, referenced until completion
+    uint64_t submit_us;                   // Submit time for latency statistics
+} video_encoder_job_t;
+
 /**
  * @brief Encoder node private data
  */
@@ -53,6 +75,13 @@ typedef struct {
     enc_param_t enc_param;                // Encoder parameters
     aicam_bool_t is_initialized;          // Initialization status
     aicam_bool_t is_running;              // Running status
+    encoder_roi_callback_t roi_callback;  // ROI source callback
+    void *roi_callback_user_data;         // User data for ROI callback
+    enc_roi_box_t roi_boxes[ENC_ROI_MAX_BOXES];
+    video_abr_t abr;                      // Adaptive bitrate controller
+    uint32_t abr_last_ms;                 // Last controller update
+    video_encoder_job_t jobs[ENC_ASYNC_DEPTH]; // In-flight frames
+    osSemaphoreId_t job_sem;              // Free in-flight slots
 } video_encoder_node_data_t;
 
 /* ==================== API Functions ==================== */
@@ -103,6 +132,17 @@ aicam_result_t video_encoder_node_get_stats(video_node_t *node, video_encoder_st
  */
 aicam_result_t video_encoder_node_reset_stats(video_node_t *node);
 
+/**
+ * @brief Set ROI source callback, enables detection driven ROI coding
+ * @param node Encoder node handle
+ * @param callback Callback function (NULL to disable ROI coding)
+ * @param user_data User data for callback
+ * @return Operation result
+ */
+aicam_result_t video_encoder_node_set_roi_callback(video_node_t *node,
+                                                   encoder_roi_callback_t callback,
+                                                   void *user_data);
+
 /**
  * @brief Start encoder
  * @param node Encoder node handle
@@ -131,6 +171,7 @@ aicam_bool_t video_encoder_node_is_running(video_node_t *node);
 #define ENCODER_CMD_SET_QUALITY          0x2003
 #define ENCODER_CMD_SET_BITRATE          0x2004
 #define ENCODER_CMD_GET_PARAM            0x2005
+#define ENCODER_CMD_FORCE_IDR            0x2006
 
 #ifdef __cplusplus
 }
@@ -68,8 +68,8 @@ uint32_t video_frame_ref(video_frame_t *frame)
         return 0;
     }
     
-    frame->ref_count++;
-    return frame->ref_count;
+    // Frames can be released from another thread (e.g. encoder completion)
+    return __atomic_add_fetch(&frame->ref_count, 1, __ATOMIC_ACQ_REL);
 }
 
 uint32_t video_frame_unref(video_frame_t *frame)
@@ -78,13 +78,15 @@ uint32_t video_frame_unref(video_frame_t *frame)
         return 0;
     }
     
-    if (frame->ref_count == 0) {
-        LOG_CORE_ERROR("Attempting to unref frame with zero ref count");
-        return 0;
-    }
-    
-    frame->ref_count--;
-    uint32_t remaining = frame->ref_count;
+    uint32_t count = __atomic_load_n(&frame->ref_count, __ATOMIC_ACQUIRE);
+    do {
+        if (count == 0) {
+            LOG_CORE_ERROR("Attempting to unref frame with zero ref count");
+            return 0;
+        }
+    } while (!__atomic_compare_exchange_n(&frame->ref_count, &count, count - 1, 0,
+                                          __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE));
+    uint32_t remaining = count - 1;
     
     if (remaining == 0) {
         // Check if this is a zero-copy frame
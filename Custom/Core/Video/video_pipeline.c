@@ -11,6 +11,7 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include "cmsis_os2.h"
+#include "generic_time.h"
 
 #define VIDEO_THREAD_DELETE(handle) osThreadTerminate(handle)
 #define VIDEO_MUTEX_CREATE() osMutexNew(NULL)
@@ -59,11 +60,8 @@ static void *g_system_mutex = NULL;
  */
 static uint64_t get_timestamp_us(void)
 {
-    // Use system tick to get real elapsed time
-    uint32_t tick_count = osKernelGetTickCount();
-    uint32_t tick_freq = osKernelGetTickFreq();
-    // Convert ticks to microseconds: (tick_count * 1000000) / tick_freq
-    return ((uint64_t)tick_count * 1000000ULL) / (uint64_t)tick_freq;
+    // Cycle counter based, tick resolution is too coarse for per-node stats
+    return generic_time_us();
 }
 
 /**
@@ -55,6 +55,8 @@ typedef struct {
     uint32_t stride;                    // Bytes per line
     uint32_t size;                      // Total frame size
     uint64_t timestamp;                 // Frame timestamp (ms)
+    uint64_t pts_us;                    // Monotonic capture time (us)
+    uint32_t frame_id;                  // Camera frame id, matches AI results
     uint32_t sequence;                  // Frame sequence number
 } video_frame_info_t;
 
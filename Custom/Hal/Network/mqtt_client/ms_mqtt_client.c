@@ -213,47 +213,94 @@ static uint16_t ms_mqtt_client_get_message_id(uint8_t *buffer, size_t length)
     }
 }
 
-static int ms_mqtt_client_read_message(ms_mqtt_client_handle_t client, uint8_t *buffer, int size, uint32_t timeout_ms)
+/// @brief Parse the fixed header at the start of the receive stream
+/// @return Header length, 0 if more bytes are needed, less than 0 if malformed
+static int ms_mqtt_client_stream_header(ms_mqtt_client_handle_t client, int *msg_len)
 {
-    int ret = 0, rlen = 0, msg_len = 0, msg_rlen = 0;
-    int multiplier = 1;
-    uint8_t tmp_value = 0;
+    int i = 0, value = 0, multiplier = 1;
+    int avail = client->rx_stream_len - client->rx_stream_pos;
+    uint8_t *p = client->rx_stream + client->rx_stream_pos;
     MQTTHeader header = {0};
 
-    if (size < 2) return MQTT_ERR_INVALID_ARG;
-    ret = ms_network_recv((ms_network_handle_t)(client->network_handle), buffer, 1, timeout_ms);
-    if (ret < 0) return ret;
-    if (ret != 1) return MQTT_ERR_SIZE;
-    header.byte = *buffer;
-    rlen += ret;
-    buffer += ret;
+    if (avail < 1) return 0;
+    header.byte = p[0];
     if (ms_mqtt_client_check_header(&header) == 0) return MQTT_ERR_RESPONSE;
 
-    do {
-        if (rlen >= size) return MQTT_ERR_MEM;
-        ret = ms_network_recv((ms_network_handle_t)(client->network_handle), &tmp_value, 1, client->config->network.timeout_ms);
+    for (i = 1; i < 5; i++) {
+        if (i >= avail) return 0;
+        value += (p[i] & 127) * multiplier;
+        multiplier *= 128;
+        if ((p[i] & 128) == 0) {
+            *msg_len = value;
+            return i + 1;
+        }
+    }
+    return MQTT_ERR_RESPONSE;
+}
+
+/// @brief Whether a complete packet is already buffered
+static int ms_mqtt_client_stream_ready(ms_mqtt_client_handle_t client)
+{
+    int msg_len = 0;
+    int hdr_len = ms_mqtt_client_stream_header(client, &msg_len);
+
+    if (hdr_len <= 0) return hdr_len < 0;
+    return client->rx_stream_len - client->rx_stream_pos >= hdr_len + msg_len;
+}
+
+static void ms_mqtt_client_stream_reset(ms_mqtt_client_handle_t client)
+{
+    client->rx_stream_pos = 0;
+    client->rx_stream_len = 0;
+}
+
+static int ms_mqtt_client_stream_fill(ms_mqtt_client_handle_t client, uint32_t timeout_ms)
+{
+    int ret = 0;
+
+    if (client->rx_stream_pos > 0) {
+        memmove(client->rx_stream, client->rx_stream + client->rx_stream_pos, client->rx_stream_len - client->rx_stream_pos);
+        client->rx_stream_len -= client->rx_stream_pos;
+        client->rx_stream_pos = 0;
+    }
+    ret = ms_network_recv_some((ms_network_handle_t)(client->network_handle), client->rx_stream + client->rx_stream_len,
+                               MS_MQTT_CLIENT_RX_STREAM_SIZE - client->rx_stream_len, timeout_ms);
+    if (ret < 0) return ret;
+    if (ret == 0) return MQTT_ERR_RECV;
+    client->rx_stream_len += ret;
+    return ret;
+}
+
+static int ms_mqtt_client_read_message(ms_mqtt_client_handle_t client, uint8_t *buffer, int size, uint32_t timeout_ms)
+{
+    int ret = 0, hdr_len = 0, msg_len = 0, total = 0, rlen = 0;
+    uint32_t wait_ms = timeout_ms;
+
+    if (size < 2) return MQTT_ERR_INVALID_ARG;
+    while ((hdr_len = ms_mqtt_client_stream_header(client, &msg_len)) == 0) {
+        // A started header is finished with the network timeout, like the rest of the packet
+        if (client->rx_stream_len > client->rx_stream_pos) wait_ms = client->config->network.timeout_ms;
+        ret = ms_mqtt_client_stream_fill(client, wait_ms);
         if (ret < 0) return ret;
-        if (ret != 1) return MQTT_ERR_SIZE;
-        *buffer = tmp_value;
-        rlen += ret;
-        buffer += ret;
+    }
+    if (hdr_len < 0) return hdr_len;
 
-        msg_len += (tmp_value & 127) * multiplier;
-        multiplier *= 128;
-    } while (rlen < 5 && (tmp_value & 128) != 0);
+    total = hdr_len + msg_len;
+    if (total > size) return MQTT_ERR_MEM;
+
+    rlen = MS_MQTT_MIN(client->rx_stream_len - client->rx_stream_pos, total);
+    memcpy(buffer, client->rx_stream + client->rx_stream_pos, rlen);
+    client->rx_stream_pos += rlen;
+    if (client->rx_stream_pos == client->rx_stream_len) ms_mqtt_client_stream_reset(client);
 
-    if (msg_len + rlen > size) return MQTT_ERR_MEM;
-    if (msg_len > 0) {
-        do {
-            ret = ms_network_recv((ms_network_handle_t)(client->network_handle), buffer + msg_rlen, msg_len - msg_rlen, client->config->network.timeout_ms);
-            if (ret < 0) return ret;
-            msg_rlen += ret;
-        } while (msg_rlen != msg_len);
-        if (msg_rlen != msg_len) return MQTT_ERR_SIZE;
-        rlen += msg_rlen;
+    // Whatever did not fit the stream goes straight into the packet buffer
+    while (rlen < total) {
+        ret = ms_network_recv((ms_network_handle_t)(client->network_handle), buffer + rlen, total - rlen, client->config->network.timeout_ms);
+        if (ret <= 0) return MQTT_ERR_RECV;     // The stream lost sync, the caller reconnects
+        rlen += ret;
     }
 
-    return rlen;
+    return total;
 }
 
 static int ms_mqtt_client_connect(ms_mqtt_client_handle_t client)
@@ -283,6 +330,7 @@ static int ms_mqtt_client_connect(ms_mqtt_client_handle_t client)
     options.username.cstring = client->config->authentication.username;
     options.password.cstring = client->config->authentication.password;
 
+    ms_mqtt_client_stream_reset(client);
     slen = MQTTSerialize_connect(buffer, client->config->network.tx_buf_size, &options);
     if (slen <= 0) {
         hal_mem_free(buffer);
@@ -379,25 +427,12 @@ static int ms_mqtt_client_keepalive_process(ms_mqtt_client_handle_t client)
     return MQTT_ERR_OK;
 }
 
-static int ms_mqtt_client_receive_process(ms_mqtt_client_handle_t client)
+static int ms_mqtt_client_handle_message(ms_mqtt_client_handle_t client, uint8_t *buffer, int rlen)
 {
-    int slen = 0, rlen = 0, ret = 0;
-    uint8_t *buffer = NULL;
+    int slen = 0, ret = MQTT_ERR_OK;
     uint16_t msg_id = 0;
     MQTTHeader header = {0};
     MQTTString topicName = {0};
-    
-    buffer = (uint8_t *)hal_mem_alloc_large(client->config->network.rx_buf_size);
-    if (buffer == NULL) return MQTT_ERR_MEM;
-
-    ret = ms_mqtt_client_read_message(client, buffer, client->config->network.rx_buf_size, pdTICKS_TO_MS(MS_MQTT_CLIENT_TASK_BLOCK_TICK));
-    if (ret < 0) {
-        hal_mem_free(buffer);
-        if (ret == NET_ERR_TIMEOUT) ret = MQTT_ERR_OK;
-        return ret;
-    }
-    rlen = ret;
-    ret = MQTT_ERR_OK;
 
     header.byte = buffer[0];
     msg_id = ms_mqtt_client_get_message_id(buffer, rlen);
@@ -497,7 +532,29 @@ static int ms_mqtt_client_receive_process(ms_mqtt_client_handle_t client)
             break;
     }
 
-    hal_mem_free(buffer);
+    return ret;
+}
+
+static int ms_mqtt_client_receive_process(ms_mqtt_client_handle_t client)
+{
+    int ret = 0, count = 0;
+    uint32_t wait_ms = pdTICKS_TO_MS(MS_MQTT_CLIENT_TASK_BLOCK_TICK);
+
+    // Queued publishes should not wait for the idle timeout
+    MS_MQTT_CLIENT_LOCK(client);
+    if (outbox_dequeue(client->outbox, QUEUED, NULL) != NULL) wait_ms = 1;
+    MS_MQTT_CLIENT_UNLOCK(client);
+
+    do {
+        ret = ms_mqtt_client_read_message(client, client->rx_packet, client->config->network.rx_buf_size, wait_ms);
+        if (ret < 0) {
+            if (ret == NET_ERR_TIMEOUT) ret = MQTT_ERR_OK;
+            return ret;
+        }
+        ret = ms_mqtt_client_handle_message(client, client->rx_packet, ret);
+        if (ret != MQTT_ERR_OK) return ret;
+    } while (++count < MS_MQTT_CLIENT_RX_BURST && ms_mqtt_client_stream_ready(client));
+
     return ret;
 }
 
@@ -949,6 +1006,10 @@ ms_mqtt_client_handle_t ms_mqtt_client_init(const ms_mqtt_config_t *config)
         LOG_LIB_ERROR("MQTT client lock handle malloc failed!");
         goto ms_mqtt_client_init_failed;
     }
+    client->rx_stream = (uint8_t *)hal_mem_alloc_large(MS_MQTT_CLIENT_RX_STREAM_SIZE);
+    MS_MQTT_CHECK_MALLOC(client->rx_stream, ms_mqtt_client_init_failed);
+    client->rx_packet = (uint8_t *)hal_mem_alloc_large(client->config->network.rx_buf_size);
+    MS_MQTT_CHECK_MALLOC(client->rx_packet, ms_mqtt_client_init_failed);
     client->status_bits = xEventGroupCreate();
     if (client->status_bits == NULL) {
         LOG_LIB_ERROR("MQTT client event group handle malloc failed!");
@@ -968,6 +1029,7 @@ ms_mqtt_client_handle_t ms_mqtt_client_init(const ms_mqtt_config_t *config)
     tls_config.client_key_data = client->config->authentication.client_key_data;
     tls_config.client_key_len = client->config->authentication.client_key_len;
     tls_config.is_verify_hostname = client->config->authentication.is_verify_hostname;
+    tls_config.is_session_persist = client->config->authentication.is_session_persist;
     client->network_handle = (void *)ms_network_init(&tls_config);
     if ((ms_network_handle_t)(client->network_handle) == NULL) {
         LOG_LIB_ERROR("MQTT client network handle init failed!");
@@ -1021,6 +1083,8 @@ int ms_mqtt_client_destroy(ms_mqtt_client_handle_t client)
         vSemaphoreDelete(client->lock);
     }
 
+    if (client->rx_stream != NULL) hal_mem_free(client->rx_stream);
+    if (client->rx_packet != NULL) hal_mem_free(client->rx_packet);
     hal_mem_free(client);
     MQTT_PRINTF_ERROR_CODE(MQTT_ERR_OK);
     return MQTT_ERR_OK;
@@ -1247,6 +1311,52 @@ ms_mqtt_client_unsubscribe_end:
     return ret;
 }
 
+static void ms_mqtt_client_publish_ref_done(void *arg, int result)
+{
+    (void)result;
+    xSemaphoreGive((SemaphoreHandle_t)arg);
+}
+
+/// @brief Send a QoS 0 publish with the payload referenced from data, returns once data is released
+static int ms_mqtt_client_publish_ref(ms_mqtt_client_handle_t client, char *topic, uint8_t *data, int len, int retain)
+{
+    int ret = 0, topic_len = strlen(topic);
+    uint8_t *head = NULL, *ptr = NULL;
+    SemaphoreHandle_t done = NULL;
+    MQTTHeader header = {0};
+    MQTTString topic_str = MQTTString_initializer;
+
+    // Fixed header, remaining length and topic, QoS 0 has no packet identifier
+    head = (uint8_t *)hal_mem_alloc_fast(1 + 4 + 2 + topic_len);
+    done = xSemaphoreCreateBinary();
+    if (head == NULL || done == NULL) {
+        ret = MQTT_ERR_MEM;
+        goto ms_mqtt_client_publish_ref_end;
+    }
+    header.bits.type = PUBLISH;
+    header.bits.retain = retain;
+    ptr = head;
+    writeChar(&ptr, header.byte);
+    ptr += MQTTPacket_encode(ptr, 2 + topic_len + len);
+    topic_str.cstring = topic;
+    writeMQTTString(&ptr, topic_str);
+
+    ret = ms_network_send_ref((ms_network_handle_t)(client->network_handle), head, ptr - head, data, len,
+                              ms_mqtt_client_publish_ref_done, done, client->config->network.timeout_ms);
+    // Segments may reference data until the broker acknowledges them, the caller owns it again afterwards
+    xSemaphoreTake(done, portMAX_DELAY);
+    if (ret == len) ret = 0;
+    else if (ret >= 0) {
+        MS_MQTT_PRINTF("Actual send size: %d, expected send size: %d.", ret, len);
+        ret = MQTT_ERR_SIZE;
+    }
+
+ms_mqtt_client_publish_ref_end:
+    if (done) vSemaphoreDelete(done);
+    if (head) hal_mem_free(head);
+    return ret;
+}
+
 int ms_mqtt_client_publish(ms_mqtt_client_handle_t client, char *topic, uint8_t *data, int len, int qos, int retain)
 {
     int slen = 0, ret = 0;
@@ -1262,6 +1372,12 @@ int ms_mqtt_client_publish(ms_mqtt_client_handle_t client, char *topic, uint8_t
         MQTT_PRINTF_ERROR_CODE(MQTT_ERR_LIMIT);
         return MQTT_ERR_LIMIT;
     }
+    if (qos == 0 && data != NULL && len >= MS_MQTT_CLIENT_REF_MIN_LEN) {
+        MS_MQTT_PRINTF("send publish by reference, topic: %s, retain: %d, len: %d.", topic, retain, len);
+        ret = ms_mqtt_client_publish_ref(client, topic, data, len, retain);
+        MQTT_PRINTF_ERROR_CODE(ret);
+        return ret;
+    }
 
     buffer = (uint8_t *)hal_mem_alloc_large(client->config->network.tx_buf_size);
     if (buffer == NULL) {
@@ -15,7 +15,10 @@
 #define MS_MQTT_CLIENT_PING_TRY_COUNT               (3)
 #define MS_MQTT_CLIENT_MAX_EVENT_FUNC_SIZE          (3)
 #define MS_MQTT_CLIENT_TASK_BLOCK_TICK              (100)
+#define MS_MQTT_CLIENT_RX_STREAM_SIZE               (1024)      // Per connection read-ahead, larger payloads are read straight into the packet buffer
+#define MS_MQTT_CLIENT_RX_BURST                     (16)        // Buffered packets handled per loop before outbox and keepalive run
 #define MS_MQTT_CLIENT_MAX_CERT_DATA_SIZE           (32 * 1024)
+#define MS_MQTT_CLIENT_REF_MIN_LEN                  (2048)      // QoS 0 payloads from this size are sent from the caller's buffer instead of copied
 
 /// @brief MQTT client
 typedef struct ms_mqtt_client *ms_mqtt_client_handle_t;
@@ -48,6 +51,7 @@ typedef struct {
         size_t client_key_len;      // Client key length (if 0, use strlen)
 
         uint8_t is_verify_hostname; // Whether to verify hostname
+        uint8_t is_session_persist; // Keep the TLS session in NVS for resumption after deep sleep
     } authentication;
     
     struct last_will_t {
@@ -209,6 +213,8 @@ int ms_mqtt_client_subscribe_multiple(ms_mqtt_client_handle_t client, const ms_m
 int ms_mqtt_client_unsubscribe(ms_mqtt_client_handle_t client, char *topic);
 
 /// @brief Publish message
+/// @details QoS 0 payloads of MS_MQTT_CLIENT_REF_MIN_LEN bytes or more are sent without copying
+///          and are not limited by tx_buf_size; data is released before this returns either way.
 /// @param client Client handle
 /// @param topic Topic address
 /// @param data Message data
@@ -25,6 +25,11 @@ struct ms_mqtt_client
     uint32_t keepalive_tick;
     uint32_t reconnect_tick;
 
+    uint8_t            *rx_stream;      // Bytes read from the network, not parsed yet
+    int                 rx_stream_pos;
+    int                 rx_stream_len;
+    uint8_t            *rx_packet;      // Packet handed to the parser, events point into it
+
     outbox_handle_t     outbox;
     EventGroupHandle_t  status_bits;
     SemaphoreHandle_t   lock;
@@ -2,17 +2,29 @@
 #include <string.h>
 #include "lwip/netdb.h"
 #include "lwip/sockets.h"
+#include "lwip/api.h"
+#include "lwip/dns.h"
+#include "lwip/tcpip.h"
+#include "lwip/tcp.h"
+#include "lwip/priv/tcp_priv.h"
+#include "lwip/priv/sockets_priv.h"
 #include "lwip/altcp_tls.h"
 #include "mbedtls/debug.h"
+#include "mbedtls/sha256.h"
+#include "mbedtls/platform_util.h"
 #include "Log/debug.h"
+#include "storage.h"
+#include "drtc.h"
+#include "netif_manager.h"
 #include "ms_network.h"
 
 /// @brief Network receive data
 /// @param network_ Network handle
 /// @param buf Receive buffer
 /// @param len Receive length
+/// @param once Return after the first recv instead of filling the buffer until the link is idle
 /// @return Less than 0 indicates failure, greater than 0 indicates actual received length
-static int ms_network_base_recv(void *network_, uint8_t *buf, size_t len)
+static int ms_network_base_recv_ex(void *network_, uint8_t *buf, size_t len, uint8_t once)
 {
     int ret = 0;
     size_t all_rlen = 0;
@@ -63,7 +75,7 @@ static int ms_network_base_recv(void *network_, uint8_t *buf, size_t len)
             goto ms_network_recv_end;
         }
         all_rlen += ret;
-    } while (all_rlen < len);
+    } while (!once && all_rlen < len);
 
 ms_network_recv_end:
     xSemaphoreGive(network->rx_lock);
@@ -74,6 +86,16 @@ ms_network_recv_end:
     return ret;
 }
 
+/// @brief Network receive data
+/// @param network_ Network handle
+/// @param buf Receive buffer
+/// @param len Receive length
+/// @return Less than 0 indicates failure, greater than 0 indicates actual received length
+static int ms_network_base_recv(void *network_, uint8_t *buf, size_t len)
+{
+    return ms_network_base_recv_ex(network_, buf, len, 0);
+}
+
 /// @brief Network receive data
 /// @param network_ Network handle
 /// @param buf Receive buffer
@@ -89,18 +111,153 @@ ms_network_recv_end:
 //    return ms_network_base_recv(network_, buf, len);
 //}
 
+#define MS_NETWORK_TX_REF_FREE      (0)
+#define MS_NETWORK_TX_REF_WRITING   (1)
+#define MS_NETWORK_TX_REF_QUEUED    (2)
+
+static u8_t g_tx_ref_id = 0xFF;                 // TCP ext arg slot linking a pcb to its network
+static tcp_sent_fn g_tx_ref_netconn_sent = NULL; // Sent callback of the socket layer, chained
+
+/// @brief Release referenced sends the peer acknowledged, or all of them if result is an error,
+///        caller holds the tcpip core lock
+static void ms_network_tx_ref_complete(ms_network_handle_t network, uint32_t lastack, int result)
+{
+    ms_network_tx_ref_t *ref = NULL;
+
+    while (network->tx_ref_count > 0) {
+        ref = &network->tx_ref[network->tx_ref_head];
+        if (result == NET_ERR_OK &&
+            (ref->state != MS_NETWORK_TX_REF_QUEUED || TCP_SEQ_LT(lastack, ref->end_seq))) break;
+
+        network->tx_ref_head = (network->tx_ref_head + 1) % MS_NETWORK_TX_REF_NUM;
+        network->tx_ref_count--;
+        ref->state = MS_NETWORK_TX_REF_FREE;
+        if (ref->done_cb) ref->done_cb(ref->arg, result);
+    }
+}
+
+static err_t ms_network_tx_ref_sent(void *arg, struct tcp_pcb *pcb, u16_t len)
+{
+    ms_network_handle_t network = (ms_network_handle_t)tcp_ext_arg_get(pcb, g_tx_ref_id);
+
+    if (network != NULL) ms_network_tx_ref_complete(network, pcb->lastack, NET_ERR_OK);
+    return g_tx_ref_netconn_sent ? g_tx_ref_netconn_sent(arg, pcb, len) : ERR_OK;
+}
+
+static void ms_network_tx_ref_destroyed(u8_t id, void *data)
+{
+    ms_network_handle_t network = (ms_network_handle_t)data;
+    LWIP_UNUSED_ARG(id);
+
+    // The pcb purged its segments before being freed, nothing references the buffers anymore
+    if (network == NULL) return;
+    network->tx_pcb = NULL;
+    ms_network_tx_ref_complete(network, 0, NET_ERR_CONN);
+}
+
+static const struct tcp_ext_arg_callbacks g_tx_ref_callbacks = {
+    ms_network_tx_ref_destroyed,
+    NULL,
+};
+
+/// @brief Connection behind the socket, caller holds the tcpip core lock
+static struct tcp_pcb *ms_network_get_pcb(ms_network_handle_t network)
+{
+    struct lwip_sock *sock = lwip_socket_dbg_get_socket(network->sock_fd);
+
+    if (sock == NULL || sock->conn == NULL || NETCONNTYPE_GROUP(netconn_type(sock->conn)) != NETCONN_TCP) return NULL;
+    return sock->conn->pcb.tcp;
+}
+
+/// @brief Hook the connection so acknowledgements release referenced sends, caller holds the tcpip core lock
+static struct tcp_pcb *ms_network_tx_ref_attach(ms_network_handle_t network)
+{
+    struct tcp_pcb *pcb = ms_network_get_pcb(network);
+
+    if (pcb == NULL || (pcb->state != ESTABLISHED && pcb->state != CLOSE_WAIT)) return NULL;
+    if (pcb == network->tx_pcb) return pcb;
+
+    if (g_tx_ref_id == 0xFF) g_tx_ref_id = tcp_ext_arg_alloc_id();
+    if (pcb->sent != ms_network_tx_ref_sent) {
+        g_tx_ref_netconn_sent = pcb->sent;
+        tcp_sent(pcb, ms_network_tx_ref_sent);
+    }
+    tcp_ext_arg_set_callbacks(pcb, g_tx_ref_id, &g_tx_ref_callbacks);
+    tcp_ext_arg_set(pcb, g_tx_ref_id, network);
+    // Referenced sends never fill the byte send buffer, which is what lets copied sends
+    // bypass Nagle, so a frame tail would otherwise wait for the peer's delayed ACK
+    tcp_nagle_disable(pcb);
+    network->tx_pcb = pcb;
+    return pcb;
+}
+
+/// @brief Wait for referenced sends before the socket goes away, abort the connection if the peer
+///        does not acknowledge them in time so the buffers are released before returning
+static void ms_network_tx_ref_release(ms_network_handle_t network)
+{
+    uint32_t start_tick = xTaskGetTickCount();
+    struct tcp_pcb *pcb = NULL;
+
+    LOCK_TCPIP_CORE();
+    while (network->tx_pcb != NULL && network->tx_ref_count > 0 &&
+           pdTICKS_TO_MS(xTaskGetTickCount() - start_tick) < MS_NETWORK_LAST_SEND_TIMEOUT_MS) {
+        UNLOCK_TCPIP_CORE();
+        vTaskDelay(pdMS_TO_TICKS(10));
+        LOCK_TCPIP_CORE();
+    }
+    pcb = network->tx_pcb;
+    if (pcb != NULL) {
+        if (network->tx_ref_count > 0) {
+            LOG_DRV_WARN("Socket(%d) %d referenced sends unacknowledged, aborting.", network->sock_fd, network->tx_ref_count);
+            tcp_abort(pcb);
+        } else {
+            tcp_ext_arg_set(pcb, g_tx_ref_id, NULL);
+            tcp_sent(pcb, g_tx_ref_netconn_sent);
+            network->tx_pcb = NULL;
+        }
+    }
+    UNLOCK_TCPIP_CORE();
+}
+
+/// @brief Queue data as pbufs referencing buf instead of copying it into the send buffer
+/// @return Less than 0 indicates failure, 0 if the send queue is full, otherwise the queued length
+static int ms_network_write_ref(ms_network_handle_t network, const uint8_t *buf, size_t len)
+{
+    struct lwip_sock *sock = lwip_socket_dbg_get_socket(network->sock_fd);
+    size_t written = 0, room = 0;
+    err_t err = ERR_OK;
+
+    if (sock == NULL || sock->conn == NULL) return -1;
+    LOCK_TCPIP_CORE();
+    if (sock->conn->pcb.tcp != NULL) {
+        // Each referenced segment takes a header and a data pbuf, tcp_write rejects a write
+        // that does not fit the pbuf queue as a whole
+        room = (size_t)(TCP_SND_QUEUELEN - tcp_sndqueuelen(sock->conn->pcb.tcp)) / 2 * tcp_mss(sock->conn->pcb.tcp);
+        if (len > room) len = room;
+    }
+    UNLOCK_TCPIP_CORE();
+    if (len == 0) return 0;
+
+    err = netconn_write_partly(sock->conn, buf, len, NETCONN_NOCOPY | NETCONN_DONTBLOCK, &written);
+    if (err == ERR_WOULDBLOCK) return 0;
+    if (err != ERR_OK) {
+        errno = err_to_errno(err);
+        return -1;
+    }
+    return (int)written;
+}
+
 /// @brief Network send data
 /// @param network_ Network handle
 /// @param buf Send buffer
 /// @param len Send length
+/// @param no_copy Queue pbufs referencing buf instead of copying it
 /// @return Less than 0 indicates failure, greater than 0 indicates actual sent length
-static int ms_network_base_send(void *network_, const uint8_t *buf, size_t len)
+static int ms_network_base_send_ex(void *network_, const uint8_t *buf, size_t len, uint8_t no_copy)
 {
     int ret = 0;
     size_t all_slen = 0;
-#if defined(MS_NETWORK_ONCE_MAX_SEND_SIZE) && MS_NETWORK_ONCE_MAX_SEND_SIZE > 0
     size_t once_send_size = 0;
-#endif
     uint32_t timeout_ms = MS_NETWORK_DEFAULT_TIMEOUT_MS, send_timeout_ms = 0;
     uint32_t start_tick = 0, now_tick = 0, diff_tick = 0;
     fd_set writefds;
@@ -109,7 +266,7 @@ static int ms_network_base_send(void *network_, const uint8_t *buf, size_t len)
     if (network == NULL || buf == NULL || len == 0) return NET_ERR_INVALID_ARG;
     if (network->tx_timeout_ms > 0) timeout_ms = network->tx_timeout_ms;
 
-    xSemaphoreTake(network->tx_lock, portMAX_DELAY);
+    xSemaphoreTakeRecursive(network->tx_lock, portMAX_DELAY);
     start_tick = xTaskGetTickCount();
 
     if (network->sock_fd < 0) {
@@ -159,10 +316,12 @@ static int ms_network_base_send(void *network_, const uint8_t *buf, size_t len)
         // printf("send len = %d / %d.\r\n", all_slen, len);
 #if (defined(MS_NETWORK_ONCE_MAX_SEND_SIZE) && MS_NETWORK_ONCE_MAX_SEND_SIZE > 0)
         once_send_size = (len - all_slen) > MS_NETWORK_ONCE_MAX_SEND_SIZE ? MS_NETWORK_ONCE_MAX_SEND_SIZE : (len - all_slen);
-        ret = send(network->sock_fd, (buf + all_slen), once_send_size, 0);
 #else
-        ret = send(network->sock_fd, (buf + all_slen), (len - all_slen), 0);
+        once_send_size = len - all_slen;
 #endif
+        if (no_copy) ret = ms_network_write_ref(network, (buf + all_slen), once_send_size);
+        else ret = send(network->sock_fd, (buf + all_slen), once_send_size, 0);
+        if (ret == 0 && no_copy) continue;   // Queue full of referenced segments, select waits for acknowledgements
         if (ret <= 0) {
             ret = NET_ERR_SEND;
             LOG_DRV_ERROR("Failed to send data(socket = %d, errno = %d).", network->sock_fd, errno);
@@ -172,7 +331,7 @@ static int ms_network_base_send(void *network_, const uint8_t *buf, size_t len)
     } while (all_slen < len);
     
 ms_network_send_end:
-    xSemaphoreGive(network->tx_lock);
+    xSemaphoreGiveRecursive(network->tx_lock);
     if (all_slen > 0) {
         if (all_slen != len) {
             now_tick = xTaskGetTickCount();
@@ -185,6 +344,16 @@ ms_network_send_end:
     return ret;
 }
 
+/// @brief Network send data
+/// @param network_ Network handle
+/// @param buf Send buffer
+/// @param len Send length
+/// @return Less than 0 indicates failure, greater than 0 indicates actual sent length
+static int ms_network_base_send(void *network_, const uint8_t *buf, size_t len)
+{
+    return ms_network_base_send_ex(network_, buf, len, 0);
+}
+
 static int ms_network_rng_func(void *ctx, unsigned char *buf, size_t len)
 {
     (void) ctx;
@@ -198,6 +367,339 @@ static int ms_network_rng_func(void *ctx, unsigned char *buf, size_t len)
     return 0;
 }
 
+#define MS_NETWORK_SESSION_NVS_MAGIC     (0x544C5353)       // "TLSS"
+#define MS_NETWORK_SESSION_BLOB_MAX      (2048)           // Room for the peer certificate if MBEDTLS_SSL_KEEP_PEER_CERTIFICATE is set
+#define MS_NETWORK_RTC_VALID_S           (1577836800ULL)    // 2020-01-01, the RTC has not been set before that
+
+/// @brief Cached TLS session, shared by all handles so a re-created client can still resume
+typedef struct
+{
+    uint8_t valid;
+    uint16_t port;
+    char host[MS_NETWORK_SESSION_HOST_MAX];
+    uint8_t trust_id[MS_NETWORK_TRUST_ID_LEN];
+    uint64_t expire_ms;             // Uptime after which the session is never offered again
+    uint32_t last_use;
+    mbedtls_ssl_session session;
+} ms_network_session_slot_t;
+
+/// @brief NVS record header, followed by the mbedtls_ssl_session_save() blob
+typedef struct
+{
+    uint32_t magic;
+    uint16_t port;
+    uint16_t blob_len;
+    uint8_t trust_id[MS_NETWORK_TRUST_ID_LEN];
+    uint64_t saved_time;            // RTC seconds of the full handshake
+    char host[MS_NETWORK_SESSION_HOST_MAX];
+} ms_network_session_record_t;
+
+static ms_network_session_slot_t g_session_slots[MS_NETWORK_SESSION_CACHE_NUM];
+static SemaphoreHandle_t g_session_lock = NULL;
+static uint32_t g_session_use = 0;
+
+static int ms_network_lock_init(SemaphoreHandle_t *lock_ptr)
+{
+    SemaphoreHandle_t lock = NULL;
+    if (*lock_ptr != NULL) return 0;
+
+    lock = xSemaphoreCreateMutex();
+    if (lock == NULL) return -1;
+    taskENTER_CRITICAL();
+    if (*lock_ptr == NULL) {
+        *lock_ptr = lock;
+        lock = NULL;
+    }
+    taskEXIT_CRITICAL();
+    if (lock != NULL) vSemaphoreDelete(lock);
+    return 0;
+}
+
+/// @brief Digest of everything that decided whether the peer was trusted
+static void ms_network_session_trust_id(ms_network_handle_t network, const network_tls_config_t *tls_config)
+{
+    mbedtls_sha256_context ctx;
+    uint8_t digest[32];
+    size_t dlen = 0;
+
+    mbedtls_sha256_init(&ctx);
+    mbedtls_sha256_starts(&ctx, 0);
+    mbedtls_sha256_update(&ctx, &tls_config->is_verify_hostname, 1);
+    if (tls_config->ca_data != NULL) {
+        dlen = tls_config->ca_len ? tls_config->ca_len : strlen(tls_config->ca_data);
+        mbedtls_sha256_update(&ctx, (const unsigned char *)tls_config->ca_data, dlen);
+    }
+    if (tls_config->client_cert_data != NULL) {
+        dlen = tls_config->client_cert_len ? tls_config->client_cert_len : strlen(tls_config->client_cert_data);
+        mbedtls_sha256_update(&ctx, (const unsigned char *)tls_config->client_cert_data, dlen);
+    }
+    mbedtls_sha256_finish(&ctx, digest);
+    mbedtls_sha256_free(&ctx);
+    memcpy(network->trust_id, digest, MS_NETWORK_TRUST_ID_LEN);
+}
+
+static void ms_network_session_nvs_key(const char *host, uint16_t port, char *key, size_t key_size)
+{
+    uint32_t hash = 2166136261u;
+    while (*host) {
+        hash ^= (uint8_t)*host++;
+        hash *= 16777619u;
+    }
+    hash ^= port;
+    hash *= 16777619u;
+    snprintf(key, key_size, "tls_%08lx", (unsigned long)hash);
+}
+
+static int ms_network_session_rtc_valid(uint64_t *now)
+{
+    *now = rtc_get_timeStamp();
+    return *now >= MS_NETWORK_RTC_VALID_S;
+}
+
+static int ms_network_session_has_data(const mbedtls_ssl_session *session)
+{
+    if (mbedtls_ssl_session_get_id_len(session) > 0) return 1;
+#if defined(MBEDTLS_SSL_SESSION_TICKETS) && defined(MBEDTLS_SSL_CLI_C)
+    if (session->MBEDTLS_PRIVATE(ticket_len) > 0) return 1;
+#endif
+    return 0;
+}
+
+/// @brief Find a live slot, caller holds g_session_lock
+static ms_network_session_slot_t *ms_network_session_find(ms_network_handle_t network, const char *host, uint16_t port)
+{
+    ms_network_session_slot_t *slot = NULL;
+    uint64_t now_ms = rtc_get_uptime_ms();
+
+    for (int i = 0; i < MS_NETWORK_SESSION_CACHE_NUM; i++) {
+        slot = &g_session_slots[i];
+        if (!slot->valid || slot->port != port || strcmp(slot->host, host) != 0) continue;
+        if (memcmp(slot->trust_id, network->trust_id, MS_NETWORK_TRUST_ID_LEN) != 0) continue;
+        if (now_ms >= slot->expire_ms) {
+            mbedtls_ssl_session_free(&slot->session);
+            slot->valid = 0;
+            return NULL;
+        }
+        return slot;
+    }
+    return NULL;
+}
+
+/// @brief Take over a session into the matching or least recently used slot, caller holds g_session_lock
+static void ms_network_session_put(ms_network_handle_t network, const char *host, uint16_t port,
+                                   mbedtls_ssl_session *session, uint64_t expire_ms)
+{
+    ms_network_session_slot_t *slot = ms_network_session_find(network, host, port);
+
+    if (slot == NULL) {
+        slot = &g_session_slots[0];
+        for (int i = 0; i < MS_NETWORK_SESSION_CACHE_NUM; i++) {
+            if (!g_session_slots[i].valid) {
+                slot = &g_session_slots[i];
+                break;
+            }
+            if (g_session_slots[i].last_use < slot->last_use) slot = &g_session_slots[i];
+        }
+    }
+    if (slot->valid) mbedtls_ssl_session_free(&slot->session);
+
+    memcpy(&slot->session, session, sizeof(mbedtls_ssl_session));
+    strncpy(slot->host, host, sizeof(slot->host) - 1);
+    slot->host[sizeof(slot->host) - 1] = '\0';
+    slot->port = port;
+    memcpy(slot->trust_id, network->trust_id, MS_NETWORK_TRUST_ID_LEN);
+    slot->expire_ms = expire_ms;
+    slot->last_use = ++g_session_use;
+    slot->valid = 1;
+}
+
+/// @brief Load a session saved before deep sleep into the RAM cache
+static void ms_network_session_nvs_load(ms_network_handle_t network, const char *host, uint16_t port)
+{
+    ms_network_session_record_t *record = NULL;
+    mbedtls_ssl_session session;
+    char key[16];
+    uint64_t now = 0, age = 0;
+    int ret = 0;
+
+    if (!ms_network_session_rtc_valid(&now)) return;
+    record = (ms_network_session_record_t *)hal_mem_alloc_large(sizeof(ms_network_session_record_t) + MS_NETWORK_SESSION_BLOB_MAX);
+    if (record == NULL) return;
+
+    ms_network_session_nvs_key(host, port, key, sizeof(key));
+    ret = storage_nvs_read(NVS_USER, key, record, sizeof(ms_network_session_record_t) + MS_NETWORK_SESSION_BLOB_MAX);
+    if (ret < (int)sizeof(ms_network_session_record_t)) goto ms_network_session_nvs_load_end;
+
+    if (record->magic != MS_NETWORK_SESSION_NVS_MAGIC || record->port != port ||
+        record->blob_len > MS_NETWORK_SESSION_BLOB_MAX ||
+        ret != (int)(sizeof(ms_network_session_record_t) + record->blob_len) ||
+        strncmp(record->host, host, sizeof(record->host)) != 0 ||
+        memcmp(record->trust_id, network->trust_id, MS_NETWORK_TRUST_ID_LEN) != 0) {
+        goto ms_network_session_nvs_load_end;
+    }
+    // A clock that went backwards can not prove the age, drop the session
+    if (record->saved_time > now || now - record->saved_time >= MS_NETWORK_SESSION_LIFETIME_S) {
+        storage_nvs_delete(NVS_USER, key);
+        goto ms_network_session_nvs_load_end;
+    }
+    age = now - record->saved_time;
+
+    mbedtls_ssl_session_init(&session);
+    ret = mbedtls_ssl_session_load(&session, (const unsigned char *)(record + 1), record->blob_len);
+    if (ret != 0) {
+        LOG_DRV_WARN("TLS session load failed(ret = -0x%x).", -ret);
+        mbedtls_ssl_session_free(&session);
+        storage_nvs_delete(NVS_USER, key);
+        goto ms_network_session_nvs_load_end;
+    }
+
+    xSemaphoreTake(g_session_lock, portMAX_DELAY);
+    if (ms_network_session_find(network, host, port) == NULL) {
+        ms_network_session_put(network, host, port, &session,
+                               rtc_get_uptime_ms() + (MS_NETWORK_SESSION_LIFETIME_S - age) * 1000ULL);
+    } else {
+        mbedtls_ssl_session_free(&session);
+    }
+    xSemaphoreGive(g_session_lock);
+
+ms_network_session_nvs_load_end:
+    mbedtls_platform_zeroize(record, sizeof(ms_network_session_record_t) + MS_NETWORK_SESSION_BLOB_MAX);
+    hal_mem_free(record);
+}
+
+static void ms_network_session_nvs_save(ms_network_handle_t network, const char *host, uint16_t port,
+                                        const mbedtls_ssl_session *session)
+{
+    ms_network_session_record_t *record = NULL;
+    char key[16];
+    size_t blob_len = 0;
+    uint64_t now = 0;
+    int ret = 0;
+
+    if (!ms_network_session_rtc_valid(&now)) return;
+    record = (ms_network_session_record_t *)hal_mem_alloc_large(sizeof(ms_network_session_record_t) + MS_NETWORK_SESSION_BLOB_MAX);
+    if (record == NULL) return;
+
+    memset(record, 0, sizeof(ms_network_session_record_t));
+    ret = mbedtls_ssl_session_save(session, (unsigned char *)(record + 1), MS_NETWORK_SESSION_BLOB_MAX, &blob_len);
+    if (ret == 0) {
+        record->magic = MS_NETWORK_SESSION_NVS_MAGIC;
+        record->port = port;
+        record->blob_len = (uint16_t)blob_len;
+        memcpy(record->trust_id, network->trust_id, MS_NETWORK_TRUST_ID_LEN);
+        record->saved_time = now;
+        strncpy(record->host, host, sizeof(record->host) - 1);
+        ms_network_session_nvs_key(host, port, key, sizeof(key));
+        if (storage_nvs_write(NVS_USER, key, record, sizeof(ms_network_session_record_t) + blob_len) < 0) {
+            LOG_DRV_WARN("TLS session save to NVS failed.");
+        }
+    } else {
+        LOG_DRV_WARN("TLS session save failed(ret = -0x%x, len = %d).", -ret, (int)blob_len);
+    }
+    mbedtls_platform_zeroize(record, sizeof(ms_network_session_record_t) + MS_NETWORK_SESSION_BLOB_MAX);
+    hal_mem_free(record);
+}
+
+/// @brief Remove the saved session of a server, no flash write if there is none
+static void ms_network_session_nvs_delete(const char *host, uint16_t port)
+{
+    char key[16];
+
+    ms_network_session_nvs_key(host, port, key, sizeof(key));
+    storage_nvs_delete(NVS_USER, key);
+}
+
+/// @brief Offer a cached session for this server, call after mbedtls_ssl_session_reset()
+/// @return 1 if a session was offered, 0 otherwise
+static int ms_network_session_apply(ms_network_handle_t network, const char *host, uint16_t port, uint8_t *master)
+{
+    ms_network_session_slot_t *slot = NULL;
+    int offered = 0;
+
+    if (strlen(host) >= MS_NETWORK_SESSION_HOST_MAX) return 0;
+
+    xSemaphoreTake(g_session_lock, portMAX_DELAY);
+    slot = ms_network_session_find(network, host, port);
+    xSemaphoreGive(g_session_lock);
+    if (slot == NULL && network->is_session_persist) ms_network_session_nvs_load(network, host, port);
+
+    xSemaphoreTake(g_session_lock, portMAX_DELAY);
+    slot = ms_network_session_find(network, host, port);
+    if (slot != NULL && mbedtls_ssl_set_session(&network->ssl, &slot->session) == 0) {
+        memcpy(master, slot->session.MBEDTLS_PRIVATE(master), sizeof(slot->session.MBEDTLS_PRIVATE(master)));
+        slot->last_use = ++g_session_use;
+        offered = 1;
+    }
+    xSemaphoreGive(g_session_lock);
+    return offered;
+}
+
+/// @brief Remember the session of a finished handshake
+/// @param offered_master Master secret of the offered session, NULL if none was offered
+static void ms_network_session_update(ms_network_handle_t network, const char *host, uint16_t port, const uint8_t *offered_master)
+{
+    mbedtls_ssl_session session;
+    ms_network_session_slot_t *slot = NULL;
+    uint64_t expire_ms = 0;
+    int resumed = 0;
+
+    if (strlen(host) >= MS_NETWORK_SESSION_HOST_MAX) return;
+
+    mbedtls_ssl_session_init(&session);
+    if (mbedtls_ssl_get_session(&network->ssl, &session) != 0 || !ms_network_session_has_data(&session)) {
+        mbedtls_ssl_session_free(&session);
+        network->handshake_full++;
+        return;
+    }
+
+    // An abbreviated handshake keeps the master secret of the offered session
+    resumed = offered_master != NULL &&
+              memcmp(session.MBEDTLS_PRIVATE(master), offered_master, sizeof(session.MBEDTLS_PRIVATE(master))) == 0;
+    if (resumed) {
+        network->handshake_resumed++;
+    } else {
+        network->handshake_full++;
+        if (network->is_session_persist) {
+            ms_network_session_nvs_save(network, host, port, &session);
+        } else {
+            // Persistence turned off: do not leave an older session's secret behind
+            ms_network_session_nvs_delete(host, port);
+        }
+    }
+
+    xSemaphoreTake(g_session_lock, portMAX_DELAY);
+    slot = ms_network_session_find(network, host, port);
+    if (resumed && slot != NULL) {
+        expire_ms = slot->expire_ms;
+    } else if (resumed) {
+        // Expired while the handshake ran
+        mbedtls_ssl_session_free(&session);
+        xSemaphoreGive(g_session_lock);
+        return;
+    } else {
+        expire_ms = rtc_get_uptime_ms() + MS_NETWORK_SESSION_LIFETIME_S * 1000ULL;
+    }
+    // A renewed ticket replaces the old one, the lifetime still counts from the full handshake
+    ms_network_session_put(network, host, port, &session, expire_ms);
+    xSemaphoreGive(g_session_lock);
+}
+
+/// @brief Forget the session of a server, e.g. after a failed resumption
+static void ms_network_session_drop(ms_network_handle_t network, const char *host, uint16_t port)
+{
+    ms_network_session_slot_t *slot = NULL;
+
+    xSemaphoreTake(g_session_lock, portMAX_DELAY);
+    slot = ms_network_session_find(network, host, port);
+    if (slot != NULL) {
+        mbedtls_ssl_session_free(&slot->session);
+        slot->valid = 0;
+    }
+    xSemaphoreGive(g_session_lock);
+
+    ms_network_session_nvs_delete(host, port);
+}
+
 //static void ms_network_debug_func(void *arg, int level, const char *file, int line, const char *log)
 //{
 //    (void) arg;
@@ -226,14 +728,15 @@ ms_network_handle_t ms_network_init(const network_tls_config_t *tls_config)
         return NULL;
     }
 
-    network->tx_lock = xSemaphoreCreateMutex();
+    // Recursive so ms_network_send_ref can keep a header and its body contiguous on the wire
+    network->tx_lock = xSemaphoreCreateRecursiveMutex();
     if (network->tx_lock == NULL) {
         vSemaphoreDelete(network->rx_lock);
         hal_mem_free(network);
         return NULL;
     }
     xSemaphoreTake(network->rx_lock, portMAX_DELAY);
-    xSemaphoreTake(network->tx_lock, portMAX_DELAY);
+    xSemaphoreTakeRecursive(network->tx_lock, portMAX_DELAY);
     network->sock_fd = -1;
     if (tls_config != NULL && (tls_config->ca_data || tls_config->client_cert_data || tls_config->client_key_data)) {
         
@@ -256,6 +759,14 @@ ms_network_handle_t ms_network_init(const network_tls_config_t *tls_config)
         }
         mbedtls_ssl_conf_authmode(&network->ssl_conf, tls_config->is_verify_hostname ? MBEDTLS_SSL_VERIFY_REQUIRED : MBEDTLS_SSL_VERIFY_OPTIONAL);
         mbedtls_ssl_conf_rng(&network->ssl_conf, ms_network_rng_func, &network->ctr_drbg);
+    #if defined(MBEDTLS_SSL_SESSION_TICKETS)
+        mbedtls_ssl_conf_session_tickets(&network->ssl_conf, MBEDTLS_SSL_SESSION_TICKETS_ENABLED);
+    #endif
+        if (ms_network_lock_init(&g_session_lock) != 0) {
+            LOG_DRV_ERROR("TLS session lock create failed.");
+            goto ms_network_init_failed;
+        }
+        ms_network_session_trust_id(network, tls_config);
 
         if (tls_config->ca_data != NULL) {
             dlen = tls_config->ca_len;
@@ -300,43 +811,404 @@ ms_network_handle_t ms_network_init(const network_tls_config_t *tls_config)
 
         mbedtls_ssl_set_bio(&network->ssl, network, ms_network_base_send, ms_network_base_recv, NULL);
         network->is_verify_hostname = tls_config->is_verify_hostname;
+        network->is_session_persist = tls_config->is_session_persist;
         network->tls_enable_flag = 1;
     }
 
-    xSemaphoreGive(network->tx_lock);
+    xSemaphoreGiveRecursive(network->tx_lock);
     xSemaphoreGive(network->rx_lock);
     return network;
 ms_network_init_failed:
-    xSemaphoreGive(network->tx_lock);
+    xSemaphoreGiveRecursive(network->tx_lock);
     xSemaphoreGive(network->rx_lock);
     ms_network_deinit(network);
     return NULL;
 }
 
+#define MS_NETWORK_DNS_NVS_KEY          "dns_cache"
+#define MS_NETWORK_DNS_NVS_MAGIC        (0x444E5343)       // "DNSC"
+#define MS_NETWORK_DNS_ADDR_IS_ZERO(a)  (!((a)[0] | (a)[1] | (a)[2] | (a)[3]))
+
+/// @brief Cached host address, shared by all handles
+typedef struct
+{
+    uint8_t valid;
+    uint8_t resolving;              // Query in flight, no second one is started
+    uint8_t addr[4];
+    char host[MS_NETWORK_DNS_HOST_MAX];
+    uint32_t ttl_s;
+    uint64_t expire_ms;             // Uptime after which the address is stale
+    uint64_t refresh_ms;            // Uptime after which a lookup refreshes it in the background
+    uint32_t last_use;
+} ms_network_dns_slot_t;
+
+/// @brief NVS image of the cache, times in RTC seconds so they survive deep sleep
+typedef struct
+{
+    uint32_t magic;
+    uint32_t count;
+    struct {
+        char host[MS_NETWORK_DNS_HOST_MAX];
+        uint8_t addr[4];
+        uint32_t ttl_s;
+        uint64_t expire_time;
+    } entry[MS_NETWORK_DNS_CACHE_NUM];
+} ms_network_dns_record_t;
+
+/// @brief One lwIP query, shared by the waiting caller (if any) and the found callback
+typedef struct
+{
+    SemaphoreHandle_t done;         // NULL for background refreshes
+    uint8_t refs;
+    uint8_t found;
+    uint8_t addr[4];
+} ms_network_dns_req_t;
+
+static ms_network_dns_slot_t g_dns_slots[MS_NETWORK_DNS_CACHE_NUM];
+static SemaphoreHandle_t g_dns_lock = NULL;
+static uint32_t g_dns_use = 0;
+static uint8_t g_dns_loaded = 0;
+static uint8_t g_dns_dirty = 0;
+
+/// @brief Find a slot by host, caller holds g_dns_lock
+static ms_network_dns_slot_t *ms_network_dns_find(const char *host)
+{
+    for (int i = 0; i < MS_NETWORK_DNS_CACHE_NUM; i++) {
+        if (g_dns_slots[i].valid && lwip_stricmp(g_dns_slots[i].host, host) == 0) return &g_dns_slots[i];
+    }
+    return NULL;
+}
+
+/// @brief Find or take over the free or least recently used slot, caller holds g_dns_lock
+static ms_network_dns_slot_t *ms_network_dns_get(const char *host)
+{
+    ms_network_dns_slot_t *slot = ms_network_dns_find(host);
+    if (slot != NULL) return slot;
+
+    // A slot with a query in flight is only taken when every slot has one
+    for (int i = 0; i < MS_NETWORK_DNS_CACHE_NUM; i++) {
+        if (!g_dns_slots[i].valid) {
+            slot = &g_dns_slots[i];
+            break;
+        }
+        if (slot == NULL || (slot->resolving && !g_dns_slots[i].resolving) ||
+            (slot->resolving == g_dns_slots[i].resolving && g_dns_slots[i].last_use < slot->last_use)) {
+            slot = &g_dns_slots[i];
+        }
+    }
+    memset(slot, 0, sizeof(ms_network_dns_slot_t));
+    strncpy(slot->host, host, sizeof(slot->host) - 1);
+    slot->valid = 1;
+    return slot;
+}
+
+/// @brief Set the address and lifetime of a slot, caller holds g_dns_lock
+static void ms_network_dns_set(ms_network_dns_slot_t *slot, const uint8_t *addr, uint32_t ttl_s, uint64_t now_ms)
+{
+    if (ttl_s > MS_NETWORK_DNS_TTL_MAX_S) ttl_s = MS_NETWORK_DNS_TTL_MAX_S;
+    memcpy(slot->addr, addr, 4);
+    slot->ttl_s = ttl_s;
+    slot->expire_ms = now_ms + ttl_s * 1000ULL;
+    slot->refresh_ms = now_ms + ttl_s * 10ULL * MS_NETWORK_DNS_PREFETCH_PCT;
+}
+
+/// @brief Order of magnitude of a TTL, small TTL changes do not rewrite NVS
+static uint32_t ms_network_dns_ttl_bucket(uint32_t ttl_s)
+{
+    uint32_t bucket = 0;
+
+    if (ttl_s > MS_NETWORK_DNS_TTL_MAX_S) ttl_s = MS_NETWORK_DNS_TTL_MAX_S;
+    while (ttl_s) {
+        ttl_s >>= 1;
+        bucket++;
+    }
+    return bucket;
+}
+
+/// @brief Store a fresh answer, caller holds g_dns_lock
+/// @note Only a new address or TTL bucket marks the cache for NVS, so refreshes that
+///       return the same answer do not rewrite flash
+static void ms_network_dns_update(ms_network_dns_slot_t *slot, const uint8_t *addr, uint32_t ttl_s)
+{
+    if (memcmp(slot->addr, addr, 4) != 0 || ms_network_dns_ttl_bucket(slot->ttl_s) != ms_network_dns_ttl_bucket(ttl_s)) {
+        g_dns_dirty = 1;
+    }
+    ms_network_dns_set(slot, addr, ttl_s, rtc_get_uptime_ms());
+}
+
+/// @brief Load the cache saved before deep sleep, entries expired meanwhile stay as fallback
+static void ms_network_dns_nvs_load(void)
+{
+    ms_network_dns_record_t *record = NULL;
+    ms_network_dns_slot_t *slot = NULL;
+    uint64_t now = 0, now_ms = rtc_get_uptime_ms();
+    int rtc_valid = ms_network_session_rtc_valid(&now);
+    int ret = 0;
+
+    record = (ms_network_dns_record_t *)hal_mem_alloc_large(sizeof(ms_network_dns_record_t));
+    if (record == NULL) return;
+    ret = storage_nvs_read(NVS_USER, MS_NETWORK_DNS_NVS_KEY, record, sizeof(ms_network_dns_record_t));
+    if (ret == (int)sizeof(ms_network_dns_record_t) && record->magic == MS_NETWORK_DNS_NVS_MAGIC &&
+        record->count <= MS_NETWORK_DNS_CACHE_NUM) {
+        xSemaphoreTake(g_dns_lock, portMAX_DELAY);
+        for (uint32_t i = 0; i < record->count; i++) {
+            record->entry[i].host[MS_NETWORK_DNS_HOST_MAX - 1] = '\0';
+            if (record->entry[i].host[0] == '\0' || ms_network_dns_find(record->entry[i].host) != NULL) continue;
+            // Without a clock the age is unknown, keep the address only as fallback
+            if (rtc_valid && record->entry[i].expire_time > now + record->entry[i].ttl_s) continue;
+            if (rtc_valid && now > record->entry[i].expire_time + MS_NETWORK_DNS_STALE_S) continue;
+
+            slot = ms_network_dns_get(record->entry[i].host);
+            ms_network_dns_set(slot, record->entry[i].addr, 0, now_ms);
+            if (rtc_valid && record->entry[i].expire_time > now) {
+                ms_network_dns_set(slot, record->entry[i].addr, record->entry[i].ttl_s, now_ms);
+                // Keep the refresh point relative to when the address was resolved, not to this wake
+                slot->expire_ms = now_ms + (record->entry[i].expire_time - now) * 1000ULL;
+                uint64_t ahead_ms = slot->ttl_s * 10ULL * (100 - MS_NETWORK_DNS_PREFETCH_PCT);
+                slot->refresh_ms = slot->expire_ms > now_ms + ahead_ms ? slot->expire_ms - ahead_ms : now_ms;
+            }
+            slot->last_use = ++g_dns_use;
+        }
+        xSemaphoreGive(g_dns_lock);
+    }
+    hal_mem_free(record);
+}
+
+/// @brief Save the cache if a lookup changed it
+static void ms_network_dns_nvs_save(void)
+{
+    ms_network_dns_record_t *record = NULL;
+    uint64_t now = 0, now_ms = rtc_get_uptime_ms();
+
+    if (!g_dns_dirty || !ms_network_session_rtc_valid(&now)) return;
+    record = (ms_network_dns_record_t *)hal_mem_alloc_large(sizeof(ms_network_dns_record_t));
+    if (record == NULL) return;
+    memset(record, 0, sizeof(ms_network_dns_record_t));
+    record->magic = MS_NETWORK_DNS_NVS_MAGIC;
+
+    xSemaphoreTake(g_dns_lock, portMAX_DELAY);
+    for (int i = 0; i < MS_NETWORK_DNS_CACHE_NUM; i++) {
+        if (!g_dns_slots[i].valid || MS_NETWORK_DNS_ADDR_IS_ZERO(g_dns_slots[i].addr)) continue;
+        memcpy(record->entry[record->count].host, g_dns_slots[i].host, MS_NETWORK_DNS_HOST_MAX);
+        memcpy(record->entry[record->count].addr, g_dns_slots[i].addr, 4);
+        record->entry[record->count].ttl_s = g_dns_slots[i].ttl_s;
+        record->entry[record->count].expire_time = g_dns_slots[i].expire_ms > now_ms ?
+                                                   now + (g_dns_slots[i].expire_ms - now_ms) / 1000 : now;
+        record->count++;
+    }
+    g_dns_dirty = 0;
+    xSemaphoreGive(g_dns_lock);
+
+    if (storage_nvs_write(NVS_USER, MS_NETWORK_DNS_NVS_KEY, record, sizeof(ms_network_dns_record_t)) < 0) {
+        LOG_DRV_WARN("DNS cache save to NVS failed.");
+    }
+    hal_mem_free(record);
+}
+
+static void ms_network_dns_req_put(ms_network_dns_req_t *req)
+{
+    uint8_t refs = 0;
+
+    xSemaphoreTake(g_dns_lock, portMAX_DELAY);
+    refs = --req->refs;
+    xSemaphoreGive(g_dns_lock);
+    if (refs > 0) return;
+
+    if (req->done != NULL) vSemaphoreDelete(req->done);
+    hal_mem_free(req);
+}
+
+/// @brief lwIP found callback, runs in the tcpip thread
+static void ms_network_dns_found(const char *name, const ip_addr_t *ipaddr, void *callback_arg)
+{
+    ms_network_dns_req_t *req = (ms_network_dns_req_t *)callback_arg;
+    ms_network_dns_slot_t *slot = NULL;
+    u32_t ttl_s = 0;
+
+    if (ipaddr != NULL) {
+        memcpy(req->addr, &ip_2_ip4(ipaddr)->addr, 4);
+        req->found = 1;
+        // The answer's TTL is still in the lwIP table during the callback
+        if (dns_gethostttl(name, &ttl_s) != ERR_OK) ttl_s = 0;
+    }
+
+    xSemaphoreTake(g_dns_lock, portMAX_DELAY);
+    slot = ms_network_dns_find(name);
+    if (slot != NULL) {
+        slot->resolving = 0;
+        if (req->found) ms_network_dns_update(slot, req->addr, ttl_s);
+    }
+    xSemaphoreGive(g_dns_lock);
+
+    if (req->done != NULL) xSemaphoreGive(req->done);
+    ms_network_dns_req_put(req);
+}
+
+/// @brief Start a query for a slot marked resolving, the caller must not hold g_dns_lock
+/// @param wait Keep a reference for the caller, who waits on req->done and puts it
+/// @return Query, NULL if it could not be started
+static ms_network_dns_req_t *ms_network_dns_query(const char *host, int wait)
+{
+    ms_network_dns_req_t *req = NULL;
+    ms_network_dns_slot_t *slot = NULL;
+    ip_addr_t addr;
+    u32_t ttl_s = 0;
+    err_t err = ERR_OK;
+
+    req = (ms_network_dns_req_t *)hal_mem_alloc_fast(sizeof(ms_network_dns_req_t));
+    if (req != NULL) {
+        memset(req, 0, sizeof(ms_network_dns_req_t));
+        req->refs = wait ? 2 : 1;
+        if (wait) req->done = xSemaphoreCreateBinary();
+        if (wait && req->done == NULL) {
+            hal_mem_free(req);
+            req = NULL;
+        }
+    }
+    if (req == NULL) {
+        xSemaphoreTake(g_dns_lock, portMAX_DELAY);
+        slot = ms_network_dns_find(host);
+        if (slot != NULL) slot->resolving = 0;
+        xSemaphoreGive(g_dns_lock);
+        return NULL;
+    }
+
+    LOCK_TCPIP_CORE();
+    err = dns_gethostbyname(host, &addr, ms_network_dns_found, req);
+    if (err == ERR_OK && dns_gethostttl(host, &ttl_s) != ERR_OK) ttl_s = 0;
+    UNLOCK_TCPIP_CORE();
+    if (err == ERR_INPROGRESS) return req;
+
+    // Answered from the lwIP table or failed at once, the callback is not called
+    if (err == ERR_OK) {
+        memcpy(req->addr, &ip_2_ip4(&addr)->addr, 4);
+        req->found = 1;
+    }
+    xSemaphoreTake(g_dns_lock, portMAX_DELAY);
+    slot = ms_network_dns_find(host);
+    if (slot != NULL) {
+        slot->resolving = 0;
+        if (req->found) ms_network_dns_update(slot, req->addr, ttl_s);
+    }
+    xSemaphoreGive(g_dns_lock);
+    if (req->done != NULL) xSemaphoreGive(req->done);
+    ms_network_dns_req_put(req);
+    return wait ? req : NULL;
+}
+
 /// @brief DNS resolution
 /// @param host Hostname
 /// @param ipaddr Output IP address
 /// @return Error code
 int ms_network_dns_parse(const char *host, uint8_t *ipaddr)
 {
-    struct hostent *he = NULL;
-    struct in_addr **addr_list = NULL;
+    ms_network_dns_slot_t *slot = NULL;
+    ms_network_dns_req_t *req = NULL;
+    uint8_t stale_addr[4] = {0};
+    uint64_t now_ms = 0;
+    uint32_t wait_ms = MS_NETWORK_DNS_TIMEOUT_MS;
+    int has_stale = 0, start = 0, found = 0;
+    ip4_addr_t literal;
     if (host == NULL || ipaddr == NULL) return NET_ERR_INVALID_ARG;
 
-    // Resolve hostname
-    he = lwip_gethostbyname(host);
-    if (he == NULL) {
-        LOG_DRV_ERROR("Failed to resolve hostname: %s", host);
-        return NET_ERR_DNS;
+    if (ip4addr_aton(host, &literal)) {
+        memcpy(ipaddr, &literal.addr, 4);
+        return NET_ERR_OK;
+    }
+    if (strlen(host) >= MS_NETWORK_DNS_HOST_MAX) {
+        LOG_DRV_ERROR("Hostname too long: %s", host);
+        return NET_ERR_INVALID_ARG;
+    }
+    if (ms_network_lock_init(&g_dns_lock) != 0) return NET_ERR_FAILED;
+    if (!g_dns_loaded) {
+        g_dns_loaded = 1;
+        ms_network_dns_nvs_load();
     }
-    // Get IP address list
-    addr_list = (struct in_addr **)he->h_addr_list;
-    if (addr_list == NULL || addr_list[0] == NULL) {
-        LOG_DRV_ERROR("No IP address found for host: %s", host);
-        return NET_ERR_DNS;
+
+    now_ms = rtc_get_uptime_ms();
+    xSemaphoreTake(g_dns_lock, portMAX_DELAY);
+    slot = ms_network_dns_get(host);
+    slot->last_use = ++g_dns_use;
+    if (!MS_NETWORK_DNS_ADDR_IS_ZERO(slot->addr) && now_ms < slot->expire_ms) {
+        // Fresh: answer now, refresh in the background once most of the TTL has passed
+        memcpy(ipaddr, slot->addr, 4);
+        found = 1;
+        if (now_ms >= slot->refresh_ms && !slot->resolving) {
+            slot->resolving = 1;
+            start = 1;
+        }
+    } else {
+        // Stale addresses are kept as fallback for as long as the NVS copy would be
+        if (!MS_NETWORK_DNS_ADDR_IS_ZERO(slot->addr) && now_ms - slot->expire_ms > MS_NETWORK_DNS_STALE_S * 1000ULL) {
+            memset(slot->addr, 0, 4);
+        }
+        if (!MS_NETWORK_DNS_ADDR_IS_ZERO(slot->addr)) {
+            memcpy(stale_addr, slot->addr, 4);
+            has_stale = 1;
+            wait_ms = MS_NETWORK_DNS_SLOW_MS;
+        }
+        if (!slot->resolving) {
+            slot->resolving = 1;
+            start = 1;
+        }
     }
-    memcpy(ipaddr, &addr_list[0]->s_addr, 4);
-    return NET_ERR_OK;
+    xSemaphoreGive(g_dns_lock);
+
+    if (found) {
+        if (start) ms_network_dns_query(host, 0);
+        ms_network_dns_nvs_save();
+        return NET_ERR_OK;
+    }
+
+    if (start) req = ms_network_dns_query(host, 1);
+    if (req != NULL) {
+        if (xSemaphoreTake(req->done, pdMS_TO_TICKS(wait_ms)) == pdTRUE && req->found) {
+            memcpy(ipaddr, req->addr, 4);
+            found = 1;
+        }
+        ms_network_dns_req_put(req);
+    } else if (!start) {
+        // Somebody else is asking already, pick up the answer if it comes in time
+        for (uint32_t waited = 0; waited < wait_ms && !found; waited += 10) {
+            vTaskDelay(pdMS_TO_TICKS(10));
+            xSemaphoreTake(g_dns_lock, portMAX_DELAY);
+            slot = ms_network_dns_find(host);
+            if (slot == NULL || !slot->resolving) {
+                if (slot != NULL && rtc_get_uptime_ms() < slot->expire_ms) {
+                    memcpy(ipaddr, slot->addr, 4);
+                    found = 1;
+                } else {
+                    waited = wait_ms;
+                }
+            }
+            xSemaphoreGive(g_dns_lock);
+        }
+    }
+    ms_network_dns_nvs_save();
+    if (found) return NET_ERR_OK;
+
+    if (has_stale) {
+        LOG_DRV_WARN("DNS slow or failing for %s, using last known address.", host);
+        memcpy(ipaddr, stale_addr, 4);
+        return NET_ERR_OK;
+    }
+    LOG_DRV_ERROR("Failed to resolve hostname: %s", host);
+    return NET_ERR_DNS;
+}
+
+/// @brief Mark a cached address stale, e.g. after the server stopped answering on it
+static void ms_network_dns_expire(const char *host)
+{
+    ms_network_dns_slot_t *slot = NULL;
+    if (g_dns_lock == NULL) return;
+
+    xSemaphoreTake(g_dns_lock, portMAX_DELAY);
+    slot = ms_network_dns_find(host);
+    if (slot != NULL) {
+        slot->expire_ms = 0;
+        slot->refresh_ms = 0;
+    }
+    xSemaphoreGive(g_dns_lock);
 }
 
 /// @brief Network connection
@@ -349,34 +1221,27 @@ int ms_network_connect(ms_network_handle_t network, const char *host, uint16_t p
     int ret = 0;
     int flags = 0;
     int error_code = 0;
+    int session_offered = 0;
+    uint8_t offered_master[48];
     socklen_t error_len = sizeof(error_code);
     fd_set writefds;
     struct timeval tv;
-    struct hostent *he = NULL;
-    struct in_addr **addr_list = NULL;
+    uint8_t ipaddr[4];
+    uint32_t connect_tick = 0;
+    struct tcp_pcb *pcb = NULL;
     struct sockaddr_in server_addr;
     if (network == NULL || host == NULL || port == 0) return NET_ERR_INVALID_ARG;
 
     // Resolve hostname
-    he = lwip_gethostbyname(host);
-    if (he == NULL) {
-        LOG_DRV_ERROR("Failed to resolve hostname: %s", host);
-        return NET_ERR_DNS;
-    }
-    // Get IP address list
-    addr_list = (struct in_addr **)he->h_addr_list;
-    if (addr_list == NULL || addr_list[0] == NULL) {
-        LOG_DRV_ERROR("No IP address found for host: %s", host);
-        return NET_ERR_DNS;
-    }
-//    ip4_addr_t ipaddr = {.addr = addr_list[0]->s_addr};
-    // LOG_DRV_DEBUG("Connect to: %s:%d", ip4addr_ntoa((const ip4_addr_t *)&ipaddr), port);
+    ret = ms_network_dns_parse(host, ipaddr);
+    if (ret != NET_ERR_OK) return ret;
 
     xSemaphoreTake(network->rx_lock, portMAX_DELAY);
-    xSemaphoreTake(network->tx_lock, portMAX_DELAY);
+    xSemaphoreTakeRecursive(network->tx_lock, portMAX_DELAY);
 
     // Check socket state
     if (network->sock_fd >= 0) {
+        ms_network_tx_ref_release(network);
         close(network->sock_fd);
         network->sock_fd = -1;
     }
@@ -396,8 +1261,9 @@ int ms_network_connect(ms_network_handle_t network, const char *host, uint16_t p
     // Connect to server
     memset(&server_addr, 0, sizeof(server_addr));
     server_addr.sin_family = AF_INET;
-    server_addr.sin_addr.s_addr = addr_list[0]->s_addr;
+    memcpy(&server_addr.sin_addr.s_addr, ipaddr, 4);
     server_addr.sin_port = htons(port);
+    connect_tick = xTaskGetTickCount();
     ret = connect(network->sock_fd, (struct sockaddr *)&server_addr, sizeof(server_addr));
     if (ret < 0 && errno != EINPROGRESS) {
         LOG_DRV_ERROR("Failed to connect to server(socket = %d, ret = %d).", network->sock_fd, errno);
@@ -440,9 +1306,18 @@ int ms_network_connect(ms_network_handle_t network, const char *host, uint16_t p
     if (ret != 0) goto ms_network_connect_end;
    // LOG_DRV_DEBUG("Socket(%d) connected to server: %s:%d", network->sock_fd, host, port);
 
+    // The handshake took one round trip, size the buffers for it. lwIP does not time the SYN
+    // (sa is still 0 here) but keeps nrtx from SYN_SENT: a lost SYN, SYN-ACK or ARP reply
+    // retransmits the SYN, and the wall time then holds a whole RTO, so drop that sample
+    LOCK_TCPIP_CORE();
+    pcb = ms_network_get_pcb(network);
+    if (pcb != NULL && pcb->nrtx == 0) nm_tcp_profile_rtt_sample(pcb, pdTICKS_TO_MS(xTaskGetTickCount() - connect_tick));
+    UNLOCK_TCPIP_CORE();
+
     if (network->tls_enable_flag) {
-        // Reset TLS session
+        // Reset TLS session and offer the cached one of this server for an abbreviated handshake
         mbedtls_ssl_session_reset(&network->ssl);
+        session_offered = ms_network_session_apply(network, host, port, offered_master);
         // Set TLS configuration
         if (network->is_verify_hostname) {
             ret = mbedtls_ssl_set_hostname(&network->ssl, host);
@@ -464,19 +1339,24 @@ int ms_network_connect(ms_network_handle_t network, const char *host, uint16_t p
         while ((ret = mbedtls_ssl_handshake(&network->ssl)) != 0) {
             if (ret != MBEDTLS_ERR_SSL_WANT_READ && ret != MBEDTLS_ERR_SSL_WANT_WRITE) {
                 LOG_DRV_ERROR("TLS handshake failed(ret = %d).", ret);
+                if (session_offered) ms_network_session_drop(network, host, port);
                 ret = NET_ERR_TLS_HANDSHAKE;
                 goto ms_network_connect_end;
             }
         }
+        ms_network_session_update(network, host, port, session_offered ? offered_master : NULL);
     }
 
 ms_network_connect_end:
+    if (session_offered) mbedtls_platform_zeroize(offered_master, sizeof(offered_master));
     if (ret < 0 && network->sock_fd >= 0) {
         close(network->sock_fd);
         network->sock_fd = -1;
     }
-    xSemaphoreGive(network->tx_lock);
+    xSemaphoreGiveRecursive(network->tx_lock);
     xSemaphoreGive(network->rx_lock);
+    // The server may have moved, ask the DNS server again next time (the address stays as fallback)
+    if (ret == NET_ERR_CONN || ret == NET_ERR_TIMEOUT) ms_network_dns_expire(host);
     return ret;
 }
 
@@ -506,6 +1386,31 @@ int ms_network_recv(ms_network_handle_t network, uint8_t *buf, uint32_t len, uin
     return ret;
 }
 
+/// @brief Network receive whatever is available
+/// @param network Network handle
+/// @param buf Receive buffer
+/// @param len Receive buffer size
+/// @param timeout Timeout in milliseconds for the first byte
+/// @return Less than 0 indicates failure, greater than 0 indicates actual received length
+int ms_network_recv_some(ms_network_handle_t network, uint8_t *buf, uint32_t len, uint32_t timeout_ms)
+{
+    int ret = 0;
+    if (network == NULL) return NET_ERR_INVALID_ARG;
+    network->rx_timeout_ms = timeout_ms;
+
+    if (network->tls_enable_flag) {
+        // One record at most, mbedTLS reads exactly the record length from the socket
+        ret = mbedtls_ssl_read(&network->ssl, buf, len);
+        if (ret < NET_ERR_UNKNOWN) {
+            LOG_DRV_ERROR("TLS read failed(ret = -0x%x).", -ret);
+            ret = NET_ERR_TLS;
+        }
+    }
+    else ret = ms_network_base_recv_ex(network, buf, len, 1);
+
+    return ret;
+}
+
 /// @brief Network send data
 /// @param network Network handle
 /// @param buf Send buffer
@@ -523,25 +1428,96 @@ int ms_network_send(ms_network_handle_t network, uint8_t *buf, uint32_t len, uin
     if (network->tls_enable_flag) {
         ssl_max_out_len = mbedtls_ssl_get_max_out_record_payload(&network->ssl);
         if (ssl_max_out_len <= 0) return NET_ERR_TLS;
+        // Records of concurrent senders must not interleave
+        xSemaphoreTakeRecursive(network->tx_lock, portMAX_DELAY);
         do {
             slen = (len - all_slen) > ssl_max_out_len ? ssl_max_out_len : (len - all_slen);
             ret = mbedtls_ssl_write(&network->ssl, buf + all_slen, slen);
             if (ret < 0) {
-                if (all_slen > 0) return all_slen;
-                else if (ret < NET_ERR_UNKNOWN) {
+                if (all_slen == 0 && ret < NET_ERR_UNKNOWN) {
                     LOG_DRV_ERROR("TLS write failed(ret = -0x%x).", -ret);
                     ret = NET_ERR_TLS;
                 }
-                return ret;
+                break;
             }
             all_slen += ret;
         } while (all_slen < len);
-        return all_slen;
+        xSemaphoreGiveRecursive(network->tx_lock);
+        return all_slen > 0 ? (int)all_slen : ret;
     } else {
         return ms_network_base_send(network, (const uint8_t *)buf, len);
     }
 }
 
+/// @brief Network send data without copying it into lwIP
+/// @param network Network handle
+/// @param head Header sent by copy right before buf (optional)
+/// @param head_len Header length
+/// @param buf Send buffer, must stay unchanged until done_cb
+/// @param len Send length
+/// @param done_cb Called when buf is released (optional)
+/// @param arg Argument for done_cb
+/// @param timeout Timeout in milliseconds
+/// @return Less than 0 indicates failure, greater than or equal to 0 indicates actual sent length of buf
+int ms_network_send_ref(ms_network_handle_t network, const uint8_t *head, uint32_t head_len,
+                        const uint8_t *buf, uint32_t len,
+                        ms_network_tx_done_cb_t done_cb, void *arg, uint32_t timeout_ms)
+{
+    int ret = 0;
+    ms_network_tx_ref_t *ref = NULL;
+    if (network == NULL || buf == NULL || len == 0 || (head == NULL && head_len > 0)) {
+        if (done_cb) done_cb(arg, NET_ERR_INVALID_ARG);
+        return NET_ERR_INVALID_ARG;
+    }
+
+    // Held across header and body so no other sender gets in between
+    xSemaphoreTakeRecursive(network->tx_lock, portMAX_DELAY);
+    if (head_len > 0) {
+        ret = ms_network_send(network, (uint8_t *)head, head_len, timeout_ms);
+        if (ret != (int)head_len) {
+            xSemaphoreGiveRecursive(network->tx_lock);
+            if (ret >= 0) ret = NET_ERR_SEND;
+            if (done_cb) done_cb(arg, ret);
+            return ret;
+        }
+    }
+
+    if (!network->tls_enable_flag) {
+        // Reserve the completion slot first so acknowledgements are released in write order
+        LOCK_TCPIP_CORE();
+        if (network->tx_ref_count < MS_NETWORK_TX_REF_NUM && ms_network_tx_ref_attach(network) != NULL) {
+            ref = &network->tx_ref[(network->tx_ref_head + network->tx_ref_count) % MS_NETWORK_TX_REF_NUM];
+            ref->state = MS_NETWORK_TX_REF_WRITING;
+            ref->done_cb = done_cb;
+            ref->arg = arg;
+            network->tx_ref_count++;
+        }
+        UNLOCK_TCPIP_CORE();
+    }
+
+    if (ref == NULL) {
+        // TLS, or too many sends in flight: copy, buf is free once this returns
+        ret = ms_network_send(network, (uint8_t *)buf, len, timeout_ms);
+        xSemaphoreGiveRecursive(network->tx_lock);
+        if (done_cb) done_cb(arg, ret > 0 ? NET_ERR_OK : ret);
+        return ret;
+    }
+
+    network->tx_timeout_ms = timeout_ms;
+    ret = ms_network_base_send_ex(network, buf, len, 1);
+
+    LOCK_TCPIP_CORE();
+    // A connection lost meanwhile already released the slot
+    if (ref->state == MS_NETWORK_TX_REF_WRITING && network->tx_pcb != NULL) {
+        ref->end_seq = network->tx_pcb->snd_lbb;
+        ref->state = MS_NETWORK_TX_REF_QUEUED;
+        ms_network_tx_ref_complete(network, network->tx_pcb->lastack, NET_ERR_OK);
+    }
+    UNLOCK_TCPIP_CORE();
+    xSemaphoreGiveRecursive(network->tx_lock);
+    return ret;
+}
+
 /// @brief Network close
 /// @param network Network handle
 void ms_network_close(ms_network_handle_t network)
@@ -549,13 +1525,14 @@ void ms_network_close(ms_network_handle_t network)
     if (network == NULL) return;
     
     xSemaphoreTake(network->rx_lock, portMAX_DELAY);
-    xSemaphoreTake(network->tx_lock, portMAX_DELAY);
+    xSemaphoreTakeRecursive(network->tx_lock, portMAX_DELAY);
     if (network->sock_fd >= 0) {
+        ms_network_tx_ref_release(network);
         shutdown(network->sock_fd, SHUT_RDWR);
         close(network->sock_fd);
         network->sock_fd = -1;
     }
-    xSemaphoreGive(network->tx_lock);
+    xSemaphoreGiveRecursive(network->tx_lock);
     xSemaphoreGive(network->rx_lock);
 }
 
@@ -567,7 +1544,7 @@ void ms_network_deinit(ms_network_handle_t network)
     
     ms_network_close(network);
     xSemaphoreTake(network->rx_lock, portMAX_DELAY);
-    xSemaphoreTake(network->tx_lock, portMAX_DELAY);
+    xSemaphoreTakeRecursive(network->tx_lock, portMAX_DELAY);
     if (network->tls_enable_flag) {
         mbedtls_ssl_close_notify(&network->ssl);
         mbedtls_x509_crt_free(&network->cacert);
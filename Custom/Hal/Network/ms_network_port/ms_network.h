@@ -13,10 +13,24 @@
 #include "mbedtls/x509_crt.h"
 #include "mbedtls/ssl.h"
 
+struct tcp_pcb;
+
 #define MS_NETWORK_RECV_IDLE_TIMEOUT_MS  (10)
 #define MS_NETWORK_DEFAULT_TIMEOUT_MS    (3000)
 #define MS_NETWORK_LAST_SEND_TIMEOUT_MS  (1000)
 // #define MS_NETWORK_ONCE_MAX_SEND_SIZE    (4 * 1024)
+#define MS_NETWORK_SESSION_CACHE_NUM     (4)            // TLS sessions kept in RAM for resumption
+#define MS_NETWORK_SESSION_LIFETIME_S    (4 * 3600)     // Counted from the full handshake, resumption does not extend it
+#define MS_NETWORK_SESSION_HOST_MAX      (64)
+#define MS_NETWORK_TRUST_ID_LEN          (8)
+#define MS_NETWORK_DNS_CACHE_NUM         (8)            // Resolved hosts kept in RAM and NVS across deep sleep
+#define MS_NETWORK_DNS_HOST_MAX          (64)
+#define MS_NETWORK_DNS_TTL_MAX_S         (24 * 3600)
+#define MS_NETWORK_DNS_PREFETCH_PCT      (80)           // Share of the TTL after which a lookup refreshes in the background
+#define MS_NETWORK_DNS_STALE_S           (24 * 3600)    // Expired addresses are still used when the DNS server does not answer
+#define MS_NETWORK_DNS_SLOW_MS           (1500)         // Wait for a live answer before falling back to an expired address
+#define MS_NETWORK_DNS_TIMEOUT_MS        (20000)        // Wait for a live answer when nothing is cached
+#define MS_NETWORK_TX_REF_NUM            (8)            // Referenced sends awaiting acknowledgement per connection
 
 /// @brief Network error code
 typedef enum
@@ -39,6 +53,20 @@ typedef enum
     NET_ERR_UNKNOWN = -0xff,
 } network_error_t;
 
+/// @brief Completion of a referenced send, called once buf may be reused
+/// @param arg User argument
+/// @param result NET_ERR_OK once the peer acknowledged the data, otherwise the error that dropped it
+typedef void (*ms_network_tx_done_cb_t)(void *arg, int result);
+
+/// @brief Referenced send queued in lwIP
+typedef struct
+{
+    uint8_t state;                  // Free, being written or queued
+    uint32_t end_seq;               // TCP sequence following the last queued byte
+    ms_network_tx_done_cb_t done_cb;
+    void *arg;
+} ms_network_tx_ref_t;
+
 /// @brief Network configuration
 typedef struct
 {
@@ -52,6 +80,8 @@ typedef struct
 
     const char *client_key_data;    // Client key data
     size_t client_key_len;          // Client key length (if 0, use strlen)
+
+    uint8_t is_session_persist;     // Keep the TLS session in NVS so it survives deep sleep (stores the master secret), 0 also deletes a saved one
 } network_tls_config_t;
 
 /// @brief Network object
@@ -65,6 +95,14 @@ typedef struct
 
     uint8_t tls_enable_flag;
     uint8_t is_verify_hostname;
+    uint8_t is_session_persist;
+    uint8_t trust_id[MS_NETWORK_TRUST_ID_LEN];  // Digest of CA, client cert and verify mode, sessions are only shared between equal ones
+    uint32_t handshake_full;
+    uint32_t handshake_resumed;
+    struct tcp_pcb *tx_pcb;         // Connection the referenced sends are queued on
+    ms_network_tx_ref_t tx_ref[MS_NETWORK_TX_REF_NUM];
+    uint8_t tx_ref_head;
+    uint8_t tx_ref_count;
     mbedtls_ssl_context ssl;
     mbedtls_ssl_config ssl_conf;
     mbedtls_x509_crt cacert, clicert;
@@ -81,7 +119,8 @@ typedef ms_network_t *ms_network_handle_t;
 /// @return Network handle
 ms_network_handle_t ms_network_init(const network_tls_config_t *tls_config);
 
-/// @brief DNS resolution
+/// @brief DNS resolution through the shared cache, which honours the TTL, refreshes
+///        ahead of expiry and falls back to the last known address if DNS is slow
 /// @param host Hostname
 /// @param ipaddr Output IP address
 /// @return Error code
@@ -102,6 +141,14 @@ int ms_network_connect(ms_network_handle_t network, const char *host, uint16_t p
 /// @return Less than 0 indicates failure, greater than or equal to 0 indicates actual received length
 int ms_network_recv(ms_network_handle_t network, uint8_t *buf, uint32_t len, uint32_t timeout);
 
+/// @brief Network receive whatever is available, without waiting for the buffer to fill
+/// @param network Network handle
+/// @param buf Receive buffer
+/// @param len Receive buffer size
+/// @param timeout Timeout in milliseconds for the first byte
+/// @return Less than 0 indicates failure, greater than or equal to 0 indicates actual received length
+int ms_network_recv_some(ms_network_handle_t network, uint8_t *buf, uint32_t len, uint32_t timeout);
+
 /// @brief Network send data
 /// @param network Network handle
 /// @param buf Send buffer
@@ -110,6 +157,28 @@ int ms_network_recv(ms_network_handle_t network, uint8_t *buf, uint32_t len, uin
 /// @return Less than 0 indicates failure, greater than or equal to 0 indicates actual sent length
 int ms_network_send(ms_network_handle_t network, uint8_t *buf, uint32_t len, uint32_t timeout);
 
+/// @brief Network send data without copying it into lwIP
+/// @details On plain TCP the queued segments reference buf until the peer acknowledges them.
+///          TLS encrypts into its own record buffer, so there buf is released before returning.
+///          head is copied, so it can be a stack buffer; nothing from another sender is
+///          written between head and buf.
+///          done_cb is called exactly once, also on failure. When buf was queued by reference
+///          it runs in the TCP/IP thread, or in the thread closing the connection, with the
+///          tcpip core lock held: it must not block or call lwIP or ms_network APIs, only
+///          release buf or signal a waiting task. Otherwise it runs before this returns.
+/// @param network Network handle
+/// @param head Header sent by copy right before buf (optional)
+/// @param head_len Header length
+/// @param buf Send buffer, must stay unchanged until done_cb
+/// @param len Send length
+/// @param done_cb Called when buf is released (optional)
+/// @param arg Argument for done_cb
+/// @param timeout Timeout in milliseconds
+/// @return Less than 0 indicates failure, greater than or equal to 0 indicates actual sent length of buf
+int ms_network_send_ref(ms_network_handle_t network, const uint8_t *head, uint32_t head_len,
+                        const uint8_t *buf, uint32_t len,
+                        ms_network_tx_done_cb_t done_cb, void *arg, uint32_t timeout);
+
 /// @brief Network close
 /// @param network Network handle
 void ms_network_close(ms_network_handle_t network);
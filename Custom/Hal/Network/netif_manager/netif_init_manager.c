@@ -13,7 +13,8 @@
 
 /* ==================== Configuration ==================== */
 
-#define MAX_NETIF_COUNT 4
+#define MAX_NETIF_COUNT 6
+#define NETIF_INIT_ALL_TIMEOUT_MS 30000
 #define NETIF_INIT_STACK_SIZE 4096 * 3
 
 /* ==================== Internal Types ==================== */
@@ -430,6 +431,9 @@ aicam_result_t netif_init_manager_init_sync(const char *if_name, uint32_t timeou
 
 aicam_result_t netif_init_manager_init_all(aicam_bool_t async)
 {
+    const char *names[MAX_NETIF_COUNT] = {0};
+    aicam_bool_t wait[MAX_NETIF_COUNT] = {0};
+
     if (!g_netif_init_mgr.initialized) {
         return AICAM_ERROR_NOT_INITIALIZED;
     }
@@ -439,25 +443,39 @@ aicam_result_t netif_init_manager_init_all(aicam_bool_t async)
     osMutexAcquire(g_netif_init_mgr.mutex, osWaitForever);
     
     // Sort by priority first
-    sort_entries_by_priority();
+    if (g_netif_init_mgr.entry_count > 1) {
+        sort_entries_by_priority();
+    }
     
     uint32_t count = g_netif_init_mgr.entry_count;
+    for (uint32_t i = 0; i < count; i++) {
+        names[i] = g_netif_init_mgr.entries[i].config.if_name;
+        wait[i] = (!async || !g_netif_init_mgr.entries[i].config.async) ? AICAM_TRUE : AICAM_FALSE;
+    }
     
     osMutexRelease(g_netif_init_mgr.mutex);
     
-    // Initialize each interface
+    // Start every interface at once so a slow one (Wi-Fi association, modem
+    // attach) does not hold the others back, the default route goes to the
+    // first usable link and moves as better ones come up
     for (uint32_t i = 0; i < count; i++) {
-        const char *if_name = g_netif_init_mgr.entries[i].config.if_name;
-        
-        if (async && g_netif_init_mgr.entries[i].config.async) {
-            // Asynchronous initialization
-            netif_init_manager_init_async(if_name);
-        } else {
-            // Synchronous initialization
-            netif_init_manager_init_sync(if_name, 30000);
+        aicam_result_t result = netif_init_manager_init_async(names[i]);
+        if (result != AICAM_OK && result != AICAM_ERROR_BUSY) {
+            LOG_DRV_WARN("Failed to start initialization for %s: %d", names[i], result);
+            wait[i] = AICAM_FALSE;
         }
     }
     
+    // Synchronous entries share one deadline instead of one timeout each
+    uint64_t start_time_ms = rtc_get_uptime_ms();
+    for (uint32_t i = 0; i < count; i++) {
+        if (!wait[i]) continue;
+        
+        uint32_t elapsed_ms = (uint32_t)(rtc_get_uptime_ms() - start_time_ms);
+        uint32_t remain_ms = (elapsed_ms < NETIF_INIT_ALL_TIMEOUT_MS) ? (NETIF_INIT_ALL_TIMEOUT_MS - elapsed_ms) : 1;
+        netif_init_manager_wait_ready(names[i], remain_ms);
+    }
+    
     LOG_DRV_INFO("All network interfaces initialization started");
     
     return AICAM_OK;
@@ -102,6 +102,7 @@ aicam_result_t netif_init_manager_init_sync(const char *if_name, uint32_t timeou
 
 /**
  * @brief Initialize all registered network interfaces
+ * @details All interfaces start at once; the default route goes to the first usable one
  * @param async Use asynchronous initialization for all interfaces
  * @return AICAM_OK on success, error code otherwise
  */
@@ -2,6 +2,7 @@
 #include "lwip/tcpip.h"
 #include "lwip/init.h"
 #include "lwip/apps/sntp.h"
+#include "lwip/priv/tcp_priv.h"
 #if IP_NAT
 #include "lwip/ip4_nat.h"
 #endif
@@ -22,6 +23,8 @@
 #include "ms_network_test.h"
 #include "icmp_client.h"
 #include "netif_manager.h"
+#include "netif_route.h"
+#include "tcp_profile.h"
 #include "wifi.h"
 #include "sl_rsi_ble.h"
 #include "rtmp_push_test.h"
@@ -46,26 +49,60 @@ const osThreadAttr_t ifTask_attributes = {
 typedef struct {
     char *if_name;
     netif_type_t if_type;
+    struct netif *(*netif_ptr)(void);
 } if_name_type_t;
 
+// Ascending default route priority
 static const if_name_type_t if_name_type_list[] = {
-    {NETIF_NAME_LOCAL, NETIF_TYPE_LOCAL},
-    {NETIF_NAME_WIFI_AP, NETIF_TYPE_WIRELESS},
-    {NETIF_NAME_WIFI_STA, NETIF_TYPE_WIRELESS},
+    {NETIF_NAME_LOCAL, NETIF_TYPE_LOCAL, NULL},
+    {NETIF_NAME_WIFI_AP, NETIF_TYPE_WIRELESS, sl_net_ap_netif_ptr},
+    {NETIF_NAME_WIFI_STA, NETIF_TYPE_WIRELESS, sl_net_client_netif_ptr},
 #if NETIF_ETH_WAN_IS_ENABLE
-    {NETIF_NAME_ETH_WAN, NETIF_TYPE_ETH},
+    {NETIF_NAME_ETH_WAN, NETIF_TYPE_ETH, w5500_netif_ptr},
 #endif
 #if NETIF_4G_CAT1_IS_ENABLE
-    {NETIF_NAME_4G_CAT1, NETIF_TYPE_4G},
+    {NETIF_NAME_4G_CAT1, NETIF_TYPE_4G, eg912u_netif_ptr},
 #endif
 #if NETIF_USB_ECM_IS_ENABLE
 #if NETIF_USB_ECM_IS_CAT1_MODULE
-    {NETIF_NAME_USB_ECM, NETIF_TYPE_4G},
+    {NETIF_NAME_USB_ECM, NETIF_TYPE_4G, usb_ecm_netif_ptr},
 #else
-    {NETIF_NAME_USB_ECM, NETIF_TYPE_ETH},
+    {NETIF_NAME_USB_ECM, NETIF_TYPE_ETH, usb_ecm_netif_ptr},
 #endif
 #endif
 };
+#define IF_NAME_TYPE_COUNT      ((int)(sizeof(if_name_type_list) / sizeof(if_name_type_t)))
+
+// Default route state, only touched with the TCPIP core lock held
+static netif_route_t default_route;
+static osEventFlagsId_t default_route_evt = NULL;
+#define DEFAULT_ROUTE_EVT_READY     (1U << 0)
+NETIF_DECLARE_EXT_CALLBACK(default_route_ext_cb)
+
+// TCP buffer sizing per egress link, only touched with the TCPIP core lock held
+#define TCP_BUFFER_BUDGET           (MEM_SIZE / 2)          // Receive windows plus send buffers of all sized connections
+#define TCP_PROFILE_SLOT_NUM        (MEMP_NUM_TCP_PCB)
+static const tcp_profile_t tcp_link_profile[NETIF_TYPE_MAX] = {
+    // rx kbit/s, tx kbit/s, rtt ms, window min/max, send buffer min/max
+    [NETIF_TYPE_LOCAL]    = {100000, 100000,  1,  8 * TCP_MSS, 16 * TCP_MSS,  8 * TCP_MSS, 16 * TCP_MSS},
+    [NETIF_TYPE_WIRELESS] = { 30000,  20000, 20,  8 * TCP_MSS, 64 * TCP_MSS,  8 * TCP_MSS, 64 * TCP_MSS},
+    [NETIF_TYPE_ETH]      = { 10000,  10000,  5,  8 * TCP_MSS, 32 * TCP_MSS,  8 * TCP_MSS, 32 * TCP_MSS},
+    // Cat.1 uplink is slow, a large send buffer only adds seconds of queueing
+    [NETIF_TYPE_4G]       = {  8000,   2000, 80,  8 * TCP_MSS, 64 * TCP_MSS,  8 * TCP_MSS, 16 * TCP_MSS},
+};
+#if TCP_SNDLOWAT >= (8 * TCP_MSS)
+#error "TCP_SNDLOWAT must stay below the smallest send buffer of tcp_link_profile"
+#endif
+typedef struct {
+    struct tcp_pcb *pcb;
+    uint8_t idx;                            // if_name_type_list entry the connection leaves through
+    uint32_t wnd;
+    uint32_t snd;
+} tcp_profile_slot_t;
+static tcp_profile_budget_t tcp_budget;
+static tcp_profile_slot_t tcp_profile_slot[TCP_PROFILE_SLOT_NUM];
+static uint32_t tcp_link_srtt_ms[IF_NAME_TYPE_COUNT];
+static uint8_t tcp_profile_id = 0xFF;
 
 static uint8_t netif_manager_is_init = 0;
 static const char *netif_type_str[] = {"local", "wireless", "ethernet", "4g", "unknown"};
@@ -107,6 +144,7 @@ static int netif_manager_cmd(int argc, char* argv[])
         LOG_SIMPLE("\r\nDefault netif: %s (%s)", nm_get_default_netif_name(), nm_get_set_default_netif_name());
         LOG_SIMPLE("Dns server list: %d.%d.%d.%d, %d.%d.%d.%d", default_dns_server[0].addr & 0xFF, (default_dns_server[0].addr >> 8) & 0xFF, (default_dns_server[0].addr >> 16) & 0xFF, (default_dns_server[0].addr >> 24) & 0xFF, default_dns_server[1].addr & 0xFF, (default_dns_server[1].addr >> 8) & 0xFF, (default_dns_server[1].addr >> 16) & 0xFF, (default_dns_server[1].addr >> 24) & 0xFF);
         LOG_SIMPLE("Sntp server list: %s, %s, %s", default_sntp_server[0], default_sntp_server[1], default_sntp_server[2]);
+        LOG_SIMPLE("Tcp buffers: %u / %u KB, peak %u KB, shrunk %u, overcommit %u", tcp_budget.used / 1024, tcp_budget.total / 1024, tcp_budget.peak / 1024, tcp_budget.shrunk, tcp_budget.overcommit);
         LOG_SIMPLE("Netif list:\r\n");
         // Print all initialized network interface information, default interface first
         ret = nm_get_netif_list(&if_info_list);
@@ -218,43 +256,210 @@ static int netif_manager_cmd(int argc, char* argv[])
     return ret;
 }
 
+static int netif_manager_list_index(const char *if_name)
+{
+    if (if_name == NULL) return NETIF_ROUTE_NONE;
+
+    for (int i = 0; i < IF_NAME_TYPE_COUNT; i++) {
+        if (strcmp(if_name, if_name_type_list[i].if_name) == 0) return i;
+    }
+    return NETIF_ROUTE_NONE;
+}
+
+static int netif_manager_is_usable(struct netif *netif)
+{
+    return netif != NULL && netif_is_up(netif) && netif_is_link_up(netif) &&
+           !ip4_addr_isany_val(*netif_ip4_addr(netif));
+}
+
+// Connections that left through the old default gateway cannot follow the
+// route: their source address belongs to the old interface. Abort them now
+// so the owners see the error and reconnect instead of waiting for TCP to
+// time out. Peers on the old interface's own subnet are still reachable.
+static void netif_manager_abort_routed_pcbs(struct netif *old_if)
+{
+    struct tcp_pcb *pcb = tcp_active_pcbs;
+    struct tcp_pcb *next = NULL;
+    int aborted = 0;
+
+    if (ip4_addr_isany_val(*netif_ip4_addr(old_if))) return;
+
+    while (pcb != NULL) {
+        next = pcb->next;
+        if (ip4_addr_cmp(ip_2_ip4(&pcb->local_ip), netif_ip4_addr(old_if)) &&
+            !ip4_addr_netcmp(ip_2_ip4(&pcb->remote_ip), netif_ip4_addr(old_if), netif_ip4_netmask(old_if))) {
+            tcp_abort(pcb);
+            aborted++;
+        }
+        pcb = next;
+    }
+    if (aborted) LOG_DRV_INFO("Aborted %d connections routed via " NETIF_NAME_STR_FMT, aborted, NETIF_NAME_PARAMETER(old_if));
+}
+
+static void netif_manager_route_timeout(void *arg);
+
+// Must be called with the TCPIP core lock held
+static void netif_manager_route_update(void)
+{
+    struct netif *old_if = netif_get_default();
+    struct netif *new_if = NULL;
+    uint32_t now_ms = sys_now();
+    uint32_t recheck_ms = 0;
+    int idx = NETIF_ROUTE_NONE;
+
+    for (int i = 0; i < IF_NAME_TYPE_COUNT; i++) {
+        struct netif *netif = if_name_type_list[i].netif_ptr ? if_name_type_list[i].netif_ptr() : NULL;
+        netif_route_set_usable(&default_route, i, netif_manager_is_usable(netif), now_ms);
+    }
+
+    idx = netif_route_select(&default_route, now_ms, &recheck_ms);
+    sys_untimeout(netif_manager_route_timeout, NULL);
+    if (recheck_ms) sys_timeout(recheck_ms, netif_manager_route_timeout, NULL);
+
+    if (idx == NETIF_ROUTE_NONE) {
+        if (default_route_evt) osEventFlagsClear(default_route_evt, DEFAULT_ROUTE_EVT_READY);
+        return;
+    }
+
+    new_if = if_name_type_list[idx].netif_ptr();
+    if (new_if != old_if) {
+        netif_set_default(new_if);
+        if (old_if != NULL) netif_manager_abort_routed_pcbs(old_if);
+        LOG_DRV_INFO("Set default netif: %s\r\n", if_name_type_list[idx].if_name);
+    }
+    if (default_route_evt) osEventFlagsSet(default_route_evt, DEFAULT_ROUTE_EVT_READY);
+}
+
+static void netif_manager_route_timeout(void *arg)
+{
+    (void)arg;
+    netif_manager_route_update();
+}
+
+static void netif_manager_route_ext_callback(struct netif *netif, netif_nsc_reason_t reason, const netif_ext_callback_args_t *args)
+{
+    (void)netif;
+    (void)args;
+    if (reason & (LWIP_NSC_NETIF_REMOVED | LWIP_NSC_LINK_CHANGED | LWIP_NSC_STATUS_CHANGED |
+                  LWIP_NSC_IPV4_ADDRESS_CHANGED | LWIP_NSC_IPV4_SETTINGS_CHANGED)) {
+        netif_manager_route_update();
+    }
+}
+
 void netif_manager_change_default_if(void)
 {
-    int i = sizeof(if_name_type_list) / sizeof(if_name_type_t);
-    const char *if_name = NULL;
-    struct netif *default_if = NULL;
-    netif_state_t state = NETIF_STATE_MAX;
+    if (!netif_manager_is_init) return;
 
-    state = nm_get_netif_state(default_if_name);
-    if (state == NETIF_STATE_UP) {
-        if_name = default_if_name;
-    } else {
-        for (; i > 0; i--) {
-            state = nm_get_netif_state(if_name_type_list[i - 1].if_name);
-            if (state == NETIF_STATE_UP) {
-                if_name = if_name_type_list[i - 1].if_name;
-                break;
-            }
+    LOCK_TCPIP_CORE();
+    netif_manager_route_update();
+    UNLOCK_TCPIP_CORE();
+}
+
+static void netif_manager_tcp_destroyed(u8_t id, void *data)
+{
+    tcp_profile_slot_t *slot = (tcp_profile_slot_t *)data;
+
+    (void)id;
+    if (slot == NULL) return;
+    tcp_profile_release(&tcp_budget, slot->wnd + slot->snd);
+    slot->pcb = NULL;
+}
+
+static const struct tcp_ext_arg_callbacks tcp_profile_callbacks = {
+    netif_manager_tcp_destroyed,
+    NULL,
+};
+
+// Index of the interface the connection leaves through, -1 if it is none of ours
+static int netif_manager_tcp_link(struct tcp_pcb *pcb)
+{
+    struct netif *netif = NULL;
+
+    if (pcb->netif_idx != NETIF_NO_INDEX) netif = netif_get_by_index(pcb->netif_idx);
+    else netif = ip_route(&pcb->local_ip, &pcb->remote_ip);
+    if (netif == NULL) return -1;
+
+    for (int i = 0; i < IF_NAME_TYPE_COUNT; i++) {
+        if (if_name_type_list[i].netif_ptr && if_name_type_list[i].netif_ptr() == netif) return i;
+    }
+    return -1;
+}
+
+static tcp_profile_slot_t *netif_manager_tcp_slot_get(struct tcp_pcb *pcb)
+{
+    tcp_profile_slot_t *free_slot = NULL;
+
+    if (tcp_profile_id == 0xFF) tcp_profile_id = tcp_ext_arg_alloc_id();
+    for (int i = 0; i < TCP_PROFILE_SLOT_NUM; i++) {
+        tcp_profile_slot_t *slot = &tcp_profile_slot[i];
+        if (slot->pcb == pcb) return slot;
+        // Connections in TIME_WAIT hold no data any more, hand their share back now
+        // instead of when the pcb is finally freed
+        if (slot->pcb != NULL && slot->pcb->state == TIME_WAIT) {
+            tcp_ext_arg_set(slot->pcb, tcp_profile_id, NULL);
+            tcp_profile_release(&tcp_budget, slot->wnd + slot->snd);
+            slot->pcb = NULL;
         }
+        if (slot->pcb == NULL && free_slot == NULL) free_slot = slot;
     }
-    
-    if (if_name != NULL) {
-        if (strcmp(if_name, NETIF_NAME_WIFI_STA) == 0) default_if = sl_net_client_netif_ptr();
-        else if (strcmp(if_name, NETIF_NAME_WIFI_AP) == 0) default_if = sl_net_ap_netif_ptr();
-#if NETIF_ETH_WAN_IS_ENABLE
-        else if (strcmp(if_name, NETIF_NAME_ETH_WAN) == 0) default_if = w5500_netif_ptr();
-#endif
-#if NETIF_4G_CAT1_IS_ENABLE
-        else if (strcmp(if_name, NETIF_NAME_4G_CAT1) == 0) default_if = eg912u_netif_ptr();
-#endif
-#if NETIF_USB_ECM_IS_ENABLE
-        else if (strcmp(if_name, NETIF_NAME_USB_ECM) == 0) default_if = usb_ecm_netif_ptr();
-#endif
-        if (default_if != NULL && default_if != netif_get_default()) {
-            netif_set_default(default_if);
-            LOG_DRV_INFO("Set default netif: %s\r\n", if_name);
+    if (free_slot == NULL) return NULL;
+
+    memset(free_slot, 0, sizeof(tcp_profile_slot_t));
+    free_slot->pcb = pcb;
+    tcp_ext_arg_set_callbacks(pcb, tcp_profile_id, &tcp_profile_callbacks);
+    tcp_ext_arg_set(pcb, tcp_profile_id, free_slot);
+    return free_slot;
+}
+
+// Size the receive window and send buffer for the link and the RTT, the bytes already
+// queued keep counting against the new send buffer
+static void netif_manager_tcp_size(struct tcp_pcb *pcb, int idx, uint32_t rtt_ms)
+{
+    const tcp_profile_t *profile = &tcp_link_profile[idx < 0 ? NETIF_TYPE_LOCAL : if_name_type_list[idx].if_type];
+    tcp_profile_slot_t *slot = netif_manager_tcp_slot_get(pcb);
+    uint32_t old_snd = TCP_SND_BUF;
+    uint32_t queued = 0;
+    uint32_t wnd = 0, snd = 0;
+
+    if (rtt_ms == 0 && idx >= 0) rtt_ms = tcp_link_srtt_ms[idx];
+    tcp_profile_size(profile, rtt_ms, TCP_MSS, &wnd, &snd);
+    if (slot == NULL) {
+        // Untracked connections get the profile minimum so they cannot exhaust the heap
+        wnd = profile->wnd_min;
+        snd = profile->snd_min;
+        tcp_budget.overcommit++;
+    } else {
+        if (slot->wnd) {
+            old_snd = slot->snd;
+            tcp_profile_release(&tcp_budget, slot->wnd + slot->snd);
         }
+        tcp_profile_reserve(&tcp_budget, profile, TCP_MSS, &wnd, &snd);
+        slot->idx = (uint8_t)idx;
+        slot->wnd = wnd;
+        slot->snd = snd;
     }
+
+    tcp_set_rcv_wnd_max(pcb, (tcpwnd_size_t)wnd);
+    queued = old_snd > pcb->snd_buf ? old_snd - pcb->snd_buf : 0;
+    pcb->snd_buf = (tcpwnd_size_t)(snd > queued ? snd - queued : 0);
+}
+
+void netif_manager_tcp_established(struct tcp_pcb *pcb)
+{
+    if (pcb == NULL) return;
+
+    netif_manager_tcp_size(pcb, netif_manager_tcp_link(pcb), 0);
+}
+
+void nm_tcp_profile_rtt_sample(struct tcp_pcb *pcb, uint32_t rtt_ms)
+{
+    int idx = 0;
+
+    if (pcb == NULL || pcb->state < ESTABLISHED) return;
+
+    idx = netif_manager_tcp_link(pcb);
+    if (idx >= 0) tcp_link_srtt_ms[idx] = tcp_profile_rtt_update(tcp_link_srtt_ms[idx], rtt_ms);
+    netif_manager_tcp_size(pcb, idx, rtt_ms);
 }
 
 #if IP_NAT
@@ -421,6 +626,17 @@ void netif_manager_init(void)
     // 4. Initialize NAT if enabled
     ip4_nat_init();
 #endif
+
+    // Follow link and address changes of every interface for the default route
+    netif_route_config_t route_cfg;
+    netif_route_get_default_config(&route_cfg);
+    default_route_evt = osEventFlagsNew(NULL);
+    LOCK_TCPIP_CORE();
+    netif_route_init(&default_route, &route_cfg, IF_NAME_TYPE_COUNT);
+    tcp_profile_budget_init(&tcp_budget, TCP_BUFFER_BUDGET);
+    netif_route_set_preferred(&default_route, netif_manager_list_index(default_if_name));
+    netif_add_ext_callback(&default_route_ext_cb, netif_manager_route_ext_callback);
+    UNLOCK_TCPIP_CORE();
     
     // 5. Set DNS servers
     dns_setserver(0, &default_dns_server[0]);
@@ -755,6 +971,9 @@ int nm_ctrl_set_default_netif(const char *if_name)
     if (state >= NETIF_STATE_MAX) return AICAM_ERROR_INVALID_PARAM;
 
     default_if_name = if_name;
+    LOCK_TCPIP_CORE();
+    netif_route_set_preferred(&default_route, netif_manager_list_index(if_name));
+    UNLOCK_TCPIP_CORE();
     netif_manager_change_default_if();
 
     return AICAM_OK;
@@ -768,6 +987,19 @@ const char *nm_get_set_default_netif_name(void)
     return default_if_name;
 }
 
+/// @brief Wait until some network interface holds the default route
+/// @param timeout_ms Timeout time (unit: milliseconds)
+/// @return Error code
+int nm_wait_default_netif(uint32_t timeout_ms)
+{
+    uint32_t flags = 0;
+    if (default_route_evt == NULL) return AICAM_ERROR_NOT_INITIALIZED;
+
+    flags = osEventFlagsWait(default_route_evt, DEFAULT_ROUTE_EVT_READY, osFlagsWaitAny | osFlagsNoClear, timeout_ms);
+    if (flags & osFlagsError) return (flags == osFlagsErrorTimeout) ? AICAM_ERROR_TIMEOUT : AICAM_ERROR;
+    return AICAM_OK;
+}
+
 /// @brief Set DNS server (maximum number is DNS_MAX_SERVERS)
 /// @param idx DNS server index
 /// @param dns_server DNS server address
@@ -344,6 +344,23 @@ int nm_ctrl_set_default_netif(const char *if_name);
 /// @return Default network interface name
 const char *nm_get_set_default_netif_name(void);
 
+/// @brief Wait until some network interface holds the default route (the first usable one wins)
+/// @param timeout_ms Timeout time (unit: milliseconds)
+/// @return Error code
+int nm_wait_default_netif(uint32_t timeout_ms);
+
+/// @brief Size a new connection's receive window and send buffer for its egress link
+///        (LWIP_HOOK_TCP_ESTABLISHED, runs in the TCPIP thread)
+/// @param pcb Connection that just got established
+void netif_manager_tcp_established(struct tcp_pcb *pcb);
+
+/// @brief Report a measured RTT (e.g. the connect time of a handshake without retransmissions)
+///        for a connection, resizes it and refines the RTT assumed for later connections over
+///        the same link
+/// @param pcb Established connection, the TCPIP core lock must be held
+/// @param rtt_ms Measured RTT (unit: milliseconds)
+void nm_tcp_profile_rtt_sample(struct tcp_pcb *pcb, uint32_t rtt_ms);
+
 /// @brief Set DNS server (maximum number is DNS_MAX_SERVERS)
 /// @param idx DNS server index
 /// @param dns_server DNS server address
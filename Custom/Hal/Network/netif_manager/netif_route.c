@@ -0,0 +1,90 @@
+/**
+ * @file netif_route.c
+ * @brief Default route selection across network interfaces
+ */
+
+#include "netif_route.h"
+#include <string.h>
+
+#define NETIF_ROUTE_DEFAULT_HOLD_MS    (2000)
+
+void netif_route_get_default_config(netif_route_config_t *config)
+{
+    if (!config) return;
+
+    memset(config, 0, sizeof(netif_route_config_t));
+    config->hold_ms = NETIF_ROUTE_DEFAULT_HOLD_MS;
+}
+
+void netif_route_init(netif_route_t *rt, const netif_route_config_t *config, uint8_t count)
+{
+    if (!rt || !config) return;
+
+    memset(rt, 0, sizeof(netif_route_t));
+    rt->config = *config;
+    rt->count = count > NETIF_ROUTE_MAX_IF ? NETIF_ROUTE_MAX_IF : count;
+    rt->preferred = NETIF_ROUTE_NONE;
+    rt->current = NETIF_ROUTE_NONE;
+}
+
+void netif_route_set_preferred(netif_route_t *rt, int idx)
+{
+    if (!rt) return;
+
+    if (idx < 0 || idx >= rt->count) idx = NETIF_ROUTE_NONE;
+    rt->preferred = (int8_t)idx;
+    rt->preferred_pending = (idx != NETIF_ROUTE_NONE);
+}
+
+void netif_route_set_usable(netif_route_t *rt, int idx, int usable, uint32_t now_ms)
+{
+    if (!rt || idx < 0 || idx >= rt->count) return;
+
+    usable = usable ? 1 : 0;
+    if (usable && !rt->usable[idx]) rt->usable_since_ms[idx] = now_ms;
+    rt->usable[idx] = (uint8_t)usable;
+}
+
+static int netif_route_best(const netif_route_t *rt)
+{
+    if (rt->preferred != NETIF_ROUTE_NONE && rt->usable[rt->preferred]) return rt->preferred;
+
+    for (int i = rt->count - 1; i >= 0; i--) {
+        if (rt->usable[i]) return i;
+    }
+    return NETIF_ROUTE_NONE;
+}
+
+int netif_route_select(netif_route_t *rt, uint32_t now_ms, uint32_t *recheck_ms)
+{
+    if (recheck_ms) *recheck_ms = 0;
+    if (!rt) return NETIF_ROUTE_NONE;
+
+    int best = netif_route_best(rt);
+
+    // The preferred interface got the route, from now on it is damped like any other
+    if (best != NETIF_ROUTE_NONE && best == rt->preferred && best == rt->current) rt->preferred_pending = 0;
+    if (best == rt->current) return rt->current;
+
+    if (best == NETIF_ROUTE_NONE || rt->current == NETIF_ROUTE_NONE || !rt->usable[rt->current]) {
+        // Nothing held or the holder went away: race to the first usable one
+        if (rt->current != NETIF_ROUTE_NONE) rt->failovers++;
+        if (best != NETIF_ROUTE_NONE && best == rt->preferred) rt->preferred_pending = 0;
+        rt->current = (int8_t)best;
+        rt->switches++;
+        return rt->current;
+    }
+
+    // The holder still works, only move once the better link has settled. A newly
+    // selected preference is taken the first time it is usable; after that a flapping
+    // preferred link waits out the hold like any other so it cannot bounce the route
+    uint32_t held = now_ms - rt->usable_since_ms[best];
+    if ((best == rt->preferred && rt->preferred_pending) || held >= rt->config.hold_ms) {
+        if (best == rt->preferred) rt->preferred_pending = 0;
+        rt->current = (int8_t)best;
+        rt->switches++;
+    } else if (recheck_ms) {
+        *recheck_ms = rt->config.hold_ms - held;
+    }
+    return rt->current;
+}
@@ -0,0 +1,90 @@
+/**
+ * @file netif_route.h
+ * @brief Default route selection across network interfaces
+ * @details Pure state machine, no RTOS or lwIP dependency. Interfaces report
+ *          when they become usable or go away; the first usable one takes
+ *          the default route at once, a holder that goes away is replaced
+ *          immediately, and a newly set preferred interface takes over the
+ *          first time it is usable. Otherwise a better interface, the
+ *          preferred one included, only takes over from a working holder
+ *          after it has stayed usable for hold_ms.
+ */
+
+#ifndef NETIF_ROUTE_H
+#define NETIF_ROUTE_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define NETIF_ROUTE_MAX_IF      (8)
+#define NETIF_ROUTE_NONE        (-1)
+
+/**
+ * @brief Route selection configuration
+ */
+typedef struct {
+    uint32_t hold_ms;                 // Time a better interface must stay usable before it takes over
+} netif_route_config_t;
+
+/**
+ * @brief Route selection state
+ */
+typedef struct {
+    netif_route_config_t config;
+    uint8_t count;                          // Candidates, index order is ascending priority
+    uint8_t usable[NETIF_ROUTE_MAX_IF];
+    uint32_t usable_since_ms[NETIF_ROUTE_MAX_IF];
+    int8_t preferred;                       // User selected interface, NETIF_ROUTE_NONE for priority order
+    uint8_t preferred_pending;              // Preference not applied yet, taken without hold once usable
+    int8_t current;                         // Interface holding the default route
+    uint32_t switches;                      // Number of default route changes
+    uint32_t failovers;                     // Changes forced by the holder going away
+} netif_route_t;
+
+/**
+ * @brief Fill default configuration
+ * @param config Configuration to fill
+ */
+void netif_route_get_default_config(netif_route_config_t *config);
+
+/**
+ * @brief Reset the selector, no interface usable
+ * @param rt Selector state
+ * @param config Configuration
+ * @param count Number of candidates (at most NETIF_ROUTE_MAX_IF)
+ */
+void netif_route_init(netif_route_t *rt, const netif_route_config_t *config, uint8_t count);
+
+/**
+ * @brief Select the preferred interface, taken without hold when usable
+ * @param rt Selector state
+ * @param idx Candidate index or NETIF_ROUTE_NONE
+ */
+void netif_route_set_preferred(netif_route_t *rt, int idx);
+
+/**
+ * @brief Report whether a candidate can carry traffic
+ * @param rt Selector state
+ * @param idx Candidate index
+ * @param usable Non zero when up, linked and addressed
+ * @param now_ms Current monotonic time in ms
+ */
+void netif_route_set_usable(netif_route_t *rt, int idx, int usable, uint32_t now_ms);
+
+/**
+ * @brief Re-evaluate the default route
+ * @param rt Selector state
+ * @param now_ms Current monotonic time in ms
+ * @param recheck_ms Set to the delay before a held switch is due, 0 if none (optional)
+ * @return Candidate holding the default route, NETIF_ROUTE_NONE if nothing is usable
+ */
+int netif_route_select(netif_route_t *rt, uint32_t now_ms, uint32_t *recheck_ms);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* NETIF_ROUTE_H */
@@ -0,0 +1,93 @@
+/**
+ * @file tcp_profile.c
+ * @brief TCP window and send buffer sizing per link
+ */
+
+#include "tcp_profile.h"
+#include <string.h>
+
+static uint32_t tcp_profile_clamp(uint32_t val, uint32_t min, uint32_t max, uint32_t mss)
+{
+    if (mss) val = (val + mss - 1) / mss * mss;
+    if (val > max) val = max;
+    if (val < min) val = min;
+    return val;
+}
+
+static uint32_t tcp_profile_cut(uint32_t *val, uint32_t min, uint32_t need, uint32_t mss)
+{
+    uint32_t room = *val > min ? *val - min : 0;
+    uint32_t cut = need < room ? need : room;
+
+    // Whole segments only, rounding the cut up while the minimum allows
+    if (mss && cut % mss) cut = (cut / mss + 1) * mss;
+    if (cut > room) cut = room;
+    *val -= cut;
+    return cut;
+}
+
+void tcp_profile_size(const tcp_profile_t *profile, uint32_t rtt_ms, uint32_t mss, uint32_t *wnd, uint32_t *snd)
+{
+    if (!profile) return;
+    if (rtt_ms == 0) rtt_ms = profile->rtt_ms;
+
+    // kbit/s * ms / 8 = bytes in flight over one RTT
+    uint64_t rx_bdp = (uint64_t)profile->rx_kbps * rtt_ms / 8;
+    uint64_t tx_bdp = (uint64_t)profile->tx_kbps * rtt_ms / 8;
+
+    // A quarter more window than the BDP so the sender is not stalled by a late
+    // window update; the send buffer holds one window in flight and one being refilled
+    rx_bdp += rx_bdp / 4;
+    tx_bdp *= 2;
+    if (rx_bdp > UINT32_MAX) rx_bdp = UINT32_MAX;
+    if (tx_bdp > UINT32_MAX) tx_bdp = UINT32_MAX;
+
+    if (wnd) *wnd = tcp_profile_clamp((uint32_t)rx_bdp, profile->wnd_min, profile->wnd_max, mss);
+    if (snd) *snd = tcp_profile_clamp((uint32_t)tx_bdp, profile->snd_min, profile->snd_max, mss);
+}
+
+void tcp_profile_budget_init(tcp_profile_budget_t *budget, uint32_t total)
+{
+    if (!budget) return;
+
+    memset(budget, 0, sizeof(tcp_profile_budget_t));
+    budget->total = total;
+}
+
+void tcp_profile_reserve(tcp_profile_budget_t *budget, const tcp_profile_t *profile, uint32_t mss, uint32_t *wnd, uint32_t *snd)
+{
+    if (!budget || !profile || !wnd || !snd) return;
+
+    uint32_t avail = budget->total > budget->used ? budget->total - budget->used : 0;
+    uint32_t want = *wnd + *snd;
+
+    if (want > avail) {
+        uint32_t need = want - avail;
+        uint32_t cut = tcp_profile_cut(snd, profile->snd_min, need, mss);
+        need = cut < need ? need - cut : 0;
+        if (need) {
+            cut = tcp_profile_cut(wnd, profile->wnd_min, need, mss);
+            need = cut < need ? need - cut : 0;
+        }
+        budget->shrunk++;
+        if (need) budget->overcommit++;
+    }
+
+    budget->used += *wnd + *snd;
+    if (budget->used > budget->peak) budget->peak = budget->used;
+}
+
+void tcp_profile_release(tcp_profile_budget_t *budget, uint32_t bytes)
+{
+    if (!budget) return;
+
+    budget->used = budget->used > bytes ? budget->used - bytes : 0;
+}
+
+uint32_t tcp_profile_rtt_update(uint32_t srtt_ms, uint32_t sample_ms)
+{
+    if (sample_ms == 0) sample_ms = 1;
+    if (srtt_ms == 0) return sample_ms;
+
+    return (uint32_t)(((uint64_t)srtt_ms * 7 + sample_ms + 4) / 8);
+}
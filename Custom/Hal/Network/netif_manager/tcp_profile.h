@@ -0,0 +1,93 @@
+/**
+ * @file tcp_profile.h
+ * @brief TCP window and send buffer sizing per link
+ * @details Pure arithmetic, no RTOS or lwIP dependency. A profile describes
+ *          the nominal rates of a link type and the bounds of its buffers;
+ *          a connection is sized from the bandwidth-delay product at the
+ *          measured RTT and then has to fit into a shared memory budget,
+ *          which shrinks new grants down to the profile minimum once it
+ *          runs short.
+ */
+
+#ifndef TCP_PROFILE_H
+#define TCP_PROFILE_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Link profile, sizes in bytes
+ */
+typedef struct {
+    uint32_t rx_kbps;                 // Nominal downlink rate, sizes the receive window
+    uint32_t tx_kbps;                 // Nominal uplink rate, sizes the send buffer
+    uint32_t rtt_ms;                  // RTT assumed until one is measured
+    uint32_t wnd_min;
+    uint32_t wnd_max;
+    uint32_t snd_min;
+    uint32_t snd_max;
+} tcp_profile_t;
+
+/**
+ * @brief Memory budget shared by all sized connections
+ */
+typedef struct {
+    uint32_t total;
+    uint32_t used;
+    uint32_t peak;
+    uint32_t shrunk;                  // Grants reduced to fit the budget
+    uint32_t overcommit;              // Grants that did not fit even at the profile minimum
+} tcp_profile_budget_t;
+
+/**
+ * @brief Size a connection for a link, ignoring the budget
+ * @param profile Link profile
+ * @param rtt_ms Measured RTT, 0 to use the profile default
+ * @param mss Segment size the sizes are rounded up to
+ * @param wnd Receive window
+ * @param snd Send buffer
+ */
+void tcp_profile_size(const tcp_profile_t *profile, uint32_t rtt_ms, uint32_t mss, uint32_t *wnd, uint32_t *snd);
+
+/**
+ * @brief Reset a budget
+ * @param budget Budget state
+ * @param total Bytes available to all connections
+ */
+void tcp_profile_budget_init(tcp_profile_budget_t *budget, uint32_t total);
+
+/**
+ * @brief Take a connection's buffers from the budget, shrinking them if it runs short
+ * @details The send buffer gives way first, then the receive window, neither below
+ *          the profile minimum. The minimum is always granted so the connection works.
+ * @param budget Budget state
+ * @param profile Link profile the sizes came from
+ * @param mss Segment size the sizes are rounded to
+ * @param wnd Receive window, updated to the grant
+ * @param snd Send buffer, updated to the grant
+ */
+void tcp_profile_reserve(tcp_profile_budget_t *budget, const tcp_profile_t *profile, uint32_t mss, uint32_t *wnd, uint32_t *snd);
+
+/**
+ * @brief Return a connection's buffers to the budget
+ * @param budget Budget state
+ * @param bytes Window plus send buffer granted by tcp_profile_reserve()
+ */
+void tcp_profile_release(tcp_profile_budget_t *budget, uint32_t bytes);
+
+/**
+ * @brief Fold an RTT sample into a smoothed RTT (1/8 gain as in RFC 6298)
+ * @param srtt_ms Smoothed RTT, 0 if there is no sample yet
+ * @param sample_ms New sample
+ * @return Updated smoothed RTT
+ */
+uint32_t tcp_profile_rtt_update(uint32_t srtt_ms, uint32_t sample_ms);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* TCP_PROFILE_H */
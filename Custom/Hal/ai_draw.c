@@ -127,7 +127,8 @@ int mpe_draw_result(mpe_draw_conf_t *mpe_conf, mpe_detect_t *result)
         return -1;
     }
 
-    device_t *draw = device_find_pattern(DRAW_DEVICE_NAME, DEV_TYPE_VIDEO);
+    static device_handle_t draw_handle = DEVICE_HANDLE_INIT(DRAW_DEVICE_NAME, DEV_TYPE_VIDEO);
+    device_t *draw = device_handle_get(&draw_handle);
     if(draw == NULL){
         return -1;
     }
@@ -298,7 +299,8 @@ int od_draw_result(od_draw_conf_t *od_conf, od_detect_t *result)
         return -1;
     }
 
-    device_t *draw = device_find_pattern(DRAW_DEVICE_NAME, DEV_TYPE_VIDEO);
+    static device_handle_t draw_handle = DEVICE_HANDLE_INIT(DRAW_DEVICE_NAME, DEV_TYPE_VIDEO);
+    device_t *draw = device_handle_get(&draw_handle);
     if(draw == NULL){
         return -1;
     }
@@ -3,6 +3,7 @@
 #include "camera.h"
 #include "common_utils.h"
 #include "debug.h"
+#include "generic_time.h"
 #include "mem.h"
 #include "stm32n6xx_hal.h"
 
@@ -11,10 +12,10 @@
 #define CAMERA_BUFFER_TIMEOUT_MS      1000
 #define CAMERA_MEMORY_ALIGNMENT       32
 #define CAMERA_DEINIT_DELAY_MS        20
-#define CAMERA_MAX_READY_BUFFERS      8
 
 static int pipe_buffer_acquire(pipe_buffer_t *pipe_buffer, pipe_params_t *pipe_param, camera_dq_t *dq);
 static int pipe_buffer_release(pipe_buffer_t *pipe_buffer, pipe_params_t *pipe_param, camera_dq_t *dq);
+static uint32_t pipe_buffer_bytes(pipe_params_t *pipe_param, int buffer_nb);
 
 static camera_t g_camera = {0};
 const osThreadAttr_t cameraTask_attributes = {
@@ -185,8 +186,9 @@ static uint8_t *isp_tool_buf = NULL;
 ISP_StatusTypeDef Camera_DumpFrame(void *pDcmipp, uint32_t Pipe, ISP_DumpCfgTypeDef Config,
 uint32_t **pBuffer, ISP_DumpFrameMetaTypeDef *pMeta)
 {
-    int ret = 0, try_times = 0, isp_tool_buf_index = 0;
+    int ret = 0, isp_tool_buf_index = 0;
     uint8_t *fb_buffer = NULL;
+    camera_buffer_with_frame_id_t frame;
     DCMIPP_HandleTypeDef *pHdcmipp = (DCMIPP_HandleTypeDef*)pDcmipp;
     /* Check handle validity */
     if ((pHdcmipp == NULL) || (pBuffer == NULL) || (pMeta == NULL))
@@ -216,15 +218,12 @@ uint32_t **pBuffer, ISP_DumpFrameMetaTypeDef *pMeta)
         }
     }
 
-    do {
-        ret = device_ioctl(g_camera.dev, CAM_CMD_GET_PIPE1_BUFFER, (uint8_t *)&fb_buffer, 0);
-        if (ret <= 0) {
-            if (++try_times > 10) {
-                return ISP_ERR_DCMIPP_FRAMESIZE;
-            }
-            osDelay(1);
-        }
-    } while (ret <= 0);
+    ret = device_ioctl(g_camera.dev, CAM_CMD_WAIT_PIPE1_BUFFER, (uint8_t *)&frame, CAMERA_BUFFER_TIMEOUT_MS);
+    if (ret != AICAM_OK) {
+        return ISP_ERR_DCMIPP_FRAMESIZE;
+    }
+    fb_buffer = frame.buffer;
+    ret = (int)frame.size;
 
     // printf("ret: %d\r\n", ret);
     if (ret > PIPE1_DEFAULT_WIDTH * PIPE1_DEFAULT_HEIGHT * PIPE1_DEFAULT_BPP) {
@@ -268,96 +267,18 @@ ISP_AppliHelpersTypeDef appliHelpers = {
 };
 #endif
 
-void buffer_reset(pipe_buffer_t *bufs, int nb, camera_dq_t *dq)
-{
-    uint32_t idx;
-    for (int i = 0; i < nb; ++i) {
-        bufs[i].state = BUFFER_IDLE;
-        bufs[i].frame_id = 0;
-    }
-    while (osMessageQueueGet(dq->ready_queue, &idx, NULL, 0) == osOK);
-    if (dq->idle_sem) {
-        osSemaphoreDelete(dq->idle_sem);
-    }
-    dq->idle_sem = osSemaphoreNew(nb, nb, NULL);
-}
-
-pipe_buffer_t* buffer_acquire(pipe_buffer_t *bufs, int nb, camera_dq_t *dq)
-{
-    uint32_t idx = 0xFFFFFFFF;
-    if (osSemaphoreAcquire(dq->idle_sem, 0) == osOK) {
-        for (int i = 0; i < nb; i++) {
-            if (bufs[i].state == BUFFER_IDLE) {
-                bufs[i].state = BUFFER_PROCESSING;
-                return &bufs[i];
-            }
-        }
-    }
-    if (osMessageQueueGet(dq->ready_queue, &idx, NULL, 0) == osOK) {
-        if (idx < nb && bufs[idx].state == BUFFER_READY) {
-            bufs[idx].state = BUFFER_PROCESSING;
-            return &bufs[idx];
-        }
-    }
-    return NULL;
-}
-
-pipe_buffer_t* find_processing_buffer(pipe_buffer_t *bufs, int nb)
-{
-    for (int i = 0; i < nb; ++i) {
-        if (bufs[i].state == BUFFER_PROCESSING) {
-            return &bufs[i];
-        }
-    }
-    return NULL;
-}
-
-void buffer_set_ready_isr(pipe_buffer_t *bufs, camera_dq_t *dq, pipe_buffer_t* buf, uint32_t frame_id)
+static inline uint32_t camera_irq_lock(void)
 {
-    buf->state = BUFFER_READY;
-    buf->frame_id = frame_id;
-    uint32_t idx = buf - bufs;
-    osMessageQueuePut(dq->ready_queue, &idx, 0, 0);
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    return primask;
 }
 
-void buffer_release_isr(pipe_buffer_t *buf, camera_dq_t *dq)
+static inline void camera_irq_unlock(uint32_t primask)
 {
-    buf->state = BUFFER_IDLE;
-    osSemaphoreRelease(dq->idle_sem);
+    __set_PRIMASK(primask);
 }
 
-pipe_buffer_t* buffer_get_latest_ready(pipe_buffer_t *bufs, int nb, camera_dq_t *dq)
-{
-    uint32_t idxs[CAMERA_MAX_READY_BUFFERS];
-    uint32_t count = 0;
-    pipe_buffer_t* latest = NULL;
-    uint32_t max_frame_id = 0;
-
-    while (osMessageQueueGet(dq->ready_queue, &idxs[count], NULL, 0) == osOK) {
-        uint32_t idx = idxs[count];
-        if (idx < nb && bufs[idx].state == BUFFER_READY) {
-            if (latest == NULL || bufs[idx].frame_id > max_frame_id) {
-                latest = &bufs[idx];
-                max_frame_id = bufs[idx].frame_id;
-            }
-        }
-        count++;
-    }
-
-    for (uint32_t i = 0; i < count; i++) {
-        if (latest && (&bufs[idxs[i]] == latest))
-            continue;
-        // for old buffers, release them
-        buffer_release_isr(&bufs[idxs[i]], dq);
-    }
-
-    if (latest) {
-        latest->state = BUFFER_IN_USE;
-    }
-    return latest;
-}
-
-
 static void CAM_setSensorInfo(CMW_Sensor_Name_t sensor, camera_t *camera)
 {
     switch (sensor) {
@@ -568,60 +489,84 @@ int CAM_Init(camera_t *camera)
     return CMW_ERROR_NONE;
 }
 
-static void main_pipe_frame_event()
+// Restart a pipe stalled by the BLOCK policy, interrupts masked or from the frame interrupt
+static void pipe_resume_if_stalled(uint32_t pipe_id, pipe_buffer_t *bufs, int nb, camera_dq_t *dq)
 {
-    int ret;
-    pipe_buffer_t *buffer,*buffer1;
-    buffer1 = find_processing_buffer(g_camera.pipe1_buffer, g_camera.pipe1_param.buffer_nb);
-    if(buffer1 != NULL){
-        buffer_set_ready_isr(g_camera.pipe1_buffer, &g_camera.pipe1_dq, buffer1, g_camera.current_frame_id);
+    pipe_buffer_t *buffer = buffer_resume_isr(bufs, nb, dq);
+    if (buffer == NULL) {
+        return;
     }
-
-    buffer = buffer_acquire(g_camera.pipe1_buffer, g_camera.pipe1_param.buffer_nb, &g_camera.pipe1_dq);
-    if(buffer != NULL){
-        ret = HAL_DCMIPP_PIPE_SetMemoryAddress(CMW_CAMERA_GetDCMIPPHandle(), DCMIPP_PIPE1,
-                                                DCMIPP_MEMORY_ADDRESS_0, (uint32_t) buffer->data);
-        if(ret == HAL_OK){
-            osSemaphoreRelease(g_camera.sem_pipe1);
-        }else{
-            buffer_release_isr(buffer, &g_camera.pipe1_dq);
-        }
-    }else{
-        ret = HAL_DCMIPP_PIPE_SetMemoryAddress(CMW_CAMERA_GetDCMIPPHandle(), DCMIPP_PIPE1,
-                                                DCMIPP_MEMORY_ADDRESS_0, (uint32_t) buffer1->data);
-        if(ret == HAL_OK){
-            osSemaphoreRelease(g_camera.sem_pipe1);
-        }
+    if (HAL_DCMIPP_PIPE_SetMemoryAddress(CMW_CAMERA_GetDCMIPPHandle(), pipe_id,
+                                         DCMIPP_MEMORY_ADDRESS_0, (uint32_t) buffer->data) == HAL_OK) {
+        CMW_CAMERA_Resume(pipe_id);
     }
 }
 
-static void ancillary_pipe_frame_event()
+static void pipe_frame_event(uint32_t pipe_id, pipe_buffer_t *bufs, pipe_params_t *param,
+                             camera_dq_t *dq, osSemaphoreId_t sem, camera_frame_cb_config_t *cb)
 {
-    pipe_buffer_t *buffer,*buffer1;
-    int ret;
+    pipe_buffer_t *buffer, *done, *latest;
+    camera_buffer_with_frame_id_t frame;
 
-    // Use the same frame_id as PIPE1 to keep synchronization
-    buffer1 = find_processing_buffer(g_camera.pipe2_buffer, g_camera.pipe2_param.buffer_nb);
-    if(buffer1 != NULL){
-        buffer_set_ready_isr(g_camera.pipe2_buffer, &g_camera.pipe2_dq, buffer1, g_camera.current_frame_id);
+    if (bufs == NULL) {
+        return;
     }
 
-    buffer = buffer_acquire(g_camera.pipe2_buffer, g_camera.pipe2_param.buffer_nb, &g_camera.pipe2_dq);
-    if(buffer != NULL){
-        ret = HAL_DCMIPP_PIPE_SetMemoryAddress(CMW_CAMERA_GetDCMIPPHandle(), DCMIPP_PIPE2,
-                                                DCMIPP_MEMORY_ADDRESS_0, (uint32_t) buffer->data);
-        if(ret == HAL_OK){
-            osSemaphoreRelease(g_camera.sem_pipe2);
-        }else{
-            buffer_release_isr(buffer, &g_camera.pipe2_dq);
+    // PIPE2 uses the same frame_id as PIPE1 to keep synchronization
+    done = find_processing_buffer(bufs, param->buffer_nb);
+    buffer = buffer_frame_done_isr(bufs, param->buffer_nb, dq, g_camera.current_frame_id,
+                                   g_camera.current_frame_pts_us);
+    if (buffer == NULL) {
+        // BLOCK policy: no capture is active at frame end, hold the pipe until a buffer comes back
+        CMW_CAMERA_Suspend(pipe_id);
+    } else if (buffer != done && param->buffer_nb > 1) {
+        // a single buffer is written in place and never reprogrammed
+        if (HAL_DCMIPP_PIPE_SetMemoryAddress(CMW_CAMERA_GetDCMIPPHandle(), pipe_id,
+                                             DCMIPP_MEMORY_ADDRESS_0, (uint32_t) buffer->data) != HAL_OK) {
+            buffer_release_isr(buffer, dq);
         }
-    }else{
-        ret = HAL_DCMIPP_PIPE_SetMemoryAddress(CMW_CAMERA_GetDCMIPPHandle(), DCMIPP_PIPE2,
-                                                DCMIPP_MEMORY_ADDRESS_0, (uint32_t) buffer1->data);
-        if(ret == HAL_OK){
-            osSemaphoreRelease(g_camera.sem_pipe2);
+    }
+
+    if (buffer_ready_count(dq) == 0) {
+        return;
+    }
+
+    if (cb->cb != NULL) {
+        if (param->extbuffer_flag == 1) {
+            frame.buffer = param->extbuffer;
+            frame.frame_id = g_camera.current_frame_id;
+            frame.size = param->width * param->height * param->bpp;
+            frame.pts_us = g_camera.current_frame_pts_us;
+            cb->cb(pipe_id, &frame, cb->user_data);
+            return;
+        }
+        latest = buffer_take_ready(bufs, param->buffer_nb, dq);
+        if (latest != NULL) {
+            frame.buffer = latest->data;
+            frame.frame_id = latest->frame_id;
+            frame.size = param->width * param->height * param->bpp;
+            frame.pts_us = latest->pts_us;
+            if (cb->cb(pipe_id, &frame, cb->user_data) != 0) {
+                buffer_release_isr(latest, dq);
+                pipe_resume_if_stalled(pipe_id, bufs, param->buffer_nb, dq);
+            }
+            return;
         }
     }
+
+    osSemaphoreRelease(sem);
+}
+
+static void main_pipe_frame_event()
+{
+    pipe_frame_event(DCMIPP_PIPE1, g_camera.pipe1_buffer, &g_camera.pipe1_param,
+                     &g_camera.pipe1_dq, g_camera.sem_pipe1, &g_camera.pipe1_cb);
+}
+
+static void ancillary_pipe_frame_event()
+{
+    pipe_frame_event(DCMIPP_PIPE2, g_camera.pipe2_buffer, &g_camera.pipe2_param,
+                     &g_camera.pipe2_dq, g_camera.sem_pipe2, &g_camera.pipe2_cb);
 }
 
 static void app_main_pipe_vsync_event()
@@ -643,6 +588,8 @@ int CMW_CAMERA_PIPE_FrameEventCallback(uint32_t pipe)
 int CMW_CAMERA_PIPE_VsyncEventCallback(uint32_t pipe)
 {
   if (pipe == DCMIPP_PIPE1) {
+    // frame start: the capture time every pipe's buffer of this frame carries
+    g_camera.current_frame_pts_us = generic_time_us();
     g_camera.current_frame_id++;
     app_main_pipe_vsync_event();
 #ifdef ISP_MW_TUNING_TOOL_SUPPORT
@@ -945,11 +892,75 @@ static void cameraProcess(void *argument)
     osThreadExit();
 }
 
+/*
+ * Wait for the newest ready frame of a pipe, called with mtx_id held.
+ * The frame interrupt wakes the waiter directly through sem_pipeX; a stale
+ * wakeup (frame already taken) just waits again for the remaining time.
+ */
+static int pipe_wait_buffer(camera_t *camera, uint32_t pipe_id, uint32_t timeout_ms,
+                            camera_buffer_with_frame_id_t *frame)
+{
+    pipe_buffer_t *buffer;
+    pipe_params_t *param;
+    osSemaphoreId_t sem;
+    osStatus_t status;
+    uint32_t primask, elapsed;
+    uint32_t start = osKernelGetTickCount();
+
+    for (;;) {
+        if (pipe_id == DCMIPP_PIPE1) {
+            if (camera->state.pipe1_state != PIPE_START) return AICAM_ERROR_NOT_SUPPORTED;
+            param = &camera->pipe1_param;
+            sem = camera->sem_pipe1;
+            primask = camera_irq_lock();
+            buffer = buffer_take_ready(camera->pipe1_buffer, param->buffer_nb, &camera->pipe1_dq);
+            camera_irq_unlock(primask);
+        } else {
+            if (camera->state.pipe2_state != PIPE_START) return AICAM_ERROR_NOT_SUPPORTED;
+            param = &camera->pipe2_param;
+            sem = camera->sem_pipe2;
+            buffer = NULL;
+            if (param->extbuffer_flag != 1) {
+                primask = camera_irq_lock();
+                buffer = buffer_take_ready(camera->pipe2_buffer, param->buffer_nb, &camera->pipe2_dq);
+                camera_irq_unlock(primask);
+            }
+        }
+
+        if (buffer != NULL) {
+            frame->buffer = buffer->data;
+            frame->frame_id = buffer->frame_id;
+            frame->size = param->width * param->height * param->bpp;
+            frame->pts_us = buffer->pts_us;
+            return AICAM_OK;
+        }
+
+        elapsed = osKernelGetTickCount() - start;
+        if (elapsed >= timeout_ms) {
+            return AICAM_ERROR_TIMEOUT;
+        }
+
+        osMutexRelease(camera->mtx_id);
+        status = osSemaphoreAcquire(sem, timeout_ms - elapsed);
+        osMutexAcquire(camera->mtx_id, osWaitForever);
+
+        if (status == osOK && param->extbuffer_flag == 1) {
+            if (param->extbuffer == NULL) return AICAM_ERROR_NOT_FOUND;
+            frame->buffer = param->extbuffer;
+            frame->frame_id = camera->current_frame_id;  // Use current_frame_id for extbuffer
+            frame->size = param->width * param->height * param->bpp;
+            frame->pts_us = camera->current_frame_pts_us;
+            return AICAM_OK;
+        }
+    }
+}
+
 static int camera_ioctl(void *priv, unsigned int cmd, unsigned char* ubuf, unsigned long arg)
 {
     camera_t *camera = (camera_t *)priv;
     CAM_CMD_E cam_cmd = (CAM_CMD_E)cmd;
-    pipe_buffer_t *buffer = NULL;
+    camera_buffer_with_frame_id_t frame;
+    uint32_t primask;
     int ret = AICAM_OK;
 
     if(!camera->is_init){
@@ -1112,116 +1123,49 @@ static int camera_ioctl(void *priv, unsigned int cmd, unsigned char* ubuf, unsig
             break;
 
         case CAM_CMD_GET_PIPE1_BUFFER:
-            if(camera->state.pipe1_state != PIPE_START){
-                ret = AICAM_ERROR_NOT_SUPPORTED;
-                break;
-            }
-            osMutexRelease(camera->mtx_id);
-            if (osSemaphoreAcquire(camera->sem_pipe1, CAMERA_BUFFER_TIMEOUT_MS) == osOK){
-                osMutexAcquire(camera->mtx_id, osWaitForever);
-                buffer = buffer_get_latest_ready(camera->pipe1_buffer, camera->pipe1_param.buffer_nb, &camera->pipe1_dq);
-                if(buffer != NULL){
-                    *((unsigned char **)ubuf) = buffer->data;
-                    ret = camera->pipe1_param.width * camera->pipe1_param.height * camera->pipe1_param.bpp;
-                }else{
-                    ret = AICAM_ERROR_NOT_FOUND;
-                }
-            }else{
-                osMutexAcquire(camera->mtx_id, osWaitForever);
-                ret = AICAM_ERROR_BUSY;
-            }
-            break;
-        
         case CAM_CMD_GET_PIPE2_BUFFER:
-            if(camera->state.pipe2_state != PIPE_START){
-                ret = AICAM_ERROR_NOT_SUPPORTED;
-                break;
-            }
-            osMutexRelease(camera->mtx_id);
-            if (osSemaphoreAcquire(camera->sem_pipe2, CAMERA_BUFFER_TIMEOUT_MS) == osOK){
-                osMutexAcquire(camera->mtx_id, osWaitForever);
-                if(camera->pipe2_param.extbuffer_flag == 1){
-                    if(camera->pipe2_param.extbuffer != NULL){
-                        *((unsigned char **)ubuf) = camera->pipe2_param.extbuffer;
-                        ret = camera->pipe2_param.width * camera->pipe2_param.height * camera->pipe2_param.bpp;
-                    }else{
-                        ret = AICAM_ERROR_NOT_FOUND;
-                    }
-                }else{
-                    buffer = buffer_get_latest_ready(camera->pipe2_buffer, camera->pipe2_param.buffer_nb, &camera->pipe2_dq);
-                    if(buffer != NULL){
-                        *((unsigned char **)ubuf) = buffer->data;
-                        ret = camera->pipe2_param.width * camera->pipe2_param.height * camera->pipe2_param.bpp;
-                    }else{
-                        ret = AICAM_ERROR_NOT_FOUND;
-                    }
-                }
-            }else{
-                osMutexAcquire(camera->mtx_id, osWaitForever);
+            ret = pipe_wait_buffer(camera, cam_cmd == CAM_CMD_GET_PIPE1_BUFFER ? DCMIPP_PIPE1 : DCMIPP_PIPE2,
+                                   CAMERA_BUFFER_TIMEOUT_MS, &frame);
+            if(ret == AICAM_OK){
+                *((unsigned char **)ubuf) = frame.buffer;
+                ret = frame.size;
+            }else if(ret == AICAM_ERROR_TIMEOUT){
                 ret = AICAM_ERROR_BUSY;
             }
             break;
 
         case CAM_CMD_GET_PIPE1_BUFFER_WITH_FRAME_ID:
-            if(camera->state.pipe1_state != PIPE_START){
-                ret = AICAM_ERROR_NOT_SUPPORTED;
-                break;
-            }
-            osMutexRelease(camera->mtx_id);
-            if (osSemaphoreAcquire(camera->sem_pipe1, CAMERA_BUFFER_TIMEOUT_MS) == osOK){
-                osMutexAcquire(camera->mtx_id, osWaitForever);
-                buffer = buffer_get_latest_ready(camera->pipe1_buffer, camera->pipe1_param.buffer_nb, &camera->pipe1_dq);
-                if(buffer != NULL){
-                    camera_buffer_with_frame_id_t *result = (camera_buffer_with_frame_id_t *)ubuf;
-                    result->buffer = buffer->data;
-                    result->frame_id = buffer->frame_id;
-                    result->size = camera->pipe1_param.width * camera->pipe1_param.height * camera->pipe1_param.bpp;
-                    ret = AICAM_OK;
-                }else{
-                    ret = AICAM_ERROR_NOT_FOUND;
-                }
-            }else{
-                osMutexAcquire(camera->mtx_id, osWaitForever);
+        case CAM_CMD_GET_PIPE2_BUFFER_WITH_FRAME_ID:
+            ret = pipe_wait_buffer(camera, cam_cmd == CAM_CMD_GET_PIPE1_BUFFER_WITH_FRAME_ID ? DCMIPP_PIPE1 : DCMIPP_PIPE2,
+                                   CAMERA_BUFFER_TIMEOUT_MS, (camera_buffer_with_frame_id_t *)ubuf);
+            if(ret == AICAM_ERROR_TIMEOUT){
                 ret = AICAM_ERROR_BUSY;
             }
             break;
 
-        case CAM_CMD_GET_PIPE2_BUFFER_WITH_FRAME_ID:
-            if(camera->state.pipe2_state != PIPE_START){
-                ret = AICAM_ERROR_NOT_SUPPORTED;
+        case CAM_CMD_WAIT_PIPE1_BUFFER:
+        case CAM_CMD_WAIT_PIPE2_BUFFER:
+            if(ubuf == NULL){
+                ret = AICAM_ERROR_INVALID_PARAM;
                 break;
             }
-            osMutexRelease(camera->mtx_id);
-            if (osSemaphoreAcquire(camera->sem_pipe2, CAMERA_BUFFER_TIMEOUT_MS) == osOK){
-                osMutexAcquire(camera->mtx_id, osWaitForever);
-                if(camera->pipe2_param.extbuffer_flag == 1){
-                    if(camera->pipe2_param.extbuffer != NULL){
-                        camera_buffer_with_frame_id_t *result = (camera_buffer_with_frame_id_t *)ubuf;
-                        result->buffer = camera->pipe2_param.extbuffer;
-                        result->frame_id = camera->current_frame_id;  // Use current_frame_id for extbuffer
-                        result->size = camera->pipe2_param.width * camera->pipe2_param.height * camera->pipe2_param.bpp;
-                        ret = AICAM_OK;
-                    }else{
-                        ret = AICAM_ERROR_NOT_FOUND;
-                    }
-                }else{
-                    buffer = buffer_get_latest_ready(camera->pipe2_buffer, camera->pipe2_param.buffer_nb, &camera->pipe2_dq);
-                    if(buffer != NULL){
-                        camera_buffer_with_frame_id_t *result = (camera_buffer_with_frame_id_t *)ubuf;
-                        result->buffer = buffer->data;
-                        result->frame_id = buffer->frame_id;
-                        result->size = camera->pipe2_param.width * camera->pipe2_param.height * camera->pipe2_param.bpp;
-                        ret = AICAM_OK;
-                    }else{
-                        ret = AICAM_ERROR_NOT_FOUND;
-                    }
-                }
-            }else{
-                osMutexAcquire(camera->mtx_id, osWaitForever);
-                ret = AICAM_ERROR_BUSY;
-            }
+            ret = pipe_wait_buffer(camera, cam_cmd == CAM_CMD_WAIT_PIPE1_BUFFER ? DCMIPP_PIPE1 : DCMIPP_PIPE2,
+                                   (uint32_t)arg, (camera_buffer_with_frame_id_t *)ubuf);
             break;
 
+        case CAM_CMD_SET_PIPE1_FRAME_CALLBACK:
+        case CAM_CMD_SET_PIPE2_FRAME_CALLBACK:
+        {
+            camera_frame_cb_config_t *cb = (cam_cmd == CAM_CMD_SET_PIPE1_FRAME_CALLBACK) ? &camera->pipe1_cb : &camera->pipe2_cb;
+            camera_frame_cb_config_t *cfg = (camera_frame_cb_config_t *)ubuf;
+            primask = camera_irq_lock();
+            cb->cb = cfg ? cfg->cb : NULL;
+            cb->user_data = cfg ? cfg->user_data : NULL;
+            camera_irq_unlock(primask);
+            ret = AICAM_OK;
+            break;
+        }
+
         case CAM_CMD_RETURN_PIPE1_BUFFER:
             if(camera->state.pipe1_state != PIPE_START){
                 ret = AICAM_ERROR_NOT_FOUND;
@@ -1229,7 +1173,10 @@ static int camera_ioctl(void *priv, unsigned int cmd, unsigned char* ubuf, unsig
             }
             for (int i = 0; i < camera->pipe1_param.buffer_nb; ++i) {
                 if (camera->pipe1_buffer[i].data == ubuf) {
+                    primask = camera_irq_lock();
                     buffer_release_isr(&camera->pipe1_buffer[i], &camera->pipe1_dq);
+                    pipe_resume_if_stalled(DCMIPP_PIPE1, camera->pipe1_buffer, camera->pipe1_param.buffer_nb, &camera->pipe1_dq);
+                    camera_irq_unlock(primask);
                     ret = AICAM_OK;
                     break;
                 }
@@ -1243,13 +1190,80 @@ static int camera_ioctl(void *priv, unsigned int cmd, unsigned char* ubuf, unsig
             }
             for (int i = 0; i < camera->pipe2_param.buffer_nb; ++i) {
                 if (camera->pipe2_buffer[i].data == ubuf) {
+                    primask = camera_irq_lock();
                     buffer_release_isr(&camera->pipe2_buffer[i], &camera->pipe2_dq);
+                    pipe_resume_if_stalled(DCMIPP_PIPE2, camera->pipe2_buffer, camera->pipe2_param.buffer_nb, &camera->pipe2_dq);
+                    camera_irq_unlock(primask);
                     ret = AICAM_OK;
                     break;
                 }
             }
             break;
 
+        case CAM_CMD_SET_PIPE1_BUFFER_CONFIG:
+        case CAM_CMD_SET_PIPE2_BUFFER_CONFIG:
+        {
+            camera_buffer_config_t *cfg = (camera_buffer_config_t *)ubuf;
+            bool is_pipe1 = (cam_cmd == CAM_CMD_SET_PIPE1_BUFFER_CONFIG);
+            pipe_params_t *param = is_pipe1 ? &camera->pipe1_param : &camera->pipe2_param;
+            pipe_params_t *other = is_pipe1 ? &camera->pipe2_param : &camera->pipe1_param;
+            PIPE_STATE_E state = is_pipe1 ? camera->state.pipe1_state : camera->state.pipe2_state;
+            if(state != PIPE_STOP){
+                ret = AICAM_ERROR_BUSY;
+                break;
+            }
+            if(cfg == NULL || cfg->buffer_nb <= 0 || cfg->buffer_nb > CAMERA_BUFFER_MAX_NB ||
+               cfg->policy > CAMERA_BUFFER_BLOCK){
+                ret = AICAM_ERROR_INVALID_PARAM;
+                break;
+            }
+            if(param->extbuffer_flag == 1 && cfg->buffer_nb != 1){
+                ret = AICAM_ERROR_NOT_SUPPORTED;
+                break;
+            }
+            if(pipe_buffer_bytes(param, cfg->buffer_nb) + pipe_buffer_bytes(other, other->buffer_nb) > CAMERA_BUFFER_BUDGET){
+                LOG_DRV_ERROR("pipe%d %d buffers exceed budget %d \r\n", is_pipe1 ? 1 : 2, cfg->buffer_nb, CAMERA_BUFFER_BUDGET);
+                ret = AICAM_ERROR_NO_MEMORY;
+                break;
+            }
+            param->buffer_nb = cfg->buffer_nb;
+            if(is_pipe1){
+                camera->pipe1_dq.policy = cfg->policy;
+            }else{
+                camera->pipe2_dq.policy = cfg->policy;
+            }
+            ret = AICAM_OK;
+            break;
+        }
+
+        case CAM_CMD_GET_PIPE1_BUFFER_CONFIG:
+        case CAM_CMD_GET_PIPE2_BUFFER_CONFIG:
+        {
+            camera_buffer_config_t *cfg = (camera_buffer_config_t *)ubuf;
+            bool is_pipe1 = (cam_cmd == CAM_CMD_GET_PIPE1_BUFFER_CONFIG);
+            if(cfg == NULL){
+                ret = AICAM_ERROR_INVALID_PARAM;
+                break;
+            }
+            cfg->buffer_nb = is_pipe1 ? camera->pipe1_param.buffer_nb : camera->pipe2_param.buffer_nb;
+            cfg->policy = is_pipe1 ? camera->pipe1_dq.policy : camera->pipe2_dq.policy;
+            ret = AICAM_OK;
+            break;
+        }
+
+        case CAM_CMD_GET_PIPE1_BUFFER_STATS:
+        case CAM_CMD_GET_PIPE2_BUFFER_STATS:
+            if(ubuf == NULL){
+                ret = AICAM_ERROR_INVALID_PARAM;
+                break;
+            }
+            primask = camera_irq_lock();
+            memcpy(ubuf, cam_cmd == CAM_CMD_GET_PIPE1_BUFFER_STATS ? &camera->pipe1_dq.stats : &camera->pipe2_dq.stats,
+                   sizeof(camera_buffer_stats_t));
+            camera_irq_unlock(primask);
+            ret = AICAM_OK;
+            break;
+
         case CAM_CMD_SET_PIPE2_BUFFER_ADDR:
             if(camera->state.pipe2_state == PIPE_START){
                 ret = AICAM_ERROR_BUSY;
@@ -1274,8 +1288,25 @@ static int camera_ioctl(void *priv, unsigned int cmd, unsigned char* ubuf, unsig
     osMutexRelease(camera->mtx_id);
     return ret;
 }
+static uint32_t pipe_buffer_bytes(pipe_params_t *pipe_param, int buffer_nb)
+{
+    if (pipe_param->extbuffer_flag == 1) {
+        return 0;
+    }
+    return (uint32_t)(pipe_param->width * pipe_param->height * pipe_param->bpp) * (uint32_t)buffer_nb;
+}
+
 static int pipe_buffer_acquire(pipe_buffer_t *pipe_buffer, pipe_params_t *pipe_param, camera_dq_t *dq)
 {
+    if (pipe_param->buffer_nb <= 0 || pipe_param->buffer_nb > CAMERA_BUFFER_MAX_NB) {
+        LOG_DRV_ERROR("pipe buffer number %d out of range \r\n", pipe_param->buffer_nb);
+        return -1;
+    }
+    for (int i = 0; i < pipe_param->buffer_nb; i++) {
+        pipe_buffer[i].data = NULL;
+    }
+    buffer_reset(pipe_buffer, pipe_param->buffer_nb, dq);
+    memset(&dq->stats, 0, sizeof(dq->stats));
     for (int i = 0; i < pipe_param->buffer_nb; i++) {
         pipe_buffer[i].state = BUFFER_IDLE;
         pipe_buffer[i].frame_id = 0;
@@ -1290,25 +1321,17 @@ static int pipe_buffer_acquire(pipe_buffer_t *pipe_buffer, pipe_params_t *pipe_p
             return -1;
         }
     }
-    dq->ready_queue = osMessageQueueNew(pipe_param->buffer_nb, sizeof(uint32_t), NULL);
-    dq->idle_sem = osSemaphoreNew(pipe_param->buffer_nb, pipe_param->buffer_nb, NULL);
-
     return 0;
 }
 
 
 static int pipe_buffer_release(pipe_buffer_t *pipe_buffer, pipe_params_t *pipe_param, camera_dq_t *dq)
 {
-    
-    if (dq->ready_queue != NULL) {
-        osMessageQueueDelete(dq->ready_queue);
-        dq->ready_queue = NULL;
-    }
-
-    if (dq->idle_sem != NULL) {
-        osSemaphoreDelete(dq->idle_sem);
-        dq->idle_sem = NULL;
+    if (pipe_buffer == NULL) {
+        return 0;
     }
+    dq->ready_head = 0;
+    dq->ready_count = 0;
 
     if(pipe_param->extbuffer_flag == 1){
         return 0;
@@ -1346,6 +1369,7 @@ static int camera_init(void *priv)
 
     camera->mtx_id = osMutexNew(NULL);
     camera->current_frame_id = 0;
+    camera->current_frame_pts_us = 0;
     camera->sem_init = osSemaphoreNew(1, 0, NULL);
     camera->sem_isp = osSemaphoreNew(1, 0, NULL);
     camera->sem_pipe1 = osSemaphoreNew(1, 0, NULL);
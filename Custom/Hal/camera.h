@@ -6,6 +6,7 @@
 #include "dev_manager.h"
 #include "pwr.h"
 #include "aicam_error.h"
+#include "camera_buffer.h"
 
 /* Define sensor info */
 #define SENSOR_IMX335_WIDTH 2592
@@ -51,12 +52,18 @@
 #define PIPE2_MAX_WIDTH     480
 #define PIPE2_MAX_HEIGHT    480
 
-#ifdef ISP_MW_TUNING_TOOL_SUPPORT
-#define CAPTURE_BUFFER_NB (CAPTURE_DELAY + 1)
-#else
+/* Default buffer depth per pipe, changeable at runtime with CAM_CMD_SET_PIPEx_BUFFER_CONFIG */
+#ifndef CAPTURE_BUFFER_NB
 #define CAPTURE_BUFFER_NB (CAPTURE_DELAY + 1)
 #endif
+#ifndef NN_BUFFER_NB
 #define NN_BUFFER_NB 2
+#endif
+
+/* PSRAM budget shared by the capture buffers of both pipes */
+#ifndef CAMERA_BUFFER_BUDGET
+#define CAMERA_BUFFER_BUDGET (12 * 1024 * 1024)
+#endif
 
 #define CAMERA_CTRL_PIPE1_BIT (1<<1)
 #define CAMERA_CTRL_PIPE2_BIT (1<<2)
@@ -83,6 +90,16 @@ typedef enum {
     CAM_CMD_SET_PIPE2_BUFFER_ADDR,
     CAM_CMD_RETURN_PIPE1_BUFFER,
     CAM_CMD_RETURN_PIPE2_BUFFER,
+    CAM_CMD_WAIT_PIPE1_BUFFER,              // ubuf: camera_buffer_with_frame_id_t*, arg: timeout ms
+    CAM_CMD_WAIT_PIPE2_BUFFER,              // ubuf: camera_buffer_with_frame_id_t*, arg: timeout ms
+    CAM_CMD_SET_PIPE1_FRAME_CALLBACK,       // ubuf: camera_frame_cb_config_t*, NULL to disable
+    CAM_CMD_SET_PIPE2_FRAME_CALLBACK,       // ubuf: camera_frame_cb_config_t*, NULL to disable
+    CAM_CMD_SET_PIPE1_BUFFER_CONFIG,        // ubuf: camera_buffer_config_t*, pipe must be stopped
+    CAM_CMD_SET_PIPE2_BUFFER_CONFIG,        // ubuf: camera_buffer_config_t*, pipe must be stopped
+    CAM_CMD_GET_PIPE1_BUFFER_CONFIG,        // ubuf: camera_buffer_config_t*
+    CAM_CMD_GET_PIPE2_BUFFER_CONFIG,        // ubuf: camera_buffer_config_t*
+    CAM_CMD_GET_PIPE1_BUFFER_STATS,         // ubuf: camera_buffer_stats_t*
+    CAM_CMD_GET_PIPE2_BUFFER_STATS,         // ubuf: camera_buffer_stats_t*
 } CAM_CMD_E;
 
 typedef enum {
@@ -97,29 +114,30 @@ typedef enum {
     CAMERA_START,
 } CAMERA_STATE_E;
 
-typedef enum {
-    BUFFER_IDLE = 0,      // Idle
-    BUFFER_PROCESSING,    // Processing
-    BUFFER_READY,         // Ready
-    BUFFER_IN_USE         // In use
-} BUFFER_STATE_E;
-
-typedef struct {
-    uint8_t* data;
-    BUFFER_STATE_E state;
-    uint32_t frame_id;
-} pipe_buffer_t;
-
 typedef struct {
     uint8_t* buffer;        // Buffer pointer
     uint32_t frame_id;      // Frame ID
     uint32_t size;          // Buffer size in bytes
+    uint64_t pts_us;        // Capture time at frame start (generic_time_us)
 } camera_buffer_with_frame_id_t;
 
+/*
+ * Frame ready callback, called from the DCMIPP frame interrupt with the
+ * newest ready buffer already marked in use. Return 0 to keep the buffer
+ * (give it back later with CAM_CMD_RETURN_PIPEx_BUFFER), non-zero to let
+ * the driver recycle it immediately.
+ */
+typedef int (*camera_frame_cb_t)(uint32_t pipe, const camera_buffer_with_frame_id_t *frame, void *user_data);
+
+typedef struct {
+    camera_frame_cb_t cb;
+    void *user_data;
+} camera_frame_cb_config_t;
+
 typedef struct {
-    osMessageQueueId_t ready_queue;
-    osSemaphoreId_t idle_sem;
-} camera_dq_t;
+    int buffer_nb;                          // 1..CAMERA_BUFFER_MAX_NB
+    camera_buffer_policy_t policy;          // policy when all buffers are in use
+} camera_buffer_config_t;
 
 typedef struct {
     const char *name;
@@ -164,8 +182,11 @@ typedef struct {
     camera_dq_t pipe1_dq;
     pipe_buffer_t *pipe2_buffer;
     camera_dq_t pipe2_dq;
+    camera_frame_cb_config_t pipe1_cb;
+    camera_frame_cb_config_t pipe2_cb;
     uint8_t device_ctrl_pipe;
     int current_frame_id;
+    uint64_t current_frame_pts_us;  // stamped at VSYNC with current_frame_id
     osThreadId_t camera_processId;
     camera_state_t state;
     PowerHandle pwr_handle;
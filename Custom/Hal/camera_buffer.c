@@ -0,0 +1,247 @@
+#include <stddef.h>
+#include "camera_buffer.h"
+
+static int ready_pop(camera_dq_t *dq, uint32_t *idx)
+{
+    if (dq->ready_count == 0) {
+        return -1;
+    }
+    *idx = dq->ready[dq->ready_head];
+    dq->ready_head = (dq->ready_head + 1) % CAMERA_BUFFER_MAX_NB;
+    dq->ready_count--;
+    return 0;
+}
+
+static int ready_push(camera_dq_t *dq, uint32_t idx)
+{
+    if (dq->ready_count == CAMERA_BUFFER_MAX_NB) {
+        return -1;
+    }
+    dq->ready[(dq->ready_head + dq->ready_count) % CAMERA_BUFFER_MAX_NB] = (uint8_t)idx;
+    dq->ready_count++;
+    return 0;
+}
+
+// drop stale and repeated entries, keeping the order of the rest
+static void ready_compact(pipe_buffer_t *bufs, int nb, camera_dq_t *dq)
+{
+    uint8_t keep[CAMERA_BUFFER_MAX_NB];
+    uint32_t seen = 0, count = 0, idx;
+
+    while (ready_pop(dq, &idx) == 0) {
+        if (idx < (uint32_t)nb && bufs[idx].state == BUFFER_READY && !(seen & (1u << idx))) {
+            seen |= 1u << idx;
+            keep[count++] = (uint8_t)idx;
+        }
+    }
+    dq->ready_head = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        ready_push(dq, keep[i]);
+    }
+}
+
+// entries can be stale if a ready buffer was returned without being taken
+static pipe_buffer_t* ready_pop_valid(pipe_buffer_t *bufs, int nb, camera_dq_t *dq)
+{
+    uint32_t idx;
+    while (ready_pop(dq, &idx) == 0) {
+        if (idx < (uint32_t)nb && bufs[idx].state == BUFFER_READY) {
+            return &bufs[idx];
+        }
+    }
+    return NULL;
+}
+
+static pipe_buffer_t* acquire_idle(pipe_buffer_t *bufs, int nb)
+{
+    for (int i = 0; i < nb; i++) {
+        if (bufs[i].state == BUFFER_IDLE) {
+            bufs[i].state = BUFFER_PROCESSING;
+            return &bufs[i];
+        }
+    }
+    return NULL;
+}
+
+static void deliver(camera_dq_t *dq, pipe_buffer_t *buf)
+{
+    uint32_t age = dq->last_frame_id - buf->frame_id;
+
+    buf->state = BUFFER_IN_USE;
+    dq->stats.delivered++;
+    dq->stats.age_sum += age;
+    if (age > dq->stats.age_max) {
+        dq->stats.age_max = age;
+    }
+}
+
+void buffer_reset(pipe_buffer_t *bufs, int nb, camera_dq_t *dq)
+{
+    for (int i = 0; i < nb; ++i) {
+        bufs[i].state = BUFFER_IDLE;
+        bufs[i].frame_id = 0;
+        bufs[i].pts_us = 0;
+    }
+    dq->ready_head = 0;
+    dq->ready_count = 0;
+    dq->stalled = 0;
+}
+
+pipe_buffer_t* buffer_acquire(pipe_buffer_t *bufs, int nb, camera_dq_t *dq)
+{
+    pipe_buffer_t *buf = acquire_idle(bufs, nb);
+    if (buf == NULL && dq->policy == CAMERA_BUFFER_DROP_OLDEST) {
+        buf = ready_pop_valid(bufs, nb, dq);
+        if (buf != NULL) {
+            buf->state = BUFFER_PROCESSING;
+            dq->stats.dropped++;
+        }
+    }
+    return buf;
+}
+
+pipe_buffer_t* find_processing_buffer(pipe_buffer_t *bufs, int nb)
+{
+    for (int i = 0; i < nb; ++i) {
+        if (bufs[i].state == BUFFER_PROCESSING) {
+            return &bufs[i];
+        }
+    }
+    return NULL;
+}
+
+/*
+ * A single buffer (nb == 1, including an external one) is never rotated: the
+ * hardware keeps writing into it and every frame end republishes it, as the
+ * pipes did before policies existed. The policy does not apply.
+ */
+static pipe_buffer_t* frame_done_in_place(pipe_buffer_t *bufs, camera_dq_t *dq)
+{
+    pipe_buffer_t *buf = &bufs[0];
+
+    dq->stats.frames++;
+    if (buf->state == BUFFER_IN_USE) {
+        // the consumer still holds the previous frame, it is being overwritten anyway
+        dq->stats.dropped++;
+        return buf;
+    }
+    if (buf->state == BUFFER_READY) {
+        dq->stats.dropped++;
+    }
+    dq->ready_head = 0;
+    dq->ready_count = 0;
+    buffer_set_ready_isr(bufs, 1, dq, buf);
+    return buf;
+}
+
+pipe_buffer_t* buffer_frame_done_isr(pipe_buffer_t *bufs, int nb, camera_dq_t *dq, uint32_t frame_id, uint64_t pts_us)
+{
+    pipe_buffer_t *done = find_processing_buffer(bufs, nb);
+    pipe_buffer_t *next;
+
+    dq->last_frame_id = frame_id;
+    dq->last_pts_us = pts_us;
+    if (nb == 1) {
+        return frame_done_in_place(bufs, dq);
+    }
+    if (done == NULL) {
+        return buffer_acquire(bufs, nb, dq);
+    }
+    dq->stats.frames++;
+
+    next = acquire_idle(bufs, nb);
+    if (next == NULL) {
+        dq->stats.overruns++;
+        next = buffer_acquire(bufs, nb, dq);
+    }
+    if (next != NULL) {
+        buffer_set_ready_isr(bufs, nb, dq, done);
+        return next;
+    }
+
+    if (dq->policy == CAMERA_BUFFER_BLOCK) {
+        buffer_set_ready_isr(bufs, nb, dq, done);
+        dq->stalled = 1;
+        dq->stats.stalls++;
+        return NULL;
+    }
+
+    // nothing to recycle: the hardware writes over the frame just captured
+    dq->stats.dropped++;
+    return done;
+}
+
+int buffer_set_ready_isr(pipe_buffer_t *bufs, int nb, camera_dq_t *dq, pipe_buffer_t* buf)
+{
+    uint32_t idx = (uint32_t)(buf - bufs);
+
+    buf->state = BUFFER_READY;
+    buf->frame_id = dq->last_frame_id;
+    buf->pts_us = dq->last_pts_us;
+    if (ready_push(dq, idx) == 0) {
+        return 0;
+    }
+
+    // queue full of stale entries: squeeze them out and retry
+    ready_compact(bufs, nb, dq);
+    if (ready_push(dq, idx) == 0) {
+        return 0;
+    }
+
+    // cannot be queued, so it could never be taken: give it back to capture
+    dq->stats.queue_overflows++;
+    dq->stats.dropped++;
+    buf->state = BUFFER_IDLE;
+    return -1;
+}
+
+void buffer_release_isr(pipe_buffer_t *buf, camera_dq_t *dq)
+{
+    (void)dq;
+    buf->state = BUFFER_IDLE;
+}
+
+pipe_buffer_t* buffer_resume_isr(pipe_buffer_t *bufs, int nb, camera_dq_t *dq)
+{
+    pipe_buffer_t *buf;
+    if (!dq->stalled) {
+        return NULL;
+    }
+    buf = acquire_idle(bufs, nb);
+    if (buf != NULL) {
+        dq->stalled = 0;
+    }
+    return buf;
+}
+
+pipe_buffer_t* buffer_take_ready(pipe_buffer_t *bufs, int nb, camera_dq_t *dq)
+{
+    pipe_buffer_t *latest = NULL, *buf;
+
+    if (dq->policy != CAMERA_BUFFER_DROP_OLDEST) {
+        latest = ready_pop_valid(bufs, nb, dq);
+        if (latest) {
+            deliver(dq, latest);
+        }
+        return latest;
+    }
+
+    while ((buf = ready_pop_valid(bufs, nb, dq)) != NULL) {
+        if (latest == NULL || buf->frame_id > latest->frame_id) {
+            // for old buffers, release them
+            if (latest) {
+                buffer_release_isr(latest, dq);
+                dq->stats.dropped++;
+            }
+            latest = buf;
+        } else {
+            buffer_release_isr(buf, dq);
+            dq->stats.dropped++;
+        }
+    }
+
+    if (latest) {
+        deliver(dq, latest);
+    }
+    return latest;
+}
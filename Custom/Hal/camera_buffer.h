@@ -0,0 +1,96 @@
+#ifndef _CAMERA_BUFFER_H
+#define _CAMERA_BUFFER_H
+
+#include <stdint.h>
+
+/*
+ * Capture buffer state machine shared by the DCMIPP pipes.
+ *
+ *   IDLE -> PROCESSING (handed to DCMIPP) -> READY (frame complete)
+ *        -> IN_USE (owned by a consumer) -> IDLE (returned)
+ *
+ * The module only keeps the bookkeeping and has no RTOS or HAL dependency.
+ * The frame event side runs in interrupt context, so callers on the thread
+ * side must keep that interrupt masked around each call.
+ */
+
+#define CAMERA_BUFFER_MAX_NB 8
+
+typedef enum {
+    BUFFER_IDLE = 0,      // Idle
+    BUFFER_PROCESSING,    // Processing
+    BUFFER_READY,         // Ready
+    BUFFER_IN_USE         // In use
+} BUFFER_STATE_E;
+
+/* What to do when a frame completes and no idle buffer is left */
+typedef enum {
+    CAMERA_BUFFER_DROP_OLDEST = 0,  // recycle the oldest ready frame, consumers get the newest
+    CAMERA_BUFFER_DROP_NEWEST,      // overwrite the frame just captured, consumers get frames in order
+    CAMERA_BUFFER_BLOCK,            // stall capture until a buffer is returned, consumers get frames in order
+} camera_buffer_policy_t;
+
+typedef struct {
+    uint8_t* data;
+    BUFFER_STATE_E state;
+    uint32_t frame_id;
+    uint64_t pts_us;        // capture time (frame start), set with frame_id
+} pipe_buffer_t;
+
+typedef struct {
+    uint32_t frames;        // frames completed by the hardware
+    uint32_t delivered;     // frames handed to consumers
+    uint32_t overruns;      // frame ends with no idle buffer left
+    uint32_t dropped;       // completed frames never delivered
+    uint32_t stalls;        // capture stalls (BLOCK policy)
+    uint32_t queue_overflows; // ready frames that did not fit the ready queue
+    uint32_t age_max;       // max frames between capture and hand off
+    uint64_t age_sum;       // sum of hand off ages, divide by delivered
+} camera_buffer_stats_t;
+
+typedef struct {
+    uint8_t ready[CAMERA_BUFFER_MAX_NB];    // ready buffer indexes, oldest first
+    uint8_t ready_head;
+    uint8_t ready_count;
+    uint8_t stalled;
+    camera_buffer_policy_t policy;
+    uint32_t last_frame_id;
+    uint64_t last_pts_us;
+    camera_buffer_stats_t stats;
+} camera_dq_t;
+
+void buffer_reset(pipe_buffer_t *bufs, int nb, camera_dq_t *dq);
+
+/* Next buffer for the hardware: an idle one, or the oldest ready one under DROP_OLDEST */
+pipe_buffer_t* buffer_acquire(pipe_buffer_t *bufs, int nb, camera_dq_t *dq);
+
+pipe_buffer_t* find_processing_buffer(pipe_buffer_t *bufs, int nb);
+
+/*
+ * Frame end: publish the in-flight buffer according to the policy and
+ * return the buffer the hardware must write next. NULL means the pipe has
+ * to be stalled until buffer_resume_isr() returns a buffer.
+ */
+pipe_buffer_t* buffer_frame_done_isr(pipe_buffer_t *bufs, int nb, camera_dq_t *dq, uint32_t frame_id, uint64_t pts_us);
+
+/* Mark a buffer READY with the last frame end's id and time and queue it, -1 (buffer back to IDLE) if the ready queue overflows */
+int buffer_set_ready_isr(pipe_buffer_t *bufs, int nb, camera_dq_t *dq, pipe_buffer_t* buf);
+
+void buffer_release_isr(pipe_buffer_t *buf, camera_dq_t *dq);
+
+/* Buffer to restart a stalled pipe with, NULL if not stalled or still no idle buffer */
+pipe_buffer_t* buffer_resume_isr(pipe_buffer_t *bufs, int nb, camera_dq_t *dq);
+
+/*
+ * Hand a ready buffer to a consumer (IN_USE): the newest one under
+ * DROP_OLDEST, older ready buffers are then released; the oldest one
+ * otherwise.
+ */
+pipe_buffer_t* buffer_take_ready(pipe_buffer_t *bufs, int nb, camera_dq_t *dq);
+
+static inline int buffer_ready_count(const camera_dq_t *dq)
+{
+    return dq->ready_count;
+}
+
+#endif
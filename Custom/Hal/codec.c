@@ -499,6 +499,11 @@ static void recordProcess(void *argument)
                 codec->record_state = CODEC_IDLE;
                 continue;
             }
+            // The final size is known from the duration, reserve it up front so the card
+            // does not allocate clusters while audio is streaming in (optional, SD only)
+            if (codec->record_time > 0) {
+                file_fallocate(codec->record_fd, 44 + (uint64_t)codec->record_time * 16000 * 2 * 2);
+            }
             file_fwrite(codec->record_fd, wav_header, 44);
             codec->record_total_bytes = 0;
             codec->record_stop_flag = false;
@@ -37,7 +37,7 @@ static JpegEncIn   jpegEncIn= {0};
 static JpegEncOut  jpegEncOut= {0};
 #endif
 
-static uint8_t venc_out_buffer[VENC_OUT_BUFFER_SIZE] ALIGN_32 IN_PSRAM;
+static uint8_t venc_out_buffer[ENC_OUT_BUFFER_NB][VENC_OUT_BUFFER_SIZE] ALIGN_32 IN_PSRAM;
 
 static enc_t g_enc = {0};
 
@@ -53,6 +53,7 @@ static struct VENC_Context {
     int is_sps_pps_done;
     uint64_t pic_cnt;
     int gop_len;
+    uint64_t last_pts_us;       // capture time of the previous frame, 0 = unknown
 } VENC_Instance;
 
 #if !USE_H264_VENC
@@ -266,8 +267,26 @@ static int VENC_H264_EncodeStart(struct VENC_Context *p_ctx, uint8_t *p_out, siz
     return 0;
 }
 
+/**
+ * @brief time since the previous frame in frame periods, from the capture times
+ * @details frames dropped before the encoder then still count for rate control
+ *          and the stream timing, a gap is capped at one second
+ */
+static u32 VENC_H264_TimeIncrement(struct VENC_Context *p_ctx, uint64_t pts_us, int fps)
+{
+    u32 time_inc = 1;
+
+    if (pts_us != 0 && p_ctx->last_pts_us != 0 && pts_us > p_ctx->last_pts_us && fps > 0) {
+        uint64_t period_us = 1000000 / fps;
+        uint64_t periods = (pts_us - p_ctx->last_pts_us + period_us / 2) / period_us;
+        time_inc = (periods == 0) ? 1 : (periods > (uint64_t)fps) ? (u32)fps : (u32)periods;
+    }
+    p_ctx->last_pts_us = pts_us;
+    return time_inc;
+}
+
 static int VENC_H264_EncodeFrame(struct VENC_Context *p_ctx, uint8_t *p_in, uint8_t *p_out, size_t out_len,
-                            size_t *p_out_len, int is_intra_force, H264EncOut *p_enc_out)
+                            size_t *p_out_len, int is_intra_force, u32 time_inc, H264EncOut *p_enc_out)
 {
     H264EncIn enc_in;
     int ret;
@@ -279,12 +298,15 @@ static int VENC_H264_EncodeFrame(struct VENC_Context *p_ctx, uint8_t *p_in, uint
     enc_in.pOutBuf = (u32 *) p_out;
     enc_in.busOutBuf = (ptr_t) p_out;
     enc_in.outBufSize = out_len;
+    if (is_intra_force) {
+        // restart the GOP so the next periodic IDR is a full GOP away
+        p_ctx->pic_cnt = 0;
+    }
     enc_in.codingType = (p_ctx->pic_cnt % (p_ctx->gop_len + 1) == 0) ? H264ENC_INTRA_FRAME : H264ENC_PREDICTED_FRAME;
-    enc_in.codingType = is_intra_force ? H264ENC_INTRA_FRAME : enc_in.codingType;
     if(enc_in.codingType == H264ENC_INTRA_FRAME){
         enc_in.timeIncrement = 0;
     }else{
-        enc_in.timeIncrement = 1;
+        enc_in.timeIncrement = time_inc;
     }
     enc_in.ipf = H264ENC_REFERENCE_AND_REFRESH; /* FIXME : can be H264ENC_NO_REFERENCE_NO_REFRESH in I only mode */
     enc_in.ltrf = H264ENC_REFERENCE;
@@ -301,6 +323,80 @@ static int VENC_H264_EncodeFrame(struct VENC_Context *p_ctx, uint8_t *p_in, uint
     return 0;
 }
 
+/**
+ * @brief push pending ROI config/map to the encoder, called with hw_mtx held
+ */
+static void VENC_H264_ApplyRoi(enc_t *enc)
+{
+    struct VENC_Context *p_ctx = &VENC_Instance;
+    H264EncCodingCtrl ctrl;
+    int ret;
+
+    osMutexAcquire(enc->state_mtx, osWaitForever);
+    if (enc->roi_map == NULL || (!enc->roi_cfg_dirty && !enc->roi_map_dirty)) {
+        osMutexRelease(enc->state_mtx);
+        return;
+    }
+
+    if (enc->roi_cfg_dirty) {
+        if (!enc->roi_cfg.enable) {
+            // leave a neutral map behind, the segment map stays enabled in hardware
+            memset(enc->roi_map, ENC_ROI_SEG_NONE, enc->roi_mb_total);
+            H264EncSetRoiMap(p_ctx->hdl, enc->roi_map);
+        }
+        ret = H264EncGetCodingCtrl(p_ctx->hdl, &ctrl);
+        if (ret == H264ENC_OK) {
+            ctrl.roiMapEnable = enc->roi_cfg.enable ? 1 : 0;
+            ctrl.qpOffset[0] = enc->roi_cfg.roi_qp_offset;
+            ctrl.qpOffset[1] = enc->roi_cfg.margin_qp_offset;
+            ctrl.qpOffset[2] = enc->roi_cfg.background_qp_offset;
+            ret = H264EncSetCodingCtrl(p_ctx->hdl, &ctrl);
+        }
+        if (ret != H264ENC_OK) {
+            LOG_DRV_ERROR("ROI coding ctrl failed: %d\r\n", ret);
+        }
+        enc->roi_cfg_dirty = 0;
+    }
+
+    if (enc->roi_map_dirty && enc->roi_cfg.enable) {
+        H264EncSetRoiMap(p_ctx->hdl, enc->roi_map);
+    }
+    enc->roi_map_dirty = 0;
+    osMutexRelease(enc->state_mtx);
+}
+
+/**
+ * @brief push a pending VBR target to the encoder, called with hw_mtx held
+ */
+static void VENC_H264_ApplyBitrate(enc_t *enc)
+{
+    struct VENC_Context *p_ctx = &VENC_Instance;
+    H264EncRateCtrl rate;
+    uint32_t bitrate;
+    int ret;
+
+    osMutexAcquire(enc->state_mtx, osWaitForever);
+    if (!enc->bitrate_dirty) {
+        osMutexRelease(enc->state_mtx);
+        return;
+    }
+    bitrate = enc->bitrate;
+    enc->bitrate_dirty = 0;
+    osMutexRelease(enc->state_mtx);
+
+    if (enc->params.rate_ctrl_mode != VENC_RATE_CTRL_VBR)
+        return;
+
+    ret = H264EncGetRateCtrl(p_ctx->hdl, &rate);
+    if (ret == H264ENC_OK) {
+        rate.bitPerSecond = bitrate;
+        ret = H264EncSetRateCtrl(p_ctx->hdl, &rate);
+    }
+    if (ret != H264ENC_OK) {
+        LOG_DRV_ERROR("set bitrate %lu failed: %d\r\n", (unsigned long)bitrate, ret);
+    }
+}
+
 static int VENC_H264_Encode(enc_t *enc)
 {
     struct VENC_Context *p_ctx = &VENC_Instance;
@@ -318,7 +414,8 @@ static int VENC_H264_Encode(enc_t *enc)
     }
 
     p_out += start_len;
-    ret = VENC_H264_EncodeFrame(p_ctx, enc->in_buffer, p_out, VENC_OUT_BUFFER_SIZE - start_len, &frame_len, enc->is_intra_force, &enc->out_frame.frame_info);
+    u32 time_inc = VENC_H264_TimeIncrement(p_ctx, enc->in_pts_us, enc->params.fps);
+    ret = VENC_H264_EncodeFrame(p_ctx, enc->in_buffer, p_out, VENC_OUT_BUFFER_SIZE - start_len, &frame_len, enc->is_intra_force, time_inc, &enc->out_frame.frame_info);
     if (ret)
         return ret;
 
@@ -382,7 +479,11 @@ static int ENC_H264_Init(enc_t *enc)
     if(ret != H264ENC_OK){
         return ret;
     }
-    target_bitrate = ((enc->params.width * enc->params.height * 2) * enc->params.fps) / 30;
+    if (enc->bitrate == 0) {
+        enc->bitrate = VENC_DEFAULT_BITRATE(enc->params.width, enc->params.height, enc->params.fps);
+    }
+    enc->bitrate_dirty = 0;
+    target_bitrate = enc->bitrate;
     if (enc->params.rate_ctrl_mode == VENC_RATE_CTRL_QP_CONSTANT)
     {
         VENC_H264_SetupConstantQp(&rate, enc->params.rate_ctrl_dq);
@@ -453,10 +554,10 @@ uint8_t * ENC_Jpeg_EncodeFrame(uint8_t *p_in, int *out_len)
 {
     int ret;
 
-    ret = encode_jpeg_frame(p_in, venc_out_buffer, VENC_OUT_BUFFER_SIZE);
+    ret = encode_jpeg_frame(p_in, venc_out_buffer[0], VENC_OUT_BUFFER_SIZE);
     if(ret != 0){
         *out_len = ret;
-        return venc_out_buffer;
+        return venc_out_buffer[0];
     }else{
         *out_len = 0;
         return NULL;
@@ -466,8 +567,123 @@ uint8_t * ENC_Jpeg_EncodeFrame(uint8_t *p_in, int *out_len)
 
 #define EVT_ENC_DONE    (1 << 0)  // encoder done event
 #define EVT_ENC_ERROR   (1 << 1)  // encoder error event 
+#define EVT_ENC_OUT_FREE (1 << 2) // an output buffer came back from the consumer
+#define ENC_OUT_WAIT_MS 1000      // recheck period while the consumer holds every output
 
 
+/**
+ * @brief run one encode on enc->in_buffer into enc->out_frame, takes hw_mtx
+ */
+static int enc_encode_one(enc_t *enc)
+{
+    int encode_ret = 0;
+
+    /* long time encoding call: use hw_mtx to protect */
+    osMutexAcquire(enc->hw_mtx, osWaitForever);
+
+#if USE_H264_VENC
+    VENC_H264_ApplyBitrate(enc);
+    VENC_H264_ApplyRoi(enc);
+    encode_ret = VENC_H264_Encode(enc);
+#else
+    encode_ret = encode_jpeg_frame(enc->in_buffer,
+                                   enc->out_frame.frame_buffer + enc->out_frame.header_size,
+                                   VENC_OUT_BUFFER_SIZE - enc->out_frame.header_size);
+    if (encode_ret > 0) {
+        enc->out_frame.data_size = encode_ret;
+        encode_ret = 0; /* success */
+    } else {
+        encode_ret = -1; /* failed */
+    }
+#endif
+
+    osMutexRelease(enc->hw_mtx);
+    return encode_ret;
+}
+
+/**
+ * @brief find a free output buffer, called with state_mtx held
+ */
+static int enc_out_find_free(enc_t *enc)
+{
+    for (int i = 0; i < ENC_OUT_BUFFER_NB; i++) {
+        if (enc->out_owner[i] == ENC_OUT_FREE)
+            return i;
+    }
+    return -1;
+}
+
+/**
+ * @brief drain the async job queue, completions go to the done callback
+ */
+static void enc_process_jobs(enc_t *enc)
+{
+    while (enc->is_init) {
+        enc_job_t job;
+        enc_done_cb_t cb;
+        void *user_data;
+        int idx = -1;
+
+        osMutexAcquire(enc->state_mtx, osWaitForever);
+        if (enc->job_count == 0) {
+            osMutexRelease(enc->state_mtx);
+            return;
+        }
+        if (enc->state != ENC_STOP) {
+            idx = enc_out_find_free(enc);
+        }
+        if (idx < 0 && enc->state != ENC_STOP) {
+            /* the job keeps its place until the consumer returns an output */
+            osEventFlagsClear(enc->evt_flags, EVT_ENC_OUT_FREE);
+            osMutexRelease(enc->state_mtx);
+            osEventFlagsWait(enc->evt_flags, EVT_ENC_OUT_FREE, osFlagsWaitAny, ENC_OUT_WAIT_MS);
+            continue;
+        }
+        job = enc->jobs[enc->job_head];
+        enc->job_head = (enc->job_head + 1) % ENC_ASYNC_DEPTH;
+        enc->job_count--;
+        cb = enc->done_cb;
+        user_data = enc->done_cb_user_data;
+        if (idx >= 0) {
+            enc->out_owner[idx] = ENC_OUT_ENCODING;
+            enc->in_buffer = job.in_buffer;
+            enc->in_pts_us = job.pts_us;
+            enc->out_frame.frame_buffer = enc->out_bufs[idx];
+            enc->out_frame.data_size = 0;
+            if (enc->idr_request) {
+                enc->is_intra_force = 1;
+                enc->idr_request = 0;
+            }
+        }
+        osMutexRelease(enc->state_mtx);
+
+        if (idx < 0) {
+            if (cb) cb(NULL, AICAM_ERROR, job.ctx, user_data);
+            continue;
+        }
+
+        int encode_ret = enc_encode_one(enc);
+
+        osMutexAcquire(enc->state_mtx, osWaitForever);
+        enc->is_intra_force = (encode_ret != 0);
+        enc->in_buffer = NULL;
+        if (encode_ret == 0 && enc->out_frame.data_size > 0) {
+            /* ownership moves to the consumer until ENC_CMD_RELEASE_OUTPUT */
+            enc->out_frames[idx] = enc->out_frame;
+            enc->out_owner[idx] = ENC_OUT_CONSUMER;
+        } else {
+            enc->out_owner[idx] = ENC_OUT_FREE;
+            encode_ret = -1;
+        }
+        osMutexRelease(enc->state_mtx);
+
+        if (cb) {
+            cb(encode_ret == 0 ? &enc->out_frames[idx] : NULL,
+               encode_ret == 0 ? AICAM_OK : AICAM_ERROR, job.ctx, user_data);
+        }
+    }
+}
+
 /**
  * @brief encoder process thread
  */
@@ -488,12 +704,22 @@ static void encProcess(void *argument)
             break;
         }
 
+        /* async mode: jobs are queued by ENC_CMD_SUBMIT */
+        if (enc->done_cb != NULL) {
+            enc_process_jobs(enc);
+            continue;
+        }
+
         /* short lock: read and check if need to process */
         uint8_t *local_in = NULL;
         osMutexAcquire(enc->state_mtx, osWaitForever);
         if (enc->state == ENC_PROCESSING && enc->in_buffer != NULL && 
             enc->out_frame.frame_buffer != NULL) {
             local_in = enc->in_buffer;
+            if (enc->idr_request) {
+                enc->is_intra_force = 1;
+                enc->idr_request = 0;
+            }
         } else {
             LOG_DRV_WARN("[PROC T: %p] State=%d, skipping job.\r\n", tid, enc->state);
         }
@@ -506,25 +732,7 @@ static void encProcess(void *argument)
             continue;
         }
 
-        /* long time encoding call: use hw_mtx to protect */
-        int encode_ret = 0;
-        osMutexAcquire(enc->hw_mtx, osWaitForever);
-        
-#if USE_H264_VENC
-        encode_ret = VENC_H264_Encode(enc);
-#else
-        encode_ret = encode_jpeg_frame(local_in, 
-                                       enc->out_frame.frame_buffer + enc->out_frame.header_size,
-                                       VENC_OUT_BUFFER_SIZE - enc->out_frame.header_size);
-        if (encode_ret > 0) {
-            enc->out_frame.data_size = encode_ret;
-            encode_ret = 0; /* success */
-        } else {
-            encode_ret = -1; /* failed */
-        }
-#endif
-        
-        osMutexRelease(enc->hw_mtx);
+        int encode_ret = enc_encode_one(enc);
 
         /* update state and notify through event flags */
         osMutexAcquire(enc->state_mtx, osWaitForever);
@@ -563,6 +771,16 @@ static int enc_start(void *priv)
     }
     enc->state = ENC_IDLE;
     enc->is_intra_force = 1;
+#if USE_H264_VENC
+    enc->roi_mb_total = enc_roi_mb_count(enc->params.width, enc->params.height);
+    enc->roi_map = hal_mem_calloc_fast(enc->roi_mb_total, 1);
+    if (enc->roi_map == NULL) {
+        LOG_DRV_WARN("enc_start: no memory for ROI map, ROI disabled\r\n");
+    }
+    enc->roi_mb_count = 0;
+    enc->roi_cfg_dirty = 1;
+    enc->roi_map_dirty = 0;
+#endif
     osMutexRelease(enc->state_mtx);
 
     /* hardware initialization */
@@ -610,7 +828,12 @@ static int enc_stop(void *priv)
     osMutexRelease(enc->state_mtx);
 
     /* wake up the threads that are waiting for events */
-    osEventFlagsSet(enc->evt_flags, EVT_ENC_ERROR);
+    osEventFlagsSet(enc->evt_flags, EVT_ENC_ERROR | EVT_ENC_OUT_FREE);
+
+    /* queued async jobs complete with an error, the thread sees ENC_STOP */
+    if (enc->done_cb != NULL && enc->sem_work != NULL) {
+        osSemaphoreRelease(enc->sem_work);
+    }
 
     /* wait for hw_mtx to safely call DeInit */
     if (osMutexAcquire(enc->hw_mtx, 5000) != osOK) {
@@ -625,6 +848,13 @@ static int enc_stop(void *priv)
 #endif
     osMutexRelease(enc->hw_mtx);
 
+    osMutexAcquire(enc->state_mtx, osWaitForever);
+    if (enc->roi_map != NULL) {
+        hal_mem_free(enc->roi_map);
+        enc->roi_map = NULL;
+    }
+    osMutexRelease(enc->state_mtx);
+
     return AICAM_OK;
 }
 
@@ -657,6 +887,8 @@ static int enc_ioctl(void *priv, unsigned int cmd, unsigned char *ubuf, unsigned
             }
             osMutexAcquire(enc->state_mtx, osWaitForever);
             memcpy(&enc->params, ubuf, sizeof(enc_param_t));
+            // format may have changed, the default target follows it on the next start
+            enc->bitrate = 0;
             osMutexRelease(enc->state_mtx);
             ret = AICAM_OK;
             break;
@@ -678,6 +910,12 @@ static int enc_ioctl(void *priv, unsigned int cmd, unsigned char *ubuf, unsigned
                 break;
             }
             osMutexAcquire(enc->state_mtx, osWaitForever);
+            if (enc->done_cb != NULL) {
+                /* async mode owns the job path, use ENC_CMD_SUBMIT */
+                osMutexRelease(enc->state_mtx);
+                ret = AICAM_ERROR_NOT_SUPPORTED;
+                break;
+            }
             if (enc->state != ENC_IDLE && enc->state != ENC_COMPLETE) {
                 osMutexRelease(enc->state_mtx);
                 ret = AICAM_ERROR_BUSY;
@@ -688,6 +926,7 @@ static int enc_ioctl(void *priv, unsigned int cmd, unsigned char *ubuf, unsigned
             osEventFlagsClear(enc->evt_flags, EVT_ENC_DONE | EVT_ENC_ERROR);
             
             enc->in_buffer = ubuf;
+            enc->in_pts_us = 0;
             enc->state = ENC_PROCESSING;
             osMutexRelease(enc->state_mtx);
             
@@ -799,6 +1038,155 @@ static int enc_ioctl(void *priv, unsigned int cmd, unsigned char *ubuf, unsigned
             break;
         }
 
+        case ENC_CMD_SET_ROI_CONFIG: {
+            enc_roi_config_t *cfg = (enc_roi_config_t *)ubuf;
+            if (cfg == NULL || cfg->roi_qp_offset < -8 || cfg->roi_qp_offset > 7 ||
+                cfg->margin_qp_offset < -30 || cfg->margin_qp_offset > 30 ||
+                cfg->background_qp_offset < -30 || cfg->background_qp_offset > 30) {
+                ret = AICAM_ERROR_INVALID_PARAM;
+                break;
+            }
+            osMutexAcquire(enc->state_mtx, osWaitForever);
+            enc->roi_cfg = *cfg;
+            enc->roi_cfg_dirty = 1;
+            osMutexRelease(enc->state_mtx);
+            ret = AICAM_OK;
+            break;
+        }
+
+        case ENC_CMD_GET_ROI_CONFIG:
+            if (ubuf == NULL) {
+                ret = AICAM_ERROR_INVALID_PARAM;
+                break;
+            }
+            osMutexAcquire(enc->state_mtx, osWaitForever);
+            memcpy(ubuf, &enc->roi_cfg, sizeof(enc_roi_config_t));
+            osMutexRelease(enc->state_mtx);
+            ret = AICAM_OK;
+            break;
+
+        case ENC_CMD_SET_ROI_BOXES:
+            if (ubuf == NULL && arg != 0) {
+                ret = AICAM_ERROR_INVALID_PARAM;
+                break;
+            }
+            osMutexAcquire(enc->state_mtx, osWaitForever);
+            if (enc->roi_map == NULL || !enc->roi_cfg.enable) {
+                osMutexRelease(enc->state_mtx);
+                ret = AICAM_ERROR_NOT_SUPPORTED;
+                break;
+            }
+            enc->roi_mb_count = enc_roi_build_map((const enc_roi_box_t *)ubuf, (uint32_t)arg, &enc->roi_cfg,
+                                                  (enc->params.width + ENC_ROI_MB_SIZE - 1) / ENC_ROI_MB_SIZE,
+                                                  (enc->params.height + ENC_ROI_MB_SIZE - 1) / ENC_ROI_MB_SIZE,
+                                                  enc->roi_map);
+            enc->roi_map_dirty = 1;
+            osMutexRelease(enc->state_mtx);
+            ret = (int)enc->roi_mb_count;
+            break;
+
+        case ENC_CMD_SET_BITRATE:
+            if (arg < VENC_MIN_BITRATE || arg > VENC_MAX_BITRATE) {
+                ret = AICAM_ERROR_INVALID_PARAM;
+                break;
+            }
+            osMutexAcquire(enc->state_mtx, osWaitForever);
+            if (enc->params.rate_ctrl_mode != VENC_RATE_CTRL_VBR) {
+                osMutexRelease(enc->state_mtx);
+                ret = AICAM_ERROR_NOT_SUPPORTED;
+                break;
+            }
+            if (enc->bitrate != (uint32_t)arg) {
+                enc->bitrate = (uint32_t)arg;
+                // only live encoders need the hardware update, a stopped one picks it up at start
+                enc->bitrate_dirty = (enc->state != ENC_STOP);
+            }
+            osMutexRelease(enc->state_mtx);
+            ret = AICAM_OK;
+            break;
+
+        case ENC_CMD_GET_BITRATE:
+            if (ubuf == NULL) {
+                ret = AICAM_ERROR_INVALID_PARAM;
+                break;
+            }
+            osMutexAcquire(enc->state_mtx, osWaitForever);
+            *(uint32_t *)ubuf = enc->bitrate ? enc->bitrate :
+                VENC_DEFAULT_BITRATE(enc->params.width, enc->params.height, enc->params.fps);
+            osMutexRelease(enc->state_mtx);
+            ret = AICAM_OK;
+            break;
+
+        case ENC_CMD_FORCE_IDR:
+            osMutexAcquire(enc->state_mtx, osWaitForever);
+            enc->idr_request = 1;
+            osMutexRelease(enc->state_mtx);
+            ret = AICAM_OK;
+            break;
+
+        case ENC_CMD_SET_DONE_CALLBACK: {
+            enc_done_cb_config_t *cb_cfg = (enc_done_cb_config_t *)ubuf;
+            osMutexAcquire(enc->state_mtx, osWaitForever);
+            if (enc->job_count != 0 || enc->state == ENC_PROCESSING) {
+                osMutexRelease(enc->state_mtx);
+                ret = AICAM_ERROR_BUSY;
+                break;
+            }
+            enc->done_cb = cb_cfg ? cb_cfg->cb : NULL;
+            enc->done_cb_user_data = cb_cfg ? cb_cfg->user_data : NULL;
+            if (enc->done_cb == NULL) {
+                /* back to the synchronous single buffer path */
+                enc->out_frame.frame_buffer = enc->out_bufs[0];
+            }
+            osMutexRelease(enc->state_mtx);
+            ret = AICAM_OK;
+            break;
+        }
+
+        case ENC_CMD_SUBMIT: {
+            enc_job_t *job = (enc_job_t *)ubuf;
+            if (job == NULL || job->in_buffer == NULL ||
+                job->size != enc->params.width * enc->params.height * enc->params.bpp) {
+                ret = AICAM_ERROR_INVALID_PARAM;
+                break;
+            }
+            osMutexAcquire(enc->state_mtx, osWaitForever);
+            if (enc->done_cb == NULL || enc->state == ENC_STOP) {
+                osMutexRelease(enc->state_mtx);
+                ret = AICAM_ERROR_NOT_SUPPORTED;
+                break;
+            }
+            /* output buffers are taken when a job starts, not here */
+            if (enc->job_count >= ENC_ASYNC_DEPTH) {
+                osMutexRelease(enc->state_mtx);
+                ret = AICAM_ERROR_BUSY;
+                break;
+            }
+            enc->jobs[(enc->job_head + enc->job_count) % ENC_ASYNC_DEPTH] = *job;
+            enc->job_count++;
+            osMutexRelease(enc->state_mtx);
+
+            osSemaphoreRelease(enc->sem_work);
+            ret = AICAM_OK;
+            break;
+        }
+
+        case ENC_CMD_RELEASE_OUTPUT:
+            ret = AICAM_ERROR_INVALID_PARAM;
+            osMutexAcquire(enc->state_mtx, osWaitForever);
+            for (int i = 0; i < ENC_OUT_BUFFER_NB; i++) {
+                if (enc->out_bufs[i] == ubuf && enc->out_owner[i] == ENC_OUT_CONSUMER) {
+                    enc->out_owner[i] = ENC_OUT_FREE;
+                    ret = AICAM_OK;
+                    break;
+                }
+            }
+            osMutexRelease(enc->state_mtx);
+            if (ret == AICAM_OK) {
+                osEventFlagsSet(enc->evt_flags, EVT_ENC_OUT_FREE);
+            }
+            break;
+
         default:
             ret = AICAM_ERROR_NOT_SUPPORTED;
             break;
@@ -843,11 +1231,19 @@ static int enc_init(void *priv)
     enc->params.bpp = VENC_DEFAULT_BPP;
     enc->params.rate_ctrl_mode = VENC_RATE_CTRL_VBR;
     enc->params.rate_ctrl_dq = VENC_DEFAULT_RATE_CTRL_QP;
+    enc_roi_get_default_config(&enc->roi_cfg);
 
     enc->in_buffer = NULL;
-    enc->out_frame.frame_buffer = venc_out_buffer;
+    enc->out_frame.frame_buffer = venc_out_buffer[0];
     enc->out_frame.header_size = ENC_FRAME_HEADER_SIZE;
     enc->out_frame.data_size = 0;
+    for (int i = 0; i < ENC_OUT_BUFFER_NB; i++) {
+        enc->out_bufs[i] = venc_out_buffer[i];
+        enc->out_owner[i] = ENC_OUT_FREE;
+    }
+    enc->done_cb = NULL;
+    enc->job_head = 0;
+    enc->job_count = 0;
 
     osMutexAcquire(enc->state_mtx, osWaitForever);
     enc->state = ENC_STOP;
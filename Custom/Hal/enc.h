@@ -8,6 +8,7 @@
 #include "aicam_error.h"
 #include "h264encapi.h"
 #include "jpegencapi.h"
+#include "enc_roi.h"
 
 #define USE_H264_VENC  1
 
@@ -24,9 +25,22 @@
 #define VENC_DEFAULT_BPP 2
 #endif
 #define VENC_DEFAULT_RATE_CTRL_QP 25
+#define VENC_DEFAULT_BITRATE(w, h, fps) ((uint32_t)(((w) * (h) * 2) * (fps)) / 30)
+#define VENC_MIN_BITRATE 10000
+#define VENC_MAX_BITRATE 60000000
 #define VENC_OUT_BUFFER_SIZE (292 * 1024)
 
 #define ENC_FRAME_HEADER_SIZE (1*64)
+/*
+ * A queued job takes an output buffer only when it starts encoding and
+ * waits for ENC_CMD_RELEASE_OUTPUT if the consumer still holds them all,
+ * so the next frame can be queued while one encodes. The video node
+ * releases the output inside the done callback, one buffer is enough for
+ * it. A second frame in flight needs a spare pipe1 capture buffer (see
+ * CAM_CMD_SET_PIPE1_BUFFER_CONFIG), the DCMIPP always writes into one.
+ */
+#define ENC_OUT_BUFFER_NB 1    // encoding, then held by the consumer until released
+#define ENC_ASYNC_DEPTH 2      // jobs accepted by ENC_CMD_SUBMIT: one encoding, one queued
 enum {
     VENC_RATE_CTRL_QP_CONSTANT,
     VENC_RATE_CTRL_VBR,
@@ -39,6 +53,15 @@ typedef enum {
     ENC_CMD_INPUT_BUFFER,
     ENC_CMD_OUTPUT_BUFFER,
     ENC_CMD_OUTPUT_FRAME,
+    ENC_CMD_SET_ROI_CONFIG,     // ubuf: enc_roi_config_t*, applied from the next frame
+    ENC_CMD_GET_ROI_CONFIG,     // ubuf: enc_roi_config_t*
+    ENC_CMD_SET_ROI_BOXES,      // ubuf: enc_roi_box_t*, arg: box count, for the next frame
+    ENC_CMD_SET_BITRATE,        // arg: bits per second, VBR only, applied from the next frame
+    ENC_CMD_GET_BITRATE,        // ubuf: uint32_t* current target in bits per second
+    ENC_CMD_FORCE_IDR,          // next frame is coded as IDR and restarts the GOP
+    ENC_CMD_SET_DONE_CALLBACK,  // ubuf: enc_done_cb_config_t*, non NULL callback selects async mode
+    ENC_CMD_SUBMIT,             // ubuf: enc_job_t*, async mode only, BUSY when the queue is full
+    ENC_CMD_RELEASE_OUTPUT,     // ubuf: frame_buffer of a frame handed to the done callback
 } ENC_CMD_E;
 
 typedef enum {
@@ -54,6 +77,33 @@ typedef struct {
     uint32_t header_size;
     uint32_t data_size;//venc size
 } enc_out_frame_t;
+
+/**
+ * @brief async completion, called from the encoder thread
+ * @param frame encoded frame owned by the callee until ENC_CMD_RELEASE_OUTPUT, NULL on error
+ * @param status AICAM_OK or error, the job input buffer is no longer used either way
+ * @param ctx job context given to ENC_CMD_SUBMIT
+ */
+typedef void (*enc_done_cb_t)(enc_out_frame_t *frame, int status, void *ctx, void *user_data);
+
+typedef struct {
+    enc_done_cb_t cb;
+    void *user_data;
+} enc_done_cb_config_t;
+
+typedef struct {
+    uint8_t *in_buffer;     // must stay valid until the done callback
+    uint32_t size;
+    uint64_t pts_us;        // capture time, sets the H.264 time increment, 0 = one frame period
+    void *ctx;
+} enc_job_t;
+
+typedef enum {
+    ENC_OUT_FREE = 0,
+    ENC_OUT_ENCODING,
+    ENC_OUT_CONSUMER,
+} ENC_OUT_OWNER_E;
+
 typedef struct {
     int width;
     int height;
@@ -76,8 +126,26 @@ typedef struct {
     osEventFlagsId_t evt_flags;  
     enc_param_t params;
     uint8_t *in_buffer;
+    uint64_t in_pts_us;         // capture time of in_buffer, 0 = unknown
     enc_out_frame_t out_frame;
     int is_intra_force;
+    uint8_t idr_request;        // IDR asked for by a client, picked up with the next job
+    uint32_t bitrate;           // VBR target in bits per second, 0 = default for the format
+    uint8_t bitrate_dirty;
+    enc_roi_config_t roi_cfg;
+    uint8_t *roi_map;           // segment per macroblock, see enc_roi.h
+    uint32_t roi_mb_total;
+    uint32_t roi_mb_count;      // macroblocks in detections for the pending map
+    uint8_t roi_cfg_dirty;
+    uint8_t roi_map_dirty;
+    enc_done_cb_t done_cb;      // async mode when set
+    void *done_cb_user_data;
+    enc_job_t jobs[ENC_ASYNC_DEPTH];
+    uint8_t job_head;
+    uint8_t job_count;
+    uint8_t *out_bufs[ENC_OUT_BUFFER_NB];
+    enc_out_frame_t out_frames[ENC_OUT_BUFFER_NB];
+    uint8_t out_owner[ENC_OUT_BUFFER_NB];   // ENC_OUT_OWNER_E
 } enc_t;
 
 int enc_register(void);
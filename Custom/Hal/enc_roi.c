@@ -0,0 +1,93 @@
+#include <string.h>
+#include "enc_roi.h"
+
+typedef struct {
+    int x0, y0, x1, y1;     // macroblock rectangle, end exclusive
+} roi_rect_t;
+
+static int clamp_int(int v, int lo, int hi)
+{
+    return v < lo ? lo : (v > hi ? hi : v);
+}
+
+static int ceil_int(float v)
+{
+    int i = (int)v;
+    return ((float)i < v) ? i + 1 : i;
+}
+
+static int box_to_rect(const enc_roi_box_t *box, uint32_t mb_width, uint32_t mb_height, roi_rect_t *rect)
+{
+    float x0 = box->x * (float)mb_width;
+    float y0 = box->y * (float)mb_height;
+    float x1 = (box->x + box->width) * (float)mb_width;
+    float y1 = (box->y + box->height) * (float)mb_height;
+
+    // cover every macroblock the box touches
+    rect->x0 = clamp_int((int)x0, 0, (int)mb_width);
+    rect->y0 = clamp_int((int)y0, 0, (int)mb_height);
+    rect->x1 = clamp_int(ceil_int(x1), 0, (int)mb_width);
+    rect->y1 = clamp_int(ceil_int(y1), 0, (int)mb_height);
+    return rect->x0 < rect->x1 && rect->y0 < rect->y1;
+}
+
+static void fill_rect(uint8_t *map, uint32_t mb_width, const roi_rect_t *rect, uint8_t seg)
+{
+    for (int y = rect->y0; y < rect->y1; y++) {
+        memset(&map[y * mb_width + rect->x0], seg, (size_t)(rect->x1 - rect->x0));
+    }
+}
+
+void enc_roi_get_default_config(enc_roi_config_t *cfg)
+{
+    if (!cfg) return;
+    cfg->enable = 0;
+    cfg->roi_qp_offset = -4;
+    cfg->margin_qp_offset = -2;
+    cfg->background_qp_offset = 4;
+    cfg->margin_mb = 1;
+    cfg->min_confidence = 0.3f;
+}
+
+uint32_t enc_roi_build_map(const enc_roi_box_t *boxes, uint32_t count, const enc_roi_config_t *cfg,
+                           uint32_t mb_width, uint32_t mb_height, uint8_t *map)
+{
+    roi_rect_t rects[ENC_ROI_MAX_BOXES];
+    roi_rect_t rect;
+    uint32_t nb_rects = 0;
+    uint32_t roi_mbs = 0;
+
+    if (!map || !cfg || mb_width == 0 || mb_height == 0) return 0;
+
+    if (count > ENC_ROI_MAX_BOXES) count = ENC_ROI_MAX_BOXES;
+    for (uint32_t i = 0; boxes && i < count; i++) {
+        if (boxes[i].conf < cfg->min_confidence) continue;
+        if (box_to_rect(&boxes[i], mb_width, mb_height, &rects[nb_rects])) {
+            nb_rects++;
+        }
+    }
+
+    if (nb_rects == 0) {
+        memset(map, ENC_ROI_SEG_NONE, mb_width * mb_height);
+        return 0;
+    }
+
+    memset(map, ENC_ROI_SEG_BACKGROUND, mb_width * mb_height);
+
+    // margins first so that overlapping boxes always win
+    for (uint32_t i = 0; cfg->margin_mb > 0 && i < nb_rects; i++) {
+        rect.x0 = clamp_int(rects[i].x0 - cfg->margin_mb, 0, (int)mb_width);
+        rect.y0 = clamp_int(rects[i].y0 - cfg->margin_mb, 0, (int)mb_height);
+        rect.x1 = clamp_int(rects[i].x1 + cfg->margin_mb, 0, (int)mb_width);
+        rect.y1 = clamp_int(rects[i].y1 + cfg->margin_mb, 0, (int)mb_height);
+        fill_rect(map, mb_width, &rect, ENC_ROI_SEG_MARGIN);
+    }
+    for (uint32_t i = 0; i < nb_rects; i++) {
+        fill_rect(map, mb_width, &rects[i], ENC_ROI_SEG_OBJECT);
+    }
+
+    for (uint32_t i = 0; i < mb_width * mb_height; i++) {
+        roi_mbs += (map[i] == ENC_ROI_SEG_OBJECT);
+    }
+    return roi_mbs;
+}
@@ -0,0 +1,57 @@
+#ifndef ENC_ROI_H
+#define ENC_ROI_H
+
+#include <stdint.h>
+
+/*
+ * Detection driven ROI map for the H.264 encoder. Every macroblock gets a
+ * segment index, the encoder applies the QP offset of that segment:
+ *   0 - no offset (no detections in the frame)
+ *   1 - inside a detection box
+ *   2 - margin ring around a box
+ *   3 - background
+ * Pure function of its inputs, no HAL or RTOS dependency.
+ */
+
+#define ENC_ROI_MB_SIZE         16
+#define ENC_ROI_MAX_BOXES       32
+
+#define ENC_ROI_SEG_NONE        0
+#define ENC_ROI_SEG_OBJECT      1
+#define ENC_ROI_SEG_MARGIN      2
+#define ENC_ROI_SEG_BACKGROUND  3
+
+typedef struct {
+    float x;            // top-left, normalized 0..1
+    float y;
+    float width;        // normalized 0..1
+    float height;
+    float conf;
+} enc_roi_box_t;
+
+typedef struct {
+    uint8_t enable;
+    int8_t roi_qp_offset;           // [-8..7] inside detections
+    int8_t margin_qp_offset;        // [-30..30] around detections
+    int8_t background_qp_offset;    // [-30..30] everything else
+    uint8_t margin_mb;              // margin width in macroblocks
+    float min_confidence;           // boxes below are ignored
+} enc_roi_config_t;
+
+void enc_roi_get_default_config(enc_roi_config_t *cfg);
+
+static inline uint32_t enc_roi_mb_count(int width, int height)
+{
+    return (uint32_t)((width + ENC_ROI_MB_SIZE - 1) / ENC_ROI_MB_SIZE) *
+           (uint32_t)((height + ENC_ROI_MB_SIZE - 1) / ENC_ROI_MB_SIZE);
+}
+
+/*
+ * Build a raster scan segment map of mb_width * mb_height entries.
+ * Returns the number of macroblocks in segment 1. With no usable box the
+ * map is all ENC_ROI_SEG_NONE and 0 is returned.
+ */
+uint32_t enc_roi_build_map(const enc_roi_box_t *boxes, uint32_t count, const enc_roi_config_t *cfg,
+                           uint32_t mb_width, uint32_t mb_height, uint8_t *map);
+
+#endif
@@ -6,11 +6,15 @@
 
 #include "common_utils.h"
 #include "generic_math.h"
+#include "generic_time.h"
 #include "debug.h"
 #include <assert.h>
 #include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
+#include <math.h>
+#include <float.h>
+#include <limits.h>
 #include "ll_aton_runtime.h"
 #include "ll_aton_reloc_network.h"
 #include "pp.h"
@@ -283,44 +287,119 @@ static int load_info(const uintptr_t file_ptr, nn_model_info_t *info)
     return 0;
 }
 
-static void update_inference_stats(uint32_t inference_time)
+/* ==================== model warm-start snapshot ==================== */
+
+#define NN_SNAPSHOT_NVS_KEY     "nn_snapshot"
+#define NN_SNAPSHOT_MAGIC       0x504E534E  // 'NSNP'
+#define NN_SNAPSHOT_VERSION     1
+
+// resolved load-time state of a model package, keyed by the package checksums
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t file_ptr;                  // package address the snapshot was taken from
+    uint32_t header_checksum;           // model hash: package header CRC32
+    uint32_t package_checksum;          // model hash: whole package CRC32
+    uint32_t rt_ram_copy;               // exec RAM size for COPY mode install
+    uint32_t ext_ram_sz;                // external RAM size for activations
+    nn_model_info_t model;              // parsed config and metadata
+    uint32_t crc;                       // CRC32 over the fields above
+} nn_model_snapshot_t;
+
+// RAM copy of the last snapshot, avoids the NVS read on reloads in the same session
+static nn_model_snapshot_t g_nn_snapshot = {0};
+
+static uint32_t snapshot_crc(const nn_model_snapshot_t *snap)
 {
-    g_nn.inference_count++;
-    g_nn.total_inference_time += inference_time;
+    return generic_crc32((const uint8_t *)snap, offsetof(nn_model_snapshot_t, crc));
 }
 
-static int model_init(const uintptr_t model_ptr, nn_t *nn)
+static bool snapshot_match(const nn_model_snapshot_t *snap, const uintptr_t file_ptr)
 {
-    if (!model_ptr) {
-        return -1;
+    const nn_package_header_t *header = (const nn_package_header_t *)file_ptr;
+
+    if (snap->magic != NN_SNAPSHOT_MAGIC || snap->version != NN_SNAPSHOT_VERSION) {
+        return false;
+    }
+    if (snap->crc != snapshot_crc(snap)) {
+        return false;
     }
+    return snap->file_ptr == (uint32_t)file_ptr &&
+           snap->header_checksum == header->header_checksum &&
+           snap->package_checksum == header->package_checksum;
+}
 
-    /* Print model information */
-    ll_aton_reloc_log_info(model_ptr);
+static int snapshot_restore(const uintptr_t file_ptr, nn_model_snapshot_t *snap)
+{
+    if (snapshot_match(&g_nn_snapshot, file_ptr)) {
+        memcpy(snap, &g_nn_snapshot, sizeof(nn_model_snapshot_t));
+        return 0;
+    }
 
-    /* Get model information */
-    ll_aton_reloc_info rt;
-    int res = ll_aton_reloc_get_info(model_ptr, &rt);
-    if (res != 0) {
-        LOG_DRV_ERROR("ll_aton_reloc_get_info failed %d\r\r\n", res);
+    int len = (int)storage_nvs_read(NVS_USER, NN_SNAPSHOT_NVS_KEY, snap, sizeof(nn_model_snapshot_t));
+    if (len != (int)sizeof(nn_model_snapshot_t) || !snapshot_match(snap, file_ptr)) {
         return -1;
     }
 
+    memcpy(&g_nn_snapshot, snap, sizeof(nn_model_snapshot_t));
+    return 0;
+}
+
+static void snapshot_save(const uintptr_t file_ptr, const nn_model_info_t *info,
+                          uint32_t rt_ram_copy, uint32_t ext_ram_sz)
+{
+    const nn_package_header_t *header = (const nn_package_header_t *)file_ptr;
+    nn_model_snapshot_t *snap = &g_nn_snapshot;
+
+    memset(snap, 0, sizeof(nn_model_snapshot_t));
+    snap->magic = NN_SNAPSHOT_MAGIC;
+    snap->version = NN_SNAPSHOT_VERSION;
+    snap->file_ptr = (uint32_t)file_ptr;
+    snap->header_checksum = header->header_checksum;
+    snap->package_checksum = header->package_checksum;
+    snap->rt_ram_copy = rt_ram_copy;
+    snap->ext_ram_sz = ext_ram_sz;
+    memcpy(&snap->model, info, sizeof(nn_model_info_t));
+    snap->crc = snapshot_crc(snap);
+
+    if ((int)storage_nvs_write(NVS_USER, NN_SNAPSHOT_NVS_KEY, snap, sizeof(nn_model_snapshot_t)) < 0) {
+        LOG_DRV_WARN("snapshot_save: NVS write failed, warm start limited to this session\r\r\n");
+    }
+}
+
+static void snapshot_invalidate(void)
+{
+    memset(&g_nn_snapshot, 0, sizeof(nn_model_snapshot_t));
+    storage_nvs_delete(NVS_USER, NN_SNAPSHOT_NVS_KEY);
+}
+
+static void update_inference_stats(uint32_t inference_time_us)
+{
+    g_nn.inference_count++;
+    g_nn.last_inference_time_us = inference_time_us;
+    g_nn.total_inference_time_us += inference_time_us;
+    g_nn.total_inference_time = (uint32_t)(g_nn.total_inference_time_us / 1000ULL);
+}
+
+static int model_install(const uintptr_t model_ptr, nn_t *nn, uint32_t rt_ram_copy, uint32_t ext_ram_sz)
+{
+    int res;
+
     /* Initialize LL_ATON runtime */
     LL_ATON_RT_RuntimeInit();
     /* Create and install an instance of the relocatable model */
     ll_aton_reloc_config config;
 
-    nn->exec_ram_addr = hal_mem_alloc_large(rt.rt_ram_copy);
-    nn->ext_ram_addr = hal_mem_alloc_large(rt.ext_ram_sz);
+    nn->exec_ram_addr = hal_mem_alloc_large(rt_ram_copy);
+    nn->ext_ram_addr = hal_mem_alloc_large(ext_ram_sz);
     if (nn->exec_ram_addr == NULL || nn->ext_ram_addr == NULL) {
         LOG_DRV_ERROR("model_init: OOM\r\r\n");
         return -1;
     }
     config.exec_ram_addr = (uintptr_t)nn->exec_ram_addr;
-    config.exec_ram_size = rt.rt_ram_copy;
+    config.exec_ram_size = rt_ram_copy;
     config.ext_ram_addr = (uintptr_t)nn->ext_ram_addr;
-    config.ext_ram_size = rt.ext_ram_sz;
+    config.ext_ram_size = ext_ram_sz;
     config.ext_param_addr = 0;  /* or @ of the weights/params if split mode is used */
     config.mode = AI_RELOC_RT_LOAD_MODE_COPY; // | AI_RELOC_RT_LOAD_MODE_CLEAR;
 
@@ -375,6 +454,25 @@ static int model_init(const uintptr_t model_ptr, nn_t *nn)
 
 }
 
+static int model_init(const uintptr_t model_ptr, nn_t *nn, ll_aton_reloc_info *rt)
+{
+    if (!model_ptr) {
+        return -1;
+    }
+
+    /* Print model information */
+    ll_aton_reloc_log_info(model_ptr);
+
+    /* Get model information */
+    int res = ll_aton_reloc_get_info(model_ptr, rt);
+    if (res != 0) {
+        LOG_DRV_ERROR("ll_aton_reloc_get_info failed %d\r\r\n", res);
+        return -1;
+    }
+
+    return model_install(model_ptr, nn, rt->rt_ram_copy, rt->ext_ram_sz);
+}
+
 static int model_deinit(nn_t *nn)
 {
     if (nn->nn_inst) {
@@ -415,7 +513,7 @@ static int model_run(nn_t *nn, nn_result_t *result, bool is_callback)
         /* flush input cache */
         flush_input_cache(nn);
         /* start time */
-        uint32_t start_time = osKernelGetTickCount();
+        uint64_t start_time = generic_time_us();
         /* Run inference using LL_ATON */
         LL_ATON_RT_RetValues_t ll_aton_ret;
         do {
@@ -435,7 +533,7 @@ static int model_run(nn_t *nn, nn_result_t *result, bool is_callback)
                 return -1;
             }
             /* end time */
-            update_inference_stats(osKernelGetTickCount() - start_time);
+            update_inference_stats((uint32_t)(generic_time_us() - start_time));
             if (is_callback && nn->callback) {
                 nn->callback(result, nn->callback_user_data);
             }
@@ -470,16 +568,33 @@ static int load_model(const uintptr_t file_ptr)
         g_nn.output_buffer_size[i] = 0;
     }
 
-    /* load model information */
-    if (load_info(file_ptr, &g_nn.model) != 0) {
-        LOG_DRV_ERROR("load_model: load model info failed\r\r\n");
-        return -1;
-    }
+    uint32_t start_time = osKernelGetTickCount();
+    nn_model_snapshot_t snap;
+    bool warm = (snapshot_restore(file_ptr, &snap) == 0);
 
-    /* initialize model */
-    if (model_init(g_nn.model.model_ptr, &g_nn) != 0) {
-        LOG_DRV_ERROR("load_model: model init failed\r\r\n");
-        return -1;
+    if (warm) {
+        /* warm start: model info and install sizes come from the snapshot */
+        memcpy(&g_nn.model, &snap.model, sizeof(nn_model_info_t));
+        if (model_install(g_nn.model.model_ptr, &g_nn, snap.rt_ram_copy, snap.ext_ram_sz) != 0) {
+            LOG_DRV_ERROR("load_model: model install failed\r\r\n");
+            return -1;
+        }
+    } else {
+        ll_aton_reloc_info rt;
+
+        /* load model information */
+        if (load_info(file_ptr, &g_nn.model) != 0) {
+            LOG_DRV_ERROR("load_model: load model info failed\r\r\n");
+            return -1;
+        }
+
+        /* initialize model */
+        if (model_init(g_nn.model.model_ptr, &g_nn, &rt) != 0) {
+            LOG_DRV_ERROR("load_model: model init failed\r\r\n");
+            return -1;
+        }
+
+        snapshot_save(file_ptr, &g_nn.model, rt.rt_ram_copy, rt.ext_ram_sz);
     }
     
     /* load postprocess */
@@ -498,8 +613,10 @@ static int load_model(const uintptr_t file_ptr)
     g_nn.pp_vt = pp_vt;
     // update state
     g_nn.state = NN_STATE_READY;
+    g_nn.last_load_time = osKernelGetTickCount() - start_time;
+    g_nn.last_load_warm = warm;
 
-    LOG_DRV_INFO("Model loaded successfully\r\r\n");
+    LOG_DRV_INFO("Model loaded successfully (%s, %lu ms)\r\r\n", warm ? "warm" : "cold", g_nn.last_load_time);
     return 0;
 }
 
@@ -727,6 +844,254 @@ static int nn_camera_stop(void)
 }
 
 
+/* ==================== streaming JSON writer ==================== */
+
+// bounded writer over a caller buffer; keeps counting past the end like snprintf
+typedef struct {
+    char *buf;
+    size_t size;
+    size_t len;
+} nn_json_writer_t;
+
+static void jw_put(nn_json_writer_t *w, const char *str, size_t n)
+{
+    if (w->len < w->size) {
+        size_t room = w->size - w->len;
+        memcpy(w->buf + w->len, str, n < room ? n : room);
+    }
+    w->len += n;
+}
+
+static void jw_raw(nn_json_writer_t *w, const char *str)
+{
+    jw_put(w, str, strlen(str));
+}
+
+static void jw_string(nn_json_writer_t *w, const char *str)
+{
+    char esc[8];
+
+    jw_put(w, "\"", 1);
+    for (const unsigned char *p = (const unsigned char *)str; *p; p++) {
+        switch (*p) {
+            case '\"': jw_put(w, "\\\"", 2); break;
+            case '\\': jw_put(w, "\\\\", 2); break;
+            case '\b': jw_put(w, "\\b", 2); break;
+            case '\f': jw_put(w, "\\f", 2); break;
+            case '\n': jw_put(w, "\\n", 2); break;
+            case '\r': jw_put(w, "\\r", 2); break;
+            case '\t': jw_put(w, "\\t", 2); break;
+            default:
+                if (*p < 32) {
+                    snprintf(esc, sizeof(esc), "\\u%04x", *p);
+                    jw_put(w, esc, 6);
+                } else {
+                    jw_put(w, (const char *)p, 1);
+                }
+                break;
+        }
+    }
+    jw_put(w, "\"", 1);
+}
+
+// number formatting identical to cJSON print_number
+static void jw_number(nn_json_writer_t *w, double d)
+{
+    char num[26];
+    double test = 0.0;
+    int valueint;
+    int length;
+
+    if (d >= INT_MAX) {
+        valueint = INT_MAX;
+    } else if (d <= (double)INT_MIN) {
+        valueint = INT_MIN;
+    } else {
+        valueint = (int)d;
+    }
+
+    if (isnan(d) || isinf(d)) {
+        length = snprintf(num, sizeof(num), "null");
+    } else if (d == (double)valueint) {
+        length = snprintf(num, sizeof(num), "%d", valueint);
+    } else {
+        length = snprintf(num, sizeof(num), "%1.15g", d);
+        test = strtod(num, NULL);
+        double max_val = fabs(test) > fabs(d) ? fabs(test) : fabs(d);
+        if (fabs(test - d) > max_val * DBL_EPSILON) {
+            length = snprintf(num, sizeof(num), "%1.17g", d);
+        }
+    }
+
+    if (length > 0 && length < (int)sizeof(num)) {
+        jw_put(w, num, (size_t)length);
+    }
+}
+
+static void jw_key(nn_json_writer_t *w, const char *key, bool first)
+{
+    if (!first) {
+        jw_put(w, ",", 1);
+    }
+    jw_string(w, key);
+    jw_put(w, ":", 1);
+}
+
+static void jw_key_number(nn_json_writer_t *w, const char *key, double d, bool first)
+{
+    jw_key(w, key, first);
+    jw_number(w, d);
+}
+
+// a NULL string drops the member, as cJSON_AddStringToObject does
+static void jw_key_string(nn_json_writer_t *w, const char *key, const char *str, bool first)
+{
+    if (!str) {
+        return;
+    }
+    jw_key(w, key, first);
+    jw_string(w, str);
+}
+
+static void jw_detection(nn_json_writer_t *w, const od_detect_t *detection, int index)
+{
+    jw_put(w, "{", 1);
+    jw_key_number(w, "index", index, true);
+    jw_key_string(w, "class_name", detection->class_name, false);
+    jw_key_number(w, "confidence", detection->conf, false);
+    jw_key_number(w, "x", detection->x, false);
+    jw_key_number(w, "y", detection->y, false);
+    jw_key_number(w, "width", detection->width, false);
+    jw_key_number(w, "height", detection->height, false);
+    jw_put(w, "}", 1);
+}
+
+static void jw_mpe_detection(nn_json_writer_t *w, const mpe_detect_t *detection, int index)
+{
+    jw_put(w, "{", 1);
+    jw_key_number(w, "index", index, true);
+    jw_key_string(w, "class_name", detection->class_name ? detection->class_name : "person", false);
+    jw_key_number(w, "confidence", detection->conf, false);
+    jw_key_number(w, "x", detection->x, false);
+    jw_key_number(w, "y", detection->y, false);
+    jw_key_number(w, "width", detection->width, false);
+    jw_key_number(w, "height", detection->height, false);
+
+    jw_key(w, "keypoints", false);
+    jw_put(w, "[", 1);
+    for (uint32_t i = 0; i < detection->nb_keypoints && i < 33; i++) {
+        const keypoint_t *keypoint = &detection->keypoints[i];
+        if (i > 0) {
+            jw_put(w, ",", 1);
+        }
+        jw_put(w, "{", 1);
+        jw_key_number(w, "index", i, true);
+        jw_key_number(w, "x", keypoint->x, false);
+        jw_key_number(w, "y", keypoint->y, false);
+        jw_key_number(w, "confidence", keypoint->conf, false);
+        if (detection->keypoint_names && detection->keypoint_names[i]) {
+            jw_key_string(w, "name", detection->keypoint_names[i], false);
+        }
+        jw_put(w, "}", 1);
+    }
+    jw_put(w, "]", 1);
+    jw_key_number(w, "keypoint_count", detection->nb_keypoints, false);
+
+    if (detection->keypoint_connections && detection->num_connections > 0) {
+        jw_key(w, "connections", false);
+        jw_put(w, "[", 1);
+        for (uint8_t i = 0; i < detection->num_connections; i += 2) {
+            if (i > 0) {
+                jw_put(w, ",", 1);
+            }
+            jw_put(w, "{", 1);
+            jw_key_number(w, "from", detection->keypoint_connections[i], true);
+            jw_key_number(w, "to", detection->keypoint_connections[i + 1], false);
+            jw_put(w, "}", 1);
+        }
+        jw_put(w, "]", 1);
+        jw_key_number(w, "connection_count", detection->num_connections / 2, false);
+    }
+    jw_put(w, "}", 1);
+}
+
+static const char *ai_result_type_name(pp_type_t type)
+{
+    switch (type) {
+        case PP_TYPE_OD:
+            return "object_detection";
+        case PP_TYPE_MPE:
+            return "multi_pose_estimation";
+        case PP_TYPE_SEG:
+            return "segmentation";
+        case PP_TYPE_CLASS:
+            return "classification";
+        case PP_TYPE_PD:
+            return "person_detection";
+        case PP_TYPE_SPE:
+            return "single_pose_estimation";
+        case PP_TYPE_ISEG:
+            return "instance_segmentation";
+        case PP_TYPE_SSEG:
+            return "semantic_segmentation";
+        default:
+            return "unknown";
+    }
+}
+
+/**
+ * @brief Serialize AI result JSON into a caller buffer
+ */
+int nn_serialize_ai_result_json(const nn_result_t* ai_result, char *buf, size_t size)
+{
+    if (!ai_result || (!buf && size > 0)) {
+        return -1;
+    }
+
+    nn_json_writer_t w = { .buf = buf, .size = size, .len = 0 };
+
+    jw_put(&w, "{", 1);
+    jw_key_number(&w, "type", ai_result->type, true);
+
+    if (ai_result->type == PP_TYPE_OD && ai_result->od.nb_detect > 0) {
+        jw_key(&w, "detections", false);
+        jw_put(&w, "[", 1);
+        for (int i = 0; i < ai_result->od.nb_detect; i++) {
+            if (i > 0) {
+                jw_put(&w, ",", 1);
+            }
+            jw_detection(&w, &ai_result->od.detects[i], i);
+        }
+        jw_put(&w, "]", 1);
+        jw_key_number(&w, "detection_count", ai_result->od.nb_detect, false);
+        jw_raw(&w, ",\"poses\":[],\"pose_count\":0");
+    } else if (ai_result->type == PP_TYPE_MPE && ai_result->mpe.nb_detect > 0) {
+        jw_key(&w, "poses", false);
+        jw_put(&w, "[", 1);
+        for (int i = 0; i < ai_result->mpe.nb_detect; i++) {
+            if (i > 0) {
+                jw_put(&w, ",", 1);
+            }
+            jw_mpe_detection(&w, &ai_result->mpe.detects[i], i);
+        }
+        jw_put(&w, "]", 1);
+        jw_key_number(&w, "pose_count", ai_result->mpe.nb_detect, false);
+        jw_raw(&w, ",\"detections\":[],\"detection_count\":0");
+    } else {
+        jw_raw(&w, ",\"detections\":[],\"detection_count\":0,\"poses\":[],\"pose_count\":0");
+    }
+
+    jw_key_string(&w, "type_name", ai_result_type_name(ai_result->type), false);
+    jw_put(&w, "}", 1);
+
+    // always NUL-terminate, truncating if needed
+    if (size > 0) {
+        buf[w.len < size ? w.len : size - 1] = '\0';
+    }
+
+    return (int)w.len;
+}
+
 /* ==================== JSON creation functions ==================== */
 /**
  * @brief Create detection result JSON
@@ -867,37 +1232,7 @@ cJSON* nn_create_ai_result_json(const nn_result_t* ai_result) {
     }
     
     // Add type name for better frontend understanding
-    const char* type_name = "unknown";
-    switch (ai_result->type) {
-        case PP_TYPE_OD:
-            type_name = "object_detection";
-            break;
-        case PP_TYPE_MPE:
-            type_name = "multi_pose_estimation";
-            break;
-        case PP_TYPE_SEG:
-            type_name = "segmentation";
-            break;
-        case PP_TYPE_CLASS:
-            type_name = "classification";
-            break;
-        case PP_TYPE_PD:
-            type_name = "person_detection";
-            break;
-        case PP_TYPE_SPE:
-            type_name = "single_pose_estimation";
-            break;
-        case PP_TYPE_ISEG:
-            type_name = "instance_segmentation";
-            break;
-        case PP_TYPE_SSEG:
-            type_name = "semantic_segmentation";
-            break;
-        default:
-            type_name = "unknown";
-            break;
-    }
-    cJSON_AddStringToObject(result_json, "type_name", type_name);
+    cJSON_AddStringToObject(result_json, "type_name", ai_result_type_name(ai_result->type));
     
     return result_json;
 }
@@ -916,6 +1251,7 @@ static int nn_cmd(int argc, char *argv[])
         LOG_SIMPLE("  stop            - Stop inference\r\n");
         LOG_SIMPLE("  stats           - Show inference statistics\r\n");
         LOG_SIMPLE("  validate        - Validate model file\r\n");
+        LOG_SIMPLE("  snapshot clear  - Drop the warm-start snapshot\r\n");
         LOG_SIMPLE("  camera          - sample : camera inference\r\n");
         return 0;
     }
@@ -941,9 +1277,11 @@ static int nn_cmd(int argc, char *argv[])
                        g_nn.model.input_channels);
         }
 
-        LOG_SIMPLE("Inference Count: %ld, Total Time: %ld ms, Average Time: %ld ms\r\n",
+        LOG_SIMPLE("Last Load: %lu ms (%s)\r\n", g_nn.last_load_time, g_nn.last_load_warm ? "warm" : "cold");
+        LOG_SIMPLE("Inference Count: %ld, Total Time: %ld ms, Average Time: %lu us, Last Time: %lu us\r\n",
                    g_nn.inference_count, g_nn.total_inference_time,
-                   g_nn.inference_count > 0 ? g_nn.total_inference_time / g_nn.inference_count : 0);
+                   g_nn.inference_count > 0 ? (uint32_t)(g_nn.total_inference_time_us / g_nn.inference_count) : 0,
+                   g_nn.last_inference_time_us);
 
     } else if (strcmp(cmd, "load") == 0) {
         // load model
@@ -1011,13 +1349,15 @@ static int nn_cmd(int argc, char *argv[])
 
     } else if (strcmp(cmd, "stats") == 0) {
         // show statistics
-        uint32_t count, total_time;
-        if (nn_get_inference_stats(&count, &total_time) == 0) {
+        uint32_t count, last_time_us;
+        uint64_t total_time_us;
+        if (nn_get_inference_stats_us(&count, &total_time_us, &last_time_us) == 0) {
             LOG_SIMPLE("Inference Statistics:\r\n");
             LOG_SIMPLE("  Total Inferences: %lu\r\n", count);
-            LOG_SIMPLE("  Total Time: %lu ms\r\n", total_time);
+            LOG_SIMPLE("  Total Time: %.3f ms\r\n", (float)total_time_us / 1000.0f);
             if (count > 0) {
-                LOG_SIMPLE("  Average Time: %.2f ms\r\n", (float)total_time / count);
+                LOG_SIMPLE("  Average Time: %.3f ms\r\n", (float)total_time_us / 1000.0f / count);
+                LOG_SIMPLE("  Last Time: %.3f ms\r\n", (float)last_time_us / 1000.0f);
             }
         }
 
@@ -1035,6 +1375,15 @@ static int nn_cmd(int argc, char *argv[])
             LOG_SIMPLE("Model file is invalid: %d\r\n", ret);
         }
 
+    } else if (strcmp(cmd, "snapshot") == 0) {
+        // warm-start snapshot control
+        if (argc >= 3 && strcmp(argv[2], "clear") == 0) {
+            nn_invalidate_model_snapshot();
+            LOG_SIMPLE("Model snapshot cleared\r\n");
+        } else {
+            LOG_SIMPLE("Usage: nn snapshot clear\r\n");
+        }
+
     } else if (strcmp(cmd, "camera") == 0) {
         // camera inference
         if (argc < 3) {
@@ -1281,6 +1630,21 @@ int nn_get_inference_stats(uint32_t *count, uint32_t *total_time)
     return 0;
 }
 
+int nn_get_inference_stats_us(uint32_t *count, uint64_t *total_time_us, uint32_t *last_time_us)
+{
+    if (!count || !total_time_us) {
+        return -1;
+    }
+
+    *count = g_nn.inference_count;
+    *total_time_us = g_nn.total_inference_time_us;
+    if (last_time_us) {
+        *last_time_us = g_nn.last_inference_time_us;
+    }
+
+    return 0;
+}
+
 
 int nn_set_callback(nn_callback_t callback, void *user_data)
 {
@@ -1309,6 +1673,9 @@ int nn_update_model(const uintptr_t file_ptr)
         nn_stop_inference();
     }
 
+    // the old snapshot must never be restored for the new package
+    nn_invalidate_model_snapshot();
+
     // unload current model
     int ret = nn_unload_model();
     if (ret != 0) {
@@ -1336,3 +1703,15 @@ int nn_validate_model(const uintptr_t file_ptr)
 {
     return validate_model(file_ptr);
 }
+
+int nn_invalidate_model_snapshot(void)
+{
+    if (g_nn.mtx_id) {
+        osMutexAcquire(g_nn.mtx_id, osWaitForever);
+        snapshot_invalidate();
+        osMutexRelease(g_nn.mtx_id);
+    } else {
+        snapshot_invalidate();
+    }
+    return 0;
+}
@@ -86,7 +86,11 @@ typedef struct {
 
     // inference related
     uint32_t inference_count;         // inference count
-    uint32_t total_inference_time;    // total inference time
+    uint32_t total_inference_time;    // total inference time(ms)
+    uint64_t total_inference_time_us; // total inference time(us)
+    uint32_t last_inference_time_us;  // last inference time(us)
+    uint32_t last_load_time;          // last model load time(ms)
+    bool last_load_warm;              // last load restored from snapshot
 
     //postprocess
     const pp_vtable_t *pp_vt;
@@ -241,6 +245,13 @@ nn_state_t nn_get_state(void);
 */
 int nn_get_inference_stats(uint32_t *count, uint32_t *total_time);
 
+/*
+* description: get inference stats with microsecond resolution
+* input: count pointer, total time(us) pointer, last time(us) pointer (optional)
+* output: 0 success, -1 failed
+*/
+int nn_get_inference_stats_us(uint32_t *count, uint64_t *total_time_us, uint32_t *last_time_us);
+
 // callback function
 /*
 * description: set callback function for inference result before nn_start_inference
@@ -265,6 +276,14 @@ int nn_update_model(const uintptr_t file_ptr);
 */
 int nn_validate_model(const uintptr_t file_ptr);
 
+/*
+* description: drop the warm-start snapshot (RAM and NVS) so the next load runs cold
+* input: none
+* output: 0 success, -1 failed
+* note: the snapshot is keyed by the package checksums and is also dropped by nn_update_model
+*/
+int nn_invalidate_model_snapshot(void);
+
 
 /* ==================== JSON creation functions ==================== */
 /**
@@ -274,4 +293,14 @@ int nn_validate_model(const uintptr_t file_ptr);
  */
 cJSON* nn_create_ai_result_json(const nn_result_t* ai_result);
 
+/**
+ * @brief Serialize AI result JSON into a caller buffer without heap allocation
+ * @param ai_result AI result
+ * @param buf output buffer, always NUL-terminated when size > 0
+ * @param size output buffer size
+ * @return JSON length excluding NUL (output is truncated if >= size), -1 on invalid parameter
+ * @note output is field-compatible with cJSON_PrintUnformatted(nn_create_ai_result_json())
+ */
+int nn_serialize_ai_result_json(const nn_result_t* ai_result, char *buf, size_t size);
+
 #endif // _NN_H
\ No newline at end of file
@@ -6,6 +6,16 @@
 
 extern SD_HandleTypeDef hsd1;
 static sd_t g_sd = {0};
+
+// Open file: FileX handle plus the write-behind buffer in front of it
+typedef struct {
+    FX_FILE file;
+    uint8_t *wb_buf;        // DMA aligned, allocated on first write
+    uint32_t wb_size;       // cluster (or SD_FILE_WB_MAX_SIZE) bytes
+    uint32_t wb_len;        // bytes buffered, logically at file offset + 0
+    uint32_t wb_alloc_failed;
+    ULONG64 prealloc_size;  // size asked for with fallocate, 0 if none
+} sd_file_t;
 static uint8_t sd_tread_stack[1024 * 4] ALIGN_32 IN_PSRAM;
 const osThreadAttr_t sdTask_attributes = {
     .name = "sdTask",
@@ -218,9 +228,16 @@ static void media_close_callback(FX_MEDIA *media_ptr)
 void* sd_filex_fopen(void *context, const char *path, const char *mode) 
 {
     FX_MEDIA *media = (FX_MEDIA*)context;
-    FX_FILE *file = hal_mem_alloc_fast(sizeof(FX_FILE));
+    sd_file_t *sf = hal_mem_alloc_fast(sizeof(sd_file_t));
+    FX_FILE *file;
     UINT status;
 
+    if (sf == NULL) {
+        return NULL;
+    }
+    memset(sf, 0, sizeof(sd_file_t));
+    file = &sf->file;
+
     int reading = 0, writing = 0, appending = 0, plus = 0;
 
     // Parse mode
@@ -267,42 +284,166 @@ void* sd_filex_fopen(void *context, const char *path, const char *mode)
             fx_file_seek(file, file_size);
         }
     } else {
-        hal_mem_free(file);
+        hal_mem_free(sf);
         return NULL;
     }
 
     if (status != FX_SUCCESS) {
-        hal_mem_free(file);
+        hal_mem_free(sf);
         return NULL;
     }
-    return file;
+    return sf;
 }
 
+static uint32_t sd_file_wb_size(FX_MEDIA *media)
+{
+    uint32_t cluster = media->fx_media_bytes_per_sector * media->fx_media_sectors_per_cluster;
+
+    if (cluster == 0 || cluster > SD_FILE_WB_MAX_SIZE) {
+        cluster = SD_FILE_WB_MAX_SIZE;
+    }
+    return cluster;
+}
 
-int sd_filex_fclose(void *context, void *fd) 
+// Write buffered data to the file. No media flush, FAT and directory stay in the FileX cache.
+// On failure the data stays buffered so a later fflush/fwrite/fclose can retry it.
+static int sd_file_wb_drain(sd_file_t *sf)
 {
-    FX_FILE *file = (FX_FILE*)fd;
-    fx_file_close(file);
-    hal_mem_free(file);
+    UINT status;
+
+    if (sf->wb_len == 0) {
+        return 0;
+    }
+    status = fx_file_write(&sf->file, sf->wb_buf, sf->wb_len);
+    if (status != FX_SUCCESS) {
+        LOG_DRV_ERROR("sd write-behind drain failed: 0x%x, %lu bytes kept\r\n", status, (unsigned long)sf->wb_len);
+        return -1;
+    }
+    sf->wb_len = 0;
     return 0;
 }
 
-// Write file
+// Commit data and metadata of the whole media, the fsync/checkpoint of this driver
+static int sd_file_sync(FX_MEDIA *media, sd_file_t *sf)
+{
+    int ret = sd_file_wb_drain(sf);
+
+    if (fx_media_flush(media) != FX_SUCCESS) {
+        ret = -1;
+    }
+    return ret;
+}
+
+
+// Data and metadata are on the card when this returns 0
+int sd_filex_fclose(void *context, void *fd) 
+{
+    FX_MEDIA *media = (FX_MEDIA*)context;
+    sd_file_t *sf = (sd_file_t*)fd;
+    FX_FILE *file = &sf->file;
+    int ret = sd_file_wb_drain(sf);
+
+    if (ret != 0) {
+        LOG_DRV_ERROR("sd fclose: %lu buffered bytes lost\r\n", (unsigned long)sf->wb_len);
+    }
+    // Give back preallocated clusters that were not written
+    if (sf->prealloc_size != 0 &&
+        file->fx_file_current_available_size > file->fx_file_current_file_size) {
+        fx_file_extended_truncate_release(file, file->fx_file_current_file_size);
+    }
+    if (fx_file_close(file) != FX_SUCCESS) {
+        ret = -1;
+    }
+    if (fx_media_flush(media) != FX_SUCCESS) {
+        ret = -1;
+    }
+    // The handle is gone either way, report the failure but release it
+    if (ret != 0) {
+        LOG_DRV_ERROR("sd fclose: data may not be durable\r\n");
+    }
+    if (sf->wb_buf) {
+        hal_mem_free(sf->wb_buf);
+    }
+    hal_mem_free(sf);
+    return ret;
+}
+
+// Write file. Data is buffered up to a cluster boundary of the file offset and
+// written a cluster at a time, the media is only flushed by fflush/fclose.
 int sd_filex_fwrite(void *context, void *fd, const void *buf, size_t size) 
 {
     FX_MEDIA *media = (FX_MEDIA*)context;
-    FX_FILE *file = (FX_FILE*)fd;
-    fx_file_write(file, (void*)buf, size);
-    fx_media_flush(media);
+    sd_file_t *sf = (sd_file_t*)fd;
+    FX_FILE *file = &sf->file;
+    const uint8_t *src = (const uint8_t *)buf;
+    size_t left = size;
+
+    if (size == 0) {
+        return 0;
+    }
+
+    if (sf->wb_buf == NULL && !sf->wb_alloc_failed) {
+        sf->wb_size = sd_file_wb_size(media);
+        sf->wb_buf = hal_mem_alloc_aligned(sf->wb_size, 32, MEM_LARGE);
+        if (sf->wb_buf == NULL) {
+            sf->wb_alloc_failed = 1;
+            LOG_DRV_WARN("sd write-behind buffer alloc failed, writing through\r\n");
+        }
+    }
+    if (sf->wb_buf == NULL) {
+        if (fx_file_write(file, (void*)buf, size) != FX_SUCCESS) {
+            return -1;
+        }
+        return size;
+    }
+
+    while (left > 0) {
+        // FileX offset is where the buffer starts, fill up to the next boundary
+        uint32_t pos = (uint32_t)((file->fx_file_current_file_offset + sf->wb_len) % sf->wb_size);
+        uint32_t room = sf->wb_size - pos;
+
+        // A full buffer is only left behind by a failed drain, retry it before taking more
+        if (sf->wb_len > 0 && pos == 0) {
+            if (sd_file_wb_drain(sf) != 0) {
+                return size > left ? (int)(size - left) : -1;
+            }
+            continue;
+        }
+
+        // Whole chunks from a cache line aligned source go to the SD DMA without the copy
+        if (sf->wb_len == 0 && pos == 0 && left >= sf->wb_size && ((uintptr_t)src & 0x1F) == 0) {
+            uint32_t chunk = (uint32_t)(left - (left % sf->wb_size));
+            if (fx_file_write(file, (void*)src, chunk) != FX_SUCCESS) {
+                return -1;
+            }
+            src += chunk;
+            left -= chunk;
+            continue;
+        }
+
+        uint32_t n = left < room ? (uint32_t)left : room;
+        memcpy(sf->wb_buf + sf->wb_len, src, n);
+        sf->wb_len += n;
+        src += n;
+        left -= n;
+        // The bytes are buffered even if the drain fails, it is retried on the next call
+        if (n == room && sd_file_wb_drain(sf) != 0) {
+            return (int)(size - left);
+        }
+    }
     return size;
 }
 
 // Read file
 int sd_filex_fread(void *context, void *fd, void *buf, size_t size) 
 {
-    FX_FILE *file = (FX_FILE*)fd;
+    sd_file_t *sf = (sd_file_t*)fd;
     unsigned long actual;
-    fx_file_read(file, buf, size, &actual);
+
+    if (sd_file_wb_drain(sf) != 0) {
+        return -1;
+    }
+    fx_file_read(&sf->file, buf, size, &actual);
     return actual;
 }
 
@@ -325,16 +466,21 @@ int sd_filex_rename(void *context, const char *oldpath, const char *newpath)
 // File pointer position
 long sd_filex_ftell(void *context, void *fd) 
 {
-    FX_FILE *file = (FX_FILE*)fd;
-    return file->fx_file_current_file_offset;
+    sd_file_t *sf = (sd_file_t*)fd;
+    return sf->file.fx_file_current_file_offset + sf->wb_len;
 }
 
 // Move file pointer
 int sd_filex_fseek(void *context, void *fd, long offset, int whence) 
 {
-    FX_FILE *file = (FX_FILE*)fd;
+    sd_file_t *sf = (sd_file_t*)fd;
+    FX_FILE *file = &sf->file;
     unsigned long new_offset = 0;
 
+    if (sd_file_wb_drain(sf) != 0) {
+        return -1;
+    }
+
     if (whence == SEEK_SET) {
         new_offset = offset;
     } else if (whence == SEEK_CUR) {
@@ -346,14 +492,49 @@ int sd_filex_fseek(void *context, void *fd, long offset, int whence)
     return 0;
 }
 
-// Flush file
+// Flush file: buffered data, FAT and directory entry reach the card (fsync)
 int sd_filex_fflush(void *context, void *fd) 
 {
     FX_MEDIA *media = (FX_MEDIA*)context;
-    fx_media_flush(media);
-    return 0;
+    sd_file_t *sf = (sd_file_t*)fd;
+
+    if (sf == NULL) {
+        return fx_media_flush(media) == FX_SUCCESS ? 0 : -1;
+    }
+    return sd_file_sync(media, sf);
 }
 
+// Reserve clusters for a file of known final size, contiguous when possible.
+// Unused clusters are released at close.
+int sd_filex_fallocate(void *context, void *fd, uint64_t size)
+{
+    sd_file_t *sf = (sd_file_t*)fd;
+    FX_FILE *file;
+    ULONG64 needed;
+    ULONG64 actual = 0;
+    UINT status;
+
+    if (sf == NULL) {
+        return -1;
+    }
+    file = &sf->file;
+    if (size <= file->fx_file_current_available_size) {
+        return 0;
+    }
+    needed = size - file->fx_file_current_available_size;
+
+    // One contiguous run keeps the FAT chain trivial, take what is there otherwise
+    status = fx_file_extended_allocate(file, needed);
+    if (status == FX_NO_MORE_SPACE) {
+        status = fx_file_extended_best_effort_allocate(file, needed, &actual);
+    }
+    if (status != FX_SUCCESS) {
+        LOG_DRV_ERROR("sd preallocate %lu bytes failed: 0x%x\r\n", (unsigned long)needed, status);
+        return -1;
+    }
+    sf->prealloc_size = size;
+    return 0;
+}
 
 void* sd_filex_opendir(void *context, const char *path)
 {
@@ -494,6 +675,7 @@ static file_ops_t sd_file_ops = {
     .readdir = sd_filex_readdir,
     .closedir= sd_filex_closedir,
     .stat = sd_filex_stat,
+    .fallocate = sd_filex_fallocate,
 };
 
 
@@ -24,6 +24,8 @@
 
 #define FX_SD_VOLUME_NAME "SD_DISK"
 
+#define SD_FILE_WB_MAX_SIZE (128 * 1024)  // write-behind buffer cap, a cluster when smaller
+
 #define SD_TYPE_REG 0
 #define SD_TYPE_DIR 1
 
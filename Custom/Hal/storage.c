@@ -8,7 +8,6 @@
 #define LFS_UNLOCK(sys) do{ if ((sys)->thread_safe && (sys)->unlock) (sys)->unlock(); }while(0)
 
 static storage_t g_storage = {0};
-static uint8_t old_data[4096];
 static uint8_t storage_tread_stack[1024 * 4] ALIGN_32 IN_PSRAM;
 const osThreadAttr_t storageTask_attributes = {
     .name = "storageTask",
@@ -30,10 +29,31 @@ const osThreadAttr_t nvsSyncTask_attributes = {
 static void storage_nvs_cache_init(nvs_cache_t *cache);
 static void nvs_sync_thread(void *arg);
 static void nvs_sync_timer_callback(void *arg);
-static nvs_cache_entry_t* nvs_cache_find(nvs_cache_t *cache, const char *key);
-static nvs_cache_entry_t* nvs_cache_alloc(nvs_cache_t *cache, const char *key);
+static nvs_cache_t *storage_nvs_cache_hold(NVS_Type_t type, const char *key);
+static void storage_nvs_cache_release(nvs_cache_t *cache);
 
 /* Block device operations simulating Flash characteristics */
+/*
+ * Memory mapped mode is the resting state of the NOR: reads are plain copies
+ * from the mapped window and only programs and erases leave it. Programs are
+ * gathered into one XSPI page and issued on a page change, a read of the
+ * pending range, an erase or sync. Each block remembers how far it may have
+ * been programmed since it was erased, a program starting past that point
+ * needs no check; anything else is checked against the mapped contents.
+ */
+#define MEM_BLOCK_FRONTIER_UNKNOWN  0xFFFF
+
+static inline const uint8_t *mem_block_mapped(uint32_t addr)
+{
+    return (const uint8_t *)(FS_BASE_MEM_START + addr);
+}
+
+// The mapped window is cacheable, drop lines that an indirect write made stale
+static inline void mem_block_invalidate(uint32_t addr, uint32_t size)
+{
+    SCB_InvalidateDCache_by_Addr((void *)(FS_BASE_MEM_START + addr), (int32_t)size);
+}
+
 // Check if programming operation is allowed (conforms to Flash characteristics)
 static bool is_programmable(const uint8_t *dst, const uint8_t *src, size_t size) 
 {
@@ -45,17 +65,50 @@ static bool is_programmable(const uint8_t *dst, const uint8_t *src, size_t size)
     return true;
 }
 
+static int mem_block_flush(mem_block_dev_t *dev)
+{
+    int ret = LFS_ERR_OK;
+
+    if (dev->pend_len == 0) {
+        return LFS_ERR_OK;
+    }
+    XSPI_NOR_DisableMemoryMappedMode();
+    if (XSPI_NOR_Write(dev->pend_buf, dev->pend_addr, dev->pend_len) != 0) {
+        ret = LFS_ERR_IO;
+    }
+    XSPI_NOR_EnableMemoryMappedMode();
+    mem_block_invalidate(dev->pend_addr, dev->pend_len);
+    dev->pend_len = 0;
+    return ret;
+}
+
+// Bytes from the block start that may hold programmed data, found once per block
+static uint16_t mem_block_frontier(mem_block_dev_t *dev, lfs_block_t block)
+{
+    if (dev->prog_frontier[block] == MEM_BLOCK_FRONTIER_UNKNOWN) {
+        const uint8_t *p = mem_block_mapped(dev->start_addr + block * dev->block_size);
+        uint32_t end = dev->block_size;
+        while (end > 0 && p[end - 1] == NVS_FLASH_ERASE_VALUE) {
+            end--;
+        }
+        dev->prog_frontier[block] = (uint16_t)end;
+    }
+    return dev->prog_frontier[block];
+}
+
 static int mem_block_read(const struct lfs_config *cfg, lfs_block_t block,
                          lfs_off_t off, void *buffer, lfs_size_t size) 
 {
     mem_block_dev_t *dev = (mem_block_dev_t *)cfg->context;
     uint32_t addr = dev->start_addr + block * dev->block_size + off;
-    XSPI_NOR_DisableMemoryMappedMode();
-    if (XSPI_NOR_Read((uint8_t *)buffer, addr, size) != 0) {
-        XSPI_NOR_EnableMemoryMappedMode();
-        return LFS_ERR_IO;
+
+    if (dev->pend_len != 0 &&
+        addr < dev->pend_addr + dev->pend_len && dev->pend_addr < addr + size) {
+        if (mem_block_flush(dev) != LFS_ERR_OK) {
+            return LFS_ERR_IO;
+        }
     }
-    XSPI_NOR_EnableMemoryMappedMode();
+    memcpy(buffer, mem_block_mapped(addr), size);
     return LFS_ERR_OK;
 }
 
@@ -64,22 +117,47 @@ static int mem_block_prog(const struct lfs_config *cfg, lfs_block_t block,
                          lfs_off_t off, const void *buffer, lfs_size_t size) 
 {
     mem_block_dev_t *dev = (mem_block_dev_t *)cfg->context;
-    uint32_t addr = dev->start_addr + block * dev->block_size + off;
+    uint32_t block_addr = dev->start_addr + block * dev->block_size;
+    const uint8_t *src = (const uint8_t *)buffer;
 
-    if (size > sizeof(old_data)) {
-        return LFS_ERR_IO;
-    }
-    XSPI_NOR_DisableMemoryMappedMode();
-    if (XSPI_NOR_Read(old_data, addr, size) != 0) {
+    if (off + size > dev->block_size) {
         return LFS_ERR_IO;
     }
-    if (!is_programmable(old_data, buffer, size)) {
-        return LFS_ERR_CORRUPT;
-    }
-    if (XSPI_NOR_Write((const uint8_t *)buffer, addr, size) != 0) {
-        return LFS_ERR_IO;
+
+    while (size > 0) {
+        uint32_t addr = block_addr + off;
+        uint32_t chunk = FLASH_PAGE_SIZE - (addr % FLASH_PAGE_SIZE);
+        if (chunk > size) {
+            chunk = size;
+        }
+
+        // Only a continuation of the pending run within the same page is merged
+        if (dev->pend_len != 0 &&
+            (addr != dev->pend_addr + dev->pend_len ||
+             addr / FLASH_PAGE_SIZE != dev->pend_addr / FLASH_PAGE_SIZE)) {
+            if (mem_block_flush(dev) != LFS_ERR_OK) {
+                return LFS_ERR_IO;
+            }
+        }
+
+        if (off < mem_block_frontier(dev, block) &&
+            !is_programmable(mem_block_mapped(addr), src, chunk)) {
+            return LFS_ERR_CORRUPT;
+        }
+
+        if (dev->pend_len == 0) {
+            dev->pend_addr = addr;
+        }
+        memcpy(dev->pend_buf + dev->pend_len, src, chunk);
+        dev->pend_len += chunk;
+        if (off + chunk > dev->prog_frontier[block]) {
+            dev->prog_frontier[block] = (uint16_t)(off + chunk);
+        }
+
+        src += chunk;
+        off += chunk;
+        size -= chunk;
     }
-    XSPI_NOR_EnableMemoryMappedMode();
     return LFS_ERR_OK;
 }
 
@@ -87,23 +165,44 @@ static int mem_block_prog(const struct lfs_config *cfg, lfs_block_t block,
 static int mem_block_erase(const struct lfs_config *cfg, lfs_block_t block) 
 {
     mem_block_dev_t *dev = (mem_block_dev_t *)cfg->context;
+    int ret = LFS_ERR_OK;
+
+    // Worn out: littlefs retires the block and relocates its contents
     if (dev->erase_counts[block] >= dev->max_erase) {
+        return LFS_ERR_CORRUPT;
+    }
+    if (mem_block_flush(dev) != LFS_ERR_OK) {
         return LFS_ERR_IO;
     }
     XSPI_NOR_DisableMemoryMappedMode();
     uint32_t block_addr = dev->start_addr + block * dev->block_size;
     // uint32_t block_addr = (dev->start_addr / dev->block_size) + block;
     if (XSPI_NOR_Erase4K(block_addr) != 0) {
-        return LFS_ERR_IO;
+        ret = LFS_ERR_IO;
     }
     XSPI_NOR_EnableMemoryMappedMode();
+    mem_block_invalidate(block_addr, dev->block_size);
+    // A failed erase leaves the block in an unknown state
+    dev->prog_frontier[block] = (ret == LFS_ERR_OK) ? 0 : MEM_BLOCK_FRONTIER_UNKNOWN;
+    if (ret != LFS_ERR_OK) {
+        return ret;
+    }
     dev->erase_counts[block]++;
+    dev->wear_unsaved++;
     return LFS_ERR_OK;
 }
 
 static int mem_block_sync(const struct lfs_config *cfg) 
 {
-    return LFS_ERR_OK;
+    mem_block_dev_t *dev = (mem_block_dev_t *)cfg->context;
+    return mem_block_flush(dev);
+}
+
+// Allocation policy input: littlefs takes the least worn free block it sees
+static uint32_t mem_block_wear(const struct lfs_config *cfg, lfs_block_t block)
+{
+    mem_block_dev_t *dev = (mem_block_dev_t *)cfg->context;
+    return dev->erase_counts[block];
 }
 
 static void *storage_lfs_opendir(void *context, const char *path)
@@ -394,6 +493,101 @@ static file_ops_t lfs_file_ops = {
 };
 
 
+/*
+ * Persistent wear table: erase counts saved as saturated 16-bit values in a
+ * littlefs file. It is rewritten after STORAGE_WEAR_SAVE_ERASES erases, so a
+ * power loss forgets at most that many erases and saving costs a few blocks.
+ */
+#define STORAGE_WEAR_FILE           "/.wear"
+#define STORAGE_WEAR_MAGIC          0x52414557  // "WEAR"
+#define STORAGE_WEAR_SAVE_ERASES    256
+#define STORAGE_WEAR_CHUNK          128         // entries per file access
+
+typedef struct {
+    uint32_t magic;
+    uint32_t block_count;
+} storage_wear_hdr_t;
+
+static void storage_wear_load(lfs_mem_system_t *sys)
+{
+    mem_block_dev_t *dev = &sys->mem_dev;
+    storage_wear_hdr_t hdr;
+    uint16_t chunk[STORAGE_WEAR_CHUNK];
+    uint32_t max = 0;
+    lfs_file_t file;
+
+    if (lfs_file_open(&sys->lfs, &file, STORAGE_WEAR_FILE, LFS_O_RDONLY) != LFS_ERR_OK) {
+        return;
+    }
+    if (lfs_file_read(&sys->lfs, &file, &hdr, sizeof(hdr)) != sizeof(hdr) ||
+        hdr.magic != STORAGE_WEAR_MAGIC || hdr.block_count != dev->block_count) {
+        LOG_DRV_WARN("wear table mismatch, starting from zero\r\n");
+        lfs_file_close(&sys->lfs, &file);
+        return;
+    }
+    for (uint32_t i = 0; i < dev->block_count; i += STORAGE_WEAR_CHUNK) {
+        uint32_t n = dev->block_count - i;
+        if (n > STORAGE_WEAR_CHUNK) n = STORAGE_WEAR_CHUNK;
+        if (lfs_file_read(&sys->lfs, &file, chunk, n * sizeof(uint16_t)) != (lfs_ssize_t)(n * sizeof(uint16_t))) {
+            break;
+        }
+        for (uint32_t j = 0; j < n; j++) {
+            // Erases done since boot are on top of the saved history
+            dev->erase_counts[i + j] += chunk[j];
+            if (dev->erase_counts[i + j] > max) max = dev->erase_counts[i + j];
+        }
+    }
+    lfs_file_close(&sys->lfs, &file);
+    LOG_DRV_DEBUG("wear table loaded, max erase count %lu\r\n", (unsigned long)max);
+}
+
+static int storage_wear_save(lfs_mem_system_t *sys)
+{
+    mem_block_dev_t *dev = &sys->mem_dev;
+    storage_wear_hdr_t hdr = { .magic = STORAGE_WEAR_MAGIC, .block_count = dev->block_count };
+    uint16_t chunk[STORAGE_WEAR_CHUNK];
+    lfs_file_t file;
+    int err;
+
+    // Erases caused by this save are accounted to the next one
+    dev->wear_unsaved = 0;
+    err = lfs_file_open(&sys->lfs, &file, STORAGE_WEAR_FILE, LFS_O_WRONLY | LFS_O_CREAT | LFS_O_TRUNC);
+    if (err != LFS_ERR_OK) {
+        return err;
+    }
+    if (lfs_file_write(&sys->lfs, &file, &hdr, sizeof(hdr)) < 0) {
+        err = LFS_ERR_IO;
+    }
+    for (uint32_t i = 0; err == LFS_ERR_OK && i < dev->block_count; i += STORAGE_WEAR_CHUNK) {
+        uint32_t n = dev->block_count - i;
+        if (n > STORAGE_WEAR_CHUNK) n = STORAGE_WEAR_CHUNK;
+        for (uint32_t j = 0; j < n; j++) {
+            uint32_t c = dev->erase_counts[i + j];
+            chunk[j] = c > 0xFFFF ? 0xFFFF : (uint16_t)c;
+        }
+        if (lfs_file_write(&sys->lfs, &file, chunk, n * sizeof(uint16_t)) < 0) {
+            err = LFS_ERR_IO;
+        }
+    }
+    if (lfs_file_close(&sys->lfs, &file) != LFS_ERR_OK) {
+        err = LFS_ERR_IO;
+    }
+    return err;
+}
+
+// Save the wear table once enough erases have accumulated
+static void storage_wear_sync(lfs_mem_system_t *sys)
+{
+    LFS_LOCK(sys);
+    if (sys->mounted && sys->mem_dev.wear_unsaved >= STORAGE_WEAR_SAVE_ERASES) {
+        int err = storage_wear_save(sys);
+        if (err != LFS_ERR_OK) {
+            LOG_DRV_ERROR("wear table save failed: %d\r\n", err);
+        }
+    }
+    LFS_UNLOCK(sys);
+}
+
 /* Filesystem initialization */
 static int lfs_mem_init(lfs_mem_system_t *sys, 
                 uint32_t mem_start, 
@@ -421,6 +615,15 @@ static int lfs_mem_init(lfs_mem_system_t *sys,
         return LFS_ERR_NOMEM;
     }
 
+    // Program extent of each block, learnt lazily from the mapped contents
+    sys->mem_dev.prog_frontier = hal_mem_alloc_large(sys->mem_dev.block_count * sizeof(uint16_t));
+    if (!sys->mem_dev.prog_frontier) {
+        hal_mem_free(sys->mem_dev.erase_counts);
+        sys->mem_dev.erase_counts = NULL;
+        return LFS_ERR_NOMEM;
+    }
+    memset(sys->mem_dev.prog_frontier, 0xFF, sys->mem_dev.block_count * sizeof(uint16_t));
+
     // Configure littlefs
     sys->config = (struct lfs_config){
         .context = &sys->mem_dev,
@@ -428,14 +631,15 @@ static int lfs_mem_init(lfs_mem_system_t *sys,
         .prog  = mem_block_prog,
         .erase = mem_block_erase,
         .sync  = mem_block_sync,
+        .wear  = mem_block_wear,
 
         .read_size = 16,
         .prog_size = 16,
         .block_size = block_size,
         .block_count = sys->mem_dev.block_count,
-        .cache_size = 16,
-        .lookahead_size = 16,
-        .block_cycles = max_erase_cycles
+        .cache_size = FLASH_PAGE_SIZE,   // lets littlefs hand over whole pages
+        .lookahead_size = 32,           // 256 blocks to choose from per allocation
+        .block_cycles = STORAGE_LFS_BLOCK_CYCLES
     };
 
     // Mount filesystem
@@ -446,6 +650,9 @@ static int lfs_mem_init(lfs_mem_system_t *sys,
     }
     
     sys->mounted = (err == LFS_ERR_OK);
+    if (sys->mounted) {
+        storage_wear_load(sys);
+    }
 
         // Thread safety
     if (lock && unlock) {
@@ -473,10 +680,12 @@ int storage_flash_write(uint32_t offset, void *data, size_t size)
     XSPI_NOR_DisableMemoryMappedMode();
     if (XSPI_NOR_Write((uint8_t *)data, offset, size) != 0) {
         XSPI_NOR_EnableMemoryMappedMode();
+        mem_block_invalidate(offset, size);
         storage_unlock();
         return -1; 
     }
     XSPI_NOR_EnableMemoryMappedMode();
+    mem_block_invalidate(offset, size);
     storage_unlock();
     return 0;
 }
@@ -506,10 +715,13 @@ int storage_flash_erase(uint32_t offset, size_t num_blk)
     for (size_t i = 0; i < num_blk; i++) {
         if (XSPI_NOR_Erase4K(offset + i * FLASH_BLOCK_SIZE) != 0) {
             XSPI_NOR_EnableMemoryMappedMode();
+            mem_block_invalidate(offset + i * FLASH_BLOCK_SIZE, FLASH_BLOCK_SIZE);
             storage_unlock();
             LOG_DRV_ERROR("storage_flash_erase failed at block %u\r\n", i);
             return -1;
         }
+        // Readers may run in the mapped window during the yields below
+        mem_block_invalidate(offset + i * FLASH_BLOCK_SIZE, FLASH_BLOCK_SIZE);
         
         // Periodically yield CPU to prevent watchdog timeout and allow other tasks to run
         // This is especially important for large OTA upgrades (e.g., 10MB = 2560 blocks)
@@ -551,10 +763,12 @@ static int storage_flash_erase4K(uint32_t base, size_t offset)
 
     if (XSPI_NOR_Erase4K(base + offset) != 0) {
         XSPI_NOR_EnableMemoryMappedMode();
+        mem_block_invalidate(base + offset, FS_FLASH_BLK);
         storage_unlock();
         return -1; 
     }
     XSPI_NOR_EnableMemoryMappedMode();
+    mem_block_invalidate(base + offset, FS_FLASH_BLK);
     storage_unlock();
     return 0;
 }
@@ -647,7 +861,7 @@ int storage_init(void *priv)
     
     // Initialize NVS cache
     storage_nvs_cache_init(&storage->nvs_user_cache);
-    LOG_DRV_DEBUG("NVS cache initialized (%d entries)\r\n", NVS_CACHE_SIZE);
+    LOG_DRV_DEBUG("NVS cache initialized (%d entries, %d byte arena)\r\n", NVS_CACHE_SIZE, NVS_CACHE_ARENA_SIZE);
     
     // Create semaphore for NVS sync thread
     storage->nvs_sync_sem = osSemaphoreNew(1, 0, NULL);
@@ -706,7 +920,14 @@ int storage_nvs_write(NVS_Type_t type, const char *key, const void *data, size_t
         return -1;
     }
 
-    return nvs_write(nvs, key, data, len);
+    nvs_cache_t *cache = storage_nvs_cache_hold(type, key);
+    int ret = nvs_write(nvs, key, data, len);
+    storage_nvs_cache_release(cache);
+    // Sector nearly full: let the sync thread collect before the next writer has to
+    if (ret >= 0 && nvs->ate_wra < nvs->data_wra + NVS_GC_WATERMARK) {
+        storage_nvs_sync_trigger();
+    }
+    return ret;
 }
 
 int storage_nvs_read(NVS_Type_t type, const char *key, void *data, size_t len)
@@ -742,7 +963,10 @@ int storage_nvs_delete(NVS_Type_t type, const char *key)
         return -1;
     }
 
-    return nvs_delete(nvs, key);
+    nvs_cache_t *cache = storage_nvs_cache_hold(type, key);
+    int ret = nvs_delete(nvs, key);
+    storage_nvs_cache_release(cache);
+    return ret;
 }
 
 int storage_nvs_clear(NVS_Type_t type)
@@ -760,7 +984,10 @@ int storage_nvs_clear(NVS_Type_t type)
         return -1;
     }
 
-    return nvs_clear(nvs);
+    nvs_cache_t *cache = storage_nvs_cache_hold(type, NULL);
+    int ret = nvs_clear(nvs);
+    storage_nvs_cache_release(cache);
+    return ret;
 }
 
 void storage_nvs_dump(NVS_Type_t type)
@@ -804,59 +1031,250 @@ void storage_nvs_dump(NVS_Type_t type)
 // Initialize NVS cache
 static void storage_nvs_cache_init(nvs_cache_t *cache)
 {
-    memset(cache->entries, 0, sizeof(cache->entries));
-    cache->has_dirty = false;
+    memset(cache, 0, sizeof(nvs_cache_t));
+    for (int i = 0; i < NVS_CACHE_BUCKETS; i++) {
+        cache->buckets[i] = NVS_CACHE_NONE;
+    }
+    for (int i = 0; i < NVS_CACHE_SIZE; i++) {
+        cache->entries[i].next = (i + 1 < NVS_CACHE_SIZE) ? (uint16_t)(i + 1) : NVS_CACHE_NONE;
+    }
+    cache->free_head = 0;
+    cache->arena = hal_mem_alloc_large(NVS_CACHE_ARENA_SIZE);
+    if (cache->arena == NULL) {
+        LOG_DRV_ERROR("NVS cache arena allocation failed, cache disabled\r\n");
+    }
     cache->cache_mutex = osMutexNew(NULL);
 }
 
+static uint32_t nvs_cache_hash(const char *key)
+{
+    uint32_t h = 2166136261u;  // FNV-1a
+    for (int i = 0; i < NVS_KEY_SIZE && key[i]; i++) {
+        h = (h ^ (uint8_t)key[i]) * 16777619u;
+    }
+    return h & (NVS_CACHE_BUCKETS - 1);
+}
+
 // Find cache entry by key
 static nvs_cache_entry_t* nvs_cache_find(nvs_cache_t *cache, const char *key)
 {
-    for (int i = 0; i < NVS_CACHE_SIZE; i++) {
-        if (cache->entries[i].valid && strcmp(cache->entries[i].key, key) == 0) {
-            cache->entries[i].last_access_tick = osKernelGetTickCount();
-            return &cache->entries[i];
+    uint16_t idx = cache->buckets[nvs_cache_hash(key)];
+    while (idx != NVS_CACHE_NONE) {
+        nvs_cache_entry_t *entry = &cache->entries[idx];
+        if (strncmp(entry->key, key, sizeof(entry->key)) == 0) {
+            entry->last_access_tick = osKernelGetTickCount();
+            return entry;
         }
+        idx = entry->next;
     }
     return NULL;
 }
 
-// Allocate cache entry (LRU replacement policy)
-static nvs_cache_entry_t* nvs_cache_alloc(nvs_cache_t *cache, const char *key)
+// Drop an entry, its arena space is reclaimed by the next compaction
+static void nvs_cache_remove(nvs_cache_t *cache, nvs_cache_entry_t *entry)
 {
-    int victim_idx = -1;
-    uint32_t oldest_tick = UINT32_MAX;
-    
-    // 1. Find free entry first
+    uint16_t idx = (uint16_t)(entry - cache->entries);
+    uint16_t *link = &cache->buckets[nvs_cache_hash(entry->key)];
+
+    while (*link != idx) {
+        link = &cache->entries[*link].next;
+    }
+    *link = entry->next;
+    cache->arena_live -= entry->cap;
+    memset(entry, 0, sizeof(nvs_cache_entry_t));
+    entry->next = cache->free_head;
+    cache->free_head = idx;
+}
+
+// Drop a key (all keys if NULL) about to be written to flash behind the cache's back.
+// The cache stays locked until storage_nvs_cache_release so that no reader can load
+// the old value between the drop and the flash write.
+static nvs_cache_t *storage_nvs_cache_hold(NVS_Type_t type, const char *key)
+{
+    nvs_cache_t *cache = &g_storage.nvs_user_cache;
+
+    if (type != NVS_USER || cache->cache_mutex == NULL) {
+        return NULL;
+    }
+    osMutexAcquire(cache->cache_mutex, osWaitForever);
+    cache->direct_writes++;
+    if (key) {
+        nvs_cache_entry_t *entry = nvs_cache_find(cache, key);
+        if (entry) {
+            nvs_cache_remove(cache, entry);
+        }
+    } else {
+        for (int i = 0; i < NVS_CACHE_SIZE; i++) {
+            if (cache->entries[i].valid) {
+                nvs_cache_remove(cache, &cache->entries[i]);
+            }
+        }
+        cache->has_dirty = false;
+    }
+    return cache;
+}
+
+static void storage_nvs_cache_release(nvs_cache_t *cache)
+{
+    if (cache) {
+        osMutexRelease(cache->cache_mutex);
+    }
+}
+
+// Write every dirty entry back, NVS_WRITE_BATCH_MAX keys per flash pass
+static int nvs_cache_flush_locked(nvs_cache_t *cache)
+{
+    nvs_write_entry_t batch[NVS_WRITE_BATCH_MAX];
+    uint16_t batch_idx[NVS_WRITE_BATCH_MAX];
+    int flush_count = 0;
+    int err = 0;
+    int i = 0;
+
+    while (i < NVS_CACHE_SIZE) {
+        size_t n = 0;
+        for (; i < NVS_CACHE_SIZE && n < NVS_WRITE_BATCH_MAX; i++) {
+            nvs_cache_entry_t *entry = &cache->entries[i];
+            if (entry->valid && entry->dirty) {
+                batch[n].key = entry->key;
+                batch[n].data = cache->arena + entry->offset;
+                batch[n].len = entry->len;
+                batch_idx[n++] = (uint16_t)i;
+            }
+        }
+        if (n == 0) {
+            break;
+        }
+
+        int ret = nvs_write_batch(&g_storage.nvs_user, batch, n);
+        cache->flushes++;
+        if (ret < 0) {
+            // Entries stay dirty, the batch skips the ones that made it to flash next time
+            LOG_DRV_ERROR("NVS flush failed: %d\r\n", ret);
+            err = ret;
+            continue;
+        }
+        cache->flash_writes += ret;
+        flush_count += ret;
+        for (size_t j = 0; j < n; j++) {
+            cache->entries[batch_idx[j]].dirty = false;
+        }
+    }
+
+    // Failed entries stay dirty and go out with the next write's flush, not on every timer tick
+    cache->has_dirty = false;
+    return err ? err : flush_count;
+}
+
+// Evict the least recently used entry, dirty entries are written back together first
+static bool nvs_cache_evict(nvs_cache_t *cache)
+{
+    nvs_cache_entry_t *victim = NULL;
+
     for (int i = 0; i < NVS_CACHE_SIZE; i++) {
-        if (!cache->entries[i].valid) {
-            victim_idx = i;
+        nvs_cache_entry_t *entry = &cache->entries[i];
+        if (entry->valid &&
+            (victim == NULL || (int32_t)(entry->last_access_tick - victim->last_access_tick) < 0)) {
+            victim = entry;
+        }
+    }
+    if (victim == NULL) {
+        return false;
+    }
+    if (victim->dirty) {
+        LOG_DRV_DEBUG("NVS cache evict dirty entry: %s\r\n", victim->key);
+        nvs_cache_flush_locked(cache);
+        if (victim->dirty) {
+            return false;
+        }
+    }
+    nvs_cache_remove(cache, victim);
+    return true;
+}
+
+// Slide the live values down to the start of the arena
+static void nvs_cache_compact(nvs_cache_t *cache)
+{
+    uint32_t cursor = 0;
+
+    while (1) {
+        nvs_cache_entry_t *next = NULL;
+        for (int i = 0; i < NVS_CACHE_SIZE; i++) {
+            nvs_cache_entry_t *entry = &cache->entries[i];
+            if (entry->valid && entry->offset >= cursor &&
+                (next == NULL || entry->offset < next->offset)) {
+                next = entry;
+            }
+        }
+        if (next == NULL) {
             break;
         }
-        // Track oldest entry for LRU replacement
-        if (cache->entries[i].last_access_tick < oldest_tick) {
-            oldest_tick = cache->entries[i].last_access_tick;
-            victim_idx = i;
+        if (next->offset != cursor) {
+            memmove(cache->arena + cursor, cache->arena + next->offset, next->cap);
+            next->offset = cursor;
         }
+        cursor += next->cap;
     }
-    
-    if (victim_idx < 0) {
-        return NULL;  // Should not happen
+    cache->arena_used = cursor;
+}
+
+// Reserve arena space for a value, compacting or evicting as needed
+static bool nvs_cache_reserve(nvs_cache_t *cache, uint16_t cap, uint32_t *offset)
+{
+    while (cache->arena_used + cap > NVS_CACHE_ARENA_SIZE) {
+        if (cache->arena_live + cap <= NVS_CACHE_ARENA_SIZE) {
+            nvs_cache_compact(cache);
+        } else if (!nvs_cache_evict(cache)) {
+            return false;
+        }
     }
-    
-    nvs_cache_entry_t *entry = &cache->entries[victim_idx];
-    
-    // 2. Write back dirty entry before eviction
-    if (entry->valid && entry->dirty) {
-        LOG_DRV_DEBUG("NVS cache evict dirty entry: %s\r\n", entry->key);
-        storage_nvs_write(NVS_USER, entry->key, entry->data, entry->len);
+    *offset = cache->arena_used;
+    cache->arena_used += cap;
+    cache->arena_live += cap;
+    return true;
+}
+
+// Insert or replace the cached value of a key
+static nvs_cache_entry_t* nvs_cache_store(nvs_cache_t *cache, const char *key,
+                                          const void *data, size_t len, bool dirty)
+{
+    nvs_cache_entry_t *entry = nvs_cache_find(cache, key);
+
+    if (entry && len <= entry->cap) {
+        memcpy(cache->arena + entry->offset, data, len);
+        entry->len = (uint16_t)len;
+        entry->dirty = entry->dirty || dirty;
+        return entry;
     }
-    
-    // 3. Initialize new entry
+    if (entry) {
+        // Grown past its slot: the new value replaces it, dirty or not
+        nvs_cache_remove(cache, entry);
+    }
+
+    if (cache->free_head == NVS_CACHE_NONE && !nvs_cache_evict(cache)) {
+        return NULL;
+    }
+    uint16_t cap = (uint16_t)((len + 3) & ~3u);
+    uint32_t offset;
+    if (!nvs_cache_reserve(cache, cap, &offset)) {
+        return NULL;
+    }
+    // Eviction above may have freed more headers, take one only now
+    uint16_t idx = cache->free_head;
+    entry = &cache->entries[idx];
+    cache->free_head = entry->next;
+
+    uint32_t bucket = nvs_cache_hash(key);
     memset(entry, 0, sizeof(nvs_cache_entry_t));
     strncpy(entry->key, key, sizeof(entry->key) - 1);
+    entry->offset = offset;
+    entry->cap = cap;
+    entry->len = (uint16_t)len;
+    entry->dirty = dirty;
     entry->valid = true;
     entry->last_access_tick = osKernelGetTickCount();
+    entry->next = cache->buckets[bucket];
+    cache->buckets[bucket] = idx;
+    memcpy(cache->arena + offset, data, len);
     return entry;
 }
 
@@ -868,49 +1286,31 @@ int storage_nvs_write_cached(NVS_Type_t type, const char *key, const void *data,
         return storage_nvs_write(type, key, data, len);
     }
     
-    // Data too large, bypass cache and write directly
-    if (len > NVS_CACHE_MAX_DATA_SIZE) {
-        return storage_nvs_write(type, key, data, len);
-    }
-    
     if (!g_storage.is_init) {
         return -1;
     }
     
     nvs_cache_t *cache = &g_storage.nvs_user_cache;
+
+    // Data too large or no arena, bypass cache and write directly
+    if (len == 0 || len > NVS_CACHE_MAX_DATA_SIZE || cache->arena == NULL) {
+        return storage_nvs_write(type, key, data, len);
+    }
+
     osMutexAcquire(cache->cache_mutex, osWaitForever);
     
-    // Find existing cache entry
+    // Data unchanged, skip unnecessary write
     nvs_cache_entry_t *entry = nvs_cache_find(cache, key);
-    
-    if (entry) {
-        // Data unchanged, skip unnecessary write
-        if (entry->len == len && memcmp(entry->data, data, len) == 0) {
-            osMutexRelease(cache->cache_mutex);
-            return 0;
-        }
-        
-        // Update cache
-        memcpy(entry->data, data, len);
-        entry->len = len;
-        entry->dirty = true;
-        cache->has_dirty = true;
-        
+    if (entry && entry->len == len && memcmp(cache->arena + entry->offset, data, len) == 0) {
         osMutexRelease(cache->cache_mutex);
-        LOG_DRV_DEBUG("NVS cache update: %s\r\n", key);
         return 0;
     }
     
-    // Allocate new cache entry
-    entry = nvs_cache_alloc(cache, key);
+    entry = nvs_cache_store(cache, key, data, len, true);
     if (entry) {
-        memcpy(entry->data, data, len);
-        entry->len = len;
-        entry->dirty = true;
         cache->has_dirty = true;
-        
         osMutexRelease(cache->cache_mutex);
-        LOG_DRV_DEBUG("NVS cache add: %s\r\n", key);
+        LOG_DRV_DEBUG("NVS cache update: %s\r\n", key);
         return 0;
     }
     
@@ -939,25 +1339,27 @@ int storage_nvs_read_cached(NVS_Type_t type, const char *key, void *data, size_t
     nvs_cache_entry_t *entry = nvs_cache_find(cache, key);
     if (entry) {
         size_t copy_len = entry->len < len ? entry->len : len;
-        memcpy(data, entry->data, copy_len);
+        memcpy(data, cache->arena + entry->offset, copy_len);
+        cache->hits++;
         osMutexRelease(cache->cache_mutex);
         LOG_DRV_DEBUG("NVS cache hit: %s\r\n", key);
         return (int)copy_len;
     }
+    cache->misses++;
+    uint32_t direct_writes = cache->direct_writes;
     
     osMutexRelease(cache->cache_mutex);
     
     // Cache miss, read from Flash
     int ret = storage_nvs_read(type, key, data, len);
     
-    // Load into cache if read successful and data size is suitable
-    if (ret > 0 && ret <= NVS_CACHE_MAX_DATA_SIZE) {
+    // Load into cache if the whole value was read and fits
+    if (ret > 0 && (size_t)ret <= len && ret <= NVS_CACHE_MAX_DATA_SIZE && cache->arena != NULL) {
         osMutexAcquire(cache->cache_mutex, osWaitForever);
-        entry = nvs_cache_alloc(cache, key);
-        if (entry) {
-            memcpy(entry->data, data, ret);
-            entry->len = ret;
-            entry->dirty = false;
+        // A cached or direct write may have raced the flash read, it is newer
+        if (cache->direct_writes == direct_writes &&
+            nvs_cache_find(cache, key) == NULL &&
+            nvs_cache_store(cache, key, data, ret, false) != NULL) {
             LOG_DRV_DEBUG("NVS cache load: %s\r\n", key);
         }
         osMutexRelease(cache->cache_mutex);
@@ -984,27 +1386,13 @@ int storage_nvs_flush(NVS_Type_t type)
     }
     
     osMutexAcquire(cache->cache_mutex, osWaitForever);
-    
-    int flush_count = 0;
-    for (int i = 0; i < NVS_CACHE_SIZE; i++) {
-        if (cache->entries[i].valid && cache->entries[i].dirty) {
-            int ret = storage_nvs_write(NVS_USER, cache->entries[i].key, 
-                                       cache->entries[i].data, cache->entries[i].len);
-            if (ret >= 0) {
-                cache->entries[i].dirty = false;
-                flush_count++;
-            } else {
-                LOG_DRV_ERROR("NVS flush failed for key: %s\r\n", cache->entries[i].key);
-            }
-        }
-    }
-    
-    cache->has_dirty = false;
-    
+    int flush_count = nvs_cache_flush_locked(cache);
     osMutexRelease(cache->cache_mutex);
     
     if (flush_count > 0) {
-        LOG_DRV_DEBUG("NVS flush: %d entries written to Flash\r\n", flush_count);
+        LOG_DRV_DEBUG("NVS flush: %d entries written to Flash (hits %lu, misses %lu, batches %lu)\r\n",
+                      flush_count, (unsigned long)cache->hits, (unsigned long)cache->misses,
+                      (unsigned long)cache->flushes);
     }
     return flush_count;
 }
@@ -1023,6 +1411,25 @@ void storage_nvs_sync_trigger(void)
     }
 }
 
+// Garbage collect both partitions ahead of the writers, one bounded step at a time
+static void storage_nvs_gc(void)
+{
+    nvs_fs_t *parts[] = { &g_storage.nvs_fact, &g_storage.nvs_user };
+
+    for (size_t i = 0; i < sizeof(parts) / sizeof(parts[0]); i++) {
+        int rc;
+        if (!parts[i]->ready) {
+            continue;
+        }
+        while ((rc = nvs_gc_step(parts[i], NVS_GC_WATERMARK, NVS_GC_STEP_ENTRIES)) > 0) {
+            osDelay(1);  // let writers in between steps
+        }
+        if (rc < 0) {
+            LOG_DRV_ERROR("NVS gc failed: %d\r\n", rc);
+        }
+    }
+}
+
 // NVS sync background thread
 static void nvs_sync_thread(void *arg)
 {
@@ -1035,6 +1442,8 @@ static void nvs_sync_thread(void *arg)
             if (g_storage.is_init) {
                 // Execute flush in background thread context
                 storage_nvs_flush_all();
+                storage_nvs_gc();
+                storage_wear_sync(&g_storage.lfs_sys);
             }
         }
     }
@@ -1075,6 +1484,10 @@ void storage_format(void)
         // Remount after successful format
         err = lfs_mount(&g_storage.lfs_sys.lfs, &g_storage.lfs_sys.config);
         g_storage.lfs_sys.mounted = (err == LFS_ERR_OK);
+        // Formatting drops the table file, the counts in RAM are still right
+        if (g_storage.lfs_sys.mounted) {
+            storage_wear_save(&g_storage.lfs_sys);
+        }
     }
 
     if (g_storage.lfs_sys.thread_safe && g_storage.lfs_sys.lock && g_storage.lfs_sys.unlock) {
@@ -15,6 +15,7 @@
 #include "mem_map.h"
 
 #define FLASH_BLOCK_SIZE  4096
+#define FLASH_PAGE_SIZE   256
 #define FS_BASE_MEM_START  FLASH_BASE
 
 #define FS_FLASH_BLK    FLASH_BLOCK_SIZE
@@ -25,10 +26,13 @@
 #define FS_FLASH_SIZE   (64 * 1024 * 1024)
 #endif
 #define FS_BLK_OFFSET   (FS_FLASH_OFFSET / FS_FLASH_BLK)
+#define STORAGE_LFS_BLOCK_CYCLES  500   // metadata pair erases before littlefs moves it
 
 #define NVS_FLASH_BLK    FLASH_BLOCK_SIZE
 #define NVS_FLASH_WRITE_BLOCK_SIZE 	4	/** Choose TYPEPROGAM from HAL. */
 #define NVS_FLASH_ERASE_VALUE		0xFF
+#define NVS_GC_WATERMARK    512     // sector space left when the sync thread starts collecting
+#define NVS_GC_STEP_ENTRIES 32      // entries moved per background collection step
 
 #define NVS_FACT_FLASH_OFFSET  (NVS_BASE - FLASH_BASE)
 #define NVS_FACT_FLASH_SIZE   (32 * 1024)
@@ -60,6 +64,11 @@ typedef struct {
     size_t block_count;
     uint32_t *erase_counts;
     uint32_t max_erase;
+    uint32_t wear_unsaved;          // erases since the wear table was last saved
+    uint16_t *prog_frontier;        // per block, bytes that may be programmed, 0xFFFF unknown
+    uint32_t pend_addr;             // flash address of the pending page program
+    uint32_t pend_len;
+    uint8_t pend_buf[FLASH_PAGE_SIZE];
 } mem_block_dev_t;
 
 typedef struct {
@@ -85,14 +94,23 @@ typedef struct {
     bool is_open;
 } lfs_dir_handle_t;
 
-// NVS cache configuration
-#define NVS_CACHE_SIZE 32
-#define NVS_CACHE_MAX_DATA_SIZE 128
+// NVS cache configuration, values are kept in an arena of NVS_CACHE_ARENA_SIZE bytes
+#ifndef NVS_CACHE_SIZE
+#define NVS_CACHE_SIZE 128                  // entries
+#endif
+#ifndef NVS_CACHE_ARENA_SIZE
+#define NVS_CACHE_ARENA_SIZE (16 * 1024)
+#endif
+#define NVS_CACHE_BUCKETS 64                // power of two
+#define NVS_CACHE_MAX_DATA_SIZE (NVS_CACHE_ARENA_SIZE / 8)  // larger values bypass the cache
+#define NVS_CACHE_NONE 0xFFFF
 
 typedef struct {
     char key[24];                      // NVS_KEY_SIZE = 24
-    uint8_t data[NVS_CACHE_MAX_DATA_SIZE];
-    size_t len;
+    uint32_t offset;                   // value position in the arena
+    uint16_t len;
+    uint16_t cap;                      // arena bytes held by the value
+    uint16_t next;                     // hash chain or free list, NVS_CACHE_NONE terminated
     bool dirty;
     bool valid;
     uint32_t last_access_tick;
@@ -100,8 +118,18 @@ typedef struct {
 
 typedef struct {
     nvs_cache_entry_t entries[NVS_CACHE_SIZE];
+    uint16_t buckets[NVS_CACHE_BUCKETS];
+    uint16_t free_head;
+    uint8_t *arena;
+    uint32_t arena_used;               // allocation point, compacted when the arena is full
+    uint32_t arena_live;               // bytes held by valid entries
     bool has_dirty;
     osMutexId_t cache_mutex;
+    uint32_t hits;
+    uint32_t misses;
+    uint32_t flushes;                  // batches handed to nvs_write_batch
+    uint32_t flash_writes;             // entries actually written
+    uint32_t direct_writes;            // flash writes that bypassed the cache, a miss racing one must not load
 } nvs_cache_t;
 
 typedef struct {
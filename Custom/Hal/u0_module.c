@@ -112,6 +112,8 @@ void u0_module_notify_cb(void *handler, ms_bridging_frame_t *frame)
 
 void ms_bridging_polling_task(void *argument) 
 {
+    // Old U0 firmware ignores the probe, the link then stays stop-and-wait
+    if (ms_bridging_negotiate(u0_handler) != MS_BR_OK) LOG_SIMPLE("u0 bridging: stop-and-wait mode");
     for (;;) {
         if (u9_rx_state != HAL_OK) {
             LOG_SIMPLE("u0 rx state: %d, error: %lx", u9_rx_state, huart9.ErrorCode);
@@ -143,23 +145,19 @@ int u0_module_update_rtc_time(void)
     return ret;
 }
 
-int u0_module_sync_rtc_time(void)
+static int u0_module_apply_rtc_time(ms_bridging_time_t *ms_time)
 {
     int ret = 0;
     RTC_TimeTypeDef time = {0};
     RTC_DateTypeDef date = {0};
-    ms_bridging_time_t ms_time = {0};
 
-    ret = ms_bridging_request_get_time(u0_handler, &ms_time);
-    if (ret != MS_BR_OK) return ret;
-
-    time.Hours = ms_time.hour;
-    time.Minutes = ms_time.minute;
-    time.Seconds = ms_time.second;
-    date.Year = ms_time.year;
-    date.Month = ms_time.month;
-    date.Date = ms_time.day;
-    date.WeekDay = ms_time.week;
+    time.Hours = ms_time->hour;
+    time.Minutes = ms_time->minute;
+    time.Seconds = ms_time->second;
+    date.Year = ms_time->year;
+    date.Month = ms_time->month;
+    date.Date = ms_time->day;
+    date.WeekDay = ms_time->week;
 
     ret = HAL_RTC_SetTime(&hrtc, &time, RTC_FORMAT_BIN);
     if (ret != HAL_OK) return ret;
@@ -170,6 +168,52 @@ int u0_module_sync_rtc_time(void)
     return ret;
 }
 
+int u0_module_sync_rtc_time(void)
+{
+    int ret = 0;
+    ms_bridging_time_t ms_time = {0};
+
+    ret = ms_bridging_request_get_time(u0_handler, &ms_time);
+    if (ret != MS_BR_OK) return ret;
+
+    return u0_module_apply_rtc_time(&ms_time);
+}
+
+int u0_module_sync_wakeup_state(uint32_t *wakeup_flag)
+{
+    int ret = 0;
+    ms_bridging_batch_item_t items[3] = {0};
+
+    if (wakeup_flag == NULL) return -1;
+
+    // Pipelined when U0 speaks window mode, one after the other otherwise
+    items[0].cmd = MS_BR_FRAME_CMD_GET_TIME;
+    items[1].cmd = MS_BR_FRAME_CMD_WKUP_FLAG;
+    items[2].cmd = MS_BR_FRAME_CMD_PWR_STATUS;
+    ms_bridging_request_batch(u0_handler, items, 3);
+
+    if (items[0].result == MS_BR_OK && items[0].len_out == sizeof(ms_bridging_time_t)) {
+        ret = u0_module_apply_rtc_time((ms_bridging_time_t *)items[0].data_out);
+    } else {
+        ret = (items[0].result != MS_BR_OK) ? items[0].result : MS_BR_ERR_INVALID_SIZE;
+    }
+    if (items[1].result == MS_BR_OK && items[1].len_out == sizeof(uint32_t)) {
+        memcpy(wakeup_flag, items[1].data_out, sizeof(uint32_t));
+        g_wakeup_flag = *wakeup_flag;
+        if (g_wakeup_flag & (PWR_WAKEUP_FLAG_PIR_RISING | PWR_WAKEUP_FLAG_PIR_FALLING)) pir_is_inited = 1;
+    } else if (ret == 0) {
+        ret = (items[1].result != MS_BR_OK) ? items[1].result : MS_BR_ERR_INVALID_SIZE;
+    }
+    if (items[2].result == MS_BR_OK && items[2].len_out == sizeof(uint32_t)) {
+        memcpy(&g_power_status, items[2].data_out, sizeof(uint32_t));
+    }
+
+    for (int i = 0; i < 3; i++) {
+        if (items[i].data_out != NULL) MS_BR_FREE(items[i].data_out);
+    }
+    return ret;
+}
+
 int u0_module_get_power_status(uint32_t *switch_bits)
 {
     int ret = 0;
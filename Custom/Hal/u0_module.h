@@ -41,6 +41,11 @@ int u0_module_update_rtc_time(void);
 /// @return 0 on success, other on error
 int u0_module_sync_rtc_time(void);
 
+/// @brief wake-up burst: sync rtc time, wakeup flag and power status from u0 chip in one batch
+/// @param wakeup_flag wakeup flag
+/// @return 0 on success, other on error (rtc time or wakeup flag failed)
+int u0_module_sync_wakeup_state(uint32_t *wakeup_flag);
+
 /// @brief get u0 chip power status
 /// @param switch_bits power status bits
 /// @return 0 on success, other on error
@@ -77,6 +77,10 @@ static aicam_result_t ai_service_draw_callback(uint8_t *frame_buffer,
                                              uint32_t height, 
                                              uint32_t frame_id,
                                              void *user_data);
+static uint32_t ai_service_roi_callback(uint32_t frame_id,
+                                        enc_roi_box_t *boxes,
+                                        uint32_t max_boxes,
+                                        void *user_data);
 
 /* ==================== AI Service Implementation ==================== */
 
@@ -443,9 +447,9 @@ video_node_t* ai_service_get_ai_node(void)
     return g_ai_service.ai_node;
 }
 
-aicam_result_t ai_service_get_nn_result(nn_result_t *result, uint32_t frame_id)
+aicam_result_t ai_service_get_nn_result(nn_result_snapshot_t *snapshot, uint32_t frame_id)
 {
-    if (!result) {
+    if (!snapshot) {
         LOG_SVC_ERROR("Invalid parameter for AI service get NN result");
         return AICAM_ERROR_INVALID_PARAM;
     }
@@ -461,13 +465,13 @@ aicam_result_t ai_service_get_nn_result(nn_result_t *result, uint32_t frame_id)
     }
     
     // Get NN result from AI node
-    aicam_result_t ret = video_ai_node_get_best_nn_result(g_ai_service.ai_node, result, frame_id);
+    aicam_result_t ret = video_ai_node_get_best_nn_result(g_ai_service.ai_node, snapshot, frame_id);
     if (ret != AICAM_OK) {
         LOG_SVC_ERROR("Failed to get NN result from AI node: %d", ret);
         return ret;
     }
 
-    //LOG_SVC_DEBUG("Retrieved NN result from AI service: %d detections", result->od.nb_detect);
+    //LOG_SVC_DEBUG("Retrieved NN result from AI service: %d detections", snapshot->result.od.nb_detect);
     return AICAM_OK;
 }
 
@@ -494,12 +498,15 @@ static aicam_result_t ai_service_draw_callback(uint8_t *frame_buffer,
         return AICAM_ERROR_INVALID_PARAM;
     }
     
-    // Get latest NN result from AI service
-    nn_result_t nn_result;
-    memset(&nn_result, 0, sizeof(nn_result_t));
+    // Get latest NN result from AI service, the detections are copied so the AI
+    // thread can keep running while they are drawn. Too large for the stack and
+    // only the camera pipeline thread draws.
+    static nn_result_snapshot_t snapshot;
+    nn_result_t *nn_result = &snapshot.result;
+    memset(nn_result, 0, sizeof(nn_result_t));
     
-    aicam_result_t ai_ret = ai_service_get_nn_result(&nn_result, frame_id);
-    if (ai_ret == AICAM_OK && (nn_result.od.nb_detect > 0 || nn_result.mpe.nb_detect > 0)) {
+    aicam_result_t ai_ret = ai_service_get_nn_result(&snapshot, frame_id);
+    if (ai_ret == AICAM_OK && (nn_result->od.nb_detect > 0 || nn_result->mpe.nb_detect > 0)) {
         
         // Initialize AI draw service if not already done
         if (!ai_draw_is_initialized()) {
@@ -519,7 +526,7 @@ static aicam_result_t ai_service_draw_callback(uint8_t *frame_buffer,
         
         // Draw AI results on the frame buffer
         if (ai_draw_is_initialized()) {
-            aicam_result_t draw_ret = ai_draw_results(frame_buffer, width, height, &nn_result);
+            aicam_result_t draw_ret = ai_draw_results(frame_buffer, width, height, nn_result);
             if (draw_ret == AICAM_OK) {
                 return AICAM_OK;
             } else {
@@ -535,6 +542,60 @@ static aicam_result_t ai_service_draw_callback(uint8_t *frame_buffer,
     return AICAM_OK;
 }
 
+static uint32_t ai_service_roi_callback(uint32_t frame_id,
+                                        enc_roi_box_t *boxes,
+                                        uint32_t max_boxes,
+                                        void *user_data)
+{
+    (void)user_data;
+    
+    if (!boxes || !g_ai_service.ai_node) {
+        return 0;
+    }
+    
+    // Borrow the cached result, copy only the boxes, then check it was not recycled.
+    // The slot holds its own copy of the detections; the type, count and pointer are
+    // read once so the loop stays within that copy even if the slot is rewritten.
+    const nn_result_t *cached = NULL;
+    uint32_t generation = 0;
+    if (video_ai_node_peek_best_nn_result(g_ai_service.ai_node, frame_id,
+                                          &cached, &generation) != AICAM_OK) {
+        return 0;
+    }
+    
+    nn_result_t nn_result;
+    memcpy(&nn_result, cached, sizeof(nn_result_t));
+    
+    uint32_t count = 0;
+    if (nn_result.type == PP_TYPE_OD) {
+        for (uint32_t i = 0; i < nn_result.od.nb_detect && i < NN_RESULT_MAX_DETECTS && count < max_boxes; i++) {
+            const od_detect_t *det = &nn_result.od.detects[i];
+            boxes[count].x = det->x;
+            boxes[count].y = det->y;
+            boxes[count].width = det->width;
+            boxes[count].height = det->height;
+            boxes[count].conf = det->conf;
+            count++;
+        }
+    } else if (nn_result.type == PP_TYPE_MPE) {
+        for (uint32_t i = 0; i < nn_result.mpe.nb_detect && i < NN_RESULT_MAX_POSES && count < max_boxes; i++) {
+            const mpe_detect_t *det = &nn_result.mpe.detects[i];
+            boxes[count].x = det->x;
+            boxes[count].y = det->y;
+            boxes[count].width = det->width;
+            boxes[count].height = det->height;
+            boxes[count].conf = det->conf;
+            count++;
+        }
+    }
+    
+    if (!video_ai_node_nn_result_valid(g_ai_service.ai_node, generation)) {
+        return 0;
+    }
+    
+    return count;
+}
+
 static void ai_camera_pipeline_event_callback(video_pipeline_t *pipeline,
                                              uint32_t event_type,
                                              void *data,
@@ -653,6 +714,14 @@ static aicam_result_t ai_create_camera_pipeline_nodes(const ai_service_config_t
         LOG_SVC_INFO("AI drawing callback registered to camera node");
     }
     
+    // Feed detections to the encoder as ROI map
+    result = video_encoder_node_set_roi_callback(g_ai_service.encoder_node,
+                                                 ai_service_roi_callback,
+                                                 &g_ai_service);
+    if (result != AICAM_OK) {
+        LOG_SVC_WARN("Failed to register ROI callback to encoder node: %d", result);
+    }
+    
     
     LOG_SVC_INFO("Camera pipeline nodes created successfully");
     
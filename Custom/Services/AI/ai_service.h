@@ -187,11 +187,12 @@ aicam_bool_t ai_pipeline_is_initialized(void);
 video_node_t* ai_service_get_ai_node(void);
 
 /**
- * @brief Get latest NN result from AI service
- * @param result NN result structure to fill
+ * @brief Get the NN result closest to a frame from AI service
+ * @param snapshot Filled with the result and its own copy of the detections
+ * @param frame_id Frame ID to match
  * @return aicam_result_t Operation result
  */
-aicam_result_t ai_service_get_nn_result(nn_result_t *result, uint32_t frame_id);
+aicam_result_t ai_service_get_nn_result(nn_result_snapshot_t *snapshot, uint32_t frame_id);
 
 /* ==================== AI Inference Control Functions ==================== */
 
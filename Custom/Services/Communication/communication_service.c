@@ -777,7 +777,8 @@ aicam_result_t communication_service_init(void *config)
         LOG_SVC_INFO("RTC wakeup detected, disabling AP for faster startup");
     }
     
-    // Register WiFi AP initialization configuration
+    // Register WiFi AP initialization configuration (only interfaces this boot
+    // brings up are registered, communication_service_start starts all of them)
     netif_init_config_t ap_config = {
         .if_name = NETIF_NAME_WIFI_AP,
         .state = NETIF_INIT_STATE_IDLE,
@@ -786,9 +787,11 @@ aicam_result_t communication_service_init(void *config)
         .async = AICAM_TRUE,                       // Asynchronous initialization
         .callback = on_wifi_ap_ready
     };
-    result = netif_init_manager_register(&ap_config);
-    if (result != AICAM_OK) {
-        LOG_SVC_WARN("Failed to register WiFi AP init config: %d", result);
+    if (g_communication_service.config.auto_start_wifi_ap) {
+        result = netif_init_manager_register(&ap_config);
+        if (result != AICAM_OK) {
+            LOG_SVC_WARN("Failed to register WiFi AP init config: %d", result);
+        }
     }
     
     // Register WiFi STA initialization configuration
@@ -800,9 +803,11 @@ aicam_result_t communication_service_init(void *config)
         .async = AICAM_TRUE,                       // Asynchronous initialization
         .callback = on_wifi_sta_ready
     };
-    result = netif_init_manager_register(&sta_config);
-    if (result != AICAM_OK) {
-        LOG_SVC_WARN("Failed to register WiFi STA init config: %d", result);
+    if (g_communication_service.config.auto_start_wifi_sta) {
+        result = netif_init_manager_register(&sta_config);
+        if (result != AICAM_OK) {
+            LOG_SVC_WARN("Failed to register WiFi STA init config: %d", result);
+        }
     }
     
     // Initialize statistics
@@ -856,22 +861,15 @@ aicam_result_t communication_service_start(void)
     g_communication_service.running = AICAM_TRUE;
     g_communication_service.state = SERVICE_STATE_RUNNING;
     
-    // Start asynchronous network interface initialization (non-blocking)
-    if (g_communication_service.config.auto_start_wifi_ap) {
-        LOG_SVC_INFO("Starting async WiFi AP initialization...");
-        aicam_result_t ap_result = netif_init_manager_init_async(NETIF_NAME_WIFI_AP);
-        if (ap_result != AICAM_OK) {
-            LOG_SVC_WARN("Failed to start WiFi AP initialization: %d", ap_result);
-        }
-    }
-    
-    if (g_communication_service.config.auto_start_wifi_sta) {
-        LOG_SVC_INFO("Starting async WiFi STA initialization...");
-        aicam_result_t sta_result = netif_init_manager_init_async(NETIF_NAME_WIFI_STA);
-        if (sta_result != AICAM_OK) {
-            LOG_SVC_WARN("Failed to start WiFi STA initialization: %d", sta_result);
-        }
-        // Note: try_connect_known_networks() will be called in on_wifi_sta_ready() callback
+    // Start all auto-start interfaces concurrently (non-blocking), the first one
+    // that becomes usable takes the default route
+    // Note: try_connect_known_networks() will be called in on_wifi_sta_ready() callback
+    LOG_SVC_INFO("Starting async network interface initialization (AP: %s, STA: %s)...",
+                 g_communication_service.config.auto_start_wifi_ap ? "YES" : "NO",
+                 g_communication_service.config.auto_start_wifi_sta ? "YES" : "NO");
+    aicam_result_t init_result = netif_init_manager_init_all(AICAM_TRUE);
+    if (init_result != AICAM_OK) {
+        LOG_SVC_WARN("Failed to start network interface initialization: %d", init_result);
     }
     
     LOG_SVC_INFO("Communication Service started (network interfaces initializing in background)");
@@ -1470,6 +1468,15 @@ aicam_bool_t communication_is_running(void)
     return g_communication_service.running;
 }
 
+aicam_result_t communication_wait_network_ready(uint32_t timeout_ms)
+{
+    if (!g_communication_service.running) {
+        return AICAM_ERROR_UNAVAILABLE;
+    }
+
+    return (aicam_result_t)nm_wait_default_netif(timeout_ms);
+}
+
 const char* communication_get_version(void)
 {
     return COMMUNICATION_SERVICE_VERSION;
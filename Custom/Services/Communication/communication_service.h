@@ -279,6 +279,13 @@ aicam_result_t communication_reset_stats(void);
  */
 aicam_bool_t communication_is_running(void);
 
+/**
+ * @brief Wait until a network interface holds the default route
+ * @param timeout_ms Timeout in milliseconds
+ * @return aicam_result_t AICAM_OK once the first usable interface is up
+ */
+aicam_result_t communication_wait_network_ready(uint32_t timeout_ms);
+
 /**
  * @brief Get communication service version
  * @return const char* Version string
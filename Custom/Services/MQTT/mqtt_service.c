@@ -838,6 +838,8 @@ static aicam_result_t mqtt_base_config_persistent_to_runtime(
     }
     
     runtime->authentication.is_verify_hostname = persistent->verify_hostname;
+    // Off by default: the saved session holds the master secret in plain NVS
+    runtime->authentication.is_session_persist = persistent->tls_session_persist;
     
     // Last Will and Testament
     if (persistent->lwt_topic[0] != '\0') {
@@ -1818,6 +1820,7 @@ aicam_result_t mqtt_service_get_config(ms_mqtt_config_t *config)
     config->authentication.client_cert_len = g_mqtt_service.config.base_config.authentication.client_cert_len;
     config->authentication.client_key_len = g_mqtt_service.config.base_config.authentication.client_key_len;
     config->authentication.is_verify_hostname = g_mqtt_service.config.base_config.authentication.is_verify_hostname;
+    config->authentication.is_session_persist = g_mqtt_service.config.base_config.authentication.is_session_persist;
     
     config->last_will.msg_len = g_mqtt_service.config.base_config.last_will.msg_len;
     config->last_will.qos = g_mqtt_service.config.base_config.last_will.qos;
@@ -1981,6 +1984,7 @@ aicam_result_t mqtt_service_set_config(const ms_mqtt_config_t *config)
     g_mqtt_service.config.base_config.authentication.client_cert_len = config->authentication.client_cert_len;
     g_mqtt_service.config.base_config.authentication.client_key_len = config->authentication.client_key_len;
     g_mqtt_service.config.base_config.authentication.is_verify_hostname = config->authentication.is_verify_hostname;
+    g_mqtt_service.config.base_config.authentication.is_session_persist = config->authentication.is_session_persist;
     
     g_mqtt_service.config.base_config.last_will.msg_len = config->last_will.msg_len;
     g_mqtt_service.config.base_config.last_will.qos = config->last_will.qos;
@@ -3081,7 +3085,7 @@ static cJSON *create_metadata_json(const mqtt_image_metadata_t *metadata)
 }
 
 /**
- * @brief Create JSON for AI result
+ * @brief Create JSON for the AI model info, the result itself is added by print_publish_json
  */
 static cJSON *create_ai_result_json(const mqtt_ai_result_t *ai_result)
 {
@@ -3097,15 +3101,101 @@ static cJSON *create_ai_result_json(const mqtt_ai_result_t *ai_result)
     cJSON_AddNumberToObject(ai, "confidence_threshold", ai_result->confidence_threshold);
     cJSON_AddNumberToObject(ai, "nms_threshold", ai_result->nms_threshold);
     
-    // Add AI result
-    cJSON *ai_result_json = nn_create_ai_result_json(&ai_result->ai_result);
-    if (ai_result_json) {
-        cJSON_AddItemToObject(ai, "ai_result", ai_result_json);
-    }
-    
     return ai;
 }
 
+static void json_append(char *buf, size_t *pos, const char *str, size_t len)
+{
+    memcpy(buf + *pos, str, len);
+    *pos += len;
+}
+
+#define JSON_APPEND_LITERAL(buf, pos, str) json_append((buf), (pos), (str), sizeof(str) - 1)
+#define MQTT_DATA_URL_PREFIX_MAX 48     // "data:application/octet-stream;base64," and margin
+
+/**
+ * @brief Print a publish payload into one buffer
+ * @details The small members in head go through cJSON. The AI result and
+ *          the Base64 image are written straight into the payload, so
+ *          neither is built or copied as a cJSON item first.
+ * @param head Object with the leading members, deleted here
+ * @param ai_result AI result added as "ai_result", NULL adds null
+ * @param image_data Image added as a Base64 data URL "image_data", NULL for none
+ * @param image_size Image size in bytes
+ * @param image_format Image format for the data URL
+ * @param json_len Payload length, may be NULL
+ * @return Payload to release with buffer_free, NULL on failure
+ */
+static char *print_publish_json(cJSON *head, const mqtt_ai_result_t *ai_result,
+                                const uint8_t *image_data, uint32_t image_size,
+                                mqtt_image_format_t image_format, uint32_t *json_len)
+{
+    char *head_str = NULL;
+    char *ai_str = NULL;
+    char *json = NULL;
+    size_t head_len = 0, ai_len = 0, result_len = 0, b64_size = 0;
+    size_t pos = 0;
+
+    if (!head) return NULL;
+    head_str = cJSON_PrintUnformatted(head);
+    cJSON_Delete(head);
+    if (!head_str) return NULL;
+    head_len = strlen(head_str) - 1;    // up to the closing brace
+
+    if (ai_result) {
+        cJSON *ai = create_ai_result_json(ai_result);
+        if (ai) {
+            ai_str = cJSON_PrintUnformatted(ai);
+            cJSON_Delete(ai);
+        }
+        int len = nn_serialize_ai_result_json(&ai_result->ai_result, NULL, 0);
+        if (!ai_str || len < 0) goto exit;
+        ai_len = strlen(ai_str) - 1;
+        result_len = (size_t)len;
+    }
+    if (image_data) {
+        b64_size = MQTT_DATA_URL_PREFIX_MAX + ((image_size + 2) / 3) * 4 + 1;
+    }
+
+    size_t size = head_len + sizeof(",\"ai_result\":") + 4 + 2;     // null, closing brace and NUL
+    if (ai_result) size += ai_len + sizeof(",\"ai_result\":") + result_len + 1;
+    if (image_data) size += sizeof(",\"image_data\":\"") + b64_size + sizeof("\",\"encoding\":\"base64\"");
+    json = (char *)buffer_calloc(1, size);
+    if (!json) goto exit;
+
+    json_append(json, &pos, head_str, head_len);
+    if (head_len > 1) JSON_APPEND_LITERAL(json, &pos, ",");
+    JSON_APPEND_LITERAL(json, &pos, "\"ai_result\":");
+    if (ai_result) {
+        json_append(json, &pos, ai_str, ai_len);
+        JSON_APPEND_LITERAL(json, &pos, ",\"ai_result\":");
+        nn_serialize_ai_result_json(&ai_result->ai_result, json + pos, result_len + 1);
+        pos += result_len;
+        JSON_APPEND_LITERAL(json, &pos, "}");
+    } else {
+        JSON_APPEND_LITERAL(json, &pos, "null");
+    }
+    if (image_data) {
+        JSON_APPEND_LITERAL(json, &pos, ",\"image_data\":\"");
+        int encoded_len = base64_encode_image(image_data, image_size, json + pos, b64_size, image_format, AICAM_TRUE);
+        if (encoded_len < 0) {
+            buffer_free(json);
+            json = NULL;
+            goto exit;
+        }
+        pos += (size_t)encoded_len;
+        JSON_APPEND_LITERAL(json, &pos, "\",\"encoding\":\"base64\"");
+    }
+    JSON_APPEND_LITERAL(json, &pos, "}");
+    json[pos] = '\0';
+    if (json_len) *json_len = (uint32_t)pos;
+
+exit:
+    buffer_free(head_str);
+    if (ai_str) buffer_free(ai_str);
+    return json;
+}
+
 /**
  * @brief Upload image with AI results (JSON + Base64 format)
  */
@@ -3126,31 +3216,10 @@ int mqtt_service_publish_image_with_ai(const char *topic,
         return MQTT_ERR_INVALID_STATE;
     }
     
-    // Calculate Base64 encoded size
-    uint32_t base64_len = ((image_size + 2) / 3) * 4 + 1;
-    uint32_t prefix_len = strlen("data:image/jpeg;base64,"); // TODO: use metadata->format
-    
-    
-    // Allocate buffer for Base64 encoding
-    char *base64_buffer = (char *)buffer_calloc(1, base64_len + prefix_len);
-    if (!base64_buffer) {
-        LOG_SVC_ERROR("Failed to allocate Base64 buffer (%u bytes)", base64_len);
-        return MQTT_ERR_MEM;
-    }
-    
-    // Encode image to Base64
-    int encoded_len = base64_encode_image(image_data, image_size, base64_buffer, base64_len + prefix_len, metadata->format, AICAM_TRUE);
-    if (encoded_len < 0) {
-        LOG_SVC_ERROR("Base64 encoding failed");
-        buffer_free(base64_buffer);
-        return MQTT_ERR_INVALID_ARG;
-    }
-    
     // Create JSON object
     cJSON *root = cJSON_CreateObject();
     if (!root) {
         LOG_SVC_ERROR("Failed to create JSON object");
-        buffer_free(base64_buffer);
         return MQTT_ERR_MEM;
     }
     
@@ -3160,27 +3229,10 @@ int mqtt_service_publish_image_with_ai(const char *topic,
         cJSON_AddItemToObject(root, "metadata", meta_json);
     }
     
-    // Add AI result if provided
-    if (ai_result && ai_result->ai_result.is_valid) {
-        cJSON *ai_json = create_ai_result_json(ai_result);
-        if (ai_json) {
-            cJSON_AddItemToObject(root, "ai_result", ai_json);
-        }
-    }
-    else
-    {
-        cJSON_AddItemToObject(root, "ai_result", cJSON_CreateNull());
-    }
-    
-    // Add Base64 encoded image
-    cJSON_AddStringToObject(root, "image_data", base64_buffer);
-    cJSON_AddStringToObject(root, "encoding", "base64");
-    
-    // Convert to JSON string
-    char *json_str = cJSON_PrintUnformatted(root);
-    cJSON_Delete(root);
-    buffer_free(base64_buffer);
-    
+    // AI result (null when missing) and the Base64 image are written into the payload directly
+    uint32_t json_len = 0;
+    char *json_str = print_publish_json(root, (ai_result && ai_result->ai_result.is_valid) ? ai_result : NULL,
+                                        image_data, image_size, metadata->format, &json_len);
     if (!json_str) {
         LOG_SVC_ERROR("Failed to generate JSON string");
         return MQTT_ERR_MEM;
@@ -3191,8 +3243,8 @@ int mqtt_service_publish_image_with_ai(const char *topic,
     const char *publish_topic = topic ? topic : g_mqtt_service.config.data_report_topic;
     LOG_SVC_INFO("Publish topic: %s", publish_topic);
     
-    LOG_SVC_INFO("Publishing image with AI result (size: %u, base64: %d, json: %u)",
-                image_size, encoded_len, (uint32_t)strlen(json_str));
+    LOG_SVC_INFO("Publishing image with AI result (size: %u, json: %u)",
+                image_size, json_len);
 
     
     // Publish
@@ -3233,15 +3285,7 @@ int mqtt_service_publish_ai_result(const char *topic,
     }
     
     // Add AI result
-    cJSON *ai_json = create_ai_result_json(ai_result);
-    if (ai_json) {
-        cJSON_AddItemToObject(root, "ai_result", ai_json);
-    }
-    
-    // Convert to JSON string
-    char *json_str = cJSON_PrintUnformatted(root);
-    cJSON_Delete(root);
-    
+    char *json_str = print_publish_json(root, ai_result, NULL, 0, MQTT_IMAGE_FORMAT_JPEG, NULL);
     if (!json_str) {
         LOG_SVC_ERROR("Failed to generate JSON string");
         return MQTT_ERR_MEM;
@@ -3322,20 +3366,9 @@ int mqtt_service_publish_image_chunked(const char *topic,
         cJSON_AddItemToObject(header, "metadata", meta_json);
     }
     
-    // Add AI result if provided
-    if (ai_result && ai_result->ai_result.is_valid) {
-        cJSON *ai_json = create_ai_result_json(ai_result);
-        if (ai_json) {
-            cJSON_AddItemToObject(header, "ai_result", ai_json);
-        }
-    }
-    else
-    {
-        cJSON_AddItemToObject(header, "ai_result", cJSON_CreateNull());
-    }
-
-    char *header_str = cJSON_PrintUnformatted(header);
-    cJSON_Delete(header);
+    // Add AI result if provided, null otherwise
+    char *header_str = print_publish_json(header, (ai_result && ai_result->ai_result.is_valid) ? ai_result : NULL,
+                                          NULL, 0, MQTT_IMAGE_FORMAT_JPEG, NULL);
     
     if (!header_str) {
         LOG_SVC_ERROR("Failed to generate header JSON string");
@@ -14,6 +14,7 @@
  #include "u0_module.h"
  #include "ms_bridging.h"
  #include "mqtt_service.h"
+#include "communication_service.h"
  #include <string.h>
  #include <stdlib.h>
  #include <time.h>
@@ -1546,23 +1547,17 @@ aicam_result_t system_controller_register_io_trigger(system_controller_t *contro
      g_system_service_ctx.task_completed = false;
      g_system_service_ctx.sleep_pending = false;
      
-     // Sync RTC time from U0 on startup
-     int ret = u0_module_sync_rtc_time();
-     if (ret == 0) {
-         LOG_SVC_INFO("RTC time synchronized from U0");
-     } else {
-         LOG_SVC_WARN("Failed to sync RTC time from U0: %d", ret);
-     }
-     
-     // Check and store wakeup flag from U0 (but don't process yet)
+     // Sync RTC time and store wakeup flag from U0 in one burst (but don't process the flag yet)
      uint32_t wakeup_flag = 0;
-     ret = u0_module_get_wakeup_flag(&wakeup_flag);
+     int ret = u0_module_sync_wakeup_state(&wakeup_flag);
      if (ret == 0) {
+         LOG_SVC_INFO("RTC time synchronized from U0");
          LOG_SVC_INFO("System woken by U0, wakeup flag: 0x%08X (stored for later processing)", wakeup_flag);
          g_system_service_ctx.last_wakeup_flag = wakeup_flag;
      } else {
-         LOG_SVC_WARN("Failed to get wakeup flag from U0: %d", ret);
-         g_system_service_ctx.last_wakeup_flag = 0;
+         // Whatever part of the burst succeeded is kept by the U0 module
+         LOG_SVC_WARN("Failed to sync wakeup state from U0: %d", ret);
+         g_system_service_ctx.last_wakeup_flag = u0_module_get_wakeup_flag_ex();
      }
      
      g_system_service_ctx.is_initialized = true;
@@ -2480,7 +2475,16 @@ aicam_result_t system_service_capture_and_upload_mqtt(aicam_bool_t enable_ai,
     uint32_t current_flags = service_get_ready_flags();
     LOG_SVC_INFO("[TIMING] Step 3.1: Current service flags: 0x%08X, MQTT_NET_CONNECTED: %s", 
                  current_flags, (current_flags & MQTT_NET_CONNECTED) ? "YES" : "NO");
-    aicam_result_t result = service_wait_for_ready(MQTT_NET_CONNECTED, AICAM_TRUE, 10000);
+    // Interfaces come up concurrently on wake, wait for the first usable one
+    // before the MQTT connection, both share the same 10s budget
+    aicam_result_t result = communication_wait_network_ready(10000);
+    if (result != AICAM_OK) {
+        LOG_SVC_ERROR("[TIMING] Step 3.1 FAILED: No network interface came up: %d (timeout: 10s)", result);
+        device_service_camera_free_jpeg_buffer(jpeg_buffer);
+        return AICAM_ERROR;
+    }
+    uint32_t net_ms = (uint32_t)(rtc_get_uptime_ms() - step_start_time);
+    result = service_wait_for_ready(MQTT_NET_CONNECTED, AICAM_TRUE, (net_ms < 10000) ? (10000 - net_ms) : 1);
     if (result != AICAM_OK) {
         LOG_SVC_ERROR("[TIMING] Step 3.1 FAILED: Failed to wait for MQTT network connected: %d (timeout: 10s)", result);
         LOG_SVC_ERROR("[TIMING] Step 3.1: Final service flags: 0x%08X", service_get_ready_flags());
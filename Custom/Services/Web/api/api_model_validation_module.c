@@ -21,38 +21,6 @@
 
 /* ==================== Internal Functions ==================== */
 
-/**
- * @brief Base64 encode data
- */
-static char* base64_encode(const unsigned char* data, size_t input_length, size_t* output_length) {
-    const char base64_chars[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
-    
-    *output_length = 4 * ((input_length + 2) / 3);
-    char* encoded_data = (char*)buffer_calloc(1, *output_length + 1);
-    if (!encoded_data) return NULL;
-    
-    size_t i, j;
-    for (i = 0, j = 0; i < input_length;) {
-        uint32_t a = i < input_length ? data[i++] : 0;
-        uint32_t b = i < input_length ? data[i++] : 0;
-        uint32_t c = i < input_length ? data[i++] : 0;
-        
-        uint32_t triple = (a << 0x10) + (b << 0x08) + c;
-        
-        encoded_data[j++] = base64_chars[(triple >> 3 * 6) & 0x3F];
-        encoded_data[j++] = base64_chars[(triple >> 2 * 6) & 0x3F];
-        encoded_data[j++] = base64_chars[(triple >> 1 * 6) & 0x3F];
-        encoded_data[j++] = base64_chars[(triple >> 0 * 6) & 0x3F];
-    }
-    
-    for (i = 0; i < (3 - input_length % 3) % 3; i++) {
-        encoded_data[*output_length - 1 - i] = '=';
-    }
-    
-    encoded_data[*output_length] = '\0';
-    return encoded_data;
-}
-
 /**
  * @brief Find a substring in a string
  */
@@ -304,11 +272,6 @@ static aicam_result_t model_validation_upload_handler(http_handler_context_t* ct
     
     LOG_SVC_INFO("Parsed multipart data: AI=%d bytes, Draw=%d bytes", config.ai_image_size, config.draw_image_size);
     
-    // Initialize all pointers for proper cleanup
-    char* encoded_data = NULL;
-    cJSON* response_json = NULL;
-    char* response_string = NULL;
-    
     // Perform AI inference (data is already binary, no need to decode)
     ai_single_inference_result_t inference_result;
     aicam_result_t result = ai_single_image_inference(
@@ -319,53 +282,46 @@ static aicam_result_t model_validation_upload_handler(http_handler_context_t* ct
         return api_response_error(ctx, API_ERROR_INTERNAL_ERROR, "AI inference failed");
     }
     
-    // Encode output image to base64
-    size_t output_b64_size = 0;
-    encoded_data = base64_encode(inference_result.output_jpeg, inference_result.output_jpeg_size, &output_b64_size);
-    
-    if (!encoded_data) {
+    // Write the response straight into one buffer: the AI result is serialized
+    // and the output image Base64 encoded in place, without cJSON copies of either
+    char head[96];
+    int head_len = snprintf(head, sizeof(head), "{\"processing_time_ms\":%u,\"output_image_size\":%u,\"ai_result\":",
+                            (unsigned int)inference_result.processing_time_ms,
+                            (unsigned int)inference_result.output_jpeg_size);
+    int ai_len = nn_serialize_ai_result_json(&inference_result.ai_result, NULL, 0);
+    size_t b64_size = 4 * ((inference_result.output_jpeg_size + 2) / 3) + 1;
+    const char image_key[] = ",\"output_image\":\"";
+    if (head_len <= 0 || head_len >= (int)sizeof(head) || ai_len < 0) {
         ai_jpeg_free_buffer(inference_result.output_jpeg);
-        return api_response_error(ctx, API_ERROR_INTERNAL_ERROR, "Failed to encode output image");
+        return api_response_error(ctx, API_ERROR_INTERNAL_ERROR, "Failed to serialize response");
     }
     
-    // Create response JSON
-    response_json = cJSON_CreateObject();
-    if (!response_json) {
-        buffer_free(encoded_data);
+    size_t response_size = (size_t)head_len + (size_t)ai_len + sizeof(image_key) - 1 + b64_size + 2;
+    char* response_string = (char*)buffer_calloc(1, response_size + 1);
+    if (!response_string) {
         ai_jpeg_free_buffer(inference_result.output_jpeg);
         return api_response_error(ctx, API_ERROR_INTERNAL_ERROR, "Failed to create response");
     }
     
-    // Add processing information
-    cJSON_AddNumberToObject(response_json, "processing_time_ms", inference_result.processing_time_ms);
-    cJSON_AddNumberToObject(response_json, "output_image_size", inference_result.output_jpeg_size);
-    
-    // Add AI result
-    cJSON* ai_result_json = nn_create_ai_result_json(&inference_result.ai_result);
-    if (ai_result_json) {
-        cJSON_AddItemToObject(response_json, "ai_result", ai_result_json);
-    }
-    
-    // Add output image
-    cJSON_AddStringToObject(response_json, "output_image", encoded_data);
-    
-    // Send response
-    response_string = cJSON_Print(response_json);
-    LOG_SVC_INFO("response_string_len: %d", strlen(response_string));
-    if (response_string) {
-        api_response_success(ctx, response_string, "Model validation completed successfully");
-        //buffer_free(response_string);
-    } else {
-        cJSON_Delete(response_json);
-        buffer_free(encoded_data);
-        ai_jpeg_free_buffer(inference_result.output_jpeg);
-        return api_response_error(ctx, API_ERROR_INTERNAL_ERROR, "Failed to serialize response");
+    size_t pos = (size_t)head_len;
+    memcpy(response_string, head, pos);
+    nn_serialize_ai_result_json(&inference_result.ai_result, response_string + pos, (size_t)ai_len + 1);
+    pos += (size_t)ai_len;
+    memcpy(response_string + pos, image_key, sizeof(image_key) - 1);
+    pos += sizeof(image_key) - 1;
+    size_t b64_len = web_api_base64_encode(inference_result.output_jpeg, inference_result.output_jpeg_size,
+                                           response_string + pos, b64_size);
+    ai_jpeg_free_buffer(inference_result.output_jpeg);
+    if (b64_len == 0 && inference_result.output_jpeg_size > 0) {
+        buffer_free(response_string);
+        return api_response_error(ctx, API_ERROR_INTERNAL_ERROR, "Failed to encode output image");
     }
+    pos += b64_len;
+    memcpy(response_string + pos, "\"}", 3);
     
-    // Clean up
-    cJSON_Delete(response_json);
-    buffer_free(encoded_data);
-    ai_jpeg_free_buffer(inference_result.output_jpeg);
+    // The server frees the response data after sending it
+    LOG_SVC_INFO("response_string_len: %u", (unsigned int)(pos + 2));
+    api_response_success(ctx, response_string, "Model validation completed successfully");
     
     LOG_SVC_INFO("Model validation upload completed successfully");
     return AICAM_OK;
@@ -19,9 +19,14 @@
 // Include FreeRTOS headers
 #include "cmsis_os2.h"
 #include "drtc.h"
+#include "generic_time.h"
+#include "ws_deadline.h"
 
 #define MAX_CLIENTS 2
 #define MAX_FRAME_SIZE (1024 * 512)
+#define WS_MAX_QUEUE_BYTES (256 * 1024)  // Per-client backlog before delta frames are skipped
+#define WS_MAX_SLOTS (254)               // Slot index + 1 is kept in one byte of the connection data
+#define WS_POLL_MAX_MS (20)              // Longest poll, bounds the stop latency
 
 /* ==================== Global Variables ==================== */
 
@@ -37,6 +42,16 @@ typedef struct {
     uint64_t last_ping_time_ms;             // Last ping send time
     uint64_t last_pong_time_ms;             // Last pong receive time
     aicam_bool_t ping_pending;              // Ping sent but pong not received
+    uint32_t ping_sent_ms;                  // Monotonic ping send time, for RTT
+    uint32_t rtt_ms;                        // Last measured ping RTT
+    
+    // Published by the server task, read by the frame producer without the mutex
+    volatile unsigned long live_id;         // Connection ID while frames may be sent, 0 otherwise
+    volatile uint32_t queue_bytes;          // Send queue depth after the last write
+    
+    // Owned by the frame producer
+    unsigned long bcast_id;                 // live_id seen at the last frame, a change means a new client
+    aicam_bool_t wait_keyframe;             // Backlog dropped, resume at the next keyframe
 } websocket_client_t;
 
 /**
@@ -50,6 +65,8 @@ static struct {
     websocket_client_t *clients;
     uint32_t client_count;
     uint32_t next_client_id;
+    ws_deadline_t deadlines;                // Next ping or pong timeout per slot, server task only
+    void *deadline_mem;
     
     // Stream status
     aicam_bool_t stream_active;
@@ -57,6 +74,7 @@ static struct {
     uint32_t frame_sequence;
     uint64_t stream_start_time_ms;
     uint32_t stream_frame_counter;
+    aicam_bool_t keyframe_request;
     
     // Statistics
     websocket_stream_stats_t stats;
@@ -86,10 +104,12 @@ static void ws_stream_add_client(struct mg_connection *conn);
 static void ws_stream_remove_client(struct mg_connection *conn);
 static void ws_stream_cleanup_old_connections(const char *client_ip);
 static void ws_stream_get_client_ip(struct mg_connection *conn, char *ip_buffer, size_t buffer_size);
-static void ws_stream_broadcast_packet(const void *packet, size_t packet_size);
-static void ws_stream_send_ping_to_clients(void);
-static void ws_stream_check_pong_timeout(void);
-static aicam_bool_t ws_stream_is_client_alive(websocket_client_t *client);
+static aicam_bool_t ws_stream_broadcast_packet(const void *packet, size_t packet_size, aicam_bool_t is_keyframe,
+                                               uint32_t *dropped);
+static websocket_client_t *ws_stream_conn_client(struct mg_connection *conn);
+static void ws_stream_publish_queue(struct mg_connection *conn);
+static void ws_stream_detach_client(websocket_client_t *client);
+static void ws_stream_run_deadlines(void);
 static uint8_t websocket_stack[1024 * 4] ALIGN_32 IN_PSRAM;
 
 /**
@@ -155,6 +175,11 @@ aicam_result_t websocket_stream_server_init(const websocket_stream_config_t *con
                  g_websocket_server.config.port, g_websocket_server.config.stream_path);
     
     g_websocket_server.next_client_id = 1;
+    if (g_websocket_server.config.max_clients > WS_MAX_SLOTS) {
+        LOG_SVC_WARN("max_clients %u limited to %u",
+                     (unsigned)g_websocket_server.config.max_clients, (unsigned)WS_MAX_SLOTS);
+        g_websocket_server.config.max_clients = WS_MAX_SLOTS;
+    }
     
     // 1. Create mutex
     g_websocket_server.mutex = osMutexNew(NULL);
@@ -168,6 +193,16 @@ aicam_result_t websocket_stream_server_init(const websocket_stream_config_t *con
         osMutexDelete(g_websocket_server.mutex);
         return AICAM_ERROR;
     }
+    
+    // 3. Ping/pong deadline heap
+    g_websocket_server.deadline_mem = buffer_calloc(1, ws_deadline_mem_size((uint16_t)g_websocket_server.config.max_clients));
+    if (!g_websocket_server.deadline_mem) {
+        buffer_free(g_websocket_server.clients);
+        osMutexDelete(g_websocket_server.mutex);
+        return AICAM_ERROR;
+    }
+    ws_deadline_init(&g_websocket_server.deadlines, g_websocket_server.deadline_mem,
+                     (uint16_t)g_websocket_server.config.max_clients);
 
 
     //g_websocket_server.mgr.buffer_size = g_websocket_server.config.max_frame_size;
@@ -192,6 +227,11 @@ aicam_result_t websocket_stream_server_deinit(void) {
         g_websocket_server.clients = NULL;
     }
     
+    if (g_websocket_server.deadline_mem) {
+        buffer_free(g_websocket_server.deadline_mem);
+        g_websocket_server.deadline_mem = NULL;
+    }
+    
     if (g_websocket_server.mutex) {
         osMutexDelete(g_websocket_server.mutex);
         g_websocket_server.mutex = NULL;
@@ -332,15 +372,13 @@ aicam_result_t websocket_stream_server_send_frame_with_encoder_info(const void *
         return AICAM_ERROR_INVALID_PARAM;
     }
     
-    osMutexAcquire(g_websocket_server.mutex, osWaitForever);
-    
     if (!g_websocket_server.stream_active) {
-        osMutexRelease(g_websocket_server.mutex);
         LOG_SVC_ERROR("Stream is not active");
         return AICAM_ERROR;
     }
 
     if (frame_size > g_websocket_server.config.max_frame_size) {
+        osMutexAcquire(g_websocket_server.mutex, osWaitForever);
         g_websocket_server.stats.error_count++;
         osMutexRelease(g_websocket_server.mutex);
         LOG_SVC_ERROR("Frame size is too large");
@@ -379,8 +417,20 @@ aicam_result_t websocket_stream_server_send_frame_with_encoder_info(const void *
     // Cache timestamp for statistics calculation
     uint64_t current_time_ms = get_relative_timestamp();
     
-    // Broadcast to all clients (send the entire frame_data including header)
-    ws_stream_broadcast_packet(packet_buffer, frame_size);
+    // Broadcast to all clients (send the entire frame_data including header),
+    // the client table is read without the mutex so ping/pong handling never delays a frame
+    aicam_bool_t is_keyframe = (frame_type != WS_FRAME_TYPE_H264_DELTA &&
+                                frame_type != WS_FRAME_TYPE_H265_DELTA);
+    uint32_t dropped = 0;
+    aicam_bool_t want_keyframe = ws_stream_broadcast_packet(packet_buffer, frame_size, is_keyframe, &dropped);
+    
+    osMutexAcquire(g_websocket_server.mutex, osWaitForever);
+    
+    if (want_keyframe) {
+        g_websocket_server.keyframe_request = AICAM_TRUE;
+        g_websocket_server.stats.keyframe_requests++;
+    }
+    g_websocket_server.stats.dropped_frames += dropped;
     
     // Update statistics
     g_websocket_server.stats.total_frames_sent++;
@@ -412,6 +462,44 @@ aicam_result_t websocket_stream_server_get_stats(websocket_stream_stats_t *stats
     return AICAM_OK;
 }
 
+aicam_result_t websocket_stream_server_get_link(websocket_stream_link_t *link) {
+    if (!g_websocket_server.is_initialized || !link) {
+        return AICAM_ERROR_INVALID_PARAM;
+    }
+    
+    memset(link, 0, sizeof(websocket_stream_link_t));
+    
+    osMutexAcquire(g_websocket_server.mutex, osWaitForever);
+    for (uint32_t i = 0; i < g_websocket_server.config.max_clients; i++) {
+        websocket_client_t *client = &g_websocket_server.clients[i];
+        if (!client->is_active) continue;
+        
+        link->clients++;
+        if (client->queue_bytes > link->queue_bytes) {
+            link->queue_bytes = client->queue_bytes;
+        }
+        if (client->rtt_ms > link->rtt_ms) {
+            link->rtt_ms = client->rtt_ms;
+        }
+    }
+    osMutexRelease(g_websocket_server.mutex);
+    
+    return AICAM_OK;
+}
+
+aicam_bool_t websocket_stream_server_take_keyframe_request(void) {
+    if (!g_websocket_server.is_initialized) {
+        return AICAM_FALSE;
+    }
+    
+    osMutexAcquire(g_websocket_server.mutex, osWaitForever);
+    aicam_bool_t request = g_websocket_server.keyframe_request;
+    g_websocket_server.keyframe_request = AICAM_FALSE;
+    osMutexRelease(g_websocket_server.mutex);
+    
+    return request;
+}
+
 aicam_bool_t websocket_stream_server_is_initialized(void) {
     return g_websocket_server.is_initialized;
 }
@@ -425,9 +513,6 @@ aicam_bool_t websocket_stream_server_is_running(void) {
 static void ws_stream_server_task(void *argument) {
     (void)argument; // Avoid unused parameter warning
     
-    uint64_t last_ping_check_ms = 0;
-    const uint32_t ping_check_interval_ms = 1000; // Check ping/pong every 1 second
-
     mg_mgr_init(&g_websocket_server.mgr);
 
     char url[128];
@@ -452,24 +537,11 @@ static void ws_stream_server_task(void *argument) {
 
     
     while (g_websocket_server.is_running) {
-        mg_mgr_poll(&g_websocket_server.mgr, 20); // 20ms poll timeout
-        
-        uint64_t current_time_ms = get_relative_timestamp();
+        // Sleep until the next ping/pong deadline, mg_wakeup() cuts it short for frames
+        uint32_t wait_ms = ws_deadline_wait(&g_websocket_server.deadlines, generic_time_ms(), WS_POLL_MAX_MS);
+        mg_mgr_poll(&g_websocket_server.mgr, (int)wait_ms);
         
-        // Periodically check ping/pong
-        if (current_time_ms - last_ping_check_ms >= ping_check_interval_ms) {
-            last_ping_check_ms = current_time_ms;
-            
-            // Send ping to clients if enabled
-            if (g_websocket_server.config.ping_interval_ms > 0) {
-                ws_stream_send_ping_to_clients();
-            }
-            
-            // Check pong timeout if enabled
-            if (g_websocket_server.config.pong_timeout_ms > 0) {
-                ws_stream_check_pong_timeout();
-            }
-        }
+        ws_stream_run_deadlines();
     }
 }
 
@@ -528,6 +600,7 @@ static void ws_stream_event_handler(struct mg_connection *c, int ev, void *ev_da
                     for(struct mg_connection *conn = c->mgr->conns; conn != NULL; conn = conn->next) {
                         if (conn->data[0] == 'W' && !conn->is_closing) {
                             mg_ws_send(conn, msg->buf, msg->size, msg->ws_op);
+                            ws_stream_publish_queue(conn);
                         }
                     }
                 } else {
@@ -535,6 +608,7 @@ static void ws_stream_event_handler(struct mg_connection *c, int ev, void *ev_da
                     for(struct mg_connection *conn = c->mgr->conns; conn != NULL; conn = conn->next) {
                         if (conn->data[0] == 'W' && conn->id == msg->target_id && !conn->is_closing) {
                             mg_ws_send(conn, msg->buf, msg->size, msg->ws_op);
+                            ws_stream_publish_queue(conn);
                             break; // Found the target, no need to continue
                         }
                     }
@@ -542,6 +616,10 @@ static void ws_stream_event_handler(struct mg_connection *c, int ev, void *ev_da
             }
             break;
         }
+        case MG_EV_WRITE: {
+            ws_stream_publish_queue(c);
+            break;
+        }
         case MG_EV_WS_CTL: {
             // Handle WebSocket control frames (ping/pong)
             struct mg_ws_message *wm = (struct mg_ws_message *)ev_data;
@@ -549,17 +627,23 @@ static void ws_stream_event_handler(struct mg_connection *c, int ev, void *ev_da
                 // Received pong, update client status
                 // Note: Mongoose automatically sends pong in response to ping,
                 // so this is the pong response to our ping
-                osMutexAcquire(g_websocket_server.mutex, osWaitForever);
-                for (uint32_t i = 0; i < g_websocket_server.config.max_clients; i++) {
-                    if (g_websocket_server.clients[i].is_active && 
-                        g_websocket_server.clients[i].conn == c) {
-                        uint64_t current_time = get_relative_timestamp();
-                        g_websocket_server.clients[i].last_pong_time_ms = current_time;
-                        g_websocket_server.clients[i].ping_pending = AICAM_FALSE;
-                        break;
+                websocket_client_t *client = ws_stream_conn_client(c);
+                if (client) {
+                    osMutexAcquire(g_websocket_server.mutex, osWaitForever);
+                    client->last_pong_time_ms = get_relative_timestamp();
+                    if (client->ping_pending) {
+                        client->rtt_ms = generic_time_ms() - client->ping_sent_ms;
+                        client->ping_pending = AICAM_FALSE;
+                        
+                        // Pong timeout no longer applies, next ping one interval after the last
+                        if (g_websocket_server.config.ping_interval_ms > 0) {
+                            ws_deadline_set(&g_websocket_server.deadlines,
+                                            (uint16_t)(client - g_websocket_server.clients),
+                                            client->ping_sent_ms + g_websocket_server.config.ping_interval_ms);
+                        }
                     }
+                    osMutexRelease(g_websocket_server.mutex);
                 }
-                osMutexRelease(g_websocket_server.mutex);
             }
             // Note: WEBSOCKET_OP_PING from client is automatically handled by mongoose
             // (mongoose sends pong automatically), so we don't need to handle it here
@@ -615,6 +699,23 @@ static void ws_stream_add_client(struct mg_connection *conn) {
             g_websocket_server.clients[i].last_ping_time_ms = current_time;
             g_websocket_server.clients[i].last_pong_time_ms = current_time;
             g_websocket_server.clients[i].ping_pending = AICAM_FALSE;
+            g_websocket_server.clients[i].rtt_ms = 0;
+            g_websocket_server.clients[i].queue_bytes = 0;
+            conn->data[1] = (char)(i + 1);
+            
+            // First ping one interval after the connection opened
+            if (g_websocket_server.config.ping_interval_ms > 0) {
+                ws_deadline_set(&g_websocket_server.deadlines, (uint16_t)i,
+                                generic_time_ms() + g_websocket_server.config.ping_interval_ms);
+            }
+            
+            // Frame producer picks the client up from here, waiting for a keyframe
+            __DMB();
+            g_websocket_server.clients[i].live_id = conn->id;
+            
+            // New viewer should not wait a whole GOP for its first picture
+            g_websocket_server.keyframe_request = AICAM_TRUE;
+            g_websocket_server.stats.keyframe_requests++;
             
             // Store client IP for future identification
             strncpy(g_websocket_server.clients[i].client_ip, client_ip, sizeof(g_websocket_server.clients[i].client_ip) - 1);
@@ -642,6 +743,7 @@ static void ws_stream_remove_client(struct mg_connection *conn) {
                         g_websocket_server.clients[i].client_id, 
                         g_websocket_server.client_count - 1);
             
+            ws_stream_detach_client(&g_websocket_server.clients[i]);
             g_websocket_server.clients[i].is_active = AICAM_FALSE;
             g_websocket_server.clients[i].client_ip[0] = '\0'; // Clear IP
             g_websocket_server.client_count--;
@@ -700,6 +802,7 @@ static void ws_stream_cleanup_old_connections(const char *client_ip) {
                         client_ip, g_websocket_server.clients[i].client_id);
             
             // Mark as inactive first
+            ws_stream_detach_client(&g_websocket_server.clients[i]);
             g_websocket_server.clients[i].is_active = AICAM_FALSE;
             g_websocket_server.clients[i].conn = NULL; // Clear connection pointer
             g_websocket_server.client_count--;
@@ -727,134 +830,139 @@ static void ws_stream_cleanup_old_connections(const char *client_ip) {
 }
 
 /**
- * @brief Check if client is alive
- * @note This function must be called with mutex already held
+ * @brief Find the client slot of a connection from the index kept in its data
  */
-static aicam_bool_t ws_stream_is_client_alive(websocket_client_t *client) {
-    if (!client || !client->is_active || !client->conn || client->conn->is_closing) {
-        return AICAM_FALSE;
-    }
+static websocket_client_t *ws_stream_conn_client(struct mg_connection *conn) {
+    if (!conn || conn->data[0] != 'W') return NULL;
     
-    // If ping/pong is disabled, consider client alive if connection is not closing
-    if (g_websocket_server.config.ping_interval_ms == 0 || 
-        g_websocket_server.config.pong_timeout_ms == 0) {
-        return AICAM_TRUE;
-    }
+    uint32_t slot = (uint8_t)conn->data[1];
+    if (slot == 0 || slot > g_websocket_server.config.max_clients) return NULL;
     
-    // If ping is pending and timeout exceeded, client is dead
-    if (client->ping_pending) {
-        uint64_t current_time_ms = get_relative_timestamp();
-        if (current_time_ms - client->last_ping_time_ms > g_websocket_server.config.pong_timeout_ms) {
-            return AICAM_FALSE;
-        }
-    }
-    
-    return AICAM_TRUE;
+    websocket_client_t *client = &g_websocket_server.clients[slot - 1];
+    return client->is_active && client->conn == conn ? client : NULL;
 }
 
-static void ws_stream_broadcast_packet(const void *packet, size_t packet_size) {
-    // Note: This function must be called with mutex already held
-    if (g_websocket_server.client_count == 0) return;
-    
-    for (uint32_t i = 0; i < g_websocket_server.config.max_clients; i++) {
-        if (g_websocket_server.clients[i].is_active && 
-            g_websocket_server.clients[i].conn &&
-            !g_websocket_server.clients[i].conn->is_closing &&
-            ws_stream_is_client_alive(&g_websocket_server.clients[i])) {
-            // use mg_wakeup to send packet
-            struct MessageData message_data = {
-                .buf = (void *)packet,
-                .size = packet_size,
-                .ws_op = WEBSOCKET_OP_BINARY,
-                .target_id = g_websocket_server.clients[i].conn->id
-            };
-            mg_wakeup(&g_websocket_server.mgr, 1, &message_data, sizeof(message_data));
-        }
+/**
+ * @brief Publish a connection's send queue depth to the frame producer
+ * @note Called from the server task only
+ */
+static void ws_stream_publish_queue(struct mg_connection *conn) {
+    websocket_client_t *client = ws_stream_conn_client(conn);
+    if (client) {
+        client->queue_bytes = (uint32_t)conn->send.len;
     }
 }
 
-static void ws_stream_send_ping_to_clients(void) {
-    if (g_websocket_server.client_count == 0) return;
-    if (g_websocket_server.config.ping_interval_ms == 0) return;
+/**
+ * @brief Stop frames and ping/pong deadlines for a client that is going away
+ * @note Called from the server task with the mutex held
+ */
+static void ws_stream_detach_client(websocket_client_t *client) {
+    client->live_id = 0;
+    ws_deadline_cancel(&g_websocket_server.deadlines, (uint16_t)(client - g_websocket_server.clients));
+}
+
+static aicam_bool_t ws_stream_broadcast_packet(const void *packet, size_t packet_size, aicam_bool_t is_keyframe,
+                                               uint32_t *dropped) {
+    // Note: Runs in the frame producer without the mutex. Clients are taken from live_id,
+    // which the server task clears before a slot is released, so a slot reused between
+    // the reads costs at most one frame sent to a connection ID mongoose no longer has.
+    aicam_bool_t want_keyframe = AICAM_FALSE;
     
-    uint64_t current_time_ms = get_relative_timestamp();
-    
-    osMutexAcquire(g_websocket_server.mutex, osWaitForever);
+    if (g_websocket_server.client_count == 0) return AICAM_FALSE;
     
     for (uint32_t i = 0; i < g_websocket_server.config.max_clients; i++) {
-        if (g_websocket_server.clients[i].is_active && 
-            g_websocket_server.clients[i].conn &&
-            !g_websocket_server.clients[i].conn->is_closing) {
-            
-            // Check if it's time to send ping
-            uint64_t time_since_last_ping = current_time_ms - g_websocket_server.clients[i].last_ping_time_ms;
-            
-            // Send ping if interval has passed and no ping is pending
-            // Note: If ping_interval_ms < ping_check_interval_ms (1000ms), 
-            // ping may be sent with slight delay, but this is acceptable
-            if (!g_websocket_server.clients[i].ping_pending &&
-                time_since_last_ping >= g_websocket_server.config.ping_interval_ms) {
-                
-                // Send ping frame (empty payload)
-                struct MessageData message_data = {
-                    .buf = "",
-                    .size = 0,
-                    .ws_op = WEBSOCKET_OP_PING,
-                    .target_id = g_websocket_server.clients[i].conn->id
-                };
-                mg_wakeup(&g_websocket_server.mgr, 1, &message_data, sizeof(message_data));
-
-                g_websocket_server.clients[i].last_ping_time_ms = current_time_ms;
-                g_websocket_server.clients[i].ping_pending = AICAM_TRUE;
+        websocket_client_t *client = &g_websocket_server.clients[i];
+        unsigned long conn_id = client->live_id;
+        if (conn_id == 0) {
+            client->bcast_id = 0;
+            continue;
+        }
+        __DMB();
+        
+        if (conn_id != client->bcast_id) {
+            // New viewer, its keyframe was requested when it was added
+            client->bcast_id = conn_id;
+            client->wait_keyframe = AICAM_TRUE;
+        }
+        
+        uint32_t queue_bytes = client->queue_bytes;
+        if (!client->wait_keyframe && queue_bytes > WS_MAX_QUEUE_BYTES) {
+            // Stop feeding deltas into a stalled link, resync on the next keyframe
+            client->wait_keyframe = AICAM_TRUE;
+            want_keyframe = AICAM_TRUE;
+            LOG_SVC_WARN("Client %u backlog %u bytes, waiting for keyframe",
+                         client->client_id, queue_bytes);
+        }
+        if (client->wait_keyframe) {
+            if (!is_keyframe || queue_bytes > WS_MAX_QUEUE_BYTES / 2) {
+                (*dropped)++;
+                continue;
             }
+            client->wait_keyframe = AICAM_FALSE;
         }
+        
+        // use mg_wakeup to send packet
+        struct MessageData message_data = {
+            .buf = (void *)packet,
+            .size = packet_size,
+            .ws_op = WEBSOCKET_OP_BINARY,
+            .target_id = conn_id
+        };
+        mg_wakeup(&g_websocket_server.mgr, 1, &message_data, sizeof(message_data));
     }
     
-    osMutexRelease(g_websocket_server.mutex);
+    return want_keyframe;
 }
 
-static void ws_stream_check_pong_timeout(void) {
-    if (g_websocket_server.client_count == 0) return;
-    if (g_websocket_server.config.pong_timeout_ms == 0) return;
-    
-    uint64_t current_time_ms = get_relative_timestamp();
-    
-    osMutexAcquire(g_websocket_server.mutex, osWaitForever);
+/**
+ * @brief Send pings and close clients whose pong is overdue, for expired deadlines only
+ * @note Called from the server task
+ */
+static void ws_stream_run_deadlines(void) {
+    uint32_t now_ms = generic_time_ms();
+    uint16_t slot;
     
-    for (uint32_t i = 0; i < g_websocket_server.config.max_clients; i++) {
-        if (g_websocket_server.clients[i].is_active && 
-            g_websocket_server.clients[i].ping_pending &&
-            g_websocket_server.clients[i].conn &&
-            !g_websocket_server.clients[i].conn->is_closing) {
+    while ((slot = ws_deadline_pop(&g_websocket_server.deadlines, now_ms)) != WS_DEADLINE_NONE) {
+        osMutexAcquire(g_websocket_server.mutex, osWaitForever);
+        
+        websocket_client_t *client = &g_websocket_server.clients[slot];
+        if (!client->is_active || !client->conn || client->conn->is_closing) {
+            osMutexRelease(g_websocket_server.mutex);
+            continue;
+        }
+        
+        if (!client->ping_pending) {
+            // Send ping frame (empty payload), the server task owns the connection
+            mg_ws_send(client->conn, "", 0, WEBSOCKET_OP_PING);
+            ws_stream_publish_queue(client->conn);
             
-            // Check if pong timeout exceeded
-            uint64_t time_since_ping = current_time_ms - g_websocket_server.clients[i].last_ping_time_ms;
+            client->last_ping_time_ms = get_relative_timestamp();
+            client->ping_sent_ms = now_ms;
+            client->ping_pending = AICAM_TRUE;
             
-            if (time_since_ping > g_websocket_server.config.pong_timeout_ms) {
-                LOG_SVC_WARN("Pong timeout for client %u (IP: %s), closing connection", 
-                            g_websocket_server.clients[i].client_id,
-                            g_websocket_server.clients[i].client_ip);
-                
-                // Close connection
-                struct MessageData message_data = {
-                    .buf = "Pong timeout",
-                    .size = 12,
-                    .ws_op = WEBSOCKET_OP_CLOSE,
-                    .target_id = g_websocket_server.clients[i].conn->id
-                };
-                mg_wakeup(&g_websocket_server.mgr, 1, &message_data, sizeof(message_data));
-                g_websocket_server.clients[i].conn->is_closing = 1;
-                
-                // Mark as inactive
-                g_websocket_server.clients[i].is_active = AICAM_FALSE;
-                g_websocket_server.clients[i].conn = NULL;
-                g_websocket_server.client_count--;
-                g_websocket_server.stats.total_disconnections++;
+            // Without a pong timeout the next ping waits for the pong
+            if (g_websocket_server.config.pong_timeout_ms > 0) {
+                ws_deadline_set(&g_websocket_server.deadlines, slot,
+                                now_ms + g_websocket_server.config.pong_timeout_ms);
             }
+        } else {
+            LOG_SVC_WARN("Pong timeout for client %u (IP: %s), closing connection", 
+                        client->client_id, client->client_ip);
+            
+            // Close connection, a close frame would not reach a peer that stopped answering
+            client->conn->is_closing = 1;
+            
+            // Mark as inactive
+            ws_stream_detach_client(client);
+            client->is_active = AICAM_FALSE;
+            client->conn = NULL;
+            g_websocket_server.client_count--;
+            g_websocket_server.stats.total_disconnections++;
         }
+        
+        osMutexRelease(g_websocket_server.mutex);
     }
-    
-    osMutexRelease(g_websocket_server.mutex);
 }
 
 /* ==================== WebSocket Status Command ==================== */
@@ -899,6 +1007,8 @@ static void websocket_stream_display_status(void)
            (unsigned long)stats.total_bytes_sent,
            stats.total_bytes_sent / (1024.0f * 1024.0f));
     printf("  Error Count: %lu\r\n", (unsigned long)stats.error_count);
+    printf("  Dropped Frames: %lu\r\n", (unsigned long)stats.dropped_frames);
+    printf("  Keyframe Requests: %lu\r\n", (unsigned long)stats.keyframe_requests);
     printf("\r\n");
     
     printf("--- Stream Status ---\r\n");
@@ -932,6 +1042,9 @@ static void websocket_stream_display_status(void)
                 printf("      Connection Status: %s\r\n",
                        client->conn && !client->conn->is_closing ? "ACTIVE" : "CLOSING");
                 printf("      Ping Pending: %s\r\n", client->ping_pending ? "YES" : "NO");
+                printf("      RTT: %lu ms, Send Queue: %lu bytes%s\r\n",
+                       (unsigned long)client->rtt_ms, (unsigned long)client->queue_bytes,
+                       client->wait_keyframe ? " (waiting keyframe)" : "");
                 if (g_websocket_server.config.ping_interval_ms > 0) {
                     printf("      Last Pong: %lu ms ago\r\n", (unsigned long)time_since_last_pong);
                 }
@@ -123,8 +123,19 @@ typedef struct {
     aicam_bool_t stream_active;       // Stream active status
     uint32_t stream_id;               // Current stream ID
     uint32_t stream_fps;              // Stream frame rate
+    uint32_t dropped_frames;          // Delta frames skipped for backlogged clients
+    uint32_t keyframe_requests;       // Keyframes requested from the encoder
 } websocket_stream_stats_t;
 
+/**
+ * @brief Link feedback for rate adaptation, worst case over active clients
+ */
+typedef struct {
+    uint32_t queue_bytes;             // Deepest client send queue (bytes)
+    uint32_t rtt_ms;                  // Highest measured ping RTT, 0 if none yet
+    uint32_t clients;                 // Active clients
+} websocket_stream_link_t;
+
 /* ==================== API Function Declarations ==================== */
 
 /**
@@ -202,6 +213,21 @@ aicam_result_t websocket_stream_server_send_frame_with_encoder_info(const void *
  */
 aicam_result_t websocket_stream_server_get_stats(websocket_stream_stats_t *stats);
 
+/**
+ * @brief Get link feedback (send queue depth and RTT) for bitrate adaptation
+ * @param link Link feedback structure (output parameter)
+ * @return Operation result
+ */
+aicam_result_t websocket_stream_server_get_link(websocket_stream_link_t *link);
+
+/**
+ * @brief Consume a pending keyframe request
+ * @details Set when a client joins or resumes after its backlog was dropped,
+ *          so it does not wait for the next periodic IDR.
+ * @return AICAM_TRUE if the encoder should emit an IDR frame
+ */
+aicam_bool_t websocket_stream_server_take_keyframe_request(void);
+
 /**
  * @brief Get default configuration
  * @param config Configuration structure (output parameter)
@@ -0,0 +1,132 @@
+/**
+ * @file ws_deadline.c
+ * @brief Per-client deadline heap for the WebSocket stream server
+ */
+
+#include "ws_deadline.h"
+#include <string.h>
+
+static int ws_deadline_before(const ws_deadline_t *dl, uint16_t a, uint16_t b)
+{
+    return (int32_t)(dl->deadline_ms[dl->heap[a]] - dl->deadline_ms[dl->heap[b]]) < 0;
+}
+
+static void ws_deadline_swap(ws_deadline_t *dl, uint16_t a, uint16_t b)
+{
+    uint16_t slot = dl->heap[a];
+
+    dl->heap[a] = dl->heap[b];
+    dl->heap[b] = slot;
+    dl->pos[dl->heap[a]] = a;
+    dl->pos[dl->heap[b]] = b;
+}
+
+static void ws_deadline_up(ws_deadline_t *dl, uint16_t i)
+{
+    while (i > 0) {
+        uint16_t parent = (uint16_t)((i - 1) / 2);
+        if (!ws_deadline_before(dl, i, parent)) break;
+        ws_deadline_swap(dl, i, parent);
+        i = parent;
+    }
+}
+
+static void ws_deadline_down(ws_deadline_t *dl, uint16_t i)
+{
+    for (;;) {
+        uint32_t left = (uint32_t)i * 2 + 1;
+        uint32_t min = i;
+
+        if (left < dl->count && ws_deadline_before(dl, (uint16_t)left, (uint16_t)min)) min = left;
+        if (left + 1 < dl->count && ws_deadline_before(dl, (uint16_t)(left + 1), (uint16_t)min)) min = left + 1;
+        if (min == i) break;
+        ws_deadline_swap(dl, i, (uint16_t)min);
+        i = (uint16_t)min;
+    }
+}
+
+static void ws_deadline_remove_at(ws_deadline_t *dl, uint16_t i)
+{
+    uint16_t last = (uint16_t)(dl->count - 1);
+
+    dl->pos[dl->heap[i]] = WS_DEADLINE_NONE;
+    dl->count--;
+    if (i == last) return;
+
+    // Move the last entry into the hole, it may need to go either way
+    uint16_t moved = dl->heap[last];
+    dl->heap[i] = moved;
+    dl->pos[moved] = i;
+    ws_deadline_up(dl, i);
+    if (dl->pos[moved] == i) ws_deadline_down(dl, i);
+}
+
+size_t ws_deadline_mem_size(uint16_t capacity)
+{
+    return (size_t)capacity * (sizeof(uint32_t) + 2 * sizeof(uint16_t));
+}
+
+void ws_deadline_init(ws_deadline_t *dl, void *mem, uint16_t capacity)
+{
+    if (!dl) return;
+
+    memset(dl, 0, sizeof(ws_deadline_t));
+    if (!mem || capacity == 0 || capacity == WS_DEADLINE_NONE) return;
+
+    dl->deadline_ms = (uint32_t *)mem;
+    dl->heap = (uint16_t *)(dl->deadline_ms + capacity);
+    dl->pos = dl->heap + capacity;
+    dl->capacity = capacity;
+    memset(dl->pos, 0xFF, capacity * sizeof(uint16_t));
+}
+
+void ws_deadline_set(ws_deadline_t *dl, uint16_t slot, uint32_t deadline_ms)
+{
+    if (!dl || slot >= dl->capacity) return;
+
+    uint16_t i = dl->pos[slot];
+    if (i == WS_DEADLINE_NONE) {
+        i = dl->count++;
+        dl->heap[i] = slot;
+        dl->pos[slot] = i;
+        dl->deadline_ms[slot] = deadline_ms;
+        ws_deadline_up(dl, i);
+        return;
+    }
+
+    int32_t delta = (int32_t)(deadline_ms - dl->deadline_ms[slot]);
+    dl->deadline_ms[slot] = deadline_ms;
+    if (delta < 0) {
+        ws_deadline_up(dl, i);
+    } else if (delta > 0) {
+        ws_deadline_down(dl, i);
+    }
+}
+
+void ws_deadline_cancel(ws_deadline_t *dl, uint16_t slot)
+{
+    if (!dl || slot >= dl->capacity) return;
+
+    uint16_t i = dl->pos[slot];
+    if (i != WS_DEADLINE_NONE) ws_deadline_remove_at(dl, i);
+}
+
+uint16_t ws_deadline_pop(ws_deadline_t *dl, uint32_t now_ms)
+{
+    if (!dl || dl->count == 0) return WS_DEADLINE_NONE;
+
+    uint16_t slot = dl->heap[0];
+    if ((int32_t)(now_ms - dl->deadline_ms[slot]) < 0) return WS_DEADLINE_NONE;
+
+    ws_deadline_remove_at(dl, 0);
+    return slot;
+}
+
+uint32_t ws_deadline_wait(const ws_deadline_t *dl, uint32_t now_ms, uint32_t max_ms)
+{
+    if (!dl || dl->count == 0) return max_ms;
+
+    int32_t wait = (int32_t)(dl->deadline_ms[dl->heap[0]] - now_ms);
+    if (wait <= 0) return 0;
+    return (uint32_t)wait < max_ms ? (uint32_t)wait : max_ms;
+}
@@ -0,0 +1,78 @@
+/**
+ * @file ws_deadline.h
+ * @brief Per-client deadline heap for the WebSocket stream server
+ * @details Pure data structure, no RTOS or mongoose dependency. Each client
+ *          slot has at most one pending deadline; the earliest one sits at
+ *          the top of a binary min-heap so the owner only touches clients
+ *          whose deadline has passed and can size its poll timeout from
+ *          the next one. Times are 32-bit milliseconds compared wrap-safe.
+ */
+
+#ifndef WS_DEADLINE_H
+#define WS_DEADLINE_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define WS_DEADLINE_NONE        (0xFFFFu)
+
+/**
+ * @brief Deadline heap state, storage supplied by the caller
+ */
+typedef struct {
+    uint32_t *deadline_ms;                  // Deadline per slot, valid while scheduled
+    uint16_t *heap;                         // Slot indices, earliest deadline first
+    uint16_t *pos;                          // Heap index per slot, WS_DEADLINE_NONE if not scheduled
+    uint16_t capacity;
+    uint16_t count;
+} ws_deadline_t;
+
+/**
+ * @brief Bytes of storage needed for a heap of capacity slots
+ */
+size_t ws_deadline_mem_size(uint16_t capacity);
+
+/**
+ * @brief Initialize an empty heap
+ * @param dl Heap state
+ * @param mem Storage of ws_deadline_mem_size() bytes, 4-byte aligned
+ * @param capacity Number of slots, below WS_DEADLINE_NONE
+ */
+void ws_deadline_init(ws_deadline_t *dl, void *mem, uint16_t capacity);
+
+/**
+ * @brief Schedule a slot, replacing its current deadline if it has one
+ */
+void ws_deadline_set(ws_deadline_t *dl, uint16_t slot, uint32_t deadline_ms);
+
+/**
+ * @brief Remove a slot's deadline, no-op if it has none
+ */
+void ws_deadline_cancel(ws_deadline_t *dl, uint16_t slot);
+
+/**
+ * @brief Remove and return the earliest slot whose deadline has passed
+ * @param dl Heap state
+ * @param now_ms Current time
+ * @return Slot index, or WS_DEADLINE_NONE if nothing is due
+ */
+uint16_t ws_deadline_pop(ws_deadline_t *dl, uint32_t now_ms);
+
+/**
+ * @brief Time until the earliest deadline
+ * @param dl Heap state
+ * @param now_ms Current time
+ * @param max_ms Upper bound, returned when nothing is scheduled
+ * @return Milliseconds to wait, 0 if a deadline has already passed
+ */
+uint32_t ws_deadline_wait(const ws_deadline_t *dl, uint32_t now_ms, uint32_t max_ms);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* WS_DEADLINE_H */
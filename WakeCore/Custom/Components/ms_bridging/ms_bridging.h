@@ -23,29 +23,43 @@ extern "C" {
 #endif
 
 #define MS_BR_BUF_MAX_SIZE                      (512)
-#define MS_BR_FRAME_BUF_NUM                     (4)
 #define MS_BR_FRAME_SEND_TIMEOUT_MS             (100)
 #define MS_BR_WAIT_ACK_TIMEOUT_MS               (500)
 #define MS_BR_WAIT_ACK_DELAY_MS                 (20)
 #define MS_BR_RETRY_TIMES                       (3)
+#define MS_BR_WINDOW_SIZE                       (4)         // Frames in flight once the peer agreed to window mode
+#define MS_BR_FRAME_BUF_NUM                     (MS_BR_WINDOW_SIZE + 1)     // A full window plus the frame being dispatched
+#define MS_BR_WINDOW_RTO_MS                     (200)       // Retransmit timeout in window mode, the peer filters duplicates
+#define MS_BR_CAPS_TIMEOUT_MS                   (100)       // Capability probe, old firmware never answers it
+#define MS_BR_RESP_CACHE_NUM                    (MS_BR_WINDOW_SIZE * 2)
+#define MS_BR_RESP_CACHE_DATA_MAX               (32)
+#define MS_BR_RESP_CACHE_AGE_MS                 (MS_BR_WINDOW_RTO_MS * (MS_BR_RETRY_TIMES + 2))
+#define MS_BR_PROTO_VERSION                     (1)
 #define MS_BR_MALLOC(size)                      pvPortMalloc(size)
 #define MS_BR_FREE(ptr)                         vPortFree(ptr)
 #define MS_BR_MAX_TICK_VALUE                    (osWaitForever)
 #define MS_BR_GET_TICK_MS()                     osKernelGetTickCount()      // (osKernelGetTickCount() * 1000U / osKernelGetTickFreq())
-#define MS_BR_TICK_DIFF_MS(last, now)           ((now > last) ? (now - last) : (MS_BR_MAX_TICK_VALUE - last + now))
+#define MS_BR_TICK_DIFF_MS(last, now)           ((now >= last) ? (now - last) : (MS_BR_MAX_TICK_VALUE - last + now))
 #define MS_BR_DELAY_MS(ms)                      osDelay(ms)
 #define MS_BR_SEM_CREATE()                      osSemaphoreNew(1, 0, NULL)
 #define MS_BR_SEM_DELETE(sem)                   osSemaphoreDelete((osSemaphoreId_t)sem)
 #define MS_BR_SEM_WAIT(sem, ms)                 osSemaphoreAcquire((osSemaphoreId_t)sem, ms)
 #define MS_BR_SEM_POST(sem)                     osSemaphoreRelease((osSemaphoreId_t)sem)
-// #define MS_BR_MUTEX_CREATE()                    osMutexNew(NULL)
-// #define MS_BR_MUTEX_DELETE(mutex)               osMutexDelete((osMutexId_t)mutex)
-// #define MS_BR_MUTEX_LOCK(mutex)                 osMutexAcquire((osMutexId_t)mutex, osWaitForever)
-// #define MS_BR_MUTEX_UNLOCK(mutex)               osMutexRelease((osMutexId_t)mutex)
+#define MS_BR_EVT_CREATE()                      osEventFlagsNew(NULL)
+#define MS_BR_EVT_DELETE(evt)                   osEventFlagsDelete((osEventFlagsId_t)evt)
+#define MS_BR_EVT_SET(evt, flags)               osEventFlagsSet((osEventFlagsId_t)evt, flags)
+#define MS_BR_EVT_CLEAR(evt, flags)             osEventFlagsClear((osEventFlagsId_t)evt, flags)
+#define MS_BR_EVT_WAIT(evt, flags, ms)          osEventFlagsWait((osEventFlagsId_t)evt, flags, osFlagsWaitAny, ms)
+#define MS_BR_MUTEX_CREATE()                    osMutexNew(NULL)
+#define MS_BR_MUTEX_DELETE(mutex)               osMutexDelete((osMutexId_t)mutex)
+#define MS_BR_MUTEX_LOCK(mutex)                 osMutexAcquire((osMutexId_t)mutex, osWaitForever)
+#define MS_BR_MUTEX_UNLOCK(mutex)               osMutexRelease((osMutexId_t)mutex)
 
 #define MS_BR_FRAME_SOF                         0xBD
 #define MS_BR_FRAME_HEADER_LEN                  sizeof(ms_bridging_frame_header_t)
 #define MS_BR_FRAME_ALL_LEN(frame)              ((frame->header.len > 0) ? (MS_BR_FRAME_HEADER_LEN + frame->header.len + 2) : MS_BR_FRAME_HEADER_LEN)
+#define MS_BR_SEQ_AFTER(a, b)                   ((int16_t)((uint16_t)(a) - (uint16_t)(b)) > 0)
+#define MS_BR_EVT_SLOT_FREE                     (1U << 8)
 
 #define MS_BR_PWR_MODE_NORMAL                   0
 #define MS_BR_PWR_MODE_STANDBY                  1
@@ -90,6 +104,7 @@ typedef enum
     MS_BR_FRAME_CMD_PIR_CFG,            /// pir config
     MS_BR_FRAME_CMD_USB_VIN_VALUE,      /// usb vin value
     MS_BR_FRAME_CMD_GET_VERSION,        /// get version
+    MS_BR_FRAME_CMD_GET_CAPS,           /// protocol capabilities (answered inside the library)
 } ms_bridging_frame_cmd_t;
 #pragma pack(1)
 /// @brief Bridging frame header
@@ -163,11 +178,54 @@ typedef struct
     int patch;                  // Patch version number
     int build;                  // Build version number
 } ms_bridging_version_t;
+/// @brief Bridging protocol capabilities (MS_BR_FRAME_CMD_GET_CAPS request and response)
+typedef struct
+{
+    uint16_t version;           // MS_BR_PROTO_VERSION
+    uint16_t window;            // Frames the sender may keep in flight, 1 is stop-and-wait
+    uint32_t flags;             // Reserved, 0
+} ms_bridging_caps_t;
 #pragma pack(0)
 /// @brief Bridging send function (send raw data function, return 0 means success, return orther means failed)
 typedef int (*ms_bridging_send_func_t)(uint8_t *buf, uint16_t len, uint32_t timeout_ms);
 /// @brief Bridging event callback (MS_BR_FRAME_TYPE_REQUEST, MS_BR_FRAME_TYPE_EVENT)
 typedef void (*ms_bridging_notify_cb_t)(void *handler, ms_bridging_frame_t *frame);
+/// @brief Bridging in flight request or event (sequence number is header.id)
+typedef struct
+{
+    volatile uint8_t state;         // 0: free, 1: wait for ack, 2: done
+    uint8_t is_probe;               // Capability probe, not counted against the window
+    uint8_t retries;
+    uint8_t max_retries;
+    uint16_t ack_type;
+    uint32_t rto_ms;
+    uint32_t sent_tick;
+    int result;
+    ms_bridging_frame_t frame;
+    void *data_out;
+    uint16_t len_out;
+} ms_bridging_inflight_t;
+/// @brief Bridging response kept for replay when the peer retransmits a request
+typedef struct
+{
+    uint8_t is_valid;
+    uint16_t id;
+    uint16_t type;
+    uint16_t cmd;
+    uint16_t len;
+    uint32_t tick;
+    uint8_t data[MS_BR_RESP_CACHE_DATA_MAX];
+} ms_bridging_resp_cache_t;
+/// @brief Bridging batch request item
+typedef struct
+{
+    ms_bridging_frame_cmd_t cmd;    // request instruction
+    void *data;                     // request data, must stay valid until the batch returns
+    uint16_t len;                   // request data length
+    void *data_out;                 // response data (need to free by caller)
+    uint16_t len_out;               // response data length
+    int result;                     // Bridging error code of this item
+} ms_bridging_batch_item_t;
 /// @brief Bridging handler
 typedef struct 
 {
@@ -180,15 +238,29 @@ typedef struct
     uint32_t ack_frame_received_tick[MS_BR_FRAME_BUF_NUM];
 
     ms_bridging_frame_t notify_frame[MS_BR_FRAME_BUF_NUM];
+    uint8_t notify_head;            // Notify frames are dispatched in arrival order
+    uint8_t notify_tail;
     
     ms_bridging_send_func_t send_func;
     ms_bridging_notify_cb_t notify_cb;
 
+    volatile uint16_t window;       // 1 until the peer agreed to window mode
+    volatile uint16_t last_ack_id;
+    volatile uint8_t last_ack_valid;
+    uint8_t inflight_num;
+    ms_bridging_inflight_t inflight[MS_BR_WINDOW_SIZE];
+    ms_bridging_resp_cache_t resp_cache[MS_BR_RESP_CACHE_NUM];
+    uint8_t resp_cache_next;
 
 #if defined(MS_BR_SEM_CREATE) && defined(MS_BR_SEM_DELETE) && defined(MS_BR_SEM_WAIT) && defined(MS_BR_SEM_POST)
-    void *ack_sem;
     void *notify_sem;
 #endif
+#if defined(MS_BR_EVT_CREATE) && defined(MS_BR_EVT_DELETE) && defined(MS_BR_EVT_SET) && defined(MS_BR_EVT_CLEAR) && defined(MS_BR_EVT_WAIT)
+    void *ack_evt;                  // Bit n: ack for inflight[n], MS_BR_EVT_SLOT_FREE: a slot was released
+#endif
+#if defined(MS_BR_MUTEX_CREATE) && defined(MS_BR_MUTEX_DELETE) && defined(MS_BR_MUTEX_LOCK) && defined(MS_BR_MUTEX_UNLOCK)
+    void *lock;
+#endif
 } ms_bridging_handler_t;
 
 /// @brief Initialize the bridging handler
@@ -221,6 +293,18 @@ void ms_bridging_polling(ms_bridging_handler_t *handler);
 /// @return Bridging error code
 int ms_bridging_request(ms_bridging_handler_t *handler, ms_bridging_frame_cmd_t cmd, void *data, uint16_t len, void **data_out, uint16_t *len_out);
 
+/// @brief Issue several requests, pipelined up to the negotiated window
+/// @param handler bridging handler
+/// @param items requests, result and response are filled per item
+/// @param count number of items
+/// @return MS_BR_OK if every item succeeded, otherwise the first item error
+int ms_bridging_request_batch(ms_bridging_handler_t *handler, ms_bridging_batch_item_t *items, uint16_t count);
+
+/// @brief Ask the other party for window mode (old firmware does not answer and stays stop-and-wait)
+/// @param handler bridging handler
+/// @return Bridging error code, MS_BR_ERR_TIMEOUT when the peer only speaks stop-and-wait
+int ms_bridging_negotiate(ms_bridging_handler_t *handler);
+
 /// @brief Send a response to the other party
 /// @param handler bridging handler
 /// @param frame response frame